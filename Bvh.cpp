@@ -0,0 +1,777 @@
+#include "Bvh.h"
+#include "Simd.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+	using Aabb = Bvh::Aabb;
+
+	constexpr float Infinity = std::numeric_limits<float>::infinity();
+
+	// Proxy::slot of objects that are not in the tree
+	constexpr uint32_t NewSlot = ~0u;			// inserted since the last build
+	constexpr uint32_t FreeSlot = ~0u - 1u;		// the handle is on the free list
+	// Node::count of a node of the top of the tree that stands for a
+	// subtree still to be built; its offset is the subtree's task
+	constexpr uint32_t PendingSubtree = ~0u;
+
+	constexpr unsigned int BinCount = 16u;
+	// deeper than this splits fall back to the median, which bounds the
+	// depth (and the traversal stacks) by MaxSahDepth + log2(objects)
+	constexpr unsigned int MaxSahDepth = 64u;
+	constexpr unsigned int MaxStackDepth = 128u;
+	// ranges this large are binned on all threads
+	constexpr size_t ParallelBinSize = 65536u;
+	constexpr size_t BinGrain = 16384u;
+	// ranges below this are never split off as jobs of their own
+	constexpr size_t MinSubtreeSize = 1024u;
+	// the interior node weight of the SAH, relative to an object's
+	constexpr float TraversalCost = 1.0f;
+
+	// Boxes laid out like a Node (min, 4 bytes, max, 4 bytes) load as one
+	// SimdFloat with min in lanes 0-2 and max in lanes 4-6. Build and refit
+	// unite and measure them that way: as float[3] locals the compiler
+	// moves them through the stack in pieces too small to forward to the
+	// next load, which made refits five times slower.
+	template<class Box>
+	SimdFloat LoadBox(const Box& box) noexcept
+	{
+		static_assert(sizeof(Box) == 8u * sizeof(float), "laid out like a Node");
+		return SimdFloat::Load(reinterpret_cast<const float*>(&box));
+	}
+
+	SimdInt MaxLanes() noexcept
+	{
+		return CmpGt(SimdInt::Ramp(), SimdInt(3));
+	}
+
+	SimdFloat EmptySimdBox() noexcept
+	{
+		return Select(MaxLanes(), SimdFloat(Infinity), SimdFloat(-Infinity));
+	}
+
+	SimdFloat Unite(SimdFloat a, SimdFloat b) noexcept
+	{
+		return Select(MaxLanes(), Min(a, b), Max(a, b));
+	}
+
+	float HalfArea(SimdFloat box) noexcept
+	{
+		float extent[SimdWidth];
+		(SwapHalves(box) - box).Store(extent);
+		return extent[0] >= 0.0f && extent[1] >= 0.0f && extent[2] >= 0.0f ?
+			extent[0] * extent[1] + extent[1] * extent[2] + extent[2] * extent[0] : 0.0f;
+	}
+
+	Bvh::Aabb ToAabb(SimdFloat box) noexcept
+	{
+		float lanes[SimdWidth];
+		box.Store(lanes);
+		return { { lanes[0], lanes[1], lanes[2] }, { lanes[4], lanes[5], lanes[6] } };
+	}
+
+	template<class Box>
+	bool Overlaps(const Box& a, const Aabb& b) noexcept
+	{
+		return a.min[0] <= b.max[0] && a.max[0] >= b.min[0] &&
+			   a.min[1] <= b.max[1] && a.max[1] >= b.min[1] &&
+			   a.min[2] <= b.max[2] && a.max[2] >= b.min[2];
+	}
+
+	template<class Box>
+	float SquaredDistance(const Box& box, const float p[3]) noexcept
+	{
+		float d2 = 0.0f;
+		for (int i = 0; i < 3; i++)
+		{
+			const float d = std::max({ box.min[i] - p[i], 0.0f, p[i] - box.max[i] });
+			d2 += d * d;
+		}
+		return d2;
+	}
+
+	// -1 outside, 0 crossing a plane, 1 inside all of them
+	template<class Box>
+	int Classify(const FrustumCuller::Frustum& frustum, const Box& box) noexcept
+	{
+		int result = 1;
+		for (const FrustumCuller::Plane& plane : frustum.planes)
+		{
+			float distance = plane.d;
+			float reach = 0.0f;
+			for (int i = 0; i < 3; i++)
+			{
+				distance += plane.normal[i] * 0.5f * (box.min[i] + box.max[i]);
+				reach += std::fabs(plane.normal[i]) * 0.5f * (box.max[i] - box.min[i]);
+			}
+			if (distance < -reach)
+			{
+				return -1;
+			}
+			if (distance < reach)
+			{
+				result = 0;
+			}
+		}
+		return result;
+	}
+
+	// where the ray enters the box, Infinity if it misses it before maxDistance
+	template<class Box>
+	float RayEntry(const Box& box, const float origin[3], const float invDirection[3], float maxDistance) noexcept
+	{
+		float entry = 0.0f;
+		float exit = maxDistance;
+		for (int i = 0; i < 3; i++)
+		{
+			const float t0 = (box.min[i] - origin[i]) * invDirection[i];
+			const float t1 = (box.max[i] - origin[i]) * invDirection[i];
+			entry = std::max(entry, std::min(t0, t1));
+			exit = std::min(exit, std::max(t0, t1));
+		}
+		return entry <= exit ? entry : Infinity;
+	}
+}
+
+// Binned SAH construction. The objects are copied to an array of
+// references that the splits partition in place, so every pass over a
+// range streams through memory. Ranges are only ever touched by the job
+// building them, so subtrees can be built concurrently.
+class Bvh::Builder
+{
+public:
+	// laid out like a Node
+	struct Reference
+	{
+		float		min[3];
+		uint32_t	proxy;
+		float		max[3];
+		uint32_t	unused;
+	};
+
+	struct Task
+	{
+		uint32_t	begin;
+		uint32_t	end;
+		unsigned	depth;
+	};
+
+public:
+	Builder(std::vector<Reference>& references, JobSystem& jobs) noexcept
+		: references(references), jobs(jobs)
+	{
+	}
+
+	// Appends the subtree of references[begin,end) to nodes, depth first.
+	// With pTasks, ranges of at most subtreeSize objects are left as
+	// PendingSubtree nodes and queued instead.
+	void Build(std::vector<Node>& nodes, uint32_t begin, uint32_t end, unsigned depth,
+			   size_t subtreeSize, std::vector<Task>* pTasks, unsigned& maxDepth)
+	{
+		const uint32_t index = uint32_t(nodes.size());
+		nodes.emplace_back();
+		if (pTasks && end - begin <= subtreeSize)
+		{
+			nodes[index].count = PendingSubtree;
+			nodes[index].offset = uint32_t(pTasks->size());
+			pTasks->push_back({ begin, end, depth });
+			return;
+		}
+
+		SimdFloat bounds;
+		SimdFloat centers;
+		ComputeBounds(begin, end, bounds, centers);
+		// offset and count are written below
+		bounds.Store(reinterpret_cast<float*>(&nodes[index]));
+		maxDepth = std::max(maxDepth, depth);
+
+		const uint32_t middle = Split(begin, end, depth, bounds, centers);
+		if (middle == begin)
+		{
+			nodes[index].offset = begin;
+			nodes[index].count = end - begin;
+			return;
+		}
+		Build(nodes, begin, middle, depth + 1u, subtreeSize, pTasks, maxDepth);
+		nodes[index].offset = uint32_t(nodes.size());
+		nodes[index].count = 0u;
+		Build(nodes, middle, end, depth + 1u, subtreeSize, pTasks, maxDepth);
+	}
+
+private:
+	struct Bin
+	{
+		SimdFloat	bounds	{ EmptySimdBox() };
+		uint32_t	count	{ 0u };
+	};
+	using Bins = std::array<Bin, BinCount>;
+
+	// twice the center of a box along axis, min + max
+	static float Center2(const Reference& reference, int axis) noexcept
+	{
+		return reference.min[axis] + reference.max[axis];
+	}
+
+	// the box of references[begin,end) and the box of their centers, the
+	// latter doubled: min + max of every reference
+	void ComputeBounds(uint32_t begin, uint32_t end, SimdFloat& bounds, SimdFloat& centers)
+	{
+		auto accumulate = [&](size_t first, size_t last, SimdFloat& boxes, SimdFloat& points)
+		{
+			for (size_t i = first; i < last; i++)
+			{
+				const SimdFloat box = LoadBox(references[i]);
+				boxes = Unite(boxes, box);
+				points = Unite(points, box + SwapHalves(box));
+			}
+		};
+
+		bounds = EmptySimdBox();
+		centers = EmptySimdBox();
+		if (end - begin < ParallelBinSize)
+		{
+			accumulate(begin, end, bounds, centers);
+			return;
+		}
+		std::vector<std::pair<SimdFloat, SimdFloat>> chunks((end - begin + BinGrain - 1u) / BinGrain, { EmptySimdBox(), EmptySimdBox() });
+		jobs.ParallelFor(end - begin, BinGrain, [&](size_t first, size_t last, unsigned int)
+		{
+			auto& chunk = chunks[first / BinGrain];
+			accumulate(begin + first, begin + last, chunk.first, chunk.second);
+		});
+		for (const auto& chunk : chunks)
+		{
+			bounds = Unite(bounds, chunk.first);
+			centers = Unite(centers, chunk.second);
+		}
+	}
+
+	// where references[begin,end) is split, begin for a leaf
+	uint32_t Split(uint32_t begin, uint32_t end, unsigned depth, SimdFloat bounds, SimdFloat doubledCenters)
+	{
+		const uint32_t count = end - begin;
+		if (count <= 1u)
+		{
+			return begin;
+		}
+		const Aabb centers = ToAabb(doubledCenters);
+		int axis = 0;
+		for (int i = 1; i < 3; i++)
+		{
+			if (centers.max[i] - centers.min[i] > centers.max[axis] - centers.min[axis])
+			{
+				axis = i;
+			}
+		}
+		const float extent = centers.max[axis] - centers.min[axis];
+		if (!(extent > 0.0f))
+		{
+			// all centers in one point: no split tells them apart
+			return count <= MaxLeafSize ? begin : begin + count / 2u;
+		}
+		if (depth >= MaxSahDepth)
+		{
+			const uint32_t middle = begin + count / 2u;
+			std::nth_element(references.begin() + begin, references.begin() + middle, references.begin() + end,
+				[&](const Reference& a, const Reference& b)
+			{
+				return Center2(a, axis) < Center2(b, axis);
+			});
+			return middle;
+		}
+
+		// small ranges have no use for more bins than objects
+		const unsigned binCount = std::min(BinCount, count);
+		const float origin = centers.min[axis];
+		const float scale = float(binCount) * (1.0f - 1e-6f) / extent;
+		auto binOf = [&](const Reference& reference)
+		{
+			return std::min(unsigned((Center2(reference, axis) - origin) * scale), binCount - 1u);
+		};
+		auto fill = [&](size_t first, size_t last, Bins& bins)
+		{
+			for (size_t i = first; i < last; i++)
+			{
+				Bin& bin = bins[binOf(references[i])];
+				bin.bounds = Unite(bin.bounds, LoadBox(references[i]));
+				bin.count++;
+			}
+		};
+
+		Bins bins;
+		if (count < ParallelBinSize)
+		{
+			fill(begin, end, bins);
+		}
+		else
+		{
+			std::vector<Bins> chunks((count + BinGrain - 1u) / BinGrain);
+			jobs.ParallelFor(count, BinGrain, [&](size_t first, size_t last, unsigned int)
+			{
+				fill(begin + first, begin + last, chunks[first / BinGrain]);
+			});
+			for (const Bins& chunk : chunks)
+			{
+				for (unsigned b = 0u; b < binCount; b++)
+				{
+					bins[b].bounds = Unite(bins[b].bounds, chunk[b].bounds);
+					bins[b].count += chunk[b].count;
+				}
+			}
+		}
+
+		// cost of splitting after bin s - 1, as area * count of both sides
+		std::array<float, BinCount> rightCost{};
+		SimdFloat right = EmptySimdBox();
+		uint32_t rightCount = 0u;
+		for (unsigned s = binCount - 1u; s > 0u; s--)
+		{
+			right = Unite(right, bins[s].bounds);
+			rightCount += bins[s].count;
+			rightCost[s] = HalfArea(right) * float(rightCount);
+		}
+		float bestCost = Infinity;
+		unsigned bestSplit = 0u;
+		SimdFloat left = EmptySimdBox();
+		uint32_t leftCount = 0u;
+		for (unsigned s = 1u; s < binCount; s++)
+		{
+			left = Unite(left, bins[s - 1u].bounds);
+			leftCount += bins[s - 1u].count;
+			const float cost = HalfArea(left) * float(leftCount) + rightCost[s];
+			if (leftCount > 0u && leftCount < count && cost < bestCost)
+			{
+				bestCost = cost;
+				bestSplit = s;
+			}
+		}
+		const float area = HalfArea(bounds);
+		if (count <= MaxLeafSize && area * float(count) <= TraversalCost * area + bestCost)
+		{
+			return begin;
+		}
+
+		const uint32_t middle = uint32_t(std::partition(references.begin() + begin, references.begin() + end,
+			[&](const Reference& reference)
+		{
+			return binOf(reference) < bestSplit;
+		}) - references.begin());
+		// only without a usable split (boxes so large their areas overflow)
+		return middle != begin && middle != end ? middle : begin + count / 2u;
+	}
+
+private:
+	std::vector<Reference>&	references;
+	JobSystem&				jobs;
+};
+
+Bvh::Bvh(JobSystem& jobs)
+	: jobs(jobs)
+{
+}
+
+Bvh::Handle Bvh::Insert(uint32_t id, const Aabb& bounds)
+{
+	Handle handle;
+	if (!freeHandles.empty())
+	{
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+	}
+	else
+	{
+		handle = Handle(proxies.size());
+		proxies.emplace_back();
+	}
+	proxies[handle] = { bounds, id, NewSlot };
+	inserted = true;
+	return handle;
+}
+
+void Bvh::Remove(Handle handle) noexcept
+{
+	Proxy& proxy = proxies[handle];
+	if (proxy.slot < FreeSlot)
+	{
+		objectBounds[proxy.slot] = { { Infinity, Infinity, Infinity }, 0u, { -Infinity, -Infinity, -Infinity }, 0u };
+		objectHandles[proxy.slot] = InvalidHandle;
+		removed++;
+		changed = true;
+	}
+	proxy.slot = FreeSlot;
+	freeHandles.push_back(handle);
+}
+
+void Bvh::Move(Handle handle, const Aabb& bounds) noexcept
+{
+	Proxy& proxy = proxies[handle];
+	proxy.bounds = bounds;
+	if (proxy.slot < FreeSlot)
+	{
+		objectBounds[proxy.slot] = { { bounds.min[0], bounds.min[1], bounds.min[2] }, 0u,
+									 { bounds.max[0], bounds.max[1], bounds.max[2] }, 0u };
+		changed = true;
+	}
+}
+
+void Bvh::Update()
+{
+	if (inserted || removed * 4u > objectIds.size())
+	{
+		Rebuild();
+		return;
+	}
+	if (!changed)
+	{
+		return;
+	}
+	const auto start = std::chrono::steady_clock::now();
+	stats.sahCost = Refit();
+	stats.refits++;
+	stats.lastRefitSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	changed = false;
+	if (stats.sahCost > RebuildCostRatio * stats.builtSahCost)
+	{
+		Rebuild();
+	}
+}
+
+void Bvh::Rebuild()
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	std::vector<Builder::Reference> references;
+	references.reserve(GetObjectCount());
+	for (uint32_t handle = 0u; handle < proxies.size(); handle++)
+	{
+		if (proxies[handle].slot != FreeSlot)
+		{
+			const Aabb& box = proxies[handle].bounds;
+			references.push_back({ { box.min[0], box.min[1], box.min[2] }, handle, { box.max[0], box.max[1], box.max[2] }, 0u });
+		}
+	}
+
+	// the top of the tree here, the subtrees below it on all threads; a few
+	// subtrees per thread even out their different costs
+	Builder builder(references, jobs);
+	const size_t subtreeSize = std::max(MinSubtreeSize, references.size() / (4u * jobs.GetThreadCount()));
+	std::vector<Node> top;
+	std::vector<Builder::Task> tasks;
+	unsigned depth = 0u;
+	if (!references.empty())
+	{
+		builder.Build(top, 0u, uint32_t(references.size()), 0u, subtreeSize, &tasks, depth);
+	}
+	std::vector<std::vector<Node>> built(tasks.size());
+	std::vector<unsigned> builtDepth(tasks.size(), 0u);
+	jobs.ParallelFor(tasks.size(), 1u, [&](size_t begin, size_t end, unsigned int)
+	{
+		for (size_t t = begin; t < end; t++)
+		{
+			builder.Build(built[t], tasks[t].begin, tasks[t].end, tasks[t].depth, 0u, nullptr, builtDepth[t]);
+		}
+	});
+
+	// splice the subtrees into the top, depth first; the second child
+	// indices of both move by where their part lands
+	std::vector<uint32_t> position(top.size());
+	size_t nodeCount = 0u;
+	for (size_t i = 0u; i < top.size(); i++)
+	{
+		position[i] = uint32_t(nodeCount);
+		nodeCount += top[i].count == PendingSubtree ? built[top[i].offset].size() : 1u;
+	}
+	nodes.resize(nodeCount);
+	topNodes.clear();
+	subtrees.clear();
+	for (size_t i = 0u; i < top.size(); i++)
+	{
+		Node node = top[i];
+		if (node.count == PendingSubtree)
+		{
+			const std::vector<Node>& subtree = built[node.offset];
+			const uint32_t base = position[i];
+			for (size_t n = 0u; n < subtree.size(); n++)
+			{
+				Node& out = nodes[base + n];
+				out = subtree[n];
+				if (out.count == 0u)
+				{
+					out.offset += base;
+				}
+			}
+			subtrees.push_back({ base, base + uint32_t(subtree.size()) });
+			continue;
+		}
+		if (node.count == 0u)
+		{
+			node.offset = position[node.offset];
+		}
+		nodes[position[i]] = node;
+		topNodes.push_back(position[i]);
+	}
+	std::reverse(topNodes.begin(), topNodes.end());
+
+	// the objects in leaf order
+	objectBounds.resize(references.size());
+	objectIds.resize(references.size());
+	objectHandles.resize(references.size());
+	for (uint32_t slot = 0u; slot < references.size(); slot++)
+	{
+		const Builder::Reference& reference = references[slot];
+		Proxy& proxy = proxies[reference.proxy];
+		objectBounds[slot] = { { reference.min[0], reference.min[1], reference.min[2] }, 0u,
+							   { reference.max[0], reference.max[1], reference.max[2] }, 0u };
+		objectIds[slot] = proxy.id;
+		objectHandles[slot] = reference.proxy;
+		proxy.slot = slot;
+	}
+	inserted = false;
+	changed = false;
+	removed = 0u;
+
+	stats.nodes = nodes.size();
+	stats.leaves = size_t(std::count_if(nodes.begin(), nodes.end(), [](const Node& node) { return node.count != 0u; }));
+	stats.depth = std::max(depth, builtDepth.empty() ? 0u : *std::max_element(builtDepth.begin(), builtDepth.end()));
+	// a refit of the fresh tree changes no box, it only adds up the cost
+	stats.sahCost = Refit();
+	stats.builtSahCost = stats.sahCost;
+	stats.builds++;
+	stats.lastBuildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+float Bvh::Refit()
+{
+	// offset and count (lanes 3 and 7 of a node) are kept
+	const SimdInt linkLanes = CmpEq(SimdInt::Ramp() & SimdInt(3), SimdInt(3));
+	// returns the node's share of the SAH cost, times the root's area
+	auto refit = [&](uint32_t index)
+	{
+		Node& node = nodes[index];
+		SimdFloat box;
+		if (node.count != 0u)
+		{
+			box = EmptySimdBox();
+			for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+			{
+				box = Unite(box, LoadBox(objectBounds[i]));
+			}
+		}
+		else
+		{
+			box = Unite(LoadBox(nodes[index + 1u]), LoadBox(nodes[node.offset]));
+		}
+		Select(linkLanes, box, LoadBox(node)).Store(reinterpret_cast<float*>(&node));
+		return double(HalfArea(box)) * (node.count != 0u ? double(node.count) : double(TraversalCost));
+	};
+
+	// children come after their parents: every subtree backwards, then the top
+	std::vector<double> subtreeCost(subtrees.size(), 0.0);
+	jobs.ParallelFor(subtrees.size(), 1u, [&](size_t begin, size_t end, unsigned int)
+	{
+		for (size_t s = begin; s < end; s++)
+		{
+			double cost = 0.0;
+			for (uint32_t i = subtrees[s].endNode; i-- > subtrees[s].firstNode;)
+			{
+				cost += refit(i);
+			}
+			subtreeCost[s] = cost;
+		}
+	});
+	double cost = 0.0;
+	for (const double c : subtreeCost)
+	{
+		cost += c;
+	}
+	for (const uint32_t index : topNodes)
+	{
+		cost += refit(index);
+	}
+
+	const float rootArea = nodes.empty() ? 0.0f : HalfArea(LoadBox(nodes[0]));
+	return rootArea > 0.0f ? float(cost / rootArea) : 0.0f;
+}
+
+void Bvh::QueryFrustum(const FrustumCuller::Frustum& frustum, std::vector<uint32_t>& ids) const
+{
+	if (nodes.empty())
+	{
+		return;
+	}
+	// nodes known to be inside the frustum carry InsideFlag; nothing
+	// below them needs testing
+	constexpr uint32_t InsideFlag = 0x80000000u;
+	uint32_t stack[MaxStackDepth];
+	size_t size = 0u;
+	stack[size++] = 0u;
+	while (size > 0u)
+	{
+		const uint32_t entry = stack[--size];
+		const uint32_t index = entry & ~InsideFlag;
+		const Node& node = nodes[index];
+		bool inside = (entry & InsideFlag) != 0u;
+		if (!inside)
+		{
+			const int side = Classify(frustum, node);
+			if (side < 0)
+			{
+				continue;
+			}
+			inside = side > 0;
+		}
+		if (node.count == 0u)
+		{
+			const uint32_t flag = inside ? InsideFlag : 0u;
+			stack[size++] = node.offset | flag;
+			stack[size++] = (index + 1u) | flag;
+			continue;
+		}
+		for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+		{
+			if (objectHandles[i] != InvalidHandle && (inside || Classify(frustum, objectBounds[i]) >= 0))
+			{
+				ids.push_back(objectIds[i]);
+			}
+		}
+	}
+}
+
+void Bvh::QueryBox(const Aabb& box, std::vector<uint32_t>& ids) const
+{
+	if (nodes.empty())
+	{
+		return;
+	}
+	uint32_t stack[MaxStackDepth];
+	size_t size = 0u;
+	stack[size++] = 0u;
+	while (size > 0u)
+	{
+		const uint32_t index = stack[--size];
+		const Node& node = nodes[index];
+		if (!Overlaps(node, box))
+		{
+			continue;
+		}
+		if (node.count == 0u)
+		{
+			stack[size++] = node.offset;
+			stack[size++] = index + 1u;
+			continue;
+		}
+		for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+		{
+			if (objectHandles[i] != InvalidHandle && Overlaps(objectBounds[i], box))
+			{
+				ids.push_back(objectIds[i]);
+			}
+		}
+	}
+}
+
+void Bvh::QuerySphere(const float center[3], float radius, std::vector<uint32_t>& ids) const
+{
+	if (nodes.empty())
+	{
+		return;
+	}
+	const float radius2 = radius * radius;
+	uint32_t stack[MaxStackDepth];
+	size_t size = 0u;
+	stack[size++] = 0u;
+	while (size > 0u)
+	{
+		const uint32_t index = stack[--size];
+		const Node& node = nodes[index];
+		if (SquaredDistance(node, center) > radius2)
+		{
+			continue;
+		}
+		if (node.count == 0u)
+		{
+			stack[size++] = node.offset;
+			stack[size++] = index + 1u;
+			continue;
+		}
+		for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+		{
+			if (objectHandles[i] != InvalidHandle && SquaredDistance(objectBounds[i], center) <= radius2)
+			{
+				ids.push_back(objectIds[i]);
+			}
+		}
+	}
+}
+
+std::optional<Bvh::RayHit> Bvh::Raycast(const float origin[3], const float direction[3], float maxDistance,
+										const RayFunction& hitObject) const
+{
+	if (nodes.empty())
+	{
+		return std::nullopt;
+	}
+	const float invDirection[3] = { 1.0f / direction[0], 1.0f / direction[1], 1.0f / direction[2] };
+
+	// nearest first: of two children the farther one is pushed first, and
+	// nodes entered beyond the closest hit are skipped when popped
+	struct Entry
+	{
+		uint32_t	node;
+		float		distance;
+	};
+	Entry stack[MaxStackDepth];
+	size_t size = 0u;
+	float closest = maxDistance;
+	std::optional<RayHit> hit;
+	stack[size++] = { 0u, RayEntry(nodes[0], origin, invDirection, closest) };
+	while (size > 0u)
+	{
+		const Entry entry = stack[--size];
+		if (entry.distance >= closest)
+		{
+			continue;
+		}
+		const Node& node = nodes[entry.node];
+		if (node.count == 0u)
+		{
+			Entry first = { entry.node + 1u, RayEntry(nodes[entry.node + 1u], origin, invDirection, closest) };
+			Entry second = { node.offset, RayEntry(nodes[node.offset], origin, invDirection, closest) };
+			if (second.distance < first.distance)
+			{
+				std::swap(first, second);
+			}
+			if (second.distance < closest)
+			{
+				stack[size++] = second;
+			}
+			if (first.distance < closest)
+			{
+				stack[size++] = first;
+			}
+			continue;
+		}
+		for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+		{
+			if (objectHandles[i] == InvalidHandle)
+			{
+				continue;
+			}
+			float distance = RayEntry(objectBounds[i], origin, invDirection, closest);
+			if (distance < closest && hitObject)
+			{
+				distance = hitObject(objectIds[i], closest);
+			}
+			if (distance < closest)
+			{
+				closest = distance;
+				hit = RayHit{ objectIds[i], distance };
+			}
+		}
+	}
+	return hit;
+}
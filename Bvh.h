@@ -0,0 +1,152 @@
+#pragma once
+#include "FrustumCuller.h"
+#include "JobSystem.h"
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+
+// Bounding volume hierarchy over the bounding boxes of the scene objects,
+// the spatial index behind culling, picking and proximity queries.
+//
+// Objects are inserted, moved and removed at any time through a Handle;
+// the tree catches up in Update(), once per frame:
+//	- moves and removes only refit it: the node boxes are recomputed
+//	  bottom up, the tree keeps its shape (removed objects leave a hole);
+//	- inserts, too many holes or a refit tree whose SAH cost grew past
+//	  RebuildCostRatio times its cost when built trigger a rebuild.
+// Queries see the tree as of the last Update().
+//
+// Builds are binned SAH (Wald, "On fast Construction of SAH-based Bounding
+// Volume Hierarchies", 2007). The top of the tree is split on the calling
+// thread with the binning spread over the JobSystem, the subtrees below it
+// are built on the workers. The result does not depend on the thread count.
+//
+// Nodes are 32 bytes in one array in depth first order: the first child of
+// an interior node is the next node, the node stores the index of the
+// second. Objects sit in leaf order, so every leaf, and every subtree,
+// holds a contiguous range of them.
+class Bvh
+{
+public:
+	using Handle = uint32_t;
+	static constexpr Handle InvalidHandle = ~0u;
+
+	struct Aabb
+	{
+		float min[3];
+		float max[3];
+	};
+
+	struct RayHit
+	{
+		uint32_t	id;
+		float		distance;
+	};
+	// the distance along the ray at which object id is hit (its triangles,
+	// ...), anything >= maxDistance for a miss
+	using RayFunction = std::function<float(uint32_t id, float maxDistance)>;
+
+	struct Stats
+	{
+		uint64_t	builds				{ 0u };
+		uint64_t	refits				{ 0u };
+		double		lastBuildSeconds	{ 0.0 };
+		double		lastRefitSeconds	{ 0.0 };
+		// of the current tree
+		size_t		nodes				{ 0u };
+		size_t		leaves				{ 0u };
+		unsigned	depth				{ 0u };
+		float		sahCost				{ 0.0f };	// relative to the root box
+		float		builtSahCost		{ 0.0f };	// right after the last build
+	};
+
+	static constexpr unsigned int	MaxLeafSize			= 8u;
+	static constexpr float			RebuildCostRatio	= 1.5f;
+
+public:
+	explicit Bvh(JobSystem& jobs);
+	Bvh(const Bvh&) = delete;
+	Bvh& operator=(const Bvh&) = delete;
+
+	// id is what queries report for the object
+	Handle	Insert(uint32_t id, const Aabb& bounds);
+	void	Remove(Handle handle) noexcept;
+	void	Move(Handle handle, const Aabb& bounds) noexcept;
+	// brings the tree up to date with the changes since the last call
+	void	Update();
+	void	Rebuild();
+
+	// append the ids of the objects whose boxes intersect the volume
+	void	QueryFrustum(const FrustumCuller::Frustum& frustum, std::vector<uint32_t>& ids) const;
+	void	QueryBox(const Aabb& box, std::vector<uint32_t>& ids) const;
+	void	QuerySphere(const float center[3], float radius, std::vector<uint32_t>& ids) const;
+	// closest hit along origin + t * direction, 0 <= t < maxDistance; with
+	// no hitObject the boxes themselves are hit
+	std::optional<RayHit>	Raycast(const float origin[3], const float direction[3], float maxDistance,
+									const RayFunction& hitObject = {}) const;
+
+	size_t			GetObjectCount()	const noexcept { return proxies.size() - freeHandles.size(); }
+	const Stats&	GetStats()			const noexcept { return stats; }
+
+private:
+	struct Node
+	{
+		float		min[3];
+		// interior: index of the second child; leaf: first object
+		uint32_t	offset;
+		float		max[3];
+		// objects of a leaf, 0 for interior nodes
+		uint32_t	count;
+	};
+	static_assert(sizeof(Node) == 32u, "two nodes per cache line");
+
+	// an Aabb laid out like a Node, see LoadBox() in Bvh.cpp
+	struct PaddedBox
+	{
+		float		min[3];
+		uint32_t	unused0;
+		float		max[3];
+		uint32_t	unused1;
+	};
+
+	struct Proxy
+	{
+		Aabb		bounds;
+		uint32_t	id;
+		uint32_t	slot;	// in the leaf order, or one of the *Slot values
+	};
+
+	// a [first,end) range of nodes built as one job
+	struct Subtree
+	{
+		uint32_t	firstNode;
+		uint32_t	endNode;
+	};
+
+	class Builder;
+
+	// recomputes the node boxes, returns the SAH cost
+	float	Refit();
+
+private:
+	JobSystem&	jobs;
+
+	std::vector<Proxy>	proxies;
+	std::vector<Handle>	freeHandles;
+
+	std::vector<Node>		nodes;
+	// the objects in leaf order; removed ones have no handle and an empty box
+	std::vector<PaddedBox>	objectBounds;
+	std::vector<uint32_t>	objectIds;
+	std::vector<Handle>		objectHandles;
+	// the tree above the subtrees, in reverse depth first order
+	std::vector<uint32_t>	topNodes;
+	std::vector<Subtree>	subtrees;
+
+	bool	inserted	{ false };
+	bool	changed		{ false };
+	size_t	removed		{ 0u };	// holes since the last build
+
+	Stats	stats;
+};
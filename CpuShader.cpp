@@ -0,0 +1,154 @@
+#include "CpuShader.h"
+
+namespace
+{
+	// VertexShader.hlsl
+	//	VSOut main(float2 pos : Position, float3 color : Color)
+	//	{
+	//		vso.pos = float4(pos.x, pos.y, 0.0f, 1.0f);
+	//		vso.color = color;
+	//	}
+	void VertexShaderMain(const CpuVertexInput& in, CpuVertexOutput& out) noexcept
+	{
+		const SimdFloat* pos = in.attributes[0];
+		const SimdFloat* color = in.attributes[1];
+		out.position[0] = pos[0];
+		out.position[1] = pos[1];
+		out.position[2] = SimdFloat(0.0f);
+		out.position[3] = SimdFloat(1.0f);
+		out.varyings[0] = color[0];
+		out.varyings[1] = color[1];
+		out.varyings[2] = color[2];
+	}
+
+	// InstancedVertexShader.hlsl
+	//	VSOut main(float2 pos : Position, float3 color : Color,
+	//			   float4 transform0 : Transform0, float4 transform1 : Transform1, float4 transform2 : Transform2,
+	//			   float4 tint : InstanceColor)
+	//	{
+	//		const float4 p = float4(pos.x, pos.y, 0.0f, 1.0f);
+	//		vso.pos = float4(dot(transform0, p), dot(transform1, p), dot(transform2, p), 1.0f);
+	//		vso.color = color * tint.rgb;
+	//	}
+	void InstancedVertexShaderMain(const CpuVertexInput& in, CpuVertexOutput& out) noexcept
+	{
+		const SimdFloat* pos = in.attributes[0];
+		const SimdFloat* color = in.attributes[1];
+		const SimdFloat* tint = in.attributes[5];
+		for (int row = 0; row < 3; row++)
+		{
+			const SimdFloat* transform = in.attributes[2 + row];
+			out.position[row] = MulAdd(transform[0], pos[0], MulAdd(transform[1], pos[1], transform[3]));
+		}
+		out.position[3] = SimdFloat(1.0f);
+		out.varyings[0] = color[0] * tint[0];
+		out.varyings[1] = color[1] * tint[1];
+		out.varyings[2] = color[2] * tint[2];
+	}
+
+	// PixelShader.hlsl
+	//	float4 main(float3 color : Color) : SV_Target
+	//	{
+	//		return float4(color, 1.0f);
+	//	}
+	void PixelShaderMain(const CpuPixelInput& in, CpuPixelOutput& out) noexcept
+	{
+		out.color[0] = in.varyings[0];
+		out.color[1] = in.varyings[1];
+		out.color[2] = in.varyings[2];
+		out.color[3] = SimdFloat(1.0f);
+	}
+
+	CpuVertexShader MakeVertexShader()
+	{
+		CpuVertexShader vs;
+		vs.inputSemantics[0] = "Position";
+		vs.inputSemantics[1] = "Color";
+		vs.inputCount = 2u;
+		vs.varyingCount = 3u;
+		vs.main = &VertexShaderMain;
+		return vs;
+	}
+
+	CpuVertexShader MakeInstancedVertexShader()
+	{
+		CpuVertexShader vs;
+		const char* semantics[] = { "Position", "Color", "Transform", "Transform", "Transform", "InstanceColor" };
+		const unsigned int indices[] = { 0u, 0u, 0u, 1u, 2u, 0u };
+		for (unsigned int i = 0; i < 6u; i++)
+		{
+			vs.inputSemantics[i] = semantics[i];
+			vs.inputSemanticIndices[i] = indices[i];
+		}
+		vs.inputCount = 6u;
+		vs.varyingCount = 3u;
+		vs.main = &InstancedVertexShaderMain;
+		return vs;
+	}
+
+	CpuPixelShader MakePixelShader()
+	{
+		CpuPixelShader ps;
+		ps.varyingCount = 3u;
+		ps.main = &PixelShaderMain;
+		return ps;
+	}
+}
+
+const CpuVertexShader* CpuShaderRegistry::FindVertexShader(const char* name)
+{
+	auto& shaders = VertexShaders();
+	const auto it = shaders.find(StripName(name));
+	return it != shaders.end() ? &it->second : nullptr;
+}
+
+const CpuPixelShader* CpuShaderRegistry::FindPixelShader(const char* name)
+{
+	auto& shaders = PixelShaders();
+	const auto it = shaders.find(StripName(name));
+	return it != shaders.end() ? &it->second : nullptr;
+}
+
+void CpuShaderRegistry::RegisterVertexShader(const std::string& name, const CpuVertexShader& shader)
+{
+	VertexShaders()[name] = shader;
+}
+
+void CpuShaderRegistry::RegisterPixelShader(const std::string& name, const CpuPixelShader& shader)
+{
+	PixelShaders()[name] = shader;
+}
+
+std::string CpuShaderRegistry::StripName(const char* name)
+{
+	if (!name)
+	{
+		return {};
+	}
+	std::string stem(name);
+	if (const size_t slash = stem.find_last_of("/\\"); slash != std::string::npos)
+	{
+		stem.erase(0, slash + 1);
+	}
+	if (const size_t dot = stem.find_last_of('.'); dot != std::string::npos)
+	{
+		stem.erase(dot);
+	}
+	return stem;
+}
+
+std::unordered_map<std::string, CpuVertexShader>& CpuShaderRegistry::VertexShaders()
+{
+	static std::unordered_map<std::string, CpuVertexShader> shaders =
+	{
+		{ "VertexShader", MakeVertexShader() },
+		{ "InstancedVertexShader", MakeInstancedVertexShader() },
+	};
+	return shaders;
+}
+
+std::unordered_map<std::string, CpuPixelShader>& CpuShaderRegistry::PixelShaders()
+{
+	static std::unordered_map<std::string, CpuPixelShader> shaders = { { "PixelShader", MakePixelShader() } };
+	return shaders;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include "Simd.h"
+#include <string>
+#include <unordered_map>
+
+// C++ ports of our HLSL shaders for the SoftwareRenderDevice.
+//
+// A CPU shader processes SimdWidth (8) vertices or pixels per call in SoA
+// form: every register below holds one component for all 8 lanes, so a
+// shader body is the HLSL code written with SimdFloat and runs at a few
+// instructions per lane instead of one call per vertex/pixel.
+//
+// The software device cannot execute bytecode. It looks the C++ port up by
+// the name the bytecode was loaded under (ShaderBytecode::name), so
+// "VertexShader.cso" runs the shader registered as "VertexShader".
+
+constexpr int CpuShaderMaxInputs	= 8;	// vertex shader input elements
+constexpr int CpuShaderMaxVaryings	= 8;	// floats passed from vertex to pixel stage
+
+struct CpuVertexInput
+{
+	// [input][component]; inputs are in CpuVertexShader::inputSemantics
+	// order, missing components are filled in as (0,0,0,1)
+	SimdFloat attributes[CpuShaderMaxInputs][4];
+};
+
+struct CpuVertexOutput
+{
+	SimdFloat position[4];	// SV_Position, clip space
+	SimdFloat varyings[CpuShaderMaxVaryings];
+};
+
+struct CpuPixelInput
+{
+	SimdFloat position[2];	// SV_Position.xy, pixel centers
+	SimdFloat varyings[CpuShaderMaxVaryings];	// perspective-correct
+};
+
+struct CpuPixelOutput
+{
+	SimdFloat color[4];		// SV_Target, rgba
+};
+
+struct CpuVertexShader
+{
+	// input semantics the shader reads, like the input signature of the
+	// compiled shader
+	const char*		inputSemantics[CpuShaderMaxInputs] {};
+	unsigned int	inputSemanticIndices[CpuShaderMaxInputs] {};
+	unsigned int	inputCount		{ 0u };
+	// output varyings are linked to the pixel shader by position
+	unsigned int	varyingCount	{ 0u };
+	void			(*main)(const CpuVertexInput& in, CpuVertexOutput& out) noexcept { nullptr };
+};
+
+struct CpuPixelShader
+{
+	unsigned int	varyingCount	{ 0u };
+	void			(*main)(const CpuPixelInput& in, CpuPixelOutput& out) noexcept { nullptr };
+};
+
+// Name -> shader lookup. The ports of the shaders in the repo are registered
+// up front; more can be added at startup, before any device creates shaders.
+class CpuShaderRegistry
+{
+public:
+	// accepts a path ("shaders/VertexShader.cso") or a bare name ("VertexShader");
+	// returns nullptr when no port is registered under that name
+	static const CpuVertexShader*	FindVertexShader(const char* name);
+	static const CpuPixelShader*	FindPixelShader(const char* name);
+
+	static void RegisterVertexShader(const std::string& name, const CpuVertexShader& shader);
+	static void RegisterPixelShader(const std::string& name, const CpuPixelShader& shader);
+
+private:
+	static std::string StripName(const char* name);
+	static std::unordered_map<std::string, CpuVertexShader>&	VertexShaders();
+	static std::unordered_map<std::string, CpuPixelShader>&		PixelShaders();
+};
@@ -0,0 +1,590 @@
+#include "D3D11RenderDevice.h"
+#include "Graphics.h"
+#include "GraphicsThrowMacros.h"
+#include <iterator>
+
+#pragma comment(lib,"d3d11.lib")
+
+namespace wrl = Microsoft::WRL;
+
+// argument buffers are filled on the CPU and read by the GPU as is
+static_assert(sizeof(DrawIndexedIndirectArgs) == sizeof(D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS) &&
+			  offsetof(DrawIndexedIndirectArgs, instanceCount) == offsetof(D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS, InstanceCount) &&
+			  offsetof(DrawIndexedIndirectArgs, startIndexLocation) == offsetof(D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS, StartIndexLocation) &&
+			  offsetof(DrawIndexedIndirectArgs, baseVertexLocation) == offsetof(D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS, BaseVertexLocation) &&
+			  offsetof(DrawIndexedIndirectArgs, startInstanceLocation) == offsetof(D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS, StartInstanceLocation),
+			  "DrawIndexedIndirectArgs is the D3D11 layout");
+
+D3D11RenderDevice::D3D11RenderDevice(HWND hWnd, unsigned int width, unsigned int height, unsigned int bufferCount)
+{
+	/**
+	 *					WHAT IS SWAP CHAIN?
+	 * A swap chain is a series of virtual framebuffers utilized 
+	 * by the graphics card and graphics API for frame rate 
+	 * stabilization and several other functions. The swap 
+	 * chain usually exists in graphics memory, but it can exist 
+	 * in system memory as well. The non-utilization of a swap 
+	 * chain may result in stuttering rendering, but its existence 
+	 * and utilization are required by many graphics APIs. A swap 
+	 * chain with two buffers is a double buffer.
+	 * 
+	 * A swap chain is a collection of buffers that are used for 
+	 * displaying frames to the user. Each time an application presents 
+	 * a new frame for display, the first buffer in the swap chain takes 
+	 * the place of the displayed buffer. This process is called swapping or flipping.
+	 * https://docs.microsoft.com/en-us/windows/win32/direct3d9/what-is-a-swap-chain-
+	 */
+
+	UINT createFlags = 0u;
+#ifndef NDEBUG
+	createFlags |= D3D11_CREATE_DEVICE_DEBUG;
+#endif
+
+	// for checking results of d3d functions
+	HRESULT hr;
+
+	//////////////////////////////////////////////////////////////////////////
+	// Creates a device that represents the display adapter.
+	// D3D11CreateDevice(...)
+	//
+	// IDXGIAdapter: A pointer to the video adapter to use when creating a device.
+	//	
+	// HMODULE: A handle to a DLL that implements a software rasterizer. 
+	// If DriverType is D3D_DRIVER_TYPE_SOFTWARE, Software must not be NULL.
+	//	
+	// D3D_FEATURE_LEVEL: A pointer to an array of D3D_FEATURE_LEVELs, 
+	// which determine the order of feature levels to attempt to create.
+	//
+	// The swap chain is not created here: D3D11CreateDeviceAndSwapChain only
+	// takes a DXGI_SWAP_CHAIN_DESC, which cannot describe a flip model chain.
+	//////////////////////////////////////////////////////////////////////////
+	GFX_THROW_INFO(D3D11CreateDevice(
+		nullptr,					/* IDXGIAdapter* */
+		D3D_DRIVER_TYPE_HARDWARE,	/* D3D_DRIVER_TYPE */
+		nullptr,					/* HMODULE */
+		createFlags,				/* UINT */
+		nullptr,					/* const D3D_FEATURE_LEVEL */
+		0,							/* UINT */
+		D3D11_SDK_VERSION,			/* UINT */
+		&pDevice,					/* ID3D11Device * */
+		nullptr,					/* D3D_FEATURE_LEVEL */
+		&pContext					/* ID3D11DeviceContext* */
+	));
+
+	// Before Windows 8 (D3D11.1 runtime) a dynamic buffer that can be bound
+	// as a shader resource only maps with DISCARD.
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	if (SUCCEEDED(pDevice->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))))
+	{
+		mapNoOverwriteOnDynamicBufferSrv = options.MapNoOverwriteOnDynamicBufferSRV != FALSE;
+	}
+
+	// The swap chain has to come from the factory that created the device's
+	// adapter, so walk up device -> adapter -> factory.
+	GFX_THROW_INFO(pDevice.As(&pDXGIDevice));
+	GFX_THROW_INFO(pDXGIDevice->GetAdapter(&pDXGIAdapter));
+	GFX_THROW_INFO(pDXGIAdapter->GetParent(__uuidof(IDXGIFactory2), &pDXGIFactory));
+
+	// Describes the swap chain, DXGI 1.2 version.
+	// https://docs.microsoft.com/en-us/windows/win32/api/dxgi1_2/ns-dxgi1_2-dxgi_swap_chain_desc1
+	DXGI_SWAP_CHAIN_DESC1 sd {};
+	sd.Width = width;
+	sd.Height = height;
+
+	//A DXGI_FORMAT structure describing the display format.
+	sd.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+
+	// SampleDesc: describes multi-sampling parameters.
+	// Flip model buffers cannot be multisampled; the number of 
+	// multisamples per pixel has to be 1 and the quality 0.
+	// MSAA renders into a separate target instead (SetSampleCount()).
+	sd.SampleDesc.Count = 1;
+	sd.SampleDesc.Quality = 0;
+
+	// BufferUsage: A member of the DXGI_USAGE enumerated 
+	// type that describes the surface usage and CPU access 
+	// options for the back buffer. The back buffer can be 
+	// used for shader input or render-target output.
+	// https://docs.microsoft.com/en-us/windows/win32/direct3ddxgi/dxgi-usage
+	sd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+
+	// With the flip model the desktop compositor reads the presented buffer
+	// itself, so at least 2 are needed: one on screen, one to render into.
+	// A third lets the CPU start a frame while two are queued.
+	sd.BufferCount = bufferCount < 2u ? 2u : (bufferCount > DXGI_MAX_SWAP_CHAIN_BUFFERS ? DXGI_MAX_SWAP_CHAIN_BUFFERS : bufferCount);
+
+	// how the buffers are stretched while the window and the buffer sizes
+	// differ (between a WM_SIZE and the resize of the next frame)
+	sd.Scaling = DXGI_SCALING_STRETCH;
+	sd.AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED;
+	sd.Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH;
+
+	// enumerated type that describes options for handling the contents 
+	// of the presentation buffer after presenting a surface.
+	// FLIP_DISCARD needs Windows 10 and FLIP_SEQUENTIAL Windows 8; the
+	// bit-block transfer model (DISCARD) works everywhere, with one buffer.
+	const DXGI_SWAP_EFFECT swapEffects[] =
+	{
+		DXGI_SWAP_EFFECT_FLIP_DISCARD,
+		DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL,
+		DXGI_SWAP_EFFECT_DISCARD,
+	};
+	hr = E_FAIL;
+	for (DXGI_SWAP_EFFECT swapEffect : swapEffects)
+	{
+		sd.SwapEffect = swapEffect;
+		if (swapEffect == DXGI_SWAP_EFFECT_DISCARD)
+		{
+			sd.BufferCount = 1u;
+			sd.Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH;
+		}
+		else
+		{
+			// Present() waits on it instead of blocking in the next one
+			sd.Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH | DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+		}
+		// An HWND handle to the output window; nullptr for the fullscreen 
+		// description makes it a windowed swap chain.
+		if (SUCCEEDED(hr = pDXGIFactory->CreateSwapChainForHwnd(pDevice.Get(), hWnd, &sd, nullptr, nullptr, &pSwap)))
+		{
+			break;
+		}
+	}
+	GFX_THROW_INFO(hr);
+
+	swapChainDesc.width = width;
+	swapChainDesc.height = height;
+	swapChainDesc.bufferCount = sd.BufferCount;
+	swapChainFlags = sd.Flags;
+	if (sd.Flags & DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT)
+	{
+		// IDXGISwapChain2 is DXGI 1.3 (Windows 8.1), as is the flag; with the
+		// flag the latency is set on the swap chain, not on the device. 3 is
+		// the device default until SetPresentMode().
+		GFX_THROW_INFO(pSwap.As(&pSwap2));
+		GFX_THROW_INFO(pSwap2->SetMaximumFrameLatency(3u));
+		frameLatencyWaitable = pSwap2->GetFrameLatencyWaitableObject();
+	}
+
+	// Depth tests of the DepthMode values, in enum order. Reversed Z makes
+	// nearer fragments greater, hence GREATER_EQUAL instead of LESS.
+	const struct { BOOL enable; D3D11_DEPTH_WRITE_MASK write; D3D11_COMPARISON_FUNC func; } depthModes[] =
+	{
+		{ FALSE,	D3D11_DEPTH_WRITE_MASK_ZERO,	D3D11_COMPARISON_ALWAYS },			// Disabled
+		{ TRUE,		D3D11_DEPTH_WRITE_MASK_ALL,		D3D11_COMPARISON_GREATER_EQUAL },	// TestWrite
+		{ TRUE,		D3D11_DEPTH_WRITE_MASK_ZERO,	D3D11_COMPARISON_EQUAL },			// TestEqual
+	};
+	static_assert(std::size(depthModes) == std::tuple_size_v<decltype(depthStates)>, "one state per DepthMode");
+	for (size_t i = 0; i < depthStates.size(); i++)
+	{
+		D3D11_DEPTH_STENCIL_DESC dsd = {};
+		dsd.DepthEnable = depthModes[i].enable;
+		dsd.DepthWriteMask = depthModes[i].write;
+		dsd.DepthFunc = depthModes[i].func;
+		dsd.StencilEnable = FALSE;
+		GFX_THROW_INFO(pDevice->CreateDepthStencilState(&dsd, &depthStates[i]));
+	}
+
+	CreateBackBufferViews();
+}
+
+D3D11RenderDevice::~D3D11RenderDevice()
+{
+	if (frameLatencyWaitable)
+	{
+		CloseHandle(frameLatencyWaitable);
+	}
+}
+
+void D3D11RenderDevice::CreateBackBufferViews()
+{
+	HRESULT hr;
+
+	// Accesses one of the swap-chain's back buffers. With the flip model
+	// buffer 0 always is the current back buffer, so one view serves all.
+	// https://docs.microsoft.com/en-us/windows/win32/api/dxgi/nf-dxgi-idxgiswapchain-getbuffer
+	GFX_THROW_INFO(pSwap->GetBuffer(0, __uuidof(ID3D11Texture2D), &pBackBuffer));
+
+	// Without MSAA we draw straight into the back buffer. Otherwise into a
+	// multisampled texture of the same size and format, which Present()
+	// resolves into the back buffer.
+	ID3D11Texture2D* pDrawTarget = pBackBuffer.Get();
+	if (swapChainDesc.sampleCount > 1u)
+	{
+		D3D11_TEXTURE2D_DESC td = {};
+		pBackBuffer->GetDesc(&td);
+		td.SampleDesc.Count = swapChainDesc.sampleCount;
+		// the standard pattern; SetSampleCount() made sure the count has
+		// at least one quality level
+		td.SampleDesc.Quality = 0u;
+		td.Usage = D3D11_USAGE_DEFAULT;
+		td.BindFlags = D3D11_BIND_RENDER_TARGET;
+		td.CPUAccessFlags = 0u;
+		td.MiscFlags = 0u;
+		GFX_THROW_INFO(pDevice->CreateTexture2D(&td, nullptr, &pMsaaBuffer));
+		pDrawTarget = pMsaaBuffer.Get();
+	}
+
+	// Creates a render-target view for accessing resource data.
+	GFX_THROW_INFO(pDevice->CreateRenderTargetView(
+		pDrawTarget, // represents a render target.
+		nullptr, // nullptr -> create a view that accesses all of the subresources in mipmap level 0.
+		&pTarget
+	));
+
+	// The depth buffer has to match the draw target in size and sample
+	// count. 32 bit float without stencil: with reversed Z it keeps close to
+	// constant relative precision over the whole depth range.
+	D3D11_TEXTURE2D_DESC dd = {};
+	pDrawTarget->GetDesc(&dd);
+	dd.Format = DXGI_FORMAT_D32_FLOAT;
+	dd.Usage = D3D11_USAGE_DEFAULT;
+	dd.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+	dd.CPUAccessFlags = 0u;
+	dd.MiscFlags = 0u;
+	GFX_THROW_INFO(pDevice->CreateTexture2D(&dd, nullptr, &pDepthBuffer));
+	// nullptr -> a view of mip 0, multisampled when the texture is
+	GFX_THROW_INFO(pDevice->CreateDepthStencilView(pDepthBuffer.Get(), nullptr, &pDepthView));
+}
+
+void D3D11RenderDevice::ReleaseBackBufferViews()
+{
+	// Nothing may reference a swap chain buffer during ResizeBuffers():
+	// unbind the target from the context and drop our references, then
+	// flush so the context releases its deferred references too.
+	pContext->OMSetRenderTargets(0u, nullptr, nullptr);
+	pTarget.Reset();
+	pDepthView.Reset();
+	pDepthBuffer.Reset();
+	pMsaaBuffer.Reset();
+	pBackBuffer.Reset();
+	pContext->Flush();
+}
+
+void D3D11RenderDevice::Resize(unsigned int width, unsigned int height)
+{
+	HRESULT hr;
+
+	ReleaseBackBufferViews();
+
+	// 0 and DXGI_FORMAT_UNKNOWN keep the buffer count and the format.
+	// Shaders, buffers and layouts do not depend on the size and stay.
+	GFX_THROW_INFO(pSwap->ResizeBuffers(0u, width, height, DXGI_FORMAT_UNKNOWN, swapChainFlags));
+	swapChainDesc.width = width;
+	swapChainDesc.height = height;
+
+	CreateBackBufferViews();
+}
+
+unsigned int D3D11RenderDevice::SetSampleCount(unsigned int sampleCount)
+{
+	HRESULT hr;
+
+	// The highest power of two up to 8 that is not above the request and the
+	// hardware can do for the back buffer format. A count is supported when
+	// it has at least one quality level; quality 0 is what we use, the levels
+	// above are vendor specific.
+	UINT count = 8u;
+	for (; count > 1u; count /= 2u)
+	{
+		UINT qualityLevels = 0u;
+		if (count <= sampleCount &&
+			SUCCEEDED(pDevice->CheckMultisampleQualityLevels(DXGI_FORMAT_B8G8R8A8_UNORM, count, &qualityLevels)) &&
+			qualityLevels > 0u)
+		{
+			break;
+		}
+	}
+
+	if (count != swapChainDesc.sampleCount)
+	{
+		// the swap chain buffers keep their size, only the multisampled
+		// target is rebuilt (or dropped)
+		ReleaseBackBufferViews();
+		swapChainDesc.sampleCount = count;
+		CreateBackBufferViews();
+	}
+	return count;
+}
+
+BufferHandle D3D11RenderDevice::CreateBuffer(const BufferDesc& desc)
+{
+	HRESULT hr;
+
+	// Introduction to Buffers in Direct3D 11:
+	// https://docs.microsoft.com/en-us/windows/win32/direct3d11/overviews-direct3d-11-resources-buffers-intro
+	D3D11_BUFFER_DESC bd = {};
+	switch (desc.type)
+	{
+	case BufferType::Vertex:	bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;	break;
+	case BufferType::Index:		bd.BindFlags = D3D11_BIND_INDEX_BUFFER;		break;
+	case BufferType::Constant:	bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;	break;
+	// arguments are not bound to a stage; as a shader resource a culling
+	// pass can read last frame's counts
+	case BufferType::IndirectArgs:	bd.BindFlags = D3D11_BIND_SHADER_RESOURCE;	break;
+	}
+	if (desc.usage == BufferUsage::Dynamic)
+	{
+		// dynamic geometry is suballocated, one buffer serves both kinds
+		if (desc.type == BufferType::Vertex || desc.type == BufferType::Index)
+			bd.BindFlags = D3D11_BIND_VERTEX_BUFFER | D3D11_BIND_INDEX_BUFFER;
+		bd.Usage = D3D11_USAGE_DYNAMIC; // written by the CPU, read by the GPU
+		bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	}
+	else
+	{
+		bd.Usage = D3D11_USAGE_DEFAULT; //Identify how the buffer is expected to be read from and written to.
+		bd.CPUAccessFlags = 0u; //0 if no CPU access is necessary
+	}
+	bd.MiscFlags = desc.type == BufferType::IndirectArgs ? D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS : 0u;
+	bd.ByteWidth = desc.byteWidth; //Size of the buffer in bytes.
+	bd.StructureByteStride = desc.stride;
+
+	D3D11_SUBRESOURCE_DATA sd = {};
+	sd.pSysMem = desc.pInitialData; // Pointer to the initialization data.
+
+	wrl::ComPtr<ID3D11Buffer> pBuffer;
+	GFX_THROW_INFO(pDevice->CreateBuffer(&bd, desc.pInitialData ? &sd : nullptr, &pBuffer));
+
+	buffers.push_back(std::move(pBuffer));
+	return BufferHandle{ uint32_t(buffers.size() - 1) };
+}
+
+VertexShaderHandle D3D11RenderDevice::CreateVertexShader(const ShaderBytecode& bytecode)
+{
+	HRESULT hr;
+
+	// A vertex-shader interface manages an executable program (a vertex shader) that controls the vertex-shader stage.
+	wrl::ComPtr<ID3D11VertexShader> pVertexShader;
+	GFX_THROW_INFO(pDevice->CreateVertexShader(bytecode.pData, bytecode.size, nullptr, &pVertexShader));
+
+	vertexShaders.push_back(std::move(pVertexShader));
+	return VertexShaderHandle{ uint32_t(vertexShaders.size() - 1) };
+}
+
+PixelShaderHandle D3D11RenderDevice::CreatePixelShader(const ShaderBytecode& bytecode)
+{
+	HRESULT hr;
+
+	// A pixel-shader interface manages an executable program (a pixel shader) that controls the pixel-shader stage.
+	wrl::ComPtr<ID3D11PixelShader> pPixelShader;
+	GFX_THROW_INFO(pDevice->CreatePixelShader(bytecode.pData, bytecode.size, nullptr, &pPixelShader));
+
+	pixelShaders.push_back(std::move(pPixelShader));
+	return PixelShaderHandle{ uint32_t(pixelShaders.size() - 1) };
+}
+
+InputLayoutHandle D3D11RenderDevice::CreateInputLayout(const InputElementDesc* pElements, unsigned int count,
+													   const ShaderBytecode& vsBytecode)
+{
+	HRESULT hr;
+
+	std::vector<D3D11_INPUT_ELEMENT_DESC> ied(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		ied[i].SemanticName = pElements[i].semanticName;
+		ied[i].SemanticIndex = pElements[i].semanticIndex;
+		ied[i].Format = ToDxgiFormat(pElements[i].format);
+		ied[i].InputSlot = pElements[i].inputSlot;
+		ied[i].AlignedByteOffset = pElements[i].alignedByteOffset;
+		ied[i].InputSlotClass = pElements[i].classification == InputClassification::PerInstance ?
+			D3D11_INPUT_PER_INSTANCE_DATA : D3D11_INPUT_PER_VERTEX_DATA;
+		ied[i].InstanceDataStepRate = pElements[i].instanceDataStepRate;
+	}
+
+	wrl::ComPtr<ID3D11InputLayout> pInputLayout;
+	GFX_THROW_INFO(pDevice->CreateInputLayout(
+		ied.data(), (UINT)ied.size(),
+		vsBytecode.pData,
+		vsBytecode.size,
+		&pInputLayout
+	));
+
+	inputLayouts.push_back(std::move(pInputLayout));
+	return InputLayoutHandle{ uint32_t(inputLayouts.size() - 1) };
+}
+
+void D3D11RenderDevice::SetVertexBuffer(unsigned int slot, BufferHandle buffer, unsigned int stride, unsigned int offset)
+{
+	const UINT strides[] = { stride };
+	const UINT offsets[] = { offset };
+	pContext->IASetVertexBuffers(slot, 1u, buffers[buffer.id].GetAddressOf(), strides, offsets);
+}
+
+void D3D11RenderDevice::SetIndexBuffer(BufferHandle buffer, IndexFormat format, unsigned int offset)
+{
+	pContext->IASetIndexBuffer(
+		buffers[buffer.id].Get(),
+		format == IndexFormat::R16_UInt ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT,
+		offset
+	);
+}
+
+void D3D11RenderDevice::SetVertexShader(VertexShaderHandle shader)
+{
+	pContext->VSSetShader(vertexShaders[shader.id].Get(), nullptr, 0u);
+}
+
+void D3D11RenderDevice::SetPixelShader(PixelShaderHandle shader)
+{
+	pContext->PSSetShader(shader.IsValid() ? pixelShaders[shader.id].Get() : nullptr, nullptr, 0u);
+}
+
+void D3D11RenderDevice::SetInputLayout(InputLayoutHandle layout)
+{
+	pContext->IASetInputLayout(inputLayouts[layout.id].Get());
+}
+
+void D3D11RenderDevice::SetBackBufferTarget()
+{
+	pContext->OMSetRenderTargets(1u, pTarget.GetAddressOf(), pDepthView.Get());
+}
+
+void D3D11RenderDevice::SetDepthOnlyTarget()
+{
+	// no render targets: the pixel shader (if any) output goes nowhere and
+	// the hardware can run depth at its fast rate
+	pContext->OMSetRenderTargets(0u, nullptr, pDepthView.Get());
+}
+
+void D3D11RenderDevice::SetDepthMode(DepthMode mode)
+{
+	pContext->OMSetDepthStencilState(depthStates[size_t(mode)].Get(), 0u);
+}
+
+void D3D11RenderDevice::SetPrimitiveTopology(PrimitiveTopology topology)
+{
+	// triangle list is the only topology we emit so far
+	pContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
+
+void D3D11RenderDevice::SetViewport(const Viewport& viewport)
+{
+	D3D11_VIEWPORT vp;
+	vp.TopLeftX = viewport.topLeftX;
+	vp.TopLeftY = viewport.topLeftY;
+	vp.Width = viewport.width;
+	vp.Height = viewport.height;
+	vp.MinDepth = viewport.minDepth;
+	vp.MaxDepth = viewport.maxDepth;
+	pContext->RSSetViewports(1u, &vp);
+}
+
+void* D3D11RenderDevice::Map(BufferHandle buffer, MapMode mode)
+{
+	HRESULT hr;
+
+	// DISCARD lets the driver hand out fresh memory (renaming) while the GPU
+	// still reads the old content, NO_OVERWRITE maps without any sync
+	D3D11_MAP mapType = mode == MapMode::WriteDiscard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+	if (mapType == D3D11_MAP_WRITE_NO_OVERWRITE && !mapNoOverwriteOnDynamicBufferSrv)
+	{
+		// the indirect argument ring is such a buffer; renaming it leaves the
+		// ranges earlier frames wrote with their draws, and the ranges mapped
+		// now are written before this frame's draws read them
+		D3D11_BUFFER_DESC bd = {};
+		buffers[buffer.id]->GetDesc(&bd);
+		if (bd.BindFlags & D3D11_BIND_SHADER_RESOURCE)
+		{
+			mapType = D3D11_MAP_WRITE_DISCARD;
+		}
+	}
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	GFX_THROW_INFO(pContext->Map(buffers[buffer.id].Get(), 0u, mapType, 0u, &mapped));
+	return mapped.pData;
+}
+
+void D3D11RenderDevice::Unmap(BufferHandle buffer)
+{
+	pContext->Unmap(buffers[buffer.id].Get(), 0u);
+}
+
+void D3D11RenderDevice::ClearBackBuffer(const float color[4])
+{
+	// Set all the elements in a render target to one value.
+	pContext->ClearRenderTargetView(pTarget.Get(), color);
+}
+
+void D3D11RenderDevice::ClearDepth(float depth)
+{
+	pContext->ClearDepthStencilView(pDepthView.Get(), D3D11_CLEAR_DEPTH, depth, 0u);
+}
+
+void D3D11RenderDevice::DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+{
+	GFX_THROW_INFO_ONLY(pContext->DrawIndexed(indexCount, startIndex, baseVertex));
+}
+
+void D3D11RenderDevice::DrawIndexedInstanced(unsigned int indexCountPerInstance, unsigned int instanceCount,
+											  unsigned int startIndex, int baseVertex, unsigned int startInstance)
+{
+	GFX_THROW_INFO_ONLY(pContext->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndex, baseVertex, startInstance));
+}
+
+void D3D11RenderDevice::DrawIndexedInstancedIndirect(BufferHandle args, unsigned int byteOffset)
+{
+	GFX_THROW_INFO_ONLY(pContext->DrawIndexedInstancedIndirect(buffers[args.id].Get(), byteOffset));
+}
+
+void D3D11RenderDevice::Present()
+{
+	HRESULT hr;
+#ifndef NDEBUG
+	infoManager.Set();
+#endif
+	// the display only takes single sampled buffers
+	if (pMsaaBuffer)
+	{
+		pContext->ResolveSubresource(pBackBuffer.Get(), 0u, pMsaaBuffer.Get(), 0u, DXGI_FORMAT_B8G8R8A8_UNORM);
+	}
+
+	// flip back/front buffers
+	if (FAILED(hr = pSwap->Present(syncInterval, 0u)))
+	{
+		if (hr == DXGI_ERROR_DEVICE_REMOVED)
+			throw GFX_DEVICE_REMOVED_EXCEPT(pDevice->GetDeviceRemovedReason());
+		throw GFX_EXCEPT(hr);
+	}
+
+	// the next frame starts when the queue has room for it; the timeout
+	// only guards against a chain that stopped presenting
+	if (frameLatencyWaitable)
+	{
+		WaitForSingleObjectEx(frameLatencyWaitable, 1000u, TRUE);
+	}
+}
+
+void D3D11RenderDevice::SetPresentMode(PresentMode mode, unsigned int maxFrameLatency)
+{
+	HRESULT hr;
+
+	syncInterval = mode == PresentMode::VSync ? 1u : 0u;
+
+	// how many frames DXGI lets the CPU queue: with the waitable object
+	// Present() waits until fewer are queued, otherwise the device blocks in
+	// Present() once that many are
+	if (pSwap2)
+	{
+		GFX_THROW_INFO(pSwap2->SetMaximumFrameLatency(maxFrameLatency));
+		return;
+	}
+	wrl::ComPtr<IDXGIDevice1> pDxgiDevice1;
+	GFX_THROW_INFO(pDevice.As(&pDxgiDevice1));
+	GFX_THROW_INFO(pDxgiDevice1->SetMaximumFrameLatency(maxFrameLatency));
+}
+
+DXGI_FORMAT D3D11RenderDevice::ToDxgiFormat(ElementFormat format) noexcept
+{
+	switch (format)
+	{
+	case ElementFormat::R32G32_Float:		return DXGI_FORMAT_R32G32_FLOAT;
+	case ElementFormat::R32G32B32_Float:	return DXGI_FORMAT_R32G32B32_FLOAT;
+	case ElementFormat::R32G32B32A32_Float:	return DXGI_FORMAT_R32G32B32A32_FLOAT;
+	case ElementFormat::R8G8B8A8_UNorm:		return DXGI_FORMAT_R8G8B8A8_UNORM;
+	case ElementFormat::R8G8B8A8_SNorm:		return DXGI_FORMAT_R8G8B8A8_SNORM;
+	case ElementFormat::R16G16_SNorm:		return DXGI_FORMAT_R16G16_SNORM;
+	case ElementFormat::R16G16_Float:		return DXGI_FORMAT_R16G16_FLOAT;
+	case ElementFormat::R16G16B16A16_UNorm:	return DXGI_FORMAT_R16G16B16A16_UNORM;
+	}
+	return DXGI_FORMAT_UNKNOWN;
+}
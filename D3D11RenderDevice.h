@@ -0,0 +1,197 @@
+#pragma once
+#include "Genix.h"
+#include "RenderDevice.h"
+#include <d3d11.h>
+#include <dxgi1_3.h>
+#include <wrl.h>
+#include <array>
+#include <vector>
+#include "DxgiInfoManager.h"
+
+// To set up Direct3D we need to complete the following four steps:
+// 1. Define the device types and feature levels we want to check for.
+// 2. Create the Direct3D device, rendering context, and swap chain.
+// 3. Create the render target.
+// 4. Set the viewport.
+
+// In Direct3D 11 we can have a hardware device, a WARP device, a software
+// driver device, or a reference device.
+// -A hardware device is a Direct3D device that runs on the graphics hardware and
+// is the fastest of all devices
+// -A reference device is used for users without hardware support by performing the
+// rendering on the CPU. In other words, the reference device completely emulates
+// hardware rendering on the CPU within software. This process is very slow,
+// inefficient, and should only be used during development if there is no other
+// alternative.
+// -A software driver device allows developers to write their own software
+// rendering driver and use it with Direct3D. This is called a pluggable software
+// driver.
+// -The WARP device is an efficient CPU-rendering device that emulates the full
+// feature set of Direct3D.
+
+// The next step is the creation of the swap chain description.
+// A swap chain is a collection of buffers that are used for displaying frames
+// to the user. Each time an application presents a new frame for display,
+// the first buffer in the swap chain takes the place of the displayed buffer.
+// This process is called swapping or flipping.
+
+// The next step is to create the rendering context, device, and swap chain now that
+// we have the swap chain description. The Direct3D device is the device itself and
+// communicates with the hardware. The Direct3D context is a rendering context
+// that tells the device how to draw. It also includes rendering states and other
+// drawing information. The swap chain as we’ve already discussed is the rendering
+// destinations that the device and context will draw to.
+
+// A render target view is a Direct3D resource written to by the output merger
+// stage. In order for the output merger to render to the swap chain’s back buffer
+// (secondary buffer), we create a render target view of it.
+
+// The last piece of the Direct3D 11 puzzle is the creation and setting of the
+// viewport. The viewport defines the area of the screen we are rendering to. In
+// single player or non-split-screen multiplayer games this is often the entire
+// screen, and so we set the viewport’s width and height to the Direct3D swap
+// chain’s width and height.
+
+// IRenderDevice implemented on top of an ID3D11Device / ID3D11DeviceContext
+// pair. Created objects live in per-type tables and the handle id is simply
+// the index into the table, so binding a handle is one array lookup.
+//
+// The device is also its swap chain: a flip-model chain of bufferCount
+// buffers (clamped to 2..DXGI_MAX_SWAP_CHAIN_BUFFERS), falling back to the
+// single buffered bit-block transfer model where flip is not supported.
+// Flip chains have a frame latency waitable object: Present() returns once
+// the chain takes another frame (at most maxFrameLatency are queued), so
+// the next frame starts with the queue drained instead of blocking in the
+// following Present() on input that is already old.
+class D3D11RenderDevice : public IRenderDevice, public ISwapChain
+{
+public:
+	D3D11RenderDevice(HWND hWnd, unsigned int width, unsigned int height, unsigned int bufferCount);
+	D3D11RenderDevice(const D3D11RenderDevice&) = delete;
+	D3D11RenderDevice& operator=(const D3D11RenderDevice&) = delete;
+	~D3D11RenderDevice() override;
+
+	BufferHandle		CreateBuffer(const BufferDesc& desc) override;
+	VertexShaderHandle	CreateVertexShader(const ShaderBytecode& bytecode) override;
+	PixelShaderHandle	CreatePixelShader(const ShaderBytecode& bytecode) override;
+	InputLayoutHandle	CreateInputLayout(const InputElementDesc* pElements, unsigned int count,
+										  const ShaderBytecode& vsBytecode) override;
+
+	void SetVertexBuffer(unsigned int slot, BufferHandle buffer, unsigned int stride, unsigned int offset) override;
+	void SetIndexBuffer(BufferHandle buffer, IndexFormat format, unsigned int offset) override;
+	void SetVertexShader(VertexShaderHandle shader) override;
+	void SetPixelShader(PixelShaderHandle shader) override;
+	void SetInputLayout(InputLayoutHandle layout) override;
+	void SetBackBufferTarget() override;
+	void SetDepthOnlyTarget() override;
+	void SetDepthMode(DepthMode mode) override;
+	void SetPrimitiveTopology(PrimitiveTopology topology) override;
+	void SetViewport(const Viewport& viewport) override;
+
+	void* Map(BufferHandle buffer, MapMode mode) override;
+	void Unmap(BufferHandle buffer) override;
+
+	void ClearBackBuffer(const float color[4]) override;
+	void ClearDepth(float depth) override;
+	void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex) override;
+	void DrawIndexedInstanced(unsigned int indexCountPerInstance, unsigned int instanceCount,
+							  unsigned int startIndex, int baseVertex, unsigned int startInstance) override;
+	void DrawIndexedInstancedIndirect(BufferHandle args, unsigned int byteOffset) override;
+	void Present() override;
+	void SetPresentMode(PresentMode mode, unsigned int maxFrameLatency) override;
+	ISwapChain& GetSwapChain() noexcept override { return *this; }
+	// the depth buffer lives on the GPU; reducing it into a pyramid there
+	// needs compute shaders, which this device does not run yet
+	const HiZPyramid* GetDepthPyramid() const noexcept override { return nullptr; }
+	bool NeedsShaderBytecode() const noexcept override { return true; }
+
+	SwapChainDesc GetDesc() const noexcept override { return swapChainDesc; }
+	void Resize(unsigned int width, unsigned int height) override;
+	unsigned int SetSampleCount(unsigned int sampleCount) override;
+
+private:
+	// everything that has to be recreated when the buffers change size or
+	// the sample count changes
+	void CreateBackBufferViews();
+	void ReleaseBackBufferViews();
+	static DXGI_FORMAT ToDxgiFormat(ElementFormat format) noexcept;
+
+private:
+#ifndef NDEBUG
+	DxgiInfoManager infoManager;
+#endif
+
+	/**
+	 * You can create a swap chain by calling
+	 * IDXGIFactory2::CreateSwapChainForHwnd,
+	 * IDXGIFactory2::CreateSwapChainForCoreWindow, or
+	 * IDXGIFactory2::CreateSwapChainForComposition.
+	 *
+	 * You can also create a swap chain when you call
+	 * D3D11CreateDeviceAndSwapChain;
+	 * however, you can then only access the
+	 * sub-set of swap-chain functionality that
+	 * the IDXGISwapChain interface provides,
+	 * which has no flip model.
+	 */
+
+	/**
+	 *					WHAT IS ComPtr?
+	 * Creates a smart pointer type that represents
+	 * the interface specified by the template parameter.
+	 * ComPtr automatically maintains a reference count
+	 * for the underlying interface pointer and releases
+	 * the interface when the reference count goes to zero.
+	 * https://docs.microsoft.com/tr-tr/cpp/cppcx/wrl/comptr-class?view=vs-2019
+	 */
+
+	// one or more surfaces for storing rendered
+	// data before presenting it to an output.
+	Microsoft::WRL::ComPtr<IDXGISwapChain1> pSwap;
+
+	// virtual adapter it is used to create resources.
+	Microsoft::WRL::ComPtr<ID3D11Device> pDevice;
+
+	// a device context which generates rendering commands.
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> pContext;
+
+	// identifies the render-target subresources
+	// that can be accessed during rendering.
+	// A render target is a resource that can be written by the
+	// output-merger stage at the end of a render pass. Each
+	// render-target should also have a corresponding depth-stencil view.
+	// It views pMsaaBuffer when multisampling, the back buffer otherwise.
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> pTarget;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> pBackBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> pMsaaBuffer;
+
+	// 32 bit float depth of the draw target's size and sample count, used
+	// reversed (see DepthMode); one depth-stencil state per DepthMode
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> pDepthBuffer;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> pDepthView;
+	std::array<Microsoft::WRL::ComPtr<ID3D11DepthStencilState>, 3> depthStates;
+
+	// the factory that owns the adapter of pDevice creates the swap chain
+	Microsoft::WRL::ComPtr<IDXGIFactory2> pDXGIFactory;
+	Microsoft::WRL::ComPtr<IDXGIDevice>  pDXGIDevice;
+	Microsoft::WRL::ComPtr<IDXGIAdapter> pDXGIAdapter;
+
+	SwapChainDesc swapChainDesc;
+	// creation flags, ResizeBuffers() has to be given the same
+	UINT swapChainFlags { 0u };
+	// flip model only: signaled while fewer than the maximum frame latency
+	// frames are queued
+	Microsoft::WRL::ComPtr<IDXGISwapChain2> pSwap2;
+	HANDLE frameLatencyWaitable { nullptr };
+
+	// Present() sync interval, 1 = vsync
+	UINT syncInterval { 1u };
+	// D3D11_FEATURE_D3D11_OPTIONS::MapNoOverwriteOnDynamicBufferSRV; without
+	// it Map() turns NO_OVERWRITE on such buffers into DISCARD
+	bool mapNoOverwriteOnDynamicBufferSrv { false };
+
+	std::vector<Microsoft::WRL::ComPtr<ID3D11Buffer>>		buffers;
+	std::vector<Microsoft::WRL::ComPtr<ID3D11VertexShader>>	vertexShaders;
+	std::vector<Microsoft::WRL::ComPtr<ID3D11PixelShader>>	pixelShaders;
+	std::vector<Microsoft::WRL::ComPtr<ID3D11InputLayout>>	inputLayouts;
+};
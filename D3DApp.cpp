@@ -24,7 +24,7 @@ int D3DApp::Run()
 
 void D3DApp::DoFrame()
 {
-	wnd.Gfx().ClearBuffer(0.f, 0.f, 1.0f);
-	wnd.Gfx().DrawTestTriangle();
+	scene.Update(Timer->DeltaTime());
+	scene.Draw(wnd.Gfx());
 	wnd.Gfx().EndFrame();
 }
\ No newline at end of file
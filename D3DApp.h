@@ -7,6 +7,7 @@
 
 #include "Window.h"
 #include "GenixTimer.h"
+#include "Scene.h"
 
 class D3DApp
 {
@@ -21,4 +22,6 @@ private:
 	void DoFrame();	
 	// main window 
 	Window wnd;
+	// what gets drawn every frame
+	Scene scene;
 };
\ No newline at end of file
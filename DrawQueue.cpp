@@ -0,0 +1,372 @@
+#include "DrawQueue.h"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace
+{
+	constexpr unsigned int PipelineBits	= 12u;
+	constexpr unsigned int MaterialBits	= 12u;
+	constexpr unsigned int GeometryBits	= 16u;
+	constexpr unsigned int DepthBits	= 24u;
+	static_assert(PipelineBits + MaterialBits + GeometryBits + DepthBits == 64u, "sort key must use all 64 bits");
+
+	constexpr uint64_t FieldMask(unsigned int bits) noexcept
+	{
+		return (uint64_t(1) << bits) - 1u;
+	}
+
+	uint64_t DepthField(float depth) noexcept
+	{
+		return uint64_t(std::clamp(depth, 0.0f, 1.0f) * float(FieldMask(DepthBits)));
+	}
+
+	constexpr uint32_t NoBatch = ~0u;
+
+	// binds a packet needs when drawn on its own, plus one for an
+	// attribute stream and one for an instance stream
+	constexpr unsigned int BindsPerPacket = 5u;
+
+	// dense id of a state combination, assigned in order of first use
+	uint32_t DenseId(std::unordered_map<uint64_t, uint32_t>& ids, uint64_t combination)
+	{
+		return ids.try_emplace(combination, uint32_t(ids.size())).first->second;
+	}
+
+	// everything but depth and the instance range: packets equal in it can
+	// be drawn as instances of one draw
+	uint64_t HashBatch(const DrawPacket& p) noexcept
+	{
+		uint64_t hash = HashCombine(HashSeed, p.vertexShader.id);
+		hash = HashCombine(hash, p.pixelShader.id);
+		hash = HashCombine(hash, p.inputLayout.id);
+		hash = HashCombine(hash, p.depthInputLayout.id);
+		hash = HashCombine(hash, (uint64_t(p.vertexBuffer.id) << 32u) | p.stride);
+		hash = HashCombine(hash, (uint64_t(p.attributeBuffer.id) << 32u) | p.attributeStride);
+		hash = HashCombine(hash, (uint64_t(p.indexBuffer.id) << 32u) | uint32_t(p.indexFormat));
+		hash = HashCombine(hash, (uint64_t(p.indexCount) << 32u) | p.startIndex);
+		hash = HashCombine(hash, (uint64_t(uint32_t(p.baseVertex)) << 32u) | p.material);
+		return HashCombine(hash, p.instanceStride);
+	}
+
+	bool SameBatch(const DrawPacket& a, const DrawPacket& b) noexcept
+	{
+		return a.vertexShader == b.vertexShader && a.pixelShader == b.pixelShader && a.inputLayout == b.inputLayout &&
+			a.depthInputLayout == b.depthInputLayout && a.vertexBuffer == b.vertexBuffer && a.stride == b.stride &&
+			a.attributeBuffer == b.attributeBuffer && a.attributeStride == b.attributeStride &&
+			a.indexBuffer == b.indexBuffer && a.indexFormat == b.indexFormat && a.indexCount == b.indexCount &&
+			a.startIndex == b.startIndex && a.baseVertex == b.baseVertex && a.material == b.material &&
+			a.instanceStride == b.instanceStride;
+	}
+}
+
+void DrawQueue::Enqueue(const DrawPacket& packet)
+{
+	packets.push_back(packet);
+	keys.push_back(MakeKey(packet));
+}
+
+void DrawQueue::EnqueueInstance(const DrawPacket& packet, const void* pInstanceData)
+{
+	if (packet.instanceStride == 0u)
+	{
+		// no data, nothing to tell the instances apart
+		Enqueue(packet);
+		return;
+	}
+	// instances of one object usually come in a row: then the batch is the
+	// last one and only the depth of the key is new
+	uint32_t batch = lastBatch;
+	if (batch != NoBatch && SameBatch(packets[batches[batch].packet], packet))
+	{
+		uint64_t& batchKey = keys[batches[batch].packet];
+		batchKey = std::min(batchKey, (batchKey & ~FieldMask(DepthBits)) | DepthField(packet.depth));
+	}
+	else
+	{
+		const uint64_t key = MakeKey(packet);
+		auto [it, inserted] = batchIds.try_emplace(HashBatch(packet), uint32_t(batches.size()));
+		// a hash collision gets a batch of its own, not in the map
+		if (inserted || !SameBatch(packets[batches[it->second].packet], packet))
+		{
+			DrawPacket first = packet;
+			first.instanceBuffer = {};
+			first.instanceOffset = 0u;
+			first.instanceCount = 0u;
+			first.startInstance = 0u;
+			first.argsBuffer = {};
+			first.argsOffset = 0u;
+			batches.push_back({ uint32_t(packets.size()), 0u, 0u });
+			packets.push_back(first);
+			keys.push_back(key);
+			batch = uint32_t(batches.size() - 1u);
+		}
+		else
+		{
+			batch = it->second;
+			// the upper fields are the same for the whole batch, the lowest
+			// key has the nearest depth
+			keys[batches[batch].packet] = std::min(keys[batches[batch].packet], key);
+		}
+		lastBatch = batch;
+	}
+	batches[batch].instanceCount++;
+
+	instanceBatches.push_back(batch);
+	const unsigned char* pBytes = static_cast<const unsigned char*>(pInstanceData);
+	instanceData.insert(instanceData.end(), pBytes, pBytes + packet.instanceStride);
+}
+
+size_t DrawQueue::PrepareInstances()
+{
+	// every batch starts at a multiple of its stride, so it is reached
+	// through startInstance with the buffer bound once
+	size_t size = 0u;
+	for (Batch& batch : batches)
+	{
+		const size_t stride = packets[batch.packet].instanceStride;
+		size = (size + stride - 1u) / stride * stride;
+		batch.firstByte = uint32_t(size);
+		size += size_t(batch.instanceCount) * stride;
+	}
+	return size;
+}
+
+void DrawQueue::WriteInstances(BufferHandle buffer, unsigned int offset, void* pData) noexcept
+{
+	if (!pData)
+	{
+		// nothing to draw them with
+		for (const Batch& batch : batches)
+		{
+			packets[batch.packet].instanceCount = 0u;
+			droppedInstances += batch.instanceCount;
+		}
+		return;
+	}
+
+	// the batches' packets count their instances again while they are
+	// scattered to the batch ranges
+	unsigned char* pOut = static_cast<unsigned char*>(pData);
+	for (const Batch& batch : batches)
+	{
+		DrawPacket& p = packets[batch.packet];
+		p.instanceBuffer = buffer;
+		p.instanceOffset = offset;
+		p.startInstance = batch.firstByte / p.instanceStride;
+		p.instanceCount = 0u;
+	}
+	const unsigned char* pIn = instanceData.data();
+	for (const uint32_t b : instanceBatches)
+	{
+		DrawPacket& p = packets[batches[b].packet];
+		std::memcpy(pOut + batches[b].firstByte + size_t(p.instanceCount) * p.instanceStride, pIn, p.instanceStride);
+		pIn += p.instanceStride;
+		p.instanceCount++;
+	}
+}
+
+void DrawQueue::Submit(IRenderDevice& device)
+{
+	if (!sorted)
+	{
+		ResetStats();
+		Sort();
+	}
+	Issue(device, true);
+
+	packets.clear();
+	keys.clear();
+	sorted = false;
+	batches.clear();
+	batchIds.clear();
+	instanceBatches.clear();
+	instanceData.clear();
+	lastBatch = NoBatch;
+	droppedInstances = 0u;
+}
+
+void DrawQueue::SubmitDepthOnly(IRenderDevice& device)
+{
+	ResetStats();
+	Sort();
+	sorted = true;
+
+	// an invalid handle unbinds the stage, depth is all the pass writes
+	device.SetPixelShader(PixelShaderHandle {});
+	stats.stateChanges++;
+	Issue(device, false);
+}
+
+void DrawQueue::Issue(IRenderDevice& device, bool pixelShaders)
+{
+	const unsigned int stateChanges = stats.stateChanges;
+	unsigned int binds = 0u;
+	const DrawPacket* pPrev = nullptr;
+	InputLayoutHandle prevLayout;
+	BufferHandle boundAttributes;
+	unsigned int boundAttributeStride = 0u;
+	BufferHandle boundInstances;
+	unsigned int boundInstanceStride = 0u;
+	unsigned int boundInstanceOffset = 0u;
+	for (const uint32_t index : order)
+	{
+		const DrawPacket& p = packets[index];
+		// indirect packets take their instance count from the arguments
+		if (!p.argsBuffer.IsValid() && p.instanceCount == 0u)
+		{
+			// a dropped batch
+			continue;
+		}
+		if (!pPrev || p.vertexBuffer != pPrev->vertexBuffer || p.stride != pPrev->stride)
+		{
+			device.SetVertexBuffer(0u, p.vertexBuffer, p.stride, 0u);
+			stats.stateChanges++;
+		}
+		// depth-only passes skip the attributes when the packet has a layout
+		// without them; a stream left bound from an earlier packet is not
+		// read by the layouts of packets without one
+		const bool attributes = p.attributeBuffer.IsValid() && (pixelShaders || !p.depthInputLayout.IsValid());
+		if (attributes)
+		{
+			if (p.attributeBuffer != boundAttributes || p.attributeStride != boundAttributeStride)
+			{
+				device.SetVertexBuffer(1u, p.attributeBuffer, p.attributeStride, 0u);
+				boundAttributes = p.attributeBuffer;
+				boundAttributeStride = p.attributeStride;
+				stats.stateChanges++;
+			}
+			binds++;
+		}
+		const bool instanced = p.instanceBuffer.IsValid();
+		if (instanced)
+		{
+			if (p.instanceBuffer != boundInstances || p.instanceStride != boundInstanceStride ||
+				p.instanceOffset != boundInstanceOffset)
+			{
+				device.SetVertexBuffer(InstanceSlot, p.instanceBuffer, p.instanceStride, p.instanceOffset);
+				boundInstances = p.instanceBuffer;
+				boundInstanceStride = p.instanceStride;
+				boundInstanceOffset = p.instanceOffset;
+				stats.stateChanges++;
+			}
+			binds++;
+		}
+		if (!pPrev || p.indexBuffer != pPrev->indexBuffer || p.indexFormat != pPrev->indexFormat)
+		{
+			device.SetIndexBuffer(p.indexBuffer, p.indexFormat, 0u);
+			stats.stateChanges++;
+		}
+		if (!pPrev || p.vertexShader != pPrev->vertexShader)
+		{
+			device.SetVertexShader(p.vertexShader);
+			stats.stateChanges++;
+		}
+		if (pixelShaders && (!pPrev || p.pixelShader != pPrev->pixelShader))
+		{
+			device.SetPixelShader(p.pixelShader);
+			stats.stateChanges++;
+		}
+		const InputLayoutHandle layout = !pixelShaders && p.depthInputLayout.IsValid() ? p.depthInputLayout : p.inputLayout;
+		if (!pPrev || layout != prevLayout)
+		{
+			device.SetInputLayout(layout);
+			stats.stateChanges++;
+		}
+		if (p.argsBuffer.IsValid())
+		{
+			device.DrawIndexedInstancedIndirect(p.argsBuffer, p.argsOffset);
+			stats.indirectDraws += pixelShaders ? 1u : 0u;
+		}
+		else if (instanced)
+		{
+			device.DrawIndexedInstanced(p.indexCount, p.instanceCount, p.startIndex, p.baseVertex, p.startInstance);
+			stats.instances += pixelShaders ? p.instanceCount : 0u;
+		}
+		else
+		{
+			device.DrawIndexed(p.indexCount, p.startIndex, p.baseVertex);
+		}
+		pPrev = &p;
+		prevLayout = layout;
+	}
+	binds += stats.packets * (pixelShaders ? BindsPerPacket : BindsPerPacket - 1u);
+	stats.stateChangesAvoided += binds - std::min(binds, stats.stateChanges - stateChanges);
+}
+
+void DrawQueue::ResetStats() noexcept
+{
+	stats = {};
+	stats.packets = unsigned(packets.size());
+	stats.batchedInstances = unsigned(instanceBatches.size()) - droppedInstances;
+	stats.droppedInstances = droppedInstances;
+}
+
+uint64_t DrawQueue::MakeKey(const DrawPacket& packet)
+{
+	// handle ids are small, 21 bits each identify a combination in practice
+	const uint64_t pipeline = DenseId(pipelineIds,
+		(uint64_t(packet.vertexShader.id) & FieldMask(21u)) |
+		((uint64_t(packet.pixelShader.id) & FieldMask(21u)) << 21u) |
+		((uint64_t(packet.inputLayout.id) & FieldMask(22u)) << 42u));
+	const uint64_t geometry = DenseId(geometryIds,
+		uint64_t(packet.vertexBuffer.id) | (uint64_t(packet.indexBuffer.id) << 32u));
+	const uint64_t depth = DepthField(packet.depth);
+
+	return ((pipeline & FieldMask(PipelineBits)) << (MaterialBits + GeometryBits + DepthBits)) |
+		((uint64_t(packet.material) & FieldMask(MaterialBits)) << (GeometryBits + DepthBits)) |
+		((geometry & FieldMask(GeometryBits)) << DepthBits) |
+		(depth & FieldMask(DepthBits));
+}
+
+void DrawQueue::Sort()
+{
+	const size_t count = keys.size();
+	order.resize(count);
+	std::iota(order.begin(), order.end(), 0u);
+	if (count < 2u)
+	{
+		return;
+	}
+	keysTemp.resize(count);
+	orderTemp.resize(count);
+
+	// histograms of all 8 digits in one pass over the keys
+	constexpr int Digits = 8;
+	uint32_t histogram[Digits][256] = {};
+	for (const uint64_t key : keys)
+	{
+		for (int d = 0; d < Digits; d++)
+		{
+			histogram[d][(key >> (d * 8)) & 0xFFu]++;
+		}
+	}
+
+	for (int d = 0; d < Digits; d++)
+	{
+		uint32_t* pCount = histogram[d];
+		const unsigned int shift = unsigned(d) * 8u;
+		// every key has the same digit: the pass would not move anything
+		if (pCount[(keys[0] >> shift) & 0xFFu] == count)
+		{
+			continue;
+		}
+
+		uint32_t offset = 0u;
+		for (int bucket = 0; bucket < 256; bucket++)
+		{
+			const uint32_t bucketCount = pCount[bucket];
+			pCount[bucket] = offset;
+			offset += bucketCount;
+		}
+		for (size_t i = 0; i < count; i++)
+		{
+			const uint32_t to = pCount[(keys[i] >> shift) & 0xFFu]++;
+			keysTemp[to] = keys[i];
+			orderTemp[to] = order[i];
+		}
+		keys.swap(keysTemp);
+		order.swap(orderTemp);
+		stats.sortPasses++;
+	}
+}
@@ -0,0 +1,180 @@
+#pragma once
+#include "RenderDevice.h"
+#include "VertexFormat.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Everything needed to issue one indexed draw. Packets are plain values so
+// recording one costs a copy, not a device call.
+struct DrawPacket
+{
+	VertexShaderHandle	vertexShader;
+	PixelShaderHandle	pixelShader;
+	InputLayoutHandle	inputLayout;
+	BufferHandle		vertexBuffer;
+	unsigned int		stride		{ 0u };
+	// second stream (slot 1) for meshes whose positions have a buffer of
+	// their own (see VertexCompression.h)
+	BufferHandle		attributeBuffer;
+	unsigned int		attributeStride	{ 0u };
+	// layout of depth-only passes reading vertexBuffer alone, which then
+	// leave the attribute stream unbound; invalid = inputLayout
+	InputLayoutHandle	depthInputLayout;
+	BufferHandle		indexBuffer;
+	IndexFormat			indexFormat	{ IndexFormat::R16_UInt };
+	unsigned int		indexCount	{ 0u };
+	unsigned int		startIndex	{ 0u };
+	int					baseVertex	{ 0 };
+	// instanced draws: instanceCount copies reading per-instance data from
+	// instanceBuffer, bound to DrawQueue::InstanceSlot at instanceOffset
+	// bytes, from instance startInstance on. Without a buffer the packet is
+	// one plain draw, unless it goes through DrawQueue::EnqueueInstance().
+	BufferHandle		instanceBuffer;
+	unsigned int		instanceStride	{ 0u };
+	unsigned int		instanceOffset	{ 0u };
+	unsigned int		instanceCount	{ 1u };
+	unsigned int		startInstance	{ 0u };
+	// indirect draws: the instanced draw takes its arguments from the
+	// DrawIndexedIndirectArgs at argsOffset bytes into argsBuffer (see
+	// IndirectDrawBuilder); indexCount, startIndex, baseVertex,
+	// instanceCount and startInstance are not used
+	BufferHandle		argsBuffer;
+	unsigned int		argsOffset		{ 0u };
+	// caller defined grouping below the shaders (textures/constants once the
+	// device binds them); only used for ordering
+	uint32_t			material	{ 0u };
+	// view depth in [0,1], 0 = near; equal state is drawn front to back
+	float				depth		{ 0.0f };
+};
+
+// Per-instance data of InstancedVertexShader.hlsl: the rows of a row major
+// 3x4 transform applied to the mesh's positions and a color its vertex
+// colors are multiplied with.
+struct InstanceData
+{
+	float			transform0[4];
+	float			transform1[4];
+	float			transform2[4];
+	unsigned char	color[4];
+};
+
+// Collects the draws of a frame and issues them sorted by state.
+//
+// Each packet gets a 64 bit key, most significant field first:
+//
+//	[63..52] pipeline  (vertex shader, pixel shader, input layout)
+//	[51..40] material
+//	[39..24] geometry  (vertex buffer, index buffer)
+//	[23.. 0] depth     (front to back)
+//
+// Pipeline and geometry combinations are mapped to small dense ids the first
+// time they are seen. Ids that do not fit their field wrap around, which can
+// only cost state changes: Submit() compares the real handles, not the key.
+//
+// The keys are LSD radix sorted (8 bit digits, passes where every key has
+// the same digit are skipped), which is stable and linear in the packet count.
+//
+// EnqueueInstance() batches: instances of packets that are equal in all but
+// depth become one packet drawn instanced, sorted by its nearest instance.
+// Their data is gathered into one buffer per frame, grouped by packet in
+// the order the instances came in:
+//
+//	queue.EnqueueInstance(packet, &instance);	// any number of times
+//	size = queue.PrepareInstances();
+//	queue.WriteInstances(buffer, offset, pData);	// size bytes at pData
+//	queue.Submit(device);
+class DrawQueue
+{
+public:
+	// vertex buffer slot of the per-instance stream; slot 1 is taken by
+	// DrawPacket::attributeBuffer
+	static constexpr unsigned int InstanceSlot = 2u;
+
+	// input elements of InstanceData for layouts of instanced pipelines,
+	// listed after the mesh's elements
+	static constexpr InputElementDesc InstanceElements[] =
+	{
+		VERTEX_INSTANCE_ELEMENT(InstanceData, transform0, "Transform", 0, InstanceSlot),
+		VERTEX_INSTANCE_ELEMENT(InstanceData, transform1, "Transform", 1, InstanceSlot),
+		VERTEX_INSTANCE_ELEMENT(InstanceData, transform2, "Transform", 2, InstanceSlot),
+		VERTEX_INSTANCE_ELEMENT(InstanceData, color, "InstanceColor", 0, InstanceSlot),
+	};
+
+	struct Stats
+	{
+		unsigned int packets				{ 0u };	// after batching
+		unsigned int sortPasses				{ 0u };
+		unsigned int stateChanges			{ 0u };	// binds issued
+		unsigned int stateChangesAvoided	{ 0u };	// binds unsorted immediate drawing would have issued on top
+		unsigned int instances				{ 0u };	// drawn by instanced draws
+		unsigned int batchedInstances		{ 0u };	// of those, queued through EnqueueInstance()
+		unsigned int droppedInstances		{ 0u };	// queued, but WriteInstances() had no memory for them
+		unsigned int indirectDraws			{ 0u };	// packets drawn with arguments from a buffer
+	};
+
+public:
+	DrawQueue() = default;
+	DrawQueue(const DrawQueue&) = delete;
+	DrawQueue& operator=(const DrawQueue&) = delete;
+
+	void			Enqueue(const DrawPacket& packet);
+	// queues one instance of packet, whose per-instance data are the
+	// packet.instanceStride bytes at pInstanceData; the packet's instance
+	// fields other than the stride and its indirect arguments are ignored
+	void			EnqueueInstance(const DrawPacket& packet, const void* pInstanceData);
+	// gives every batch its range of the instance data and returns the
+	// bytes WriteInstances() writes; call once all instances are queued
+	size_t			PrepareInstances();
+	// copies the instance data to pData, which is offset bytes into buffer,
+	// and points the batches at it; nullptr drops the batches instead
+	void			WriteInstances(BufferHandle buffer, unsigned int offset, void* pData) noexcept;
+	// sorts and issues every queued packet, then empties the queue; frame
+	// wide state (target, viewport, topology, depth mode) must already be bound
+	void			Submit(IRenderDevice& device);
+	// issues every queued packet with the pixel shader unbound and keeps the
+	// queue, for a depth prepass; the Submit() that follows draws the same
+	// packets in the same order without sorting again
+	void			SubmitDepthOnly(IRenderDevice& device);
+
+	size_t			GetPacketCount() const noexcept { return packets.size(); }
+	// counters of the last Submit() (and the SubmitDepthOnly() before it)
+	const Stats&	GetStats() const noexcept { return stats; }
+
+private:
+	uint64_t		MakeKey(const DrawPacket& packet);
+	void			Sort();
+	void			Issue(IRenderDevice& device, bool pixelShaders);
+	void			ResetStats() noexcept;
+
+private:
+	std::vector<DrawPacket>	packets;
+	std::vector<uint64_t>	keys;
+	std::vector<uint32_t>	order;
+	// order is up to date (a depth-only pass ran since the last Submit())
+	bool					sorted	{ false };
+
+	// radix sort scratch
+	std::vector<uint64_t>	keysTemp;
+	std::vector<uint32_t>	orderTemp;
+
+	std::unordered_map<uint64_t, uint32_t>	pipelineIds;
+	std::unordered_map<uint64_t, uint32_t>	geometryIds;
+
+	// EnqueueInstance() batches, each one packet of packets
+	struct Batch
+	{
+		uint32_t	packet;
+		uint32_t	instanceCount;
+		uint32_t	firstByte;	// in the instance buffer, by PrepareInstances()
+	};
+	std::vector<Batch>						batches;
+	std::unordered_map<uint64_t, uint32_t>	batchIds;	// packet hash -> batch
+	// batch and data of every queued instance, in order
+	std::vector<uint32_t>					instanceBatches;
+	std::vector<unsigned char>				instanceData;
+	uint32_t								lastBatch			{ ~0u };	// of the last instance
+	unsigned int							droppedInstances	{ 0u };
+
+	Stats stats;
+};
@@ -0,0 +1,133 @@
+#include "FramePacer.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace
+{
+	// weight of the newest frame in the CPU time prediction
+	constexpr double CpuTimeSmoothing = 0.1;
+	// the prediction is scaled up so a slightly slower frame still makes it
+	constexpr double PredictionHeadroom = 1.25;
+	// DXGI's default maximum frame latency
+	constexpr unsigned int DefaultFrameLatency = 3u;
+}
+
+double SystemFrameClock::Now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void SystemFrameClock::Sleep(double seconds)
+{
+	std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+}
+
+void SystemFrameClock::Spin()
+{
+	std::this_thread::yield();
+}
+
+FramePacer::FramePacer(IFrameClock& clock) noexcept
+	: clock(clock)
+{
+	frameStart = clock.Now();
+}
+
+void FramePacer::SetPolicy(Policy policy, double targetRate) noexcept
+{
+	this->policy = policy;
+	interval = targetRate > 0.0 ? 1.0 / targetRate : 0.0;
+	deadline = clock.Now() + interval;
+}
+
+PresentMode FramePacer::GetPresentMode() const noexcept
+{
+	return policy == Policy::VSync || policy == Policy::LowLatency ? PresentMode::VSync : PresentMode::Immediate;
+}
+
+unsigned int FramePacer::GetMaxFrameLatency() const noexcept
+{
+	return policy == Policy::LowLatency ? 1u : DefaultFrameLatency;
+}
+
+void FramePacer::BeforePresent()
+{
+	const double now = clock.Now();
+	const double cpuTime = now - frameStart;
+	cpuEstimate = cpuEstimate > 0.0 ? cpuEstimate + (cpuTime - cpuEstimate) * CpuTimeSmoothing : cpuTime;
+	stats.predictedCpuTime = cpuEstimate;
+
+	if (!IsPaced())
+	{
+		return;
+	}
+	if (now > deadline)
+	{
+		stats.missedDeadlines++;
+		deadline = now;
+	}
+	else if (policy == Policy::FixedRate)
+	{
+		// vsync does this wait in the other paced policy
+		WaitUntil(deadline);
+	}
+}
+
+void FramePacer::FrameEnd()
+{
+	const double now = clock.Now();
+	if (ended)
+	{
+		// Welford's online mean/variance
+		const double frameTime = now - lastFrameEnd;
+		stats.frames++;
+		const double delta = frameTime - stats.meanFrameTime;
+		stats.meanFrameTime += delta / double(stats.frames);
+		frameTimeM2 += delta * (frameTime - stats.meanFrameTime);
+		stats.frameTimeVariance = stats.frames > 1u ? frameTimeM2 / double(stats.frames - 1u) : 0.0;
+		stats.maxFrameTime = std::max(stats.maxFrameTime, frameTime);
+	}
+	lastFrameEnd = now;
+	ended = true;
+
+	if (IsPaced())
+	{
+		// a present that blocked past the next deadline restarts the schedule
+		deadline = std::max(deadline + interval, now);
+		WaitUntil(deadline - cpuEstimate * PredictionHeadroom);
+	}
+	frameStart = clock.Now();
+}
+
+void FramePacer::ResetStats() noexcept
+{
+	stats = {};
+	stats.predictedCpuTime = cpuEstimate;
+	frameTimeM2 = 0.0;
+	ended = false;
+}
+
+bool FramePacer::IsPaced() const noexcept
+{
+	return interval > 0.0 && (policy == Policy::FixedRate || policy == Policy::LowLatency);
+}
+
+void FramePacer::WaitUntil(double time)
+{
+	double now = clock.Now();
+	if (time - now > spinThreshold)
+	{
+		clock.Sleep(time - now - spinThreshold);
+		const double woken = clock.Now();
+		stats.sleepTime += woken - now;
+		now = woken;
+	}
+	const double spinStart = now;
+	while (now < time)
+	{
+		clock.Spin();
+		now = clock.Now();
+	}
+	stats.spinTime += now - spinStart;
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include "RenderDevice.h"
+#include <cstdint>
+
+// Time source of the FramePacer. The pacer never reads a clock or sleeps on
+// its own, so it can be driven by a simulated clock (no real waiting) as
+// well as by SystemFrameClock.
+class IFrameClock
+{
+public:
+	virtual ~IFrameClock() = default;
+
+	virtual double	Now() = 0;							// seconds, monotonic
+	virtual void	Sleep(double seconds) = 0;			// may oversleep by the OS quantum
+	virtual void	Spin() = 0;							// one busy-wait step, Now() must advance
+};
+
+// steady_clock and std::this_thread
+class SystemFrameClock : public IFrameClock
+{
+public:
+	double	Now() override;
+	void	Sleep(double seconds) override;
+	void	Spin() override;
+};
+
+// Decides how a frame is presented and, for the paced policies, when the next
+// one may start.
+//
+//	VSync		present on vertical blank, up to 3 frames queued (what D3D did
+//				before)
+//	Uncapped	present immediately, no waiting anywhere (benchmarking)
+//	FixedRate	present immediately, frames are spaced 1/targetRate apart
+//	LowLatency	present on vertical blank with at most one frame queued; the
+//				device's Present() returns once that frame left the queue (the
+//				swap chain's frame latency waitable object). With a target rate
+//				(the display refresh) frames are also started late
+//
+// Every paced frame has a deadline, the previous one plus 1/targetRate. The
+// pacer predicts the CPU time of the next frame (moving average of the
+// measured ones, with some headroom) and delays the start of the frame to
+// deadline - prediction, so input is sampled as late as possible. With
+// FixedRate a frame that still finishes early waits for its deadline before
+// it is presented. Waiting sleeps while more than spinThreshold is left and
+// spins the rest, because OS sleeps are only accurate to a millisecond or
+// worse. A frame that misses its deadline restarts the schedule instead of
+// rushing the following ones.
+//
+// Call BeforePresent() right before and FrameEnd() right after the device's
+// Present(). FrameEnd() returns once the next frame may start.
+class FramePacer
+{
+public:
+	enum class Policy
+	{
+		VSync,
+		Uncapped,
+		FixedRate,
+		LowLatency,
+	};
+
+	struct Stats
+	{
+		uint64_t	frames				{ 0u };
+		double		meanFrameTime		{ 0.0 };	// seconds between FrameEnd() calls
+		double		frameTimeVariance	{ 0.0 };	// seconds^2
+		double		maxFrameTime		{ 0.0 };
+		double		predictedCpuTime	{ 0.0 };	// current prediction
+		uint64_t	missedDeadlines		{ 0u };
+		double		sleepTime			{ 0.0 };	// spent waiting, summed
+		double		spinTime			{ 0.0 };
+	};
+
+public:
+	explicit FramePacer(IFrameClock& clock) noexcept;
+	FramePacer(const FramePacer&) = delete;
+	FramePacer& operator=(const FramePacer&) = delete;
+
+	// targetRate in frames per second; required for FixedRate, optional for
+	// LowLatency and ignored otherwise
+	void			SetPolicy(Policy policy, double targetRate = 0.0) noexcept;
+	Policy			GetPolicy() const noexcept { return policy; }
+
+	// what the device has to be set to for the policy
+	PresentMode		GetPresentMode() const noexcept;
+	unsigned int	GetMaxFrameLatency() const noexcept;
+
+	void			BeforePresent();
+	void			FrameEnd();
+
+	void			SetSpinThreshold(double seconds) noexcept { spinThreshold = seconds; }
+	const Stats&	GetStats() const noexcept { return stats; }
+	void			ResetStats() noexcept;
+
+private:
+	bool			IsPaced() const noexcept;
+	void			WaitUntil(double time);
+
+private:
+	IFrameClock&	clock;
+	Policy			policy			{ Policy::VSync };
+	double			interval		{ 0.0 };	// 1 / targetRate
+	double			spinThreshold	{ 0.002 };
+
+	double			frameStart		{ 0.0 };	// when the current frame began
+	double			lastFrameEnd	{ 0.0 };
+	bool			ended			{ false };	// lastFrameEnd is valid
+	double			deadline		{ 0.0 };	// when the current frame should be presented
+	double			cpuEstimate		{ 0.0 };
+
+	Stats			stats;
+	double			frameTimeM2		{ 0.0 };	// Welford running sum of squares
+};
@@ -0,0 +1,266 @@
+#include "FrustumCuller.h"
+#include "Simd.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+	// slots per job, a multiple of SimdWidth; big enough that a job is a few
+	// tens of microseconds
+	constexpr size_t CullGrain = 16384u;
+	static_assert(CullGrain % SimdWidth == 0u, "chunks start on a SIMD block");
+
+	size_t PaddedSize(size_t count) noexcept
+	{
+		return (count + SimdWidth - 1u) / SimdWidth * SimdWidth;
+	}
+
+	// Appends the ids of the set lanes of the block at slot i, in lane order.
+	// Every lane is stored and only the visible ones advance the output;
+	// which objects survive follows no pattern, so a branch per lane would
+	// mispredict all the time. A store never lands past slot i + lane.
+	size_t WriteIds(int mask, const uint32_t* pIds, size_t i, size_t end, uint32_t* pOut) noexcept
+	{
+		if (mask == 0)
+		{
+			return 0u;
+		}
+		const size_t lanes = std::min(end - i, size_t(SimdWidth));
+		size_t written = 0u;
+		for (size_t lane = 0u; lane < lanes; lane++)
+		{
+			pOut[written] = pIds[i + lane];
+			written += (mask >> lane) & 1;
+		}
+		return written;
+	}
+}
+
+FrustumCuller::FrustumCuller(JobSystem& jobs)
+	: jobs(jobs)
+{
+}
+
+FrustumCuller::Frustum FrustumCuller::ExtractFrustum(const float m[16]) noexcept
+{
+	// a clip space point is inside where -w <= x <= w, -w <= y <= w and
+	// 0 <= z <= w; each bound is a combination of matrix rows
+	const float* row[4] = { m, m + 4, m + 8, m + 12 };
+	const float sign[6] = { 1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f };
+	const int axis[6] = { 0, 0, 1, 1, 2, 2 };
+
+	Frustum frustum;
+	for (int p = 0; p < 6; p++)
+	{
+		// the far plane (z >= 0) does not involve w
+		const float w = p == 5 ? 0.0f : 1.0f;
+		float plane[4];
+		for (int c = 0; c < 4; c++)
+		{
+			plane[c] = w * row[3][c] + sign[p] * row[axis[p]][c];
+		}
+		const float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		Plane& out = frustum.planes[p];
+		if (length > 0.0f)
+		{
+			out = { { plane[0] / length, plane[1] / length, plane[2] / length }, plane[3] / length };
+		}
+		else
+		{
+			out = { { 0.0f, 0.0f, 0.0f }, 1.0f };
+		}
+	}
+	return frustum;
+}
+
+uint32_t FrustumCuller::AddSphere(uint32_t id, const float center[3], float radius)
+{
+	const uint32_t slot = uint32_t(sphereCount++);
+	const size_t size = PaddedSize(sphereCount);
+	for (std::vector<float>* pArray : { &sphereX, &sphereY, &sphereZ, &sphereRadius })
+	{
+		pArray->resize(size);
+	}
+	sphereIds.resize(size);
+	sphereIds[slot] = id;
+	SetSphere(slot, center, radius);
+	return slot;
+}
+
+uint32_t FrustumCuller::AddBox(uint32_t id, const float min[3], const float max[3])
+{
+	const uint32_t slot = uint32_t(boxCount++);
+	const size_t size = PaddedSize(boxCount);
+	for (std::vector<float>* pArray : { &boxX, &boxY, &boxZ, &boxExtentX, &boxExtentY, &boxExtentZ })
+	{
+		pArray->resize(size);
+	}
+	boxIds.resize(size);
+	boxIds[slot] = id;
+	SetBox(slot, min, max);
+	return slot;
+}
+
+void FrustumCuller::SetSphere(uint32_t slot, const float center[3], float radius) noexcept
+{
+	sphereX[slot] = center[0];
+	sphereY[slot] = center[1];
+	sphereZ[slot] = center[2];
+	sphereRadius[slot] = radius;
+}
+
+void FrustumCuller::SetBox(uint32_t slot, const float min[3], const float max[3]) noexcept
+{
+	boxX[slot] = 0.5f * (min[0] + max[0]);
+	boxY[slot] = 0.5f * (min[1] + max[1]);
+	boxZ[slot] = 0.5f * (min[2] + max[2]);
+	boxExtentX[slot] = 0.5f * (max[0] - min[0]);
+	boxExtentY[slot] = 0.5f * (max[1] - min[1]);
+	boxExtentZ[slot] = 0.5f * (max[2] - min[2]);
+}
+
+void FrustumCuller::Clear() noexcept
+{
+	sphereCount = 0u;
+	boxCount = 0u;
+	for (std::vector<float>* pArray : { &sphereX, &sphereY, &sphereZ, &sphereRadius,
+										&boxX, &boxY, &boxZ, &boxExtentX, &boxExtentY, &boxExtentZ })
+	{
+		pArray->clear();
+	}
+	sphereIds.clear();
+	boxIds.clear();
+}
+
+size_t FrustumCuller::Cull(const float toClip[16], uint32_t* pVisible)
+{
+	return Cull(ExtractFrustum(toClip), pVisible);
+}
+
+size_t FrustumCuller::Cull(const Frustum& frustum, uint32_t* pVisible)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	// chunks never straddle the two sets; chunk c writes from the slot it
+	// starts at, spheres first
+	const size_t sphereChunks = (sphereCount + CullGrain - 1u) / CullGrain;
+	const size_t boxChunks = (boxCount + CullGrain - 1u) / CullGrain;
+	chunkVisible.resize(sphereChunks + boxChunks);
+	jobs.ParallelFor(sphereChunks + boxChunks, 1u, [&](size_t begin, size_t end, unsigned int)
+	{
+		for (size_t c = begin; c < end; c++)
+		{
+			if (c < sphereChunks)
+			{
+				const size_t first = c * CullGrain;
+				chunkVisible[c] = CullSpheres(frustum, first, std::min(first + CullGrain, sphereCount), pVisible + first);
+			}
+			else
+			{
+				const size_t first = (c - sphereChunks) * CullGrain;
+				chunkVisible[c] = CullBoxes(frustum, first, std::min(first + CullGrain, boxCount), pVisible + sphereCount + first);
+			}
+		}
+	});
+
+	// pack the chunks; a chunk never moves past its own start
+	size_t visible = 0u;
+	for (size_t c = 0u; c < chunkVisible.size(); c++)
+	{
+		const size_t first = c < sphereChunks ? c * CullGrain : sphereCount + (c - sphereChunks) * CullGrain;
+		std::copy(pVisible + first, pVisible + first + chunkVisible[c], pVisible + visible);
+		visible += chunkVisible[c];
+	}
+
+	stats.spheresTested += sphereCount;
+	stats.boxesTested += boxCount;
+	stats.visible += visible;
+	stats.lastSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	stats.seconds += stats.lastSeconds;
+	return visible;
+}
+
+size_t FrustumCuller::CullSpheres(const Frustum& frustum, size_t begin, size_t end, uint32_t* pOut) const noexcept
+{
+	size_t written = 0u;
+	for (size_t i = begin; i < end; i += SimdWidth)
+	{
+		const SimdFloat x = SimdFloat::Load(&sphereX[i]);
+		const SimdFloat y = SimdFloat::Load(&sphereY[i]);
+		const SimdFloat z = SimdFloat::Load(&sphereZ[i]);
+		const SimdFloat negRadius = -SimdFloat::Load(&sphereRadius[i]);
+		SimdInt outside(0);
+		for (const Plane& plane : frustum.planes)
+		{
+			const SimdFloat distance = MulAdd(SimdFloat(plane.normal[0]), x, MulAdd(SimdFloat(plane.normal[1]), y,
+				MulAdd(SimdFloat(plane.normal[2]), z, SimdFloat(plane.d))));
+			outside |= CmpLt(distance, negRadius);
+		}
+		written += WriteIds(~MoveMask(outside), sphereIds.data(), i, end, pOut + written);
+	}
+	return written;
+}
+
+size_t FrustumCuller::CullBoxes(const Frustum& frustum, size_t begin, size_t end, uint32_t* pOut) const noexcept
+{
+	size_t written = 0u;
+	for (size_t i = begin; i < end; i += SimdWidth)
+	{
+		const SimdFloat x = SimdFloat::Load(&boxX[i]);
+		const SimdFloat y = SimdFloat::Load(&boxY[i]);
+		const SimdFloat z = SimdFloat::Load(&boxZ[i]);
+		const SimdFloat extentX = SimdFloat::Load(&boxExtentX[i]);
+		const SimdFloat extentY = SimdFloat::Load(&boxExtentY[i]);
+		const SimdFloat extentZ = SimdFloat::Load(&boxExtentZ[i]);
+		SimdInt outside(0);
+		for (const Plane& plane : frustum.planes)
+		{
+			const SimdFloat distance = MulAdd(SimdFloat(plane.normal[0]), x, MulAdd(SimdFloat(plane.normal[1]), y,
+				MulAdd(SimdFloat(plane.normal[2]), z, SimdFloat(plane.d))));
+			// how far the box reaches towards the plane normal
+			const SimdFloat reach = MulAdd(SimdFloat(std::fabs(plane.normal[0])), extentX, MulAdd(SimdFloat(std::fabs(plane.normal[1])), extentY,
+				SimdFloat(std::fabs(plane.normal[2])) * extentZ));
+			outside |= CmpLt(distance, -reach);
+		}
+		written += WriteIds(~MoveMask(outside), boxIds.data(), i, end, pOut + written);
+	}
+	return written;
+}
+
+size_t FrustumCuller::CullReference(const Frustum& frustum, uint32_t* pVisible) const noexcept
+{
+	auto distance = [](const Plane& plane, float x, float y, float z)
+	{
+		return plane.normal[0] * x + plane.normal[1] * y + plane.normal[2] * z + plane.d;
+	};
+
+	size_t visible = 0u;
+	for (size_t i = 0u; i < sphereCount; i++)
+	{
+		bool inside = true;
+		for (const Plane& plane : frustum.planes)
+		{
+			inside = inside && distance(plane, sphereX[i], sphereY[i], sphereZ[i]) >= -sphereRadius[i];
+		}
+		if (inside)
+		{
+			pVisible[visible++] = sphereIds[i];
+		}
+	}
+	for (size_t i = 0u; i < boxCount; i++)
+	{
+		bool inside = true;
+		for (const Plane& plane : frustum.planes)
+		{
+			const float reach = std::fabs(plane.normal[0]) * boxExtentX[i] + std::fabs(plane.normal[1]) * boxExtentY[i] +
+								std::fabs(plane.normal[2]) * boxExtentZ[i];
+			inside = inside && distance(plane, boxX[i], boxY[i], boxZ[i]) >= -reach;
+		}
+		if (inside)
+		{
+			pVisible[visible++] = boxIds[i];
+		}
+	}
+	return visible;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include "JobSystem.h"
+#include <cstdint>
+#include <vector>
+
+// View frustum culling of object bounds, 8 objects per test.
+//
+// Bounds are bounding spheres and axis aligned boxes, kept apart and in
+// structure-of-arrays form (all center x next to each other, ...), so a
+// SIMD load brings the same component of 8 objects. Every object carries
+// an id of the caller's choosing (a draw index, an entity, ...) which is
+// what Cull() reports for the visible ones.
+//
+// The 6 planes come from the matrix that takes world positions to clip
+// space (row major, applied to column vectors, reversed Z as everywhere in
+// the renderer: 1 = near plane, 0 = far plane). An object is culled when
+// it lies entirely on the outside of one of them. Like all plane tests this
+// is conservative: a large object next to a frustum corner may be kept.
+//
+// The slots are split into chunks over the JobSystem; every chunk writes
+// its visible ids to the output at its own offset and the chunks are
+// packed together afterwards, so the list is in slot order (spheres, then
+// boxes) whatever the thread count.
+class FrustumCuller
+{
+public:
+	// inside where dot(normal, p) + d >= 0; normal is unit length
+	struct Plane
+	{
+		float normal[3];
+		float d;
+	};
+
+	struct Frustum
+	{
+		// left, right, bottom, top, near, far
+		Plane planes[6];
+	};
+
+	struct Stats
+	{
+		uint64_t	spheresTested	{ 0u };
+		uint64_t	boxesTested		{ 0u };
+		uint64_t	visible			{ 0u };
+		double		seconds			{ 0.0 };	// all Cull() calls
+		double		lastSeconds		{ 0.0 };
+	};
+
+public:
+	explicit FrustumCuller(JobSystem& jobs);
+	FrustumCuller(const FrustumCuller&) = delete;
+	FrustumCuller& operator=(const FrustumCuller&) = delete;
+
+	// planes of the clip space volume of toClip; a plane that degenerates
+	// (the far plane of an infinite projection) keeps everything
+	static Frustum ExtractFrustum(const float toClip[16]) noexcept;
+
+	// the returned slot stays valid until Clear() and updates the bounds of
+	// a moving object
+	uint32_t	AddSphere(uint32_t id, const float center[3], float radius);
+	uint32_t	AddBox(uint32_t id, const float min[3], const float max[3]);
+	void		SetSphere(uint32_t slot, const float center[3], float radius) noexcept;
+	void		SetBox(uint32_t slot, const float min[3], const float max[3]) noexcept;
+	void		Clear() noexcept;
+
+	size_t		GetSphereCount()	const noexcept { return sphereCount; }
+	size_t		GetBoxCount()		const noexcept { return boxCount; }
+
+	// writes the ids of the objects that intersect the frustum to pVisible
+	// (GetSphereCount() + GetBoxCount() entries at most); returns how many
+	size_t		Cull(const float toClip[16], uint32_t* pVisible);
+	size_t		Cull(const Frustum& frustum, uint32_t* pVisible);
+	// one object and one plane at a time; the same list, up to rounding of
+	// objects that touch a plane
+	size_t		CullReference(const Frustum& frustum, uint32_t* pVisible) const noexcept;
+
+	const Stats&	GetStats() const noexcept { return stats; }
+	void			ResetStats() noexcept { stats = {}; }
+
+private:
+	// visible ids of slots [begin,end) of a set written from pOut on;
+	// returns how many
+	size_t	CullSpheres(const Frustum& frustum, size_t begin, size_t end, uint32_t* pOut) const noexcept;
+	size_t	CullBoxes(const Frustum& frustum, size_t begin, size_t end, uint32_t* pOut) const noexcept;
+
+private:
+	JobSystem&	jobs;
+
+	// SoA bounds, each array padded to a multiple of SimdWidth
+	size_t					sphereCount	{ 0u };
+	std::vector<float>		sphereX, sphereY, sphereZ, sphereRadius;
+	std::vector<uint32_t>	sphereIds;
+	// boxes as center and half extent
+	size_t					boxCount	{ 0u };
+	std::vector<float>		boxX, boxY, boxZ, boxExtentX, boxExtentY, boxExtentZ;
+	std::vector<uint32_t>	boxIds;
+
+	std::vector<size_t>		chunkVisible;	// Cull() scratch
+
+	Stats stats;
+};
@@ -1,59 +1,33 @@
 ﻿#pragma once
-#include "Genix.h"
 #include "GenixException.h"
-#include <d3d11.h>
-#include <wrl.h>
 #include <vector>
-#include "DxgiInfoManager.h"
-
-// To set up Direct3D we need to complete the following four steps:
-// 1. Define the device types and feature levels we want to check for.
-// 2. Create the Direct3D device, rendering context, and swap chain.
-// 3. Create the render target.
-// 4. Set the viewport.
-
-// In Direct3D 11 we can have a hardware device, a WARP device, a software
-// driver device, or a reference device.
-// -A hardware device is a Direct3D device that runs on the graphics hardware and
-// is the fastest of all devices
-// -A reference device is used for users without hardware support by performing the
-// rendering on the CPU. In other words, the reference device completely emulates
-// hardware rendering on the CPU within software. This process is very slow,
-// inefficient, and should only be used during development if there is no other
-// alternative.
-// -A software driver device allows developers to write their own software
-// rendering driver and use it with Direct3D. This is called a pluggable software
-// driver.
-// -The WARP device is an efficient CPU-rendering device that emulates the full
-// feature set of Direct3D.
-
-// The next step is the creation of the swap chain description.
-// A swap chain is a collection of buffers that are used for displaying frames 
-// to the user. Each time an application presents a new frame for display, 
-// the first buffer in the swap chain takes the place of the displayed buffer. 
-// This process is called swapping or flipping.
-
-// The next step is to create the rendering context, device, and swap chain now that
-// we have the swap chain description. The Direct3D device is the device itself and
-// communicates with the hardware. The Direct3D context is a rendering context
-// that tells the device how to draw. It also includes rendering states and other
-// drawing information. The swap chain as we’ve already discussed is the rendering
-// destinations that the device and context will draw to.
-
-// A render target view is a Direct3D resource written to by the output merger
-// stage. In order for the output merger to render to the swap chain’s back buffer
-// (secondary buffer), we create a render target view of it.
-
-// The last piece of the Direct3D 11 puzzle is the creation and setting of the
-// viewport. The viewport defines the area of the screen we are rendering to. In
-// single player or non-split-screen multiplayer games this is often the entire
-// screen, and so we set the viewport’s width and height to the Direct3D swap
-// chain’s width and height.
+#include <memory>
+#include <string>
+#include "RenderDevice.h"
+#include "ResourceManager.h"
+#include "PipelineStateCache.h"
+#include "DrawQueue.h"
+#include "StateCachingDevice.h"
+#include "RingAllocator.h"
+#include "FramePacer.h"
+#include "IndirectDrawBuilder.h"
+#include "SwapChain.h"
+#ifdef _WIN32
+#include "Genix.h"
+#endif
+
+// Graphics is the front end the application draws through. It does not talk
+// to Direct3D itself: all work is forwarded to an IRenderDevice, which is the
+// D3D11 device when constructed from a window and can be any other device
+// (e.g. the software rasterizer) when one is handed in. Only the HWND
+// constructor and the HRESULT exceptions depend on Windows, so the class
+// also builds on our non-Windows machines.
 class Graphics
 {
 public:
 	class Exception : public GenixException { using GenixException::GenixException; };
 	
+#ifdef _WIN32
 	class HrException : public Exception
 	{
 	public:
@@ -68,6 +42,15 @@ public:
 		HRESULT hr;
 		std::string info;
 	};
+	class DeviceRemovedException : public HrException
+	{
+		using HrException::HrException;
+	public:
+		const char* GetType() const noexcept override;
+	private:
+		std::string reason;
+	};
+#endif
 	class InfoException : public Exception
 	{
 	public:
@@ -78,81 +61,166 @@ public:
 	private:
 		std::string info;
 	};
-	class DeviceRemovedException : public HrException
-	{
-		using HrException::HrException;
-	public:
-		const char* GetType() const noexcept override;
-	private:
-		std::string reason;
-	};
 
 public:
-	Graphics(HWND hWnd);
+#ifdef _WIN32
+	Graphics(HWND hWnd, unsigned int swapChainBuffers = SwapChainBufferCount);
+#endif
+	explicit Graphics(std::unique_ptr<IRenderDevice> pDevice);
 	Graphics(const Graphics&) = delete;
 	Graphics& operator=(const Graphics&) = delete;
 	~Graphics() = default;
 	
+	// issues the draws submitted this frame, sorted by state, presents and
+	// returns when the present policy lets the next frame start
 	void	EndFrame();
+	// clears the back buffer to the color and depth to the far plane
 	void	ClearBuffer(float red, float green, float blue) noexcept;
 	void 	DrawTestTriangle();
+	// the test triangle as an instance; all of a frame's instances are one
+	// instanced draw
+	void	DrawTestTriangle(const InstanceData& instance);
+	// the test triangle for every instance of the builder that is visible
+	// through toClip; the builder's draws are index ranges of the triangle
+	// (AddDraw(GetTestTriangleIndexCount(), 0, 0) is all of it) and its
+	// instances are InstanceData
+	void	DrawTestTriangles(IndirectDrawBuilder& builder, const float toClip[16]);
+	unsigned int GetTestTriangleIndexCount() const noexcept { return testTriangle.indexCount; }
+
+	// queues a draw for EndFrame(); see DrawQueue for the ordering
+	void	Submit(const DrawPacket& packet);
+	// queues one instance of the packet's mesh with packet.instanceStride
+	// bytes of per-instance data; instances of equal packets are drawn
+	// with one instanced draw (see DrawQueue::EnqueueInstance())
+	void	SubmitInstance(const DrawPacket& packet, const void* pInstanceData);
+	// culls the builder's instances against toClip and queues one indirect
+	// draw per draw of the builder; packet supplies the pipeline and the
+	// shared geometry. The visible instances and the arguments go to
+	// transient memory, nothing is queued when no instance is visible.
+	void	SubmitIndirect(const DrawPacket& packet, IndirectDrawBuilder& builder, const float toClip[16]);
+	const DrawQueue::Stats& GetDrawStats() const noexcept { return drawQueue.GetStats(); }
+	// binds issued vs. dropped as redundant during the last frame
+	const StateCachingDevice::Counters& GetStateStats() const noexcept { return pStateCache->GetFrameCounters(); }
+
+	// Per frame memory for dynamic vertex/index data, suballocated from one
+	// dynamic buffer. The first allocation of a frame maps it with DISCARD,
+	// the buffer stays mapped (remapped with NO_OVERWRITE if needed) until
+	// EndFrame(). Align to the vertex stride or index size so the offset can
+	// be expressed as DrawPacket::baseVertex/startIndex. pData is nullptr
+	// when the ring is full.
+	struct TransientAllocation
+	{
+		BufferHandle	buffer;
+		unsigned int	offset	{ 0u };
+		void*			pData	{ nullptr };
+	};
+	TransientAllocation AllocTransient(size_t size, size_t align);
+	const RingAllocator::Stats& GetTransientStats() const noexcept { return transientRing.GetStats(); }
 
-	bool	Get4xMsaaState() const { return b4xMsaaState; }
-	void	Set4xMsaaState(bool value);
+	// count DrawIndexedIndirectArgs of per frame memory in a dynamic
+	// IndirectArgs buffer, handled like the transient one; pArgs is nullptr
+	// when its ring is full
+	struct IndirectArgsAllocation
+	{
+		BufferHandle				buffer;
+		unsigned int				offset	{ 0u };
+		DrawIndexedIndirectArgs*	pArgs	{ nullptr };
+	};
+	IndirectArgsAllocation AllocIndirectArgs(size_t count);
+
+	// deduplicated shader/input layout combinations; safe to use from
+	// several recording threads
+	PipelineStateCache&	GetPipelineStates() noexcept { return *pPipelines; }
+	ResourceManager&	GetResources() noexcept { return *pResources; }
+
+	// VSync by default; see FramePacer for the policies
+	void	SetPresentPolicy(FramePacer::Policy policy, double targetRate = 0.0);
+	const FramePacer::Stats& GetFrameStats() const noexcept { return framePacer.GetStats(); }
+
+	// new client area size of the window; any number of calls between two
+	// frames result in at most one swap chain resize, done by EndFrame()
+	void	Resize(unsigned int width, unsigned int height) noexcept { swapChainResizer.Request(width, height); }
+	SwapChainDesc	GetBackBufferDesc() const noexcept { return pStateCache->GetDesc(); }
+	const SwapChainResizer::Stats& GetResizeStats() const noexcept { return swapChainResizer.GetStats(); }
+
+	// With the depth prepass on, EndFrame() draws the queued packets twice:
+	// depth only first, then color testing for equal depth, so every pixel
+	// is shaded once no matter how much the opaque geometry overlaps. It pays
+	// off when pixel shading costs more than transforming the vertices again.
+	void	SetDepthPrepass(bool enable) noexcept { depthPrepass = enable; }
+	bool	GetDepthPrepass() const noexcept { return depthPrepass; }
+	// min/max depth pyramid of the last frame that drew depth, for culling
+	// the next one; nullptr when the device builds none (see IRenderDevice)
+	const HiZPyramid* GetDepthPyramid() const noexcept { return pStateCache->GetDepthPyramid(); }
+
+	// MSAA samples per pixel: 1 (off), 2, 4 or 8. Applied by EndFrame()
+	// like a resize, only the multisampled target is rebuilt. A count the
+	// device cannot do falls back to the next lower one.
+	void			SetMsaaSampleCount(unsigned int sampleCount) noexcept { requestedSampleCount = sampleCount; }
+	unsigned int	GetMsaaSampleCount() const noexcept { return GetBackBufferDesc().sampleCount; }
 
 private:
+	void		CreateTestTriangle();
+	DrawPacket	InstancedTestTrianglePacket();
+	void		CreateTransientBuffer();
 
-#ifndef NDEBUG
-	DxgiInfoManager infoManager;
-#endif
-
-	// Set true to use 4X MSAA
-	bool b4xMsaaState{ true };    // 4X MSAA enabled
-	UINT i4xMsaaQuality{ 0 };      // quality level of 4X MSAA
-
+public:
 	static constexpr int ScreenWidth = 1280;
 	static constexpr int ScreenHeight = 720;
-	/**
-	 * You can create a swap chain by calling 
-	 * IDXGIFactory2::CreateSwapChainForHwnd, 
-	 * IDXGIFactory2::CreateSwapChainForCoreWindow, or 
-	 * IDXGIFactory2::CreateSwapChainForComposition. 
-	 * 
-	 * You can also create a swap chain when you call 
-	 * D3D11CreateDeviceAndSwapChain; 
-	 * however, you can then only access the 
-	 * sub-set of swap-chain functionality that 
-	 * the IDXGISwapChain interface provides.
-	 */
-
-	/**
-	 *					WHAT IS ComPtr?
-	 * Creates a smart pointer type that represents 
-	 * the interface specified by the template parameter. 
-	 * ComPtr automatically maintains a reference count 
-	 * for the underlying interface pointer and releases 
-	 * the interface when the reference count goes to zero.
-	 * https://docs.microsoft.com/tr-tr/cpp/cppcx/wrl/comptr-class?view=vs-2019
-	 */
-
-	// one or more surfaces for storing rendered 
-	// data before presenting it to an output.
-	Microsoft::WRL::ComPtr<IDXGISwapChain> pSwap;
-
-	// virtual adapter it is used to create resources. 
-	Microsoft::WRL::ComPtr<ID3D11Device> pDevice;	
-
-	// a device context which generates rendering commands.
-	Microsoft::WRL::ComPtr<ID3D11DeviceContext> pContext;
-
-	// identifies the render-target subresources 
-	// that can be accessed during rendering.
-	// A render target is a resource that can be written by the 
-	// output-merger stage at the end of a render pass. Each 
-	// render-target should also have a corresponding depth-stencil view.
-	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> pTarget;
-
-	Microsoft::WRL::ComPtr<IDXGIFactory> pDXGIFactory;
-	Microsoft::WRL::ComPtr<IDXGIDevice>  pDXGIDevice;
-	Microsoft::WRL::ComPtr<IDXGIAdapter> pDXGIAdapter;
+	// flip model minimum: one buffer on screen, one being drawn
+	static constexpr unsigned int SwapChainBufferCount = 2u;
+	// what a window starts with
+	static constexpr unsigned int DefaultMsaaSampleCount = 4u;
+
+	// packed shaders (see ShaderStore); loose .cso files are used without it
+	static constexpr const char* ShaderArchivePath = "Shaders.pack";
+
+	// dynamic vertex/index data and the per-instance data of batched
+	// instances (100k InstanceData are 5.2 MB)
+	static constexpr size_t TransientBufferSize = 32u << 20;
+	static constexpr size_t InstanceAlignment = 16u;
+	// 13k indirect draws a frame over MaxFramesInFlight frames
+	static constexpr size_t IndirectArgsBufferSize = 256u << 10;
+	// frames the GPU may lag behind (DXGI default maximum frame latency);
+	// transient memory of a frame is reused only after this many frames
+	static constexpr unsigned int MaxFramesInFlight = 3u;
+
+private:
+	// every draw goes through the render device; the resource manager
+	// creates objects on it once and hands out handles that stay valid.
+	// Per frame calls go through the state cache in front of the device.
+	std::unique_ptr<IRenderDevice>		pRenderDevice;
+	std::unique_ptr<StateCachingDevice>	pStateCache;
+	std::unique_ptr<ResourceManager>	pResources;
+	std::unique_ptr<PipelineStateCache>	pPipelines;
+	DrawQueue							drawQueue;
+
+	RingAllocator	transientRing { TransientBufferSize };
+	BufferHandle	transientBuffer;
+	void*			pTransientData		{ nullptr };	// while mapped
+	bool			transientDiscarded	{ false };		// mapped with DISCARD this frame
+	uint64_t		frameIndex			{ 0u };
+
+	RingAllocator	indirectArgsRing { IndirectArgsBufferSize };
+	BufferHandle	indirectArgsBuffer;
+	void*			pIndirectArgsData		{ nullptr };
+	bool			indirectArgsDiscarded	{ false };
+
+	SystemFrameClock	frameClock;
+	FramePacer			framePacer { frameClock };
+	SwapChainResizer	swapChainResizer;
+	unsigned int		requestedSampleCount	{ 0u };	// 0 = no change
+	bool				depthPrepass			{ false };
+
+	// resources of the test triangle, created once in the constructor
+	struct TestTriangle
+	{
+		BufferHandle			vertexBuffer;
+		BufferHandle			indexBuffer;
+		const PipelineState*	pPipeline	{ nullptr };
+		// created on first use, the instanced shader may not be built
+		const PipelineState*	pInstancedPipeline	{ nullptr };
+		unsigned int			stride		{ 0u };
+		unsigned int			indexCount	{ 0u };
+	} testTriangle;
 };
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+// IEEE 754 binary16, the storage type of half float vertex elements. Only
+// conversions: arithmetic happens in float.
+struct Half
+{
+	uint16_t bits { 0u };
+};
+
+// rounds to nearest even; overflow becomes infinity, NaN stays NaN
+inline Half FloatToHalf(float value) noexcept
+{
+	uint32_t f;
+	std::memcpy(&f, &value, sizeof(f));
+	const uint16_t sign = uint16_t((f >> 16) & 0x8000u);
+	const uint32_t magnitude = f & 0x7FFFFFFFu;
+
+	if (magnitude >= 0x7F800000u)
+	{
+		// infinity, or NaN with a mantissa bit kept set
+		return { uint16_t(sign | 0x7C00u | (magnitude > 0x7F800000u ? 0x0200u : 0u)) };
+	}
+	if (magnitude >= 0x477FF000u)
+	{
+		// rounds to above 65504
+		return { uint16_t(sign | 0x7C00u) };
+	}
+	if (magnitude < 0x38800000u)
+	{
+		// below the smallest normal half: a denormal (or zero), rounded in
+		// float by adding 0.5, whose exponent shifts the mantissa into place
+		float denormal;
+		const uint32_t absolute = magnitude;
+		std::memcpy(&denormal, &absolute, sizeof(denormal));
+		denormal += 0.5f;
+		uint32_t rounded;
+		std::memcpy(&rounded, &denormal, sizeof(rounded));
+		return { uint16_t(sign | (rounded - 0x3F000000u)) };
+	}
+	// rebias the exponent (127 -> 15) and round the 13 dropped bits to even
+	const uint32_t odd = (magnitude >> 13) & 1u;
+	const uint32_t rebiased = magnitude - ((127u - 15u) << 23) + 0x0FFFu + odd;
+	return { uint16_t(sign | (rebiased >> 13)) };
+}
+
+inline float HalfToFloat(Half value) noexcept
+{
+	const uint32_t sign = uint32_t(value.bits & 0x8000u) << 16;
+	const uint32_t exponent = (value.bits >> 10) & 0x1Fu;
+	const uint32_t mantissa = value.bits & 0x03FFu;
+	uint32_t f;
+	if (exponent == 0x1Fu)
+	{
+		f = sign | 0x7F800000u | (mantissa << 13);
+	}
+	else if (exponent != 0u)
+	{
+		f = sign | ((exponent + 127u - 15u) << 23) | (mantissa << 13);
+	}
+	else
+	{
+		// zero or denormal: mantissa * 2^-24
+		float denormal = float(mantissa) * (1.0f / 16777216.0f);
+		std::memcpy(&f, &denormal, sizeof(f));
+		f |= sign;
+	}
+	float result;
+	std::memcpy(&result, &f, sizeof(result));
+	return result;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Hashes for keying caches by content. They are fast, not collision
+// resistant: do not use them where an attacker controls the input.
+
+constexpr uint64_t HashSeed = 14695981039346656037ull;
+
+// 64 bit FNV-1a over a byte range
+inline uint64_t HashBytes(const void* pData, size_t size, uint64_t seed = HashSeed) noexcept
+{
+	const unsigned char* p = static_cast<const unsigned char*>(pData);
+	uint64_t hash = seed;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= p[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// HashBytes() of a NUL terminated string, usable in constant expressions
+constexpr uint64_t HashString(const char* pString, uint64_t seed = HashSeed) noexcept
+{
+	uint64_t hash = seed;
+	for (; *pString; pString++)
+	{
+		hash ^= (unsigned char)*pString;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// mixes one value into a running hash (splitmix64 finalizer)
+constexpr uint64_t HashCombine(uint64_t seed, uint64_t value) noexcept
+{
+	uint64_t x = seed ^ (value + 0x9E3779B97F4A7C15ull + (seed << 6) + (seed >> 2));
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+	return x ^ (x >> 31);
+}
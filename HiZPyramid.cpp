@@ -0,0 +1,176 @@
+#include "HiZPyramid.h"
+#include "JobSystem.h"
+#include "Simd.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+	// rows per job; the small levels are not worth splitting
+	constexpr unsigned int BuildGrain = 16u;
+
+	// One row of a level from the two rows below it (the same row twice for
+	// the last row of an odd height). For level 0 the min and max rows are
+	// both the depth buffer.
+	void ReduceRow(const float* pMin0, const float* pMin1, const float* pMax0, const float* pMax1,
+				   unsigned int srcWidth, float* pMin, float* pMax, unsigned int dstWidth) noexcept
+	{
+		unsigned int x = 0u;
+		// 8 texels from the 16 below each; the last texel of an odd width
+		// has only one, it is left to the scalar loop
+		for (; x + SimdWidth <= srcWidth / 2u; x += SimdWidth)
+		{
+			const unsigned int s = 2u * x;
+			const SimdFloat minLo = Min(SimdFloat::Load(pMin0 + s), SimdFloat::Load(pMin1 + s));
+			const SimdFloat minHi = Min(SimdFloat::Load(pMin0 + s + SimdWidth), SimdFloat::Load(pMin1 + s + SimdWidth));
+			PairwiseMin(minLo, minHi).Store(pMin + x);
+			const SimdFloat maxLo = Max(SimdFloat::Load(pMax0 + s), SimdFloat::Load(pMax1 + s));
+			const SimdFloat maxHi = Max(SimdFloat::Load(pMax0 + s + SimdWidth), SimdFloat::Load(pMax1 + s + SimdWidth));
+			PairwiseMax(maxLo, maxHi).Store(pMax + x);
+		}
+		for (; x < dstWidth; x++)
+		{
+			const unsigned int s0 = 2u * x;
+			const unsigned int s1 = std::min(s0 + 1u, srcWidth - 1u);
+			pMin[x] = std::min(std::min(pMin0[s0], pMin0[s1]), std::min(pMin1[s0], pMin1[s1]));
+			pMax[x] = std::max(std::max(pMax0[s0], pMax0[s1]), std::max(pMax1[s0], pMax1[s1]));
+		}
+	}
+}
+
+void HiZPyramid::Build(const float* pDepth, unsigned int width, unsigned int height, JobSystem* pJobs)
+{
+	const auto start = std::chrono::steady_clock::now();
+	Allocate(width, height);
+
+	for (size_t l = 0u; l < levels.size(); l++)
+	{
+		Level& level = levels[l];
+		const float* pSrcMin = l == 0u ? pDepth : levels[l - 1u].minDepth.data();
+		const float* pSrcMax = l == 0u ? pDepth : levels[l - 1u].maxDepth.data();
+		const unsigned int srcWidth = l == 0u ? width : levels[l - 1u].width;
+		const unsigned int srcHeight = l == 0u ? height : levels[l - 1u].height;
+
+		auto reduceRows = [&](size_t begin, size_t end, unsigned int)
+		{
+			for (size_t y = begin; y < end; y++)
+			{
+				const size_t row0 = 2u * y * srcWidth;
+				const size_t row1 = std::min(unsigned(2u * y + 1u), srcHeight - 1u) * size_t(srcWidth);
+				ReduceRow(pSrcMin + row0, pSrcMin + row1, pSrcMax + row0, pSrcMax + row1, srcWidth,
+						  level.minDepth.data() + y * level.width, level.maxDepth.data() + y * level.width, level.width);
+			}
+		};
+		if (pJobs && level.height > BuildGrain)
+		{
+			pJobs->ParallelFor(level.height, BuildGrain, reduceRows);
+		}
+		else
+		{
+			reduceRows(0u, level.height, 0u);
+		}
+	}
+
+	stats.builds++;
+	stats.lastSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	stats.seconds += stats.lastSeconds;
+}
+
+void HiZPyramid::BuildReference(const float* pDepth, unsigned int width, unsigned int height)
+{
+	Allocate(width, height);
+
+	for (size_t l = 0u; l < levels.size(); l++)
+	{
+		Level& level = levels[l];
+		const float* pSrcMin = l == 0u ? pDepth : levels[l - 1u].minDepth.data();
+		const float* pSrcMax = l == 0u ? pDepth : levels[l - 1u].maxDepth.data();
+		const unsigned int srcWidth = l == 0u ? width : levels[l - 1u].width;
+		const unsigned int srcHeight = l == 0u ? height : levels[l - 1u].height;
+
+		for (unsigned int y = 0u; y < level.height; y++)
+		{
+			for (unsigned int x = 0u; x < level.width; x++)
+			{
+				float minDepth = pSrcMin[size_t(2u * y) * srcWidth + 2u * x];
+				float maxDepth = pSrcMax[size_t(2u * y) * srcWidth + 2u * x];
+				for (unsigned int sy = 2u * y; sy < std::min(2u * y + 2u, srcHeight); sy++)
+				{
+					for (unsigned int sx = 2u * x; sx < std::min(2u * x + 2u, srcWidth); sx++)
+					{
+						minDepth = std::min(minDepth, pSrcMin[size_t(sy) * srcWidth + sx]);
+						maxDepth = std::max(maxDepth, pSrcMax[size_t(sy) * srcWidth + sx]);
+					}
+				}
+				level.minDepth[size_t(y) * level.width + x] = minDepth;
+				level.maxDepth[size_t(y) * level.width + x] = maxDepth;
+			}
+		}
+	}
+}
+
+bool HiZPyramid::IsOccluded(float x0, float y0, float x1, float y1, float nearestDepth) const noexcept
+{
+	x0 = std::max(x0, 0.0f);
+	y0 = std::max(y0, 0.0f);
+	x1 = std::min(x1, float(width));
+	y1 = std::min(y1, float(height));
+	// off screen (or nothing built yet) is not the pyramid's call
+	if (levels.empty() || !(x0 < x1 && y0 < y1))
+	{
+		return false;
+	}
+
+	// the finest level where the box spans at most 3x3 texels
+	const float extent = std::max(x1 - x0, y1 - y0);
+	unsigned int l = 0u;
+	while (l + 1u < levels.size() && extent > float(4u << l))
+	{
+		l++;
+	}
+	const Level& level = levels[l];
+	const float texelSize = float(2u << l);
+	const unsigned int tx0 = unsigned(x0 / texelSize);
+	const unsigned int ty0 = unsigned(y0 / texelSize);
+	const unsigned int tx1 = std::min(unsigned(std::ceil(x1 / texelSize)), level.width);
+	const unsigned int ty1 = std::min(unsigned(std::ceil(y1 / texelSize)), level.height);
+
+	// texels reaching past the box only lower the minimum: conservative
+	for (unsigned int ty = ty0; ty < ty1; ty++)
+	{
+		for (unsigned int tx = tx0; tx < tx1; tx++)
+		{
+			if (nearestDepth >= level.minDepth[size_t(ty) * level.width + tx])
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void HiZPyramid::Allocate(unsigned int width, unsigned int height)
+{
+	this->width = width;
+	this->height = height;
+
+	size_t count = 0u;
+	unsigned int w = width;
+	unsigned int h = height;
+	while (w > 1u || h > 1u)
+	{
+		w = (w + 1u) / 2u;
+		h = (h + 1u) / 2u;
+		if (count == levels.size())
+		{
+			levels.emplace_back();
+		}
+		Level& level = levels[count++];
+		level.width = w;
+		level.height = h;
+		level.minDepth.resize(size_t(w) * h);
+		level.maxDepth.resize(size_t(w) * h);
+	}
+	levels.resize(count);
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// Hierarchical depth (Hi-Z) pyramid of a reversed-Z depth buffer (see
+// DepthMode in RenderDevice.h: 1 = near plane, 0 = far plane / cleared).
+// Level 0 is half the size of the depth buffer and every texel of a level
+// holds the minimum and the maximum depth of the 2x2 texels below it (of
+// the depth buffer itself for level 0), down to a single texel. Odd sizes
+// round up, the last row or column then covers only one texel below.
+//
+// Culling uses the min depth: everything drawn inside a texel's area is at
+// least that close, so a box whose nearest point is farther away than the
+// minimum over the texels it covers is hidden. The max depth bounds the
+// closest occluder of an area, which refines the test for occluders.
+//
+// Build() reduces 8 texels at a time with the Simd.h types and spreads the
+// rows of the large levels over a JobSystem; BuildReference() is the plain
+// per texel definition it produces identical pyramids to.
+class HiZPyramid
+{
+public:
+	struct Level
+	{
+		unsigned int		width	{ 0u };
+		unsigned int		height	{ 0u };
+		// width * height texels each, rows are width texels apart
+		std::vector<float>	minDepth;
+		std::vector<float>	maxDepth;
+	};
+
+	struct Stats
+	{
+		uint64_t	builds		{ 0u };
+		double		seconds		{ 0.0 };	// all builds
+		double		lastSeconds	{ 0.0 };
+	};
+
+public:
+	// pDepth is width * height floats, rows width apart; pJobs may be nullptr
+	void			Build(const float* pDepth, unsigned int width, unsigned int height, JobSystem* pJobs = nullptr);
+	void			BuildReference(const float* pDepth, unsigned int width, unsigned int height);
+
+	// true when a box covering the depth buffer pixels [x0,x1) x [y0,y1)
+	// whose nearest point has depth nearestDepth is behind everything drawn
+	// there; conservative: may say visible for hidden boxes, never the reverse
+	bool			IsOccluded(float x0, float y0, float x1, float y1, float nearestDepth) const noexcept;
+
+	// size of the depth buffer the pyramid was built from, 0 before Build()
+	unsigned int	GetWidth()		const noexcept { return width; }
+	unsigned int	GetHeight()		const noexcept { return height; }
+	unsigned int	GetLevelCount()	const noexcept { return unsigned(levels.size()); }
+	const Level&	GetLevel(unsigned int level) const noexcept { return levels[level]; }
+
+	const Stats&	GetStats() const noexcept { return stats; }
+	void			ResetStats() noexcept { stats = {}; }
+
+private:
+	// sizes the levels for a width x height depth buffer, keeping storage
+	void			Allocate(unsigned int width, unsigned int height);
+
+private:
+	unsigned int		width	{ 0u };
+	unsigned int		height	{ 0u };
+	std::vector<Level>	levels;
+	Stats				stats;
+};
@@ -0,0 +1,171 @@
+#include "IndirectDrawBuilder.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace
+{
+	// visible instances per counting/scatter job
+	constexpr size_t CompactGrain = 16384u;
+}
+
+IndirectDrawBuilder::IndirectDrawBuilder(JobSystem& jobs, unsigned int instanceStride)
+	: jobs(jobs), culler(jobs), instanceStride(instanceStride)
+{
+}
+
+uint32_t IndirectDrawBuilder::AddDraw(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+{
+	draws.push_back({ indexCount, startIndex, baseVertex });
+	return uint32_t(draws.size() - 1u);
+}
+
+uint32_t IndirectDrawBuilder::AddInstance(uint32_t draw, const float center[3], float radius, const void* pData)
+{
+	// the culler's slots are the instances, so its visible list is in
+	// instance order
+	const uint32_t instance = uint32_t(instanceDraws.size());
+	culler.AddSphere(instance, center, radius);
+	instanceDraws.push_back(draw);
+	instanceData.resize(instanceData.size() + instanceStride);
+	std::memcpy(&instanceData[size_t(instance) * instanceStride], pData, instanceStride);
+	return instance;
+}
+
+void IndirectDrawBuilder::SetInstance(uint32_t instance, const float center[3], float radius, const void* pData) noexcept
+{
+	culler.SetSphere(instance, center, radius);
+	std::memcpy(&instanceData[size_t(instance) * instanceStride], pData, instanceStride);
+}
+
+void IndirectDrawBuilder::Clear() noexcept
+{
+	culler.Clear();
+	draws.clear();
+	instanceDraws.clear();
+	instanceData.clear();
+	visibleCount = 0u;
+	chunkOffsets.clear();
+	drawCounts.clear();
+	drawFirsts.clear();
+}
+
+size_t IndirectDrawBuilder::Cull(const float toClip[16])
+{
+	return Cull(FrustumCuller::ExtractFrustum(toClip));
+}
+
+size_t IndirectDrawBuilder::Cull(const FrustumCuller::Frustum& frustum)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	visible.resize(instanceDraws.size());
+	visibleCount = culler.Cull(frustum, visible.data());
+
+	// per chunk counts of every draw
+	const size_t drawCount = draws.size();
+	const size_t chunks = (visibleCount + CompactGrain - 1u) / CompactGrain;
+	chunkOffsets.assign(chunks * drawCount, 0u);
+	jobs.ParallelFor(chunks, 1u, [&](size_t begin, size_t end, unsigned int)
+	{
+		for (size_t c = begin; c < end; c++)
+		{
+			uint32_t* pCounts = &chunkOffsets[c * drawCount];
+			const size_t last = std::min((c + 1u) * CompactGrain, visibleCount);
+			for (size_t i = c * CompactGrain; i < last; i++)
+			{
+				pCounts[instanceDraws[visible[i]]]++;
+			}
+		}
+	});
+
+	// exclusive prefix sum, draw major: draw d's instances are those of
+	// chunk 0, then chunk 1, ... so each draw keeps the instance order
+	drawCounts.assign(drawCount, 0u);
+	drawFirsts.assign(drawCount, 0u);
+	uint32_t offset = 0u;
+	for (size_t d = 0u; d < drawCount; d++)
+	{
+		drawFirsts[d] = offset;
+		for (size_t c = 0u; c < chunks; c++)
+		{
+			const uint32_t count = chunkOffsets[c * drawCount + d];
+			chunkOffsets[c * drawCount + d] = offset;
+			offset += count;
+		}
+		drawCounts[d] = offset - drawFirsts[d];
+	}
+
+	stats.instancesTested += instanceDraws.size();
+	stats.visible += visibleCount;
+	stats.lastSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	stats.seconds += stats.lastSeconds;
+	return visibleCount;
+}
+
+void IndirectDrawBuilder::Write(DrawIndexedIndirectArgs* pArgs, void* pInstances)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	const size_t drawCount = draws.size();
+	for (size_t d = 0u; d < drawCount; d++)
+	{
+		pArgs[d] = { draws[d].indexCount, drawCounts[d], draws[d].startIndex, draws[d].baseVertex, drawFirsts[d] };
+	}
+
+	// every chunk advances its own copy of its offsets, Write() can be
+	// called again for the same Cull()
+	unsigned char* pOut = static_cast<unsigned char*>(pInstances);
+	const size_t chunks = (visibleCount + CompactGrain - 1u) / CompactGrain;
+	jobs.ParallelFor(chunks, 1u, [&](size_t begin, size_t end, unsigned int)
+	{
+		std::vector<uint32_t> cursors(drawCount);
+		for (size_t c = begin; c < end; c++)
+		{
+			std::copy_n(&chunkOffsets[c * drawCount], drawCount, cursors.data());
+			const size_t last = std::min((c + 1u) * CompactGrain, visibleCount);
+			for (size_t i = c * CompactGrain; i < last; i++)
+			{
+				const uint32_t instance = visible[i];
+				std::memcpy(pOut + size_t(cursors[instanceDraws[instance]]++) * instanceStride,
+							&instanceData[size_t(instance) * instanceStride], instanceStride);
+			}
+		}
+	});
+
+	stats.lastSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	stats.seconds += stats.lastSeconds;
+}
+
+void IndirectDrawBuilder::WriteReference(DrawIndexedIndirectArgs* pArgs, void* pInstances) const noexcept
+{
+	const size_t drawCount = draws.size();
+	for (size_t d = 0u; d < drawCount; d++)
+	{
+		pArgs[d] = { draws[d].indexCount, 0u, draws[d].startIndex, draws[d].baseVertex, 0u };
+	}
+	for (size_t i = 0u; i < visibleCount; i++)
+	{
+		pArgs[instanceDraws[visible[i]]].instanceCount++;
+	}
+	uint32_t offset = 0u;
+	for (size_t d = 0u; d < drawCount; d++)
+	{
+		pArgs[d].startInstanceLocation = offset;
+		offset += pArgs[d].instanceCount;
+	}
+
+	// the arguments double as the write positions, put them back afterwards
+	unsigned char* pOut = static_cast<unsigned char*>(pInstances);
+	for (size_t i = 0u; i < visibleCount; i++)
+	{
+		const uint32_t instance = visible[i];
+		DrawIndexedIndirectArgs& args = pArgs[instanceDraws[instance]];
+		std::memcpy(pOut + size_t(args.startInstanceLocation++) * instanceStride,
+					&instanceData[size_t(instance) * instanceStride], instanceStride);
+	}
+	for (size_t d = 0u; d < drawCount; d++)
+	{
+		pArgs[d].startInstanceLocation -= pArgs[d].instanceCount;
+	}
+}
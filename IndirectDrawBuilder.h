@@ -0,0 +1,99 @@
+#pragma once
+#include "FrustumCuller.h"
+#include "JobSystem.h"
+#include "RenderDevice.h"
+#include <cstdint>
+#include <vector>
+
+// Culls instances and writes what survives as indirect draws: the
+// per-instance data of the visible instances, packed and grouped by mesh,
+// and one DrawIndexedIndirectArgs per mesh whose instance count and first
+// instance point into that data. The draws are issued without the CPU
+// looking at the counts (DrawIndexedInstancedIndirect()), one per mesh
+// however many objects there are, which is the layout a culling compute
+// pass produces as well.
+//
+// Meshes ("draws") are index ranges of buffers shared by all of them; each
+// instance belongs to one draw and has a bounding sphere and instanceStride
+// bytes of data (e.g. InstanceData). A frame is
+//
+//	visible = builder.Cull(toClip);
+//	builder.Write(pArgs, pInstances);	// GetDrawCount() args, visible * stride bytes
+//
+// Culling goes through a FrustumCuller. Write() compacts in three steps,
+// like the GPU version would: every chunk of the visible list counts its
+// instances per draw, a prefix sum over (draw, chunk) gives every chunk
+// its output position within each draw, and the chunks scatter their
+// instances in parallel. Instances of a draw keep the order they were
+// added in, so the bytes are the same for any thread count and the same
+// as WriteReference(), which does it one instance at a time.
+class IndirectDrawBuilder
+{
+public:
+	struct Stats
+	{
+		uint64_t	instancesTested	{ 0u };
+		uint64_t	visible			{ 0u };
+		double		seconds			{ 0.0 };	// Cull() and Write() calls
+		double		lastSeconds		{ 0.0 };
+	};
+
+public:
+	IndirectDrawBuilder(JobSystem& jobs, unsigned int instanceStride);
+	IndirectDrawBuilder(const IndirectDrawBuilder&) = delete;
+	IndirectDrawBuilder& operator=(const IndirectDrawBuilder&) = delete;
+
+	// a mesh that instances can be added for; returns the index of its
+	// arguments in the Write() output
+	uint32_t	AddDraw(unsigned int indexCount, unsigned int startIndex, int baseVertex);
+	// pData is instanceStride bytes; returns the instance, which stays valid
+	// until Clear() and updates a moving one
+	uint32_t	AddInstance(uint32_t draw, const float center[3], float radius, const void* pData);
+	void		SetInstance(uint32_t instance, const float center[3], float radius, const void* pData) noexcept;
+	void		Clear() noexcept;
+
+	size_t			GetDrawCount()		const noexcept { return draws.size(); }
+	size_t			GetInstanceCount()	const noexcept { return instanceDraws.size(); }
+	unsigned int	GetInstanceStride()	const noexcept { return instanceStride; }
+
+	// culls every instance and counts the visible ones per draw; returns how
+	// many are visible
+	size_t	Cull(const float toClip[16]);
+	size_t	Cull(const FrustumCuller::Frustum& frustum);
+	// for the last Cull(): GetDrawCount() arguments to pArgs and the data of
+	// the visible instances to pInstances, startInstanceLocation counting
+	// from pInstances
+	void	Write(DrawIndexedIndirectArgs* pArgs, void* pInstances);
+	// the same bytes on the calling thread alone
+	void	WriteReference(DrawIndexedIndirectArgs* pArgs, void* pInstances) const noexcept;
+
+	const Stats&	GetStats() const noexcept { return stats; }
+	void			ResetStats() noexcept { stats = {}; }
+
+private:
+	struct Draw
+	{
+		unsigned int	indexCount;
+		unsigned int	startIndex;
+		int				baseVertex;
+	};
+
+private:
+	JobSystem&		jobs;
+	FrustumCuller	culler;
+	unsigned int	instanceStride;
+
+	std::vector<Draw>			draws;
+	std::vector<uint32_t>		instanceDraws;
+	std::vector<unsigned char>	instanceData;
+
+	// Cull() results: visible instances in the order they were added and,
+	// [chunk * drawCount + draw], where each chunk's instances of a draw go
+	std::vector<uint32_t>		visible;
+	size_t						visibleCount	{ 0u };
+	std::vector<uint32_t>		chunkOffsets;
+	std::vector<uint32_t>		drawCounts;
+	std::vector<uint32_t>		drawFirsts;
+
+	Stats stats;
+};
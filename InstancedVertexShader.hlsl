@@ -0,0 +1,18 @@
+struct VSOut
+{
+	float3 color : Color;
+	float4 pos : SV_Position;
+};
+
+// VertexShader.hlsl drawn instanced: every instance moves the mesh by the
+// row major 3x4 transform and tints it, see InstanceData in DrawQueue.h
+VSOut main(float2 pos : Position, float3 color : Color,
+		   float4 transform0 : Transform0, float4 transform1 : Transform1, float4 transform2 : Transform2,
+		   float4 tint : InstanceColor)
+{
+	VSOut vso;
+	const float4 p = float4(pos.x, pos.y, 0.0f, 1.0f);
+	vso.pos = float4(dot(transform0, p), dot(transform1, p), dot(transform2, p), 1.0f);
+	vso.color = color * tint.rgb;
+	return vso;
+}
@@ -0,0 +1,109 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+namespace
+{
+	// set on worker threads so nested ParallelFor calls run inline
+	thread_local bool isWorkerThread = false;
+}
+
+JobSystem::JobSystem(unsigned int threadCount)
+{
+	if (threadCount == 0u)
+	{
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	for (unsigned int i = 1; i < threadCount; i++)
+	{
+		workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	wakeCondition.notify_all();
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void JobSystem::ParallelFor(size_t count, size_t grain, const RangeFunction& func)
+{
+	if (count == 0u)
+	{
+		return;
+	}
+	grain = std::max<size_t>(grain, 1u);
+
+	// serial fallback: no workers, a single chunk, a nested call or another
+	// thread already owns the pool
+	bool expected = false;
+	if (workers.empty() || count <= grain || isWorkerThread || !busy.compare_exchange_strong(expected, true))
+	{
+		func(0u, count, 0u);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pJob = &func;
+		jobCount = count;
+		jobGrain = grain;
+		nextChunk.store(0u, std::memory_order_relaxed);
+		activeWorkers.store(unsigned(workers.size()), std::memory_order_relaxed);
+		generation++;
+	}
+	wakeCondition.notify_all();
+
+	RunChunks(0u);
+
+	// wait for the workers to drain their last chunks
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		doneCondition.wait(lock, [this] { return activeWorkers.load(std::memory_order_acquire) == 0u; });
+		pJob = nullptr;
+	}
+	busy.store(false, std::memory_order_release);
+}
+
+void JobSystem::WorkerLoop(unsigned int threadIndex)
+{
+	isWorkerThread = true;
+	uint64_t seenGeneration = 0u;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeCondition.wait(lock, [&] { return quit || generation != seenGeneration; });
+			if (quit)
+			{
+				return;
+			}
+			seenGeneration = generation;
+		}
+
+		RunChunks(threadIndex);
+
+		if (activeWorkers.fetch_sub(1u, std::memory_order_acq_rel) == 1u)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			doneCondition.notify_one();
+		}
+	}
+}
+
+void JobSystem::RunChunks(unsigned int threadIndex) noexcept
+{
+	const size_t chunks = (jobCount + jobGrain - 1u) / jobGrain;
+	for (size_t chunk = nextChunk.fetch_add(1u); chunk < chunks; chunk = nextChunk.fetch_add(1u))
+	{
+		const size_t begin = chunk * jobGrain;
+		const size_t end = std::min(begin + jobGrain, jobCount);
+		(*pJob)(begin, end, threadIndex);
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A small pool of worker threads for data-parallel loops. The calling
+// thread always takes part in the work, so a JobSystem with one thread
+// runs everything inline and never context switches.
+//
+// ParallelFor() splits [0,count) into chunks of `grain` items which the
+// threads pull from a shared atomic counter until the range is exhausted.
+// It blocks until every chunk has finished. A ParallelFor issued from inside
+// a job (or while another one is running) executes serially on the calling
+// thread instead of deadlocking.
+class JobSystem
+{
+public:
+	// called with a [begin,end) chunk and the index of the executing thread
+	// (0 = calling thread, 1..GetThreadCount()-1 = workers)
+	using RangeFunction = std::function<void(size_t begin, size_t end, unsigned int threadIndex)>;
+
+public:
+	// threadCount includes the calling thread; 0 picks the number of cores
+	explicit JobSystem(unsigned int threadCount = 0u);
+	~JobSystem();
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	unsigned int GetThreadCount() const noexcept { return unsigned(workers.size()) + 1u; }
+
+	void ParallelFor(size_t count, size_t grain, const RangeFunction& func);
+
+private:
+	void WorkerLoop(unsigned int threadIndex);
+	void RunChunks(unsigned int threadIndex) noexcept;
+
+private:
+	std::vector<std::thread> workers;
+
+	std::mutex				mutex;
+	std::condition_variable	wakeCondition;
+	std::condition_variable	doneCondition;
+	uint64_t				generation		{ 0u };
+	bool					quit			{ false };
+
+	// the job that is currently being executed
+	const RangeFunction*	pJob			{ nullptr };
+	size_t					jobCount		{ 0u };
+	size_t					jobGrain		{ 1u };
+	std::atomic<size_t>		nextChunk		{ 0u };
+	std::atomic<unsigned>	activeWorkers	{ 0u };
+	std::atomic<bool>		busy			{ false };
+};
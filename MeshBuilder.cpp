@@ -0,0 +1,275 @@
+#include "MeshBuilder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	constexpr uint32_t NoChunk = ~0u;
+
+	const float* PositionOf(const float* pPositions, size_t stride, uint32_t vertex) noexcept
+	{
+		return reinterpret_cast<const float*>(reinterpret_cast<const unsigned char*>(pPositions) + vertex * stride);
+	}
+
+	// how many of the triangle's vertices are not in the chunk yet
+	unsigned int NewVertices(const uint32_t* pTriangle, const std::vector<uint32_t>& chunkOf, uint32_t chunk) noexcept
+	{
+		unsigned int count = 0u;
+		for (int k = 0; k < 3; k++)
+		{
+			const uint32_t v = pTriangle[k];
+			const bool repeated = (k > 0 && pTriangle[0] == v) || (k > 1 && pTriangle[1] == v);
+			count += chunkOf[v] != chunk && !repeated ? 1u : 0u;
+		}
+		return count;
+	}
+
+	void FinishMeshlet(MeshBuilder::Meshlets& result, MeshBuilder::Meshlet& meshlet, const float* pPositions, size_t positionStride)
+	{
+		const uint32_t* pVertices = &result.vertices[meshlet.firstVertex];
+		float min[3];
+		float max[3];
+		for (int c = 0; c < 3; c++)
+		{
+			min[c] = max[c] = PositionOf(pPositions, positionStride, pVertices[0])[c];
+		}
+		for (unsigned int i = 1u; i < meshlet.vertexCount; i++)
+		{
+			const float* p = PositionOf(pPositions, positionStride, pVertices[i]);
+			for (int c = 0; c < 3; c++)
+			{
+				min[c] = std::min(min[c], p[c]);
+				max[c] = std::max(max[c], p[c]);
+			}
+		}
+		float radiusSquared = 0.0f;
+		for (int c = 0; c < 3; c++)
+		{
+			meshlet.center[c] = 0.5f * (min[c] + max[c]);
+		}
+		for (unsigned int i = 0u; i < meshlet.vertexCount; i++)
+		{
+			const float* p = PositionOf(pPositions, positionStride, pVertices[i]);
+			const float dx = p[0] - meshlet.center[0];
+			const float dy = p[1] - meshlet.center[1];
+			const float dz = p[2] - meshlet.center[2];
+			radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+		}
+		meshlet.radius = std::sqrt(radiusSquared);
+
+		// front normals (clockwise triangles), the axis is their mean and the
+		// cone has to reach the one farthest from it
+		float normals[MeshBuilder::MaxMeshletTriangles][3];
+		unsigned int normalCount = 0u;
+		float axis[3] = {};
+		const uint8_t* pTriangles = &result.triangles[meshlet.firstTriangle * 3u];
+		for (unsigned int t = 0u; t < meshlet.triangleCount; t++)
+		{
+			const float* p0 = PositionOf(pPositions, positionStride, pVertices[pTriangles[t * 3u]]);
+			const float* p1 = PositionOf(pPositions, positionStride, pVertices[pTriangles[t * 3u + 1u]]);
+			const float* p2 = PositionOf(pPositions, positionStride, pVertices[pTriangles[t * 3u + 2u]]);
+			const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (length > 0.0f)
+			{
+				for (int c = 0; c < 3; c++)
+				{
+					normals[normalCount][c] = n[c] / length;
+					axis[c] += normals[normalCount][c];
+				}
+				normalCount++;
+			}
+		}
+		const float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+		meshlet.coneAxis[0] = 0.0f;
+		meshlet.coneAxis[1] = 0.0f;
+		meshlet.coneAxis[2] = 1.0f;
+		meshlet.coneCutoff = 1.0f;
+		if (normalCount == 0u || !(axisLength > 0.0f))
+		{
+			return;
+		}
+		float minDot = 1.0f;
+		for (int c = 0; c < 3; c++)
+		{
+			meshlet.coneAxis[c] = axis[c] / axisLength;
+		}
+		for (unsigned int i = 0u; i < normalCount; i++)
+		{
+			minDot = std::min(minDot, normals[i][0] * meshlet.coneAxis[0] + normals[i][1] * meshlet.coneAxis[1] +
+									  normals[i][2] * meshlet.coneAxis[2]);
+		}
+		// the cutoff is the sine of the cone's half angle; a cone wider than
+		// a hemisphere culls nothing
+		meshlet.coneCutoff = minDot > 0.0f ? std::sqrt(1.0f - minDot * minDot) : 1.0f;
+	}
+}
+
+MeshBuilder::IndexedMesh MeshBuilder::BuildIndexedMesh(const void* pVertices, size_t vertexCount, size_t vertexSize,
+													   const uint32_t* pIndices, size_t indexCount)
+{
+	IndexedMesh mesh;
+	mesh.vertexSize = vertexSize;
+	const unsigned char* pBytes = static_cast<const unsigned char*>(pVertices);
+
+	auto singleChunk = [&](IndexFormat format)
+	{
+		mesh.indexFormat = format;
+		mesh.vertices.assign(pBytes, pBytes + vertexCount * vertexSize);
+		if (format == IndexFormat::R16_UInt)
+		{
+			mesh.indices.resize(indexCount * sizeof(uint16_t));
+			uint16_t* pOut = reinterpret_cast<uint16_t*>(mesh.indices.data());
+			std::copy(pIndices, pIndices + indexCount, pOut);
+		}
+		else
+		{
+			mesh.indices.resize(indexCount * sizeof(uint32_t));
+			std::memcpy(mesh.indices.data(), pIndices, indexCount * sizeof(uint32_t));
+		}
+		mesh.chunks.assign(1u, { 0u, unsigned(indexCount), 0, unsigned(vertexCount) });
+	};
+	if (vertexCount <= MaxChunkVertices)
+	{
+		singleChunk(IndexFormat::R16_UInt);
+		return mesh;
+	}
+
+	// chunks of whole triangles in the given order, a new one whenever the
+	// next triangle would bring too many vertices
+	std::vector<uint32_t> chunkOf(vertexCount, NoChunk);
+	std::vector<uint16_t> localIndex(vertexCount);
+	std::vector<uint32_t> chunkVertices;	// mesh vertex of every chunk vertex, all chunks
+	std::vector<uint16_t> localIndices(indexCount);
+	const size_t triangleCount = indexCount / 3u;
+	uint32_t chunk = 0u;
+	size_t chunkStart = 0u;
+	mesh.chunks.push_back({ 0u, 0u, 0, 0u });
+	for (size_t t = 0u; t < triangleCount; t++)
+	{
+		const uint32_t* pTriangle = pIndices + t * 3u;
+		if (chunkVertices.size() - chunkStart + NewVertices(pTriangle, chunkOf, chunk) > MaxChunkVertices)
+		{
+			chunk++;
+			chunkStart = chunkVertices.size();
+			mesh.chunks.push_back({ unsigned(t * 3u), 0u, int(chunkStart), 0u });
+		}
+		for (int k = 0; k < 3; k++)
+		{
+			const uint32_t v = pTriangle[k];
+			if (chunkOf[v] != chunk)
+			{
+				chunkOf[v] = chunk;
+				localIndex[v] = uint16_t(chunkVertices.size() - chunkStart);
+				chunkVertices.push_back(v);
+			}
+			localIndices[t * 3u + k] = localIndex[v];
+		}
+		mesh.chunks.back().indexCount += 3u;
+		mesh.chunks.back().vertexCount = unsigned(chunkVertices.size() - chunkStart);
+	}
+
+	// 16 bit chunks pay for their copied vertices with the index bytes saved
+	const size_t chunkedBytes = chunkVertices.size() * vertexSize + indexCount * sizeof(uint16_t);
+	const size_t wideBytes = vertexCount * vertexSize + indexCount * sizeof(uint32_t);
+	if (chunkedBytes > wideBytes)
+	{
+		singleChunk(IndexFormat::R32_UInt);
+		return mesh;
+	}
+
+	mesh.indexFormat = IndexFormat::R16_UInt;
+	mesh.vertices.resize(chunkVertices.size() * vertexSize);
+	for (size_t i = 0u; i < chunkVertices.size(); i++)
+	{
+		std::memcpy(&mesh.vertices[i * vertexSize], pBytes + chunkVertices[i] * vertexSize, vertexSize);
+	}
+	mesh.indices.resize(indexCount * sizeof(uint16_t));
+	std::memcpy(mesh.indices.data(), localIndices.data(), mesh.indices.size());
+	return mesh;
+}
+
+MeshBuilder::Meshlets MeshBuilder::BuildMeshlets(const uint32_t* pIndices, size_t indexCount, const float* pPositions,
+												 size_t positionStride, size_t vertexCount)
+{
+	Meshlets result;
+	const size_t triangleCount = indexCount / 3u;
+	// typical sizes, most meshlets run out of vertices half way to
+	// MaxMeshletTriangles
+	result.meshlets.reserve(triangleCount / (MaxMeshletTriangles / 2u) + 1u);
+	result.vertices.reserve(triangleCount);
+	result.triangles.reserve(indexCount);
+
+	std::vector<uint32_t> meshletOf(vertexCount, NoChunk);
+	std::vector<uint8_t> localIndex(vertexCount);
+	Meshlet meshlet = {};
+	uint32_t current = 0u;
+	for (size_t t = 0u; t < triangleCount; t++)
+	{
+		const uint32_t* pTriangle = pIndices + t * 3u;
+		if (meshlet.vertexCount + NewVertices(pTriangle, meshletOf, current) > MaxMeshletVertices ||
+			meshlet.triangleCount + 1u > MaxMeshletTriangles)
+		{
+			FinishMeshlet(result, meshlet, pPositions, positionStride);
+			result.meshlets.push_back(meshlet);
+			current++;
+			meshlet = {};
+			meshlet.firstVertex = uint32_t(result.vertices.size());
+			meshlet.firstTriangle = uint32_t(result.triangles.size() / 3u);
+		}
+		for (int k = 0; k < 3; k++)
+		{
+			const uint32_t v = pTriangle[k];
+			if (meshletOf[v] != current)
+			{
+				meshletOf[v] = current;
+				localIndex[v] = meshlet.vertexCount++;
+				result.vertices.push_back(v);
+			}
+			result.triangles.push_back(localIndex[v]);
+		}
+		meshlet.triangleCount++;
+	}
+	if (meshlet.triangleCount > 0u)
+	{
+		FinishMeshlet(result, meshlet, pPositions, positionStride);
+		result.meshlets.push_back(meshlet);
+	}
+	return result;
+}
+
+bool MeshBuilder::IsBackfacing(const Meshlet& meshlet, const float cameraPosition[3]) noexcept
+{
+	if (meshlet.coneCutoff >= 1.0f)
+	{
+		return false;
+	}
+	const float d[3] = { meshlet.center[0] - cameraPosition[0], meshlet.center[1] - cameraPosition[1], meshlet.center[2] - cameraPosition[2] };
+	const float distance = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+	return d[0] * meshlet.coneAxis[0] + d[1] * meshlet.coneAxis[1] + d[2] * meshlet.coneAxis[2] >=
+		   meshlet.coneCutoff * distance + meshlet.radius;
+}
+
+size_t MeshBuilder::CullMeshlets(const Meshlets& meshlets, const FrustumCuller::Frustum& frustum,
+								 const float cameraPosition[3], uint32_t* pVisible) noexcept
+{
+	size_t visible = 0u;
+	for (size_t i = 0u; i < meshlets.meshlets.size(); i++)
+	{
+		const Meshlet& meshlet = meshlets.meshlets[i];
+		bool inside = true;
+		for (const FrustumCuller::Plane& plane : frustum.planes)
+		{
+			inside = inside && plane.normal[0] * meshlet.center[0] + plane.normal[1] * meshlet.center[1] +
+							   plane.normal[2] * meshlet.center[2] + plane.d >= -meshlet.radius;
+		}
+		if (inside && !IsBackfacing(meshlet, cameraPosition))
+		{
+			pVisible[visible++] = uint32_t(i);
+		}
+	}
+	return visible;
+}
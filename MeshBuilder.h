@@ -0,0 +1,92 @@
+#pragma once
+#include "FrustumCuller.h"
+#include "RenderDevice.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Turns a loaded triangle list into what the renderer draws and culls.
+//
+// BuildIndexedMesh() picks the index format. A mesh of up to
+// MaxChunkVertices vertices gets 16 bit indices. A bigger one is split into
+// chunks of at most that many vertices, each drawn on its own with 16 bit
+// indices relative to its baseVertex; vertices shared by two chunks are
+// stored twice. When those copies would cost more memory than 32 bit
+// indices save, the mesh stays one 32 bit chunk instead. One draw per chunk:
+//
+//	for (const auto& chunk : mesh.chunks)
+//	{
+//		packet.indexFormat = mesh.indexFormat;
+//		packet.startIndex = chunk.startIndex;
+//		packet.indexCount = chunk.indexCount;
+//		packet.baseVertex = chunk.baseVertex;
+//		gfx.Submit(packet);
+//	}
+//
+// BuildMeshlets() cuts the triangles into meshlets of at most
+// MaxMeshletVertices vertices and MaxMeshletTriangles triangles, in the
+// order given (run MeshOptimizer first: its vertex cache order keeps
+// meshlets compact). Every meshlet has a bounding sphere and a cone around
+// its triangle normals, so whole meshlets can be culled on the CPU against
+// the frustum and when all of their triangles face away from the camera.
+// Front faces are clockwise, as in the rest of the renderer.
+class MeshBuilder
+{
+public:
+	static constexpr size_t			MaxChunkVertices		= 65535u;
+	static constexpr unsigned int	MaxMeshletVertices		= 64u;
+	static constexpr unsigned int	MaxMeshletTriangles		= 124u;
+
+	struct IndexedMesh
+	{
+		struct Chunk
+		{
+			unsigned int	startIndex;
+			unsigned int	indexCount;
+			int				baseVertex;
+			unsigned int	vertexCount;
+		};
+
+		IndexFormat					indexFormat	{ IndexFormat::R16_UInt };
+		size_t						vertexSize	{ 0u };
+		std::vector<unsigned char>	vertices;
+		std::vector<unsigned char>	indices;	// uint16_t or uint32_t
+		std::vector<Chunk>			chunks;
+	};
+
+	struct Meshlet
+	{
+		uint32_t	firstVertex;		// in Meshlets::vertices
+		uint32_t	firstTriangle;		// in Meshlets::triangles, 3 entries each
+		uint8_t		vertexCount;
+		uint8_t		triangleCount;
+		float		center[3];
+		float		radius;
+		// every triangle faces away from cameras where
+		// dot(center - camera, coneAxis) >= coneCutoff * |center - camera| + radius;
+		// a cutoff of 1 never culls (normals spread too wide)
+		float		coneAxis[3];
+		float		coneCutoff;
+	};
+
+	struct Meshlets
+	{
+		std::vector<Meshlet>	meshlets;
+		std::vector<uint32_t>	vertices;	// mesh vertex of every meshlet vertex
+		std::vector<uint8_t>	triangles;	// meshlet local vertices
+	};
+
+public:
+	static IndexedMesh	BuildIndexedMesh(const void* pVertices, size_t vertexCount, size_t vertexSize,
+										 const uint32_t* pIndices, size_t indexCount);
+
+	// pPositions is float[3] every positionStride bytes
+	static Meshlets		BuildMeshlets(const uint32_t* pIndices, size_t indexCount, const float* pPositions,
+									  size_t positionStride, size_t vertexCount);
+
+	static bool			IsBackfacing(const Meshlet& meshlet, const float cameraPosition[3]) noexcept;
+	// writes the indices of the meshlets that may be visible to pVisible
+	// (meshlets.size() entries at most); returns how many
+	static size_t		CullMeshlets(const Meshlets& meshlets, const FrustumCuller::Frustum& frustum,
+									 const float cameraPosition[3], uint32_t* pVisible) noexcept;
+};
@@ -0,0 +1,478 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	// Forsyth's scoring: vertices of the last triangle score LastTriangleScore,
+	// the rest of the modelled LRU cache less the older they are, and
+	// vertices with few triangles left get a boost so they are finished off
+	// rather than left to cost a miss later
+	constexpr unsigned int	ModelCacheSize		= 32u;
+	constexpr float			CacheDecayPower		= 1.5f;
+	constexpr float			LastTriangleScore	= 0.75f;
+	constexpr float			ValenceBoostScale	= 2.0f;
+	constexpr float			ValenceBoostPower	= 0.5f;
+	// valences beyond this score like it
+	constexpr uint32_t		MaxScoredValence	= 64u;
+
+	constexpr uint32_t NoTriangle = ~0u;
+	constexpr uint32_t Unmapped = ~0u;
+
+	struct ScoreTables
+	{
+		float cache[ModelCacheSize];
+		float valence[MaxScoredValence + 1u];
+	};
+
+	const ScoreTables& GetScoreTables() noexcept
+	{
+		static const ScoreTables tables = []
+		{
+			ScoreTables t = {};
+			for (unsigned int p = 0u; p < ModelCacheSize; p++)
+			{
+				t.cache[p] = p < 3u ? LastTriangleScore :
+					std::pow(1.0f - float(p - 3u) / float(ModelCacheSize - 3u), CacheDecayPower);
+			}
+			for (uint32_t v = 1u; v <= MaxScoredValence; v++)
+			{
+				t.valence[v] = ValenceBoostScale * std::pow(float(v), -ValenceBoostPower);
+			}
+			return t;
+		}();
+		return tables;
+	}
+
+	// cachePosition < 0 when the vertex is not in the modelled cache
+	float VertexScore(int cachePosition, uint32_t remainingTriangles) noexcept
+	{
+		if (remainingTriangles == 0u)
+		{
+			return -1.0f;
+		}
+		const ScoreTables& tables = GetScoreTables();
+		const float cacheScore = cachePosition < 0 ? 0.0f : tables.cache[cachePosition];
+		return cacheScore + tables.valence[std::min(remainingTriangles, MaxScoredValence)];
+	}
+
+	// Runs the indices through a FIFO cache of cacheSize vertices, restarted
+	// with Flush(). A vertex is cached while fewer than cacheSize others
+	// were loaded after it.
+	class FifoCache
+	{
+	public:
+		FifoCache(size_t vertexCount, unsigned int cacheSize)
+			: loadedAt(vertexCount, 0u), cacheSize(cacheSize), time(cacheSize + 1u)
+		{
+		}
+
+		// true on a miss
+		bool Access(uint32_t vertex) noexcept
+		{
+			if (time - loadedAt[vertex] > cacheSize)
+			{
+				loadedAt[vertex] = time++;
+				return true;
+			}
+			return false;
+		}
+
+		void Flush() noexcept
+		{
+			time += cacheSize + 1u;
+		}
+
+	private:
+		std::vector<uint32_t>	loadedAt;
+		uint32_t				cacheSize;
+		uint32_t				time;
+	};
+
+	const float* PositionOf(const float* pPositions, size_t stride, uint32_t vertex) noexcept
+	{
+		return reinterpret_cast<const float*>(reinterpret_cast<const unsigned char*>(pPositions) + vertex * stride);
+	}
+}
+
+MeshOptimizer::Report MeshOptimizer::Optimize(Mesh& mesh, float overdrawThreshold)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	// the steps work on 32 bit indices
+	std::vector<uint32_t> indices(mesh.indexCount);
+	if (mesh.indexFormat == IndexFormat::R16_UInt)
+	{
+		const uint16_t* pIndices = static_cast<const uint16_t*>(mesh.pIndices);
+		std::copy(pIndices, pIndices + mesh.indexCount, indices.begin());
+	}
+	else
+	{
+		std::memcpy(indices.data(), mesh.pIndices, mesh.indexCount * sizeof(uint32_t));
+	}
+
+	Report report;
+	report.verticesBefore = mesh.vertexCount;
+	report.before = AnalyzeVertexCache(indices.data(), indices.size(), mesh.vertexCount);
+
+	OptimizeVertexCache(indices.data(), indices.size(), mesh.vertexCount);
+	const float* pPositions = reinterpret_cast<const float*>(static_cast<const unsigned char*>(mesh.pVertices) + mesh.positionOffset);
+	OptimizeOverdraw(indices.data(), indices.size(), pPositions, mesh.vertexSize, mesh.vertexCount, overdrawThreshold);
+	mesh.vertexCount = OptimizeVertexFetch(mesh.pVertices, mesh.vertexCount, mesh.vertexSize, indices.data(), indices.size());
+
+	report.verticesAfter = mesh.vertexCount;
+	report.after = AnalyzeVertexCache(indices.data(), indices.size(), mesh.vertexCount);
+
+	if (mesh.indexFormat == IndexFormat::R16_UInt)
+	{
+		std::copy(indices.begin(), indices.end(), static_cast<uint16_t*>(mesh.pIndices));
+	}
+	else
+	{
+		std::memcpy(mesh.pIndices, indices.data(), mesh.indexCount * sizeof(uint32_t));
+	}
+	report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	mesh.report = report;
+	return report;
+}
+
+void MeshOptimizer::Optimize(JobSystem& jobs, Mesh* pMeshes, size_t meshCount, float overdrawThreshold)
+{
+	jobs.ParallelFor(meshCount, 1u, [&](size_t begin, size_t end, unsigned int)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			Optimize(pMeshes[i], overdrawThreshold);
+		}
+	});
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t* pIndices, size_t indexCount, size_t vertexCount)
+{
+	const size_t triangleCount = indexCount / 3u;
+	if (triangleCount == 0u)
+	{
+		return;
+	}
+
+	// the triangles of every vertex not yet emitted, in one array: those of
+	// vertex v start at firstTriangle[v], remaining[v] of them
+	std::vector<uint32_t> remaining(vertexCount, 0u);
+	for (size_t i = 0u; i < triangleCount * 3u; i++)
+	{
+		remaining[pIndices[i]]++;
+	}
+	std::vector<uint32_t> firstTriangle(vertexCount);
+	uint32_t offset = 0u;
+	for (size_t v = 0u; v < vertexCount; v++)
+	{
+		firstTriangle[v] = offset;
+		offset += remaining[v];
+	}
+	std::vector<uint32_t> adjacency(offset);
+	{
+		std::vector<uint32_t> filled(vertexCount, 0u);
+		for (size_t i = 0u; i < triangleCount * 3u; i++)
+		{
+			const uint32_t v = pIndices[i];
+			adjacency[firstTriangle[v] + filled[v]++] = uint32_t(i / 3u);
+		}
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t v = 0u; v < vertexCount; v++)
+	{
+		vertexScore[v] = VertexScore(-1, remaining[v]);
+	}
+	std::vector<float> triangleScore(triangleCount);
+	uint32_t best = NoTriangle;
+	for (size_t t = 0u; t < triangleCount; t++)
+	{
+		triangleScore[t] = vertexScore[pIndices[t * 3u]] + vertexScore[pIndices[t * 3u + 1u]] + vertexScore[pIndices[t * 3u + 2u]];
+		if (best == NoTriangle || triangleScore[t] > triangleScore[best])
+		{
+			best = uint32_t(t);
+		}
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> output(triangleCount * 3u);
+	// most recent first; room for the 3 vertices a triangle pushes in
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> nextCache;
+	cache.reserve(ModelCacheSize + 3u);
+	nextCache.reserve(ModelCacheSize + 3u);
+	size_t nextUnemitted = 0u;
+	for (size_t emittedCount = 0u; emittedCount < triangleCount; emittedCount++)
+	{
+		if (best == NoTriangle)
+		{
+			// nothing in the cache has triangles left: start anew from the
+			// first triangle of the input order not emitted yet
+			while (emitted[nextUnemitted])
+			{
+				nextUnemitted++;
+			}
+			best = uint32_t(nextUnemitted);
+		}
+		const uint32_t* pTriangle = pIndices + best * 3u;
+		std::copy(pTriangle, pTriangle + 3, output.begin() + emittedCount * 3u);
+		emitted[best] = true;
+
+		nextCache.clear();
+		for (int k = 0; k < 3; k++)
+		{
+			const uint32_t v = pTriangle[k];
+			uint32_t* pFirst = adjacency.data() + firstTriangle[v];
+			uint32_t* pLast = pFirst + remaining[v];
+			*std::find(pFirst, pLast, best) = *(pLast - 1);
+			remaining[v]--;
+			if (std::find(nextCache.begin(), nextCache.end(), v) == nextCache.end())
+			{
+				nextCache.push_back(v);
+			}
+		}
+		const size_t triangleVertices = nextCache.size();
+		for (const uint32_t v : cache)
+		{
+			if (std::find(nextCache.begin(), nextCache.begin() + triangleVertices, v) == nextCache.begin() + triangleVertices)
+			{
+				nextCache.push_back(v);
+			}
+		}
+
+		// rescore every vertex that moved in, within or out of the cache
+		// and pass the difference on to its triangles
+		best = NoTriangle;
+		float bestScore = -1.0f;
+		for (size_t i = 0u; i < nextCache.size(); i++)
+		{
+			const uint32_t v = nextCache[i];
+			cachePosition[v] = i < ModelCacheSize ? int(i) : -1;
+			const float score = VertexScore(cachePosition[v], remaining[v]);
+			const float delta = score - vertexScore[v];
+			vertexScore[v] = score;
+			for (uint32_t a = firstTriangle[v]; a < firstTriangle[v] + remaining[v]; a++)
+			{
+				const uint32_t t = adjacency[a];
+				triangleScore[t] += delta;
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					best = t;
+				}
+			}
+		}
+		if (nextCache.size() > ModelCacheSize)
+		{
+			nextCache.resize(ModelCacheSize);
+		}
+		std::swap(cache, nextCache);
+	}
+	std::copy(output.begin(), output.end(), pIndices);
+}
+
+void MeshOptimizer::OptimizeOverdraw(uint32_t* pIndices, size_t indexCount, const float* pPositions, size_t positionStride,
+									 size_t vertexCount, float threshold)
+{
+	const size_t triangleCount = indexCount / 3u;
+	if (triangleCount < 2u)
+	{
+		return;
+	}
+
+	// hard boundaries: triangles whose three vertices all miss the cache,
+	// the vertex cache order starting over somewhere else
+	std::vector<uint32_t> hardStarts;
+	{
+		FifoCache cache(vertexCount, AnalysisCacheSize);
+		for (size_t t = 0u; t < triangleCount; t++)
+		{
+			int misses = 0;
+			for (size_t k = 0u; k < 3u; k++)
+			{
+				misses += cache.Access(pIndices[t * 3u + k]) ? 1 : 0;
+			}
+			if (t == 0u || misses == 3)
+			{
+				hardStarts.push_back(uint32_t(t));
+			}
+		}
+		hardStarts.push_back(uint32_t(triangleCount));
+	}
+
+	// soft boundaries: within a hard cluster, a new cluster starts as soon
+	// as the current one is about as cache efficient as the whole; a
+	// cluster may then be drawn in any order at the price of a cold cache
+	std::vector<uint32_t> clusterStarts;
+	{
+		FifoCache cache(vertexCount, AnalysisCacheSize);
+		for (size_t h = 0u; h + 1u < hardStarts.size(); h++)
+		{
+			const uint32_t begin = hardStarts[h];
+			const uint32_t end = hardStarts[h + 1u];
+			cache.Flush();
+			size_t hardMisses = 0u;
+			for (uint32_t i = begin * 3u; i < end * 3u; i++)
+			{
+				hardMisses += cache.Access(pIndices[i]) ? 1u : 0u;
+			}
+			const float limit = threshold * float(hardMisses) / float(end - begin);
+
+			cache.Flush();
+			clusterStarts.push_back(begin);
+			size_t misses = 0u;
+			for (uint32_t t = begin; t < end; t++)
+			{
+				for (size_t k = 0u; k < 3u; k++)
+				{
+					misses += cache.Access(pIndices[t * 3u + k]) ? 1u : 0u;
+				}
+				if (t + 1u < end && float(misses) <= limit * float(t + 1u - clusterStarts.back()))
+				{
+					clusterStarts.push_back(t + 1u);
+					cache.Flush();
+					misses = 0u;
+				}
+			}
+		}
+		clusterStarts.push_back(uint32_t(triangleCount));
+	}
+	const size_t clusterCount = clusterStarts.size() - 1u;
+	if (clusterCount < 2u)
+	{
+		return;
+	}
+
+	// area weighted centroids and normals of the clusters and the mesh;
+	// clusters that face away from the mesh center tend to occlude the rest
+	// and go first
+	struct Cluster
+	{
+		double		centroid[3];
+		double		normal[3];
+		double		area;
+		uint32_t	begin;
+		uint32_t	end;
+		float		sortKey;
+	};
+	std::vector<Cluster> clusters(clusterCount);
+	double meshCentroid[3] = {};
+	double meshArea = 0.0;
+	for (size_t c = 0u; c < clusterCount; c++)
+	{
+		Cluster& cluster = clusters[c];
+		cluster = {};
+		cluster.begin = clusterStarts[c];
+		cluster.end = clusterStarts[c + 1u];
+		for (uint32_t t = cluster.begin; t < cluster.end; t++)
+		{
+			const float* p0 = PositionOf(pPositions, positionStride, pIndices[t * 3u]);
+			const float* p1 = PositionOf(pPositions, positionStride, pIndices[t * 3u + 1u]);
+			const float* p2 = PositionOf(pPositions, positionStride, pIndices[t * 3u + 2u]);
+			const double e1[3] = { double(p1[0]) - p0[0], double(p1[1]) - p0[1], double(p1[2]) - p0[2] };
+			const double e2[3] = { double(p2[0]) - p0[0], double(p2[1]) - p0[1], double(p2[2]) - p0[2] };
+			const double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			const double area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			for (int i = 0; i < 3; i++)
+			{
+				cluster.centroid[i] += area * (double(p0[i]) + p1[i] + p2[i]) / 3.0;
+				cluster.normal[i] += n[i];
+			}
+			cluster.area += area;
+		}
+		for (int i = 0; i < 3; i++)
+		{
+			meshCentroid[i] += cluster.centroid[i];
+		}
+		meshArea += cluster.area;
+	}
+	if (meshArea <= 0.0)
+	{
+		return;
+	}
+	for (int i = 0; i < 3; i++)
+	{
+		meshCentroid[i] /= meshArea;
+	}
+	for (Cluster& cluster : clusters)
+	{
+		const double length = std::sqrt(cluster.normal[0] * cluster.normal[0] + cluster.normal[1] * cluster.normal[1] +
+										cluster.normal[2] * cluster.normal[2]);
+		double key = 0.0;
+		if (cluster.area > 0.0 && length > 0.0)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				key += (cluster.centroid[i] / cluster.area - meshCentroid[i]) * cluster.normal[i] / length;
+			}
+		}
+		cluster.sortKey = float(key);
+	}
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b)
+	{
+		return a.sortKey > b.sortKey;
+	});
+
+	std::vector<uint32_t> output;
+	output.reserve(triangleCount * 3u);
+	for (const Cluster& cluster : clusters)
+	{
+		output.insert(output.end(), pIndices + cluster.begin * 3u, pIndices + cluster.end * 3u);
+	}
+	std::copy(output.begin(), output.end(), pIndices);
+}
+
+size_t MeshOptimizer::OptimizeVertexFetch(void* pVertices, size_t vertexCount, size_t vertexSize, uint32_t* pIndices, size_t indexCount)
+{
+	std::vector<uint32_t> remap(vertexCount, Unmapped);
+	uint32_t used = 0u;
+	for (size_t i = 0u; i < indexCount; i++)
+	{
+		uint32_t& mapped = remap[pIndices[i]];
+		if (mapped == Unmapped)
+		{
+			mapped = used++;
+		}
+		pIndices[i] = mapped;
+	}
+
+	unsigned char* pBytes = static_cast<unsigned char*>(pVertices);
+	const std::vector<unsigned char> original(pBytes, pBytes + vertexCount * vertexSize);
+	for (size_t v = 0u; v < vertexCount; v++)
+	{
+		if (remap[v] != Unmapped)
+		{
+			std::memcpy(pBytes + remap[v] * vertexSize, original.data() + v * vertexSize, vertexSize);
+		}
+	}
+	return used;
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::AnalyzeVertexCache(const uint32_t* pIndices, size_t indexCount, size_t vertexCount,
+															 unsigned int cacheSize)
+{
+	FifoCache cache(vertexCount, cacheSize);
+	std::vector<bool> used(vertexCount, false);
+	size_t misses = 0u;
+	size_t usedCount = 0u;
+	for (size_t i = 0u; i < indexCount; i++)
+	{
+		misses += cache.Access(pIndices[i]) ? 1u : 0u;
+		if (!used[pIndices[i]])
+		{
+			used[pIndices[i]] = true;
+			usedCount++;
+		}
+	}
+
+	CacheStats stats;
+	const size_t triangleCount = indexCount / 3u;
+	stats.acmr = triangleCount > 0u ? float(misses) / float(triangleCount) : 0.0f;
+	stats.atvr = usedCount > 0u ? float(misses) / float(usedCount) : 0.0f;
+	return stats;
+}
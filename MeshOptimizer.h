@@ -0,0 +1,82 @@
+#pragma once
+#include "JobSystem.h"
+#include "RenderDevice.h"
+#include <cstddef>
+#include <cstdint>
+
+// Reorders triangle lists for the GPU, at load time or offline:
+//	1. OptimizeVertexCache():	triangles in the order that reuses the post
+//								transform cache best (Forsyth, "Linear-Speed
+//								Vertex Cache Optimisation", 2006);
+//	2. OptimizeOverdraw():		that order cut into clusters of triangles,
+//								the clusters facing outwards drawn first, so
+//								early depth rejection hides more of the rest
+//								(Sander, Nehab and Barczak, "Fast Triangle
+//								Reordering for Vertex Locality and Reduced
+//								Overdraw", 2007);
+//	3. OptimizeVertexFetch():	vertices renumbered in order of first use,
+//								unused ones dropped, so vertex fetches walk
+//								the buffer forwards.
+// Optimize() runs all three on one mesh and reports the cache efficiency
+// before and after; the JobSystem overload spreads a batch of meshes over
+// the workers, one mesh per job.
+//
+// Cache efficiency is measured on a FIFO cache of AnalysisCacheSize
+// vertices, about what current GPUs reuse within a batch:
+//	- ACMR:	average cache miss ratio, vertex shader runs per triangle
+//			(0.5 at best for a large regular grid, 3 at worst);
+//	- ATVR:	average transformed vertex ratio, runs per vertex (1 at best).
+//
+// Nothing here depends on a device or on Windows.
+class MeshOptimizer
+{
+public:
+	static constexpr unsigned int AnalysisCacheSize = 16u;
+	// how much worse than its whole hard cluster the ACMR of an overdraw
+	// cluster may be
+	static constexpr float DefaultOverdrawThreshold = 1.05f;
+
+	struct CacheStats
+	{
+		float acmr { 0.0f };
+		float atvr { 0.0f };
+	};
+
+	struct Report
+	{
+		CacheStats	before;
+		CacheStats	after;
+		size_t		verticesBefore	{ 0u };
+		size_t		verticesAfter	{ 0u };
+		double		seconds			{ 0.0 };
+	};
+
+	// one mesh of a batch; vertices and indices are rewritten in place
+	struct Mesh
+	{
+		void*		pVertices		{ nullptr };
+		size_t		vertexCount		{ 0u };		// updated, unused vertices are dropped
+		size_t		vertexSize		{ 0u };		// bytes
+		size_t		positionOffset	{ 0u };		// bytes to a float[3] position in a vertex
+		void*		pIndices		{ nullptr };
+		IndexFormat	indexFormat		{ IndexFormat::R32_UInt };
+		size_t		indexCount		{ 0u };
+		Report		report;						// filled in by Optimize()
+	};
+
+public:
+	static Report	Optimize(Mesh& mesh, float overdrawThreshold = DefaultOverdrawThreshold);
+	static void		Optimize(JobSystem& jobs, Mesh* pMeshes, size_t meshCount, float overdrawThreshold = DefaultOverdrawThreshold);
+
+	// the steps on their own; indices are below vertexCount
+	static void		OptimizeVertexCache(uint32_t* pIndices, size_t indexCount, size_t vertexCount);
+	// pIndices in vertex cache order; pPositions is float[3] every
+	// positionStride bytes
+	static void		OptimizeOverdraw(uint32_t* pIndices, size_t indexCount, const float* pPositions, size_t positionStride,
+									 size_t vertexCount, float threshold = DefaultOverdrawThreshold);
+	// returns the new vertex count
+	static size_t	OptimizeVertexFetch(void* pVertices, size_t vertexCount, size_t vertexSize, uint32_t* pIndices, size_t indexCount);
+
+	static CacheStats	AnalyzeVertexCache(const uint32_t* pIndices, size_t indexCount, size_t vertexCount,
+										   unsigned int cacheSize = AnalysisCacheSize);
+};
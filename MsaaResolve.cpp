@@ -0,0 +1,300 @@
+#include "MsaaResolve.h"
+#include "Simd.h"
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+	// One dimension of the resolve filter: output pixel p reads the samples
+	// grid*p + offset + t for t in [0,taps), clamped to the image.
+	//
+	// Box reads the pixel's own grid samples with weight 1. Tent reads the
+	// 2*grid samples within one pixel of the center; a sample at distance d
+	// (in pixels) weighs 1-|d|, which scaled by 2*grid gives the odd integers
+	// 1,3,..,2*grid-1,..,3,1 (they sum to 2*grid^2).
+	struct Kernel
+	{
+		int			offset	{ 0 };
+		unsigned	taps	{ 1u };
+		uint16_t	weights[8] { 1u };
+		unsigned	sum		{ 1u };
+	};
+
+	Kernel MakeKernel(unsigned grid, ResolveFilter filter) noexcept
+	{
+		Kernel k;
+		if (grid == 1u)
+		{
+			return k;
+		}
+		if (filter == ResolveFilter::Box)
+		{
+			k.taps = grid;
+			std::fill_n(k.weights, grid, uint16_t(1u));
+			k.sum = grid;
+			return k;
+		}
+		k.offset = -int(grid / 2u);
+		k.taps = 2u * grid;
+		k.sum = 0u;
+		for (unsigned t = 0; t < k.taps; t++)
+		{
+			k.weights[t] = uint16_t(std::min(2u * t + 1u, 4u * grid - 2u * t - 1u));
+			k.sum += k.weights[t];
+		}
+		return k;
+	}
+
+	// x and y weight sums are powers of two, so is their product
+	unsigned Log2(unsigned v) noexcept
+	{
+		unsigned n = 0u;
+		while ((1u << n) < v)
+		{
+			n++;
+		}
+		return n;
+	}
+
+	int ClampIndex(int i, int count) noexcept
+	{
+		return std::clamp(i, 0, count - 1);
+	}
+
+	// the parameters both implementations derive from the arguments
+	struct Setup
+	{
+		SampleGrid	grid;
+		Kernel		kx;
+		Kernel		ky;
+		unsigned	shift;
+		int			sampleWidth;
+		int			sampleHeight;
+	};
+
+	Setup MakeSetup(unsigned width, unsigned height, unsigned sampleCount, ResolveFilter filter) noexcept
+	{
+		Setup s;
+		s.grid = GetSampleGrid(sampleCount);
+		s.kx = MakeKernel(s.grid.x, filter);
+		s.ky = MakeKernel(s.grid.y, filter);
+		s.shift = Log2(s.kx.sum * s.ky.sum);
+		s.sampleWidth = int(width * s.grid.x);
+		s.sampleHeight = int(height * s.grid.y);
+		return s;
+	}
+}
+
+SampleGrid GetSampleGrid(unsigned int sampleCount) noexcept
+{
+	switch (sampleCount)
+	{
+	case 2u:	return { 2u, 1u };
+	case 4u:	return { 2u, 2u };
+	case 8u:	return { 4u, 2u };
+	default:	return { 1u, 1u };
+	}
+}
+
+bool IsSupportedSampleCount(unsigned int sampleCount) noexcept
+{
+	return sampleCount == 1u || sampleCount == 2u || sampleCount == 4u || sampleCount == 8u;
+}
+
+void ResolveSamplesReference(const uint32_t* pSamples, uint32_t* pDest, unsigned int width, unsigned int height,
+							 unsigned int sampleCount, ResolveFilter filter, unsigned int rowBegin, unsigned int rowEnd)
+{
+	const Setup s = MakeSetup(width, height, sampleCount, filter);
+	const uint32_t round = (1u << s.shift) >> 1u;
+
+	for (unsigned y = rowBegin; y < rowEnd; y++)
+	{
+		for (unsigned x = 0; x < width; x++)
+		{
+			uint32_t acc[4] = {};
+			for (unsigned ty = 0; ty < s.ky.taps; ty++)
+			{
+				const int sy = ClampIndex(int(y * s.grid.y) + s.ky.offset + int(ty), s.sampleHeight);
+				for (unsigned tx = 0; tx < s.kx.taps; tx++)
+				{
+					const int sx = ClampIndex(int(x * s.grid.x) + s.kx.offset + int(tx), s.sampleWidth);
+					const uint32_t sample = pSamples[size_t(sy) * s.sampleWidth + sx];
+					const uint32_t w = uint32_t(s.ky.weights[ty]) * s.kx.weights[tx];
+					for (unsigned c = 0; c < 4u; c++)
+					{
+						acc[c] += ((sample >> (8u * c)) & 0xFFu) * w;
+					}
+				}
+			}
+			uint32_t color = 0u;
+			for (unsigned c = 0; c < 4u; c++)
+			{
+				color |= ((acc[c] + round) >> s.shift) << (8u * c);
+			}
+			pDest[size_t(y) * width + x] = color;
+		}
+	}
+}
+
+#if GENIX_SIMD_AVX2 || GENIX_SIMD_SSE2
+
+namespace
+{
+	// Horizontal pass over one sample row: 4 x 16 bit weighted sums per
+	// output pixel, two pixels per register. Sums stay below 2^16 because
+	// the weights of all taps (both passes) multiply to at most 256.
+	void FilterRow(const Setup& s, const uint32_t* pRow, unsigned width, uint16_t* pOut) noexcept
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const Kernel& k = s.kx;
+		unsigned x = 0u;
+
+		// box kernels start at offset 0, tent kernels never do
+		if (k.offset == 0 && k.taps == 2u)
+		{
+			// 2x box: the samples of two pixels are 4 consecutive values
+			for (; x + 2u <= width; x += 2u)
+			{
+				const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow + 2u * x));
+				const __m128i a = _mm_unpacklo_epi8(v, zero);	// s0 s1
+				const __m128i b = _mm_unpackhi_epi8(v, zero);	// s2 s3
+				const __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(a, b), _mm_unpackhi_epi64(a, b));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + 4u * x), sum);
+			}
+		}
+		else if (k.offset == 0 && k.taps == 4u)
+		{
+			// 4x box: 8 consecutive values
+			for (; x + 2u <= width; x += 2u)
+			{
+				const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow + 4u * x));
+				const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow + 4u * x + 4u));
+				const __m128i p0 = _mm_add_epi16(_mm_unpacklo_epi8(v0, zero), _mm_unpackhi_epi8(v0, zero));
+				const __m128i p1 = _mm_add_epi16(_mm_unpacklo_epi8(v1, zero), _mm_unpackhi_epi8(v1, zero));
+				const __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(p0, p1), _mm_unpackhi_epi64(p0, p1));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + 4u * x), sum);
+			}
+		}
+
+		// Tent: the taps of a pixel are consecutive samples, taken 4 at a time.
+		// A block is 2 samples in the low and 2 in the high half once widened
+		// to 16 bits, each half gets its own weight.
+		const unsigned blocks = k.offset != 0 && k.taps % 4u == 0u ? k.taps / 4u : 0u;
+		__m128i weightsLo[2];
+		__m128i weightsHi[2];
+		for (unsigned j = 0; j < blocks; j++)
+		{
+			const short* w = reinterpret_cast<const short*>(&k.weights[4u * j]);
+			weightsLo[j] = _mm_setr_epi16(w[0], w[0], w[0], w[0], w[1], w[1], w[1], w[1]);
+			weightsHi[j] = _mm_setr_epi16(w[2], w[2], w[2], w[2], w[3], w[3], w[3], w[3]);
+		}
+
+		for (; x < width; x += 2u)
+		{
+			const int k0 = int(x * s.grid.x) + k.offset;
+			const bool pair = x + 1u < width;
+			__m128i acc = zero;
+			if (blocks != 0u && pair && k0 >= 0 && k0 + int(s.grid.x + k.taps) <= s.sampleWidth)
+			{
+				__m128i p[2] = { zero, zero };
+				for (unsigned i = 0; i < 2u; i++)
+				{
+					const uint32_t* pTaps = pRow + k0 + int(i * s.grid.x);
+					for (unsigned j = 0; j < blocks; j++)
+					{
+						const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pTaps + 4u * j));
+						p[i] = _mm_add_epi16(p[i], _mm_add_epi16(
+							_mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), weightsLo[j]),
+							_mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), weightsHi[j])));
+					}
+				}
+				acc = _mm_add_epi16(_mm_unpacklo_epi64(p[0], p[1]), _mm_unpackhi_epi64(p[0], p[1]));
+			}
+			else
+			{
+				// the image borders and leftovers: every index is clamped
+				const int k1 = pair ? k0 + int(s.grid.x) : k0;
+				for (unsigned t = 0; t < k.taps; t++)
+				{
+					const __m128i v = _mm_unpacklo_epi32(
+						_mm_cvtsi32_si128(int(pRow[ClampIndex(k0 + int(t), s.sampleWidth)])),
+						_mm_cvtsi32_si128(int(pRow[ClampIndex(k1 + int(t), s.sampleWidth)])));
+					acc = _mm_add_epi16(acc, _mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), _mm_set1_epi16(short(k.weights[t]))));
+				}
+			}
+			if (pair)
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + 4u * x), acc);
+			}
+			else
+			{
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(pOut + 4u * x), acc);
+			}
+		}
+	}
+}
+
+void ResolveSamples(const uint32_t* pSamples, uint32_t* pDest, unsigned int width, unsigned int height,
+					unsigned int sampleCount, ResolveFilter filter, unsigned int rowBegin, unsigned int rowEnd)
+{
+	const Setup s = MakeSetup(width, height, sampleCount, filter);
+	const __m128i round = _mm_set1_epi16(short((1u << s.shift) >> 1u));
+	const __m128i shift = _mm_cvtsi32_si128(int(s.shift));
+
+	// Horizontally filtered sample rows, sample row sy lives in slot
+	// sy % taps. The rows an output row reads are consecutive, so they never
+	// share a slot, and a tent filter finds the rows it shares with the
+	// previous output row already done.
+	std::vector<uint16_t> rows(size_t(s.ky.taps) * width * 4u);
+	std::vector<int> rowInSlot(s.ky.taps, -1);
+	unsigned slots[8];
+
+	for (unsigned y = rowBegin; y < rowEnd; y++)
+	{
+		for (unsigned ty = 0; ty < s.ky.taps; ty++)
+		{
+			const int sy = ClampIndex(int(y * s.grid.y) + s.ky.offset + int(ty), s.sampleHeight);
+			slots[ty] = unsigned(sy) % s.ky.taps;
+			if (rowInSlot[slots[ty]] != sy)
+			{
+				FilterRow(s, pSamples + size_t(sy) * s.sampleWidth, width, &rows[size_t(slots[ty]) * width * 4u]);
+				rowInSlot[slots[ty]] = sy;
+			}
+		}
+
+		// vertical pass, normalize and pack back to bytes
+		uint32_t* pOut = pDest + size_t(y) * width;
+		for (unsigned x = 0; x < width; x += 2u)
+		{
+			const bool pair = x + 1u < width;
+			__m128i acc = _mm_setzero_si128();
+			for (unsigned ty = 0; ty < s.ky.taps; ty++)
+			{
+				const uint16_t* pIn = &rows[(size_t(slots[ty]) * width + x) * 4u];
+				const __m128i v = pair ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(pIn))
+									   : _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pIn));
+				acc = _mm_add_epi16(acc, _mm_mullo_epi16(v, _mm_set1_epi16(short(s.ky.weights[ty]))));
+			}
+			acc = _mm_srl_epi16(_mm_add_epi16(acc, round), shift);
+			const __m128i packed = _mm_packus_epi16(acc, acc);
+			if (pair)
+			{
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(pOut + x), packed);
+			}
+			else
+			{
+				pOut[x] = uint32_t(_mm_cvtsi128_si32(packed));
+			}
+		}
+	}
+}
+
+#else
+
+void ResolveSamples(const uint32_t* pSamples, uint32_t* pDest, unsigned int width, unsigned int height,
+					unsigned int sampleCount, ResolveFilter filter, unsigned int rowBegin, unsigned int rowEnd)
+{
+	ResolveSamplesReference(pSamples, pDest, width, height, sampleCount, filter, rowBegin, rowEnd);
+}
+
+#endif
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+
+// How the samples of a pixel are combined into its resolved color.
+//	Box		average of the pixel's own samples, what ResolveSubresource() does
+//	Tent	every sample closer than one pixel to the pixel center, weighted
+//			by 1 - distance (separable in x and y); softer, but thin lines
+//			and edges crawl less
+enum class ResolveFilter
+{
+	Box,
+	Tent,
+};
+
+// The software device keeps a multisampled image as an ordered grid: every
+// pixel holds x * y samples and the whole image is simply rendered at
+// x*width by y*height. Supported counts are 1, 2 (2x1), 4 (2x2) and 8 (4x2).
+struct SampleGrid
+{
+	unsigned int x { 1u };
+	unsigned int y { 1u };
+};
+SampleGrid	GetSampleGrid(unsigned int sampleCount) noexcept;
+bool		IsSupportedSampleCount(unsigned int sampleCount) noexcept;
+
+// Resolves rows [rowBegin,rowEnd) of a width x height BGRA8 image from the
+// sample image of sampleCount samples per pixel (laid out as above). Rows
+// are independent, so an image can be split over threads.
+//
+// Both functions produce bit identical results: all weights are integers
+// and the sums are exact in 16 bits. ResolveSamples() uses SSE2 where
+// Simd.h found it, ResolveSamplesReference() is the plain per pixel
+// definition it is checked against.
+void ResolveSamples(const uint32_t* pSamples, uint32_t* pDest, unsigned int width, unsigned int height,
+					unsigned int sampleCount, ResolveFilter filter, unsigned int rowBegin, unsigned int rowEnd);
+void ResolveSamplesReference(const uint32_t* pSamples, uint32_t* pDest, unsigned int width, unsigned int height,
+							 unsigned int sampleCount, ResolveFilter filter, unsigned int rowBegin, unsigned int rowEnd);
@@ -0,0 +1,393 @@
+#include "OcclusionCuller.h"
+#include "Simd.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+	static_assert(OcclusionCuller::TileHeight == unsigned(SimdWidth), "a tile row per SIMD lane");
+
+	// vertices closer to the eye plane than this are not rasterized
+	constexpr float MinW = 1e-5f;
+	// the working layer of an empty tile: nothing covered, nearest possible
+	constexpr float EmptyLayer = 1.0f;
+	constexpr float HorizontalEpsilon = 1.0f / 4096.0f;
+	// boxes per CullBoxes() job
+	constexpr size_t CullGrain = 256u;
+
+	void TransformPoint(const float m[16], const float p[3], float out[4]) noexcept
+	{
+		for (int r = 0; r < 4; r++)
+		{
+			out[r] = m[r * 4 + 0] * p[0] + m[r * 4 + 1] * p[1] + m[r * 4 + 2] * p[2] + m[r * 4 + 3];
+		}
+	}
+}
+
+OcclusionCuller::OcclusionCuller(JobSystem& jobs, unsigned int width, unsigned int height)
+	: jobs(jobs),
+	width(width),
+	height(height),
+	tilesX((width + TileWidth - 1u) / TileWidth),
+	tilesY((height + TileHeight - 1u) / TileHeight),
+	masks(size_t(tilesX) * tilesY * TileHeight),
+	zFar0(size_t(tilesX) * tilesY + SimdWidth),
+	zFar1(size_t(tilesX) * tilesY),
+	bins(tilesY)
+{
+	BeginFrame();
+}
+
+void OcclusionCuller::BeginFrame() noexcept
+{
+	std::fill(masks.begin(), masks.end(), 0u);
+	std::fill(zFar0.begin(), zFar0.end(), 0.0f);
+	std::fill(zFar1.begin(), zFar1.end(), EmptyLayer);
+	triangles.clear();
+	for (std::vector<uint32_t>& bin : bins)
+	{
+		bin.clear();
+	}
+	stats = {};
+}
+
+void OcclusionCuller::AddOccluder(const float* pPositions, size_t vertexCount, const uint32_t* pIndices,
+								  size_t triangleCount, const float toClip[16])
+{
+	clipScratch.resize(vertexCount * 4u);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		TransformPoint(toClip, pPositions + v * 3u, &clipScratch[v * 4u]);
+	}
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		SetupTriangle(&clipScratch[pIndices[t * 3u + 0u] * 4u],
+					  &clipScratch[pIndices[t * 3u + 1u] * 4u],
+					  &clipScratch[pIndices[t * 3u + 2u] * 4u]);
+	}
+	stats.occluderTriangles += triangleCount;
+}
+
+void OcclusionCuller::SetupTriangle(const float* v0, const float* v1, const float* v2)
+{
+	const float* v[3] = { v0, v1, v2 };
+	float x[3], y[3], z[3];
+	for (int i = 0; i < 3; i++)
+	{
+		// crossing the eye plane would need clipping; occluders only have
+		// to be a subset of the real geometry, so the triangle is dropped
+		if (!(v[i][3] >= MinW))
+		{
+			return;
+		}
+		const float rcpW = 1.0f / v[i][3];
+		x[i] = (v[i][0] * rcpW * 0.5f + 0.5f) * float(width);
+		y[i] = (0.5f - v[i][1] * rcpW * 0.5f) * float(height);
+		z[i] = v[i][2] * rcpW;
+	}
+
+	// clockwise on screen (y down) = front facing, like the rasterizer
+	const float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+	if (!(area > 0.0f))
+	{
+		return;
+	}
+	// entirely beyond the far plane
+	if (std::max({ z[0], z[1], z[2] }) < 0.0f)
+	{
+		return;
+	}
+
+	// pixel centers inside the bounding box, clipped to the buffer
+	Triangle tri;
+	const float minX = std::min({ x[0], x[1], x[2] });
+	const float maxX = std::max({ x[0], x[1], x[2] });
+	const float minY = std::min({ y[0], y[1], y[2] });
+	const float maxY = std::max({ y[0], y[1], y[2] });
+	tri.minX = int32_t(std::clamp(std::ceil(minX - 0.5f), 0.0f, float(width)));
+	tri.minY = int32_t(std::clamp(std::ceil(minY - 0.5f), 0.0f, float(height)));
+	tri.maxX = int32_t(std::clamp(std::floor(maxX - 0.5f), -1.0f, float(width) - 1.0f));
+	tri.maxY = int32_t(std::clamp(std::floor(maxY - 0.5f), -1.0f, float(height) - 1.0f));
+	if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+	{
+		return;
+	}
+
+	// edge i runs from vertex i+1 to vertex i+2
+	for (int i = 0; i < 3; i++)
+	{
+		const int from = (i + 1) % 3;
+		const int to = (i + 2) % 3;
+		const float dx = x[to] - x[from];
+		const float dy = y[to] - y[from];
+		// edges within 1/4096 of a pixel of horizontal are treated as such,
+		// their crossing would not be representable
+		tri.a[i] = std::fabs(dy) >= HorizontalEpsilon ? -dy : 0.0f;
+		tri.b[i] = dx;
+		tri.c[i] = dy * x[from] - dx * y[from];
+		tri.xBase[i] = tri.a[i] != 0.0f ? -tri.c[i] / tri.a[i] : 0.0f;
+		tri.xSlope[i] = tri.a[i] != 0.0f ? -tri.b[i] / tri.a[i] : 0.0f;
+	}
+
+	const float dz1 = z[1] - z[0];
+	const float dz2 = z[2] - z[0];
+	tri.zDx = (dz1 * (y[2] - y[0]) - (y[1] - y[0]) * dz2) / area;
+	tri.zDy = ((x[1] - x[0]) * dz2 - dz1 * (x[2] - x[0])) / area;
+	tri.zBase = z[0] - tri.zDx * x[0] - tri.zDy * y[0];
+	tri.zMin = std::min({ z[0], z[1], z[2] });
+	tri.zMax = std::max({ z[0], z[1], z[2] });
+
+	const uint32_t index = uint32_t(triangles.size());
+	triangles.push_back(tri);
+	for (int32_t row = tri.minY / int32_t(TileHeight); row <= tri.maxY / int32_t(TileHeight); row++)
+	{
+		bins[row].push_back(index);
+	}
+}
+
+void OcclusionCuller::RasterizeOccluders()
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	std::vector<uint64_t> bandUpdates(tilesY, 0u);
+	jobs.ParallelFor(tilesY, 1u, [&](size_t begin, size_t end, unsigned int)
+	{
+		for (size_t row = begin; row < end; row++)
+		{
+			RasterizeBand(unsigned(row), bandUpdates[row]);
+		}
+	});
+
+	stats.trianglesRasterized += triangles.size();
+	for (const uint64_t updates : bandUpdates)
+	{
+		stats.tileUpdates += updates;
+	}
+	stats.rasterSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void OcclusionCuller::RasterizeBand(unsigned int tileRow, uint64_t& tileUpdates) noexcept
+{
+	// submission order, so the result does not depend on the thread count
+	for (const uint32_t index : bins[tileRow])
+	{
+		RasterizeTriangle(triangles[index], tileRow, tileUpdates);
+	}
+}
+
+void OcclusionCuller::RasterizeTriangle(const Triangle& tri, unsigned int tileRow, uint64_t& tileUpdates) noexcept
+{
+	const int32_t rowY0 = int32_t(tileRow * TileHeight);
+	const SimdInt rowY = SimdInt::Ramp() + SimdInt(rowY0);
+	const SimdFloat rowCenter = ToFloat(rowY) + SimdFloat(0.5f);
+	// rows of the band inside the bounding box
+	const SimdInt rows = AndNot(CmpGt(SimdInt(tri.minY), rowY) | CmpGt(rowY, SimdInt(tri.maxY)), SimdInt(-1));
+	// rows of the last tile row below the buffer are never covered
+	const SimdInt rowsOutside = CmpGt(rowY, SimdInt(int32_t(height) - 1));
+
+	// Per row (lane) each edge is either a left edge (inside to the right of
+	// where it crosses the row), a right edge or horizontal (the whole row
+	// is inside or outside). The crossing is kept relative to pixel centers.
+	SimdFloat crossing[3];
+	SimdInt horizontal[3];
+	for (int i = 0; i < 3; i++)
+	{
+		crossing[i] = MulAdd(SimdFloat(tri.xSlope[i]), rowCenter, SimdFloat(tri.xBase[i] - 0.5f));
+		horizontal[i] = CmpGe(MulAdd(SimdFloat(tri.b[i]), rowCenter, SimdFloat(tri.c[i])), SimdFloat(0.0f));
+	}
+
+	const SimdInt allBits(-1);
+	const unsigned int tileX0 = unsigned(tri.minX) / TileWidth;
+	const unsigned int tileX1 = unsigned(tri.maxX) / TileWidth;
+	for (unsigned int tx = tileX0; tx <= tileX1; tx++)
+	{
+		const float left = float(tx * TileWidth);
+		SimdInt coverage = rows;
+		for (int i = 0; i < 3; i++)
+		{
+			if (tri.a[i] == 0.0f)
+			{
+				coverage &= horizontal[i];
+				continue;
+			}
+			// column of the crossing inside this tile, clamped to [-1,33]
+			// so the conversions stay in range
+			const SimdFloat column = Clamp(crossing[i] - SimdFloat(left), SimdFloat(-1.0f), SimdFloat(float(TileWidth) + 1.0f));
+			if (tri.a[i] > 0.0f)
+			{
+				// covered from the first center at or right of the crossing
+				const SimdInt first = Max(ToInt(-Floor(-column)), SimdInt(0));
+				coverage &= ShiftRightLogic(allBits, first);
+			}
+			else
+			{
+				// covered up to the last center at or left of it
+				const SimdInt count = Max(ToInt(Floor(column)) + SimdInt(1), SimdInt(0));
+				coverage &= AndNot(ShiftRightLogic(allBits, count), allBits);
+			}
+		}
+		if (MoveMask(CmpEq(coverage, SimdInt(0))) == 0xFF)
+		{
+			continue;
+		}
+
+		// depth bounds of the triangle over the part of the tile its
+		// bounding box covers: the plane at the corners, clamped to the
+		// vertex range
+		const float x0 = float(std::max(int32_t(tx * TileWidth), tri.minX)) + 0.5f;
+		const float x1 = float(std::min(int32_t(tx * TileWidth + TileWidth - 1u), tri.maxX)) + 0.5f;
+		const float y0 = float(std::max(rowY0, tri.minY)) + 0.5f;
+		const float y1 = float(std::min(rowY0 + int32_t(TileHeight) - 1, tri.maxY)) + 0.5f;
+		const float zFarTri = std::max(tri.zMin,
+			tri.zBase + std::min(tri.zDx * x0, tri.zDx * x1) + std::min(tri.zDy * y0, tri.zDy * y1));
+		const float zNearTri = std::min(tri.zMax,
+			tri.zBase + std::max(tri.zDx * x0, tri.zDx * x1) + std::max(tri.zDy * y0, tri.zDy * y1));
+
+		const size_t tile = size_t(tileRow) * tilesX + tx;
+		float& far0 = zFar0[tile];
+		float& far1 = zFar1[tile];
+		// behind everything the tile already holds
+		if (zNearTri < far0)
+		{
+			continue;
+		}
+		tileUpdates++;
+
+		// covered pixels are at least as near as the triangle and as layer 0
+		const float zTri = std::max(zFarTri, far0);
+		uint32_t* pMask = &masks[tile * TileHeight];
+		SimdInt mask = SimdInt::Load(reinterpret_cast<const int32_t*>(pMask));
+
+		// a triangle much nearer than the working layer (compared to the gap
+		// between the layers) starts a new working layer
+		if (zTri - far1 > far1 - far0)
+		{
+			far1 = EmptyLayer;
+			mask = SimdInt(0);
+		}
+		far1 = std::min(far1, zTri);
+		mask |= coverage;
+
+		// a fully covered working layer becomes layer 0; so do the columns
+		// of the last tile column right of the buffer
+		const SimdInt outside = rowsOutside | ShiftRightLogic(allBits, SimdInt(int32_t(std::min(width - tx * TileWidth, TileWidth))));
+		if (MoveMask(CmpEq(mask | outside, allBits)) == 0xFF)
+		{
+			far0 = far1;
+			far1 = EmptyLayer;
+			mask = SimdInt(0);
+		}
+		mask.Store(pMask);
+	}
+}
+
+OcclusionCuller::CullResult OcclusionCuller::TestBox(const Aabb& box, const float m[16]) const noexcept
+{
+	// the 8 corners in the 8 lanes: bit 0 of the lane picks max x, bit 1
+	// max y, bit 2 max z
+	const SimdInt lane = SimdInt::Ramp();
+	const SimdFloat px = Select(CmpEq(lane & SimdInt(1), SimdInt(1)), SimdFloat(box.min[0]), SimdFloat(box.max[0]));
+	const SimdFloat py = Select(CmpEq(lane & SimdInt(2), SimdInt(2)), SimdFloat(box.min[1]), SimdFloat(box.max[1]));
+	const SimdFloat pz = Select(CmpEq(lane & SimdInt(4), SimdInt(4)), SimdFloat(box.min[2]), SimdFloat(box.max[2]));
+	auto row = [&](int r)
+	{
+		return MulAdd(SimdFloat(m[r * 4 + 0]), px, MulAdd(SimdFloat(m[r * 4 + 1]), py,
+			MulAdd(SimdFloat(m[r * 4 + 2]), pz, SimdFloat(m[r * 4 + 3]))));
+	};
+	const SimdFloat cx = row(0);
+	const SimdFloat cy = row(1);
+	const SimdFloat cz = row(2);
+	const SimdFloat cw = row(3);
+
+	const int behindEye = MoveMask(CmpLt(cw, SimdFloat(MinW)));
+	if (behindEye == 0xFF)
+	{
+		return CullResult::OutsideView;
+	}
+	if (behindEye != 0)
+	{
+		// reaches around the eye, no screen rectangle to test
+		return CullResult::Visible;
+	}
+
+	const SimdFloat rcpW = SimdFloat(1.0f) / cw;
+	const SimdFloat sx = MulAdd(cx * rcpW, SimdFloat(0.5f * float(width)), SimdFloat(0.5f * float(width)));
+	const SimdFloat sy = MulAdd(cy * rcpW, SimdFloat(-0.5f * float(height)), SimdFloat(0.5f * float(height)));
+	const SimdFloat sz = cz * rcpW;
+	const float x0 = HorizontalMin(sx);
+	const float x1 = HorizontalMax(sx);
+	const float y0 = HorizontalMin(sy);
+	const float y1 = HorizontalMax(sy);
+	const float nearest = HorizontalMax(sz);
+	const float farthest = HorizontalMin(sz);
+	if (x1 < 0.0f || y1 < 0.0f || x0 > float(width) || y0 > float(height) || nearest < 0.0f || farthest > 1.0f)
+	{
+		return CullResult::OutsideView;
+	}
+	return IsOccluded(x0, y0, x1, y1, std::min(nearest, 1.0f)) ? CullResult::Occluded : CullResult::Visible;
+}
+
+bool OcclusionCuller::IsOccluded(float x0, float y0, float x1, float y1, float nearestDepth) const noexcept
+{
+	// every pixel the rectangle touches, as tiles
+	const unsigned int px0 = unsigned(std::clamp(std::floor(x0), 0.0f, float(width - 1u)));
+	const unsigned int py0 = unsigned(std::clamp(std::floor(y0), 0.0f, float(height - 1u)));
+	const unsigned int px1 = unsigned(std::clamp(std::ceil(x1), float(px0 + 1u), float(width)));
+	const unsigned int py1 = unsigned(std::clamp(std::ceil(y1), float(py0 + 1u), float(height)));
+	const unsigned int tx0 = px0 / TileWidth;
+	const unsigned int ty0 = py0 / TileHeight;
+	const unsigned int tx1 = (px1 - 1u) / TileWidth;
+	const unsigned int ty1 = (py1 - 1u) / TileHeight;
+
+	// 8 tiles of a row per test; zFar0 is padded for the loads past the end
+	const SimdFloat depth(nearestDepth);
+	for (unsigned int ty = ty0; ty <= ty1; ty++)
+	{
+		for (unsigned int tx = tx0; tx <= tx1; tx += SimdWidth)
+		{
+			const SimdFloat far0 = SimdFloat::Load(&zFar0[size_t(ty) * tilesX + tx]);
+			const int inRange = (1 << std::min(tx1 - tx + 1u, unsigned(SimdWidth))) - 1;
+			if ((MoveMask(CmpGe(depth, far0)) & inRange) != 0)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+size_t OcclusionCuller::CullBoxes(const Aabb* pBoxes, size_t count, const float toClip[16], uint32_t* pVisible)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	results.resize(count);
+	jobs.ParallelFor(count, CullGrain, [&](size_t begin, size_t end, unsigned int)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			results[i] = TestBox(pBoxes[i], toClip);
+		}
+	});
+
+	size_t visible = 0u;
+	for (size_t i = 0; i < count; i++)
+	{
+		switch (results[i])
+		{
+		case CullResult::Visible:
+			pVisible[visible++] = uint32_t(i);
+			break;
+		case CullResult::Occluded:
+			stats.boxesOccluded++;
+			break;
+		case CullResult::OutsideView:
+			stats.boxesOutsideView++;
+			break;
+		}
+	}
+	stats.boxesTested += count;
+	stats.boxesVisible += visible;
+	stats.cullSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return visible;
+}
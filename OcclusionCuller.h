@@ -0,0 +1,144 @@
+#pragma once
+#include "JobSystem.h"
+#include <cstdint>
+#include <vector>
+
+// Masked software occlusion culling (after Hasselgren, Andersson and
+// Akenine-Möller, "Masked Software Occlusion Culling", HPG 2016).
+//
+// A few large occluder meshes are rasterized into a small depth buffer
+// that is never stored per pixel. The screen is split into 32x8 pixel
+// tiles; a tile keeps
+//	- zFar0:	a far bound for the depth of all of its pixels
+//	- mask:		one bit per pixel (a row of 32 pixels per SIMD lane)
+//	- zFar1:	a far bound for the pixels in mask
+// Occluder triangles only add coverage to mask and pull zFar1 near. Once
+// mask covers the whole tile, zFar1 becomes the new zFar0. A triangle much
+// nearer than the working layer restarts it instead, so a tile always
+// holds its two most useful depth layers in 40 bytes.
+//
+// Object bounding boxes are then tested against zFar0 of the tiles their
+// screen rectangle touches: a box whose nearest point is farther than zFar0
+// of every one of them is hidden. Both steps are conservative: occluders
+// may be missed (triangles crossing the eye plane are dropped), an object
+// is never reported hidden while any part of it could be seen.
+//
+// Depth follows the renderer: reversed Z (see DepthMode), z / w of clip
+// space, 1 = near plane, 0 = far plane. Matrices are 4x4 floats, row major,
+// applied to column vectors: clip.x = m[0]*x + m[1]*y + m[2]*z + m[3].
+// Occluders are drawn like the rasterizer draws: clockwise triangles are
+// front facing and only front faces occlude.
+//
+// Rasterization is split into bands of one tile row over the JobSystem,
+// box tests into chunks of boxes. A frame is
+//
+//	culler.BeginFrame();
+//	culler.AddOccluder(...);			// any number
+//	culler.RasterizeOccluders();
+//	culler.CullBoxes(...);				// or TestBox() per object
+//	... submit the draws of the visible objects
+class OcclusionCuller
+{
+public:
+	static constexpr unsigned int TileWidth		= 32u;
+	static constexpr unsigned int TileHeight	= 8u;
+	// a quarter of the 720p back buffer in each direction is plenty for
+	// occluders, which are large by definition
+	static constexpr unsigned int DefaultWidth	= 320u;
+	static constexpr unsigned int DefaultHeight	= 180u;
+
+	struct Aabb
+	{
+		float min[3];
+		float max[3];
+	};
+
+	enum class CullResult : uint8_t
+	{
+		Visible,
+		Occluded,
+		OutsideView,	// off screen, beyond the far or in front of the near plane
+	};
+
+	// counters of the frame since BeginFrame()
+	struct Stats
+	{
+		uint64_t	occluderTriangles	{ 0u };	// submitted through AddOccluder()
+		uint64_t	trianglesRasterized	{ 0u };	// front facing, in front of the eye and on screen
+		uint64_t	tileUpdates			{ 0u };	// (triangle, tile) pairs that added coverage
+		uint64_t	boxesTested			{ 0u };
+		uint64_t	boxesVisible		{ 0u };
+		uint64_t	boxesOccluded		{ 0u };
+		uint64_t	boxesOutsideView	{ 0u };
+		double		rasterSeconds		{ 0.0 };
+		double		cullSeconds			{ 0.0 };
+	};
+
+public:
+	// width x height is the resolution of the culling buffer, independent of
+	// the back buffer; it is rounded up to whole tiles internally
+	explicit OcclusionCuller(JobSystem& jobs, unsigned int width = DefaultWidth, unsigned int height = DefaultHeight);
+	OcclusionCuller(const OcclusionCuller&) = delete;
+	OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+	// clears the buffer (everything at the far plane), the occluders and the stats
+	void		BeginFrame() noexcept;
+	// queues an indexed triangle list; positions are 3 floats per vertex,
+	// toClip takes them to clip space
+	void		AddOccluder(const float* pPositions, size_t vertexCount, const uint32_t* pIndices,
+							size_t triangleCount, const float toClip[16]);
+	// draws the occluders queued since BeginFrame()
+	void		RasterizeOccluders();
+
+	CullResult	TestBox(const Aabb& box, const float toClip[16]) const noexcept;
+	// true when the rectangle [x0,x1) x [y0,y1) of buffer pixels holds
+	// nothing farther than nearestDepth
+	bool		IsOccluded(float x0, float y0, float x1, float y1, float nearestDepth) const noexcept;
+	// tests every box on the worker threads and writes the indices of the
+	// visible ones to pVisible (count entries at most) in increasing order;
+	// returns how many were written
+	size_t		CullBoxes(const Aabb* pBoxes, size_t count, const float toClip[16], uint32_t* pVisible);
+
+	unsigned int	GetWidth()	const noexcept { return width; }
+	unsigned int	GetHeight()	const noexcept { return height; }
+	const Stats&	GetStats()	const noexcept { return stats; }
+
+private:
+	// occluder triangle in buffer pixels, set up once for all bands
+	struct Triangle
+	{
+		// edge i: inside where a*x + b*y + c >= 0; per row the edge is
+		// crossed at x = xBase + xSlope * y
+		float	a[3], b[3], c[3];
+		float	xBase[3], xSlope[3];
+		// z = zBase + zDx * x + zDy * y, bounded by the vertex depths
+		float	zBase, zDx, zDy;
+		float	zMin, zMax;
+		// inclusive pixel bounds
+		int32_t	minX, minY, maxX, maxY;
+	};
+
+	void	SetupTriangle(const float* v0, const float* v1, const float* v2);
+	void	RasterizeBand(unsigned int tileRow, uint64_t& tileUpdates) noexcept;
+	void	RasterizeTriangle(const Triangle& tri, unsigned int tileRow, uint64_t& tileUpdates) noexcept;
+
+private:
+	JobSystem&		jobs;
+	unsigned int	width;
+	unsigned int	height;
+	unsigned int	tilesX;
+	unsigned int	tilesY;
+
+	// per tile, SoA; masks are TileHeight rows of 32 bits, bit 31 = column 0.
+	// zFar0 has SimdWidth floats of padding so tests can load 8 tiles at once.
+	std::vector<uint32_t>	masks;
+	std::vector<float>		zFar0;
+	std::vector<float>		zFar1;
+
+	std::vector<Triangle>				triangles;
+	std::vector<std::vector<uint32_t>>	bins;		// triangles per tile row
+	std::vector<float>					clipScratch;
+	std::vector<CullResult>				results;	// CullBoxes() scratch
+
+	Stats stats;
+};
@@ -0,0 +1,326 @@
+#include "Picker.h"
+#include "Simd.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+	constexpr float Infinity = std::numeric_limits<float>::infinity();
+
+	// a cluster is v0, edge1 = v1 - v0 and edge2 = v2 - v0, each component
+	// ClusterSize lanes wide; unused lanes are all zero and never hit
+	constexpr size_t ClusterFloats = 9u * Picker::ClusterSize;
+	static_assert(Picker::ClusterSize == SimdWidth, "a cluster is one SIMD block");
+
+	constexpr uint32_t NoTriangle = ~0u;
+
+	// spreads the low 10 bits of v to every third bit
+	uint32_t SpreadBits(uint32_t v) noexcept
+	{
+		v &= 0x3FFu;
+		v = (v | (v << 16)) & 0x030000FFu;
+		v = (v | (v << 8)) & 0x0300F00Fu;
+		v = (v | (v << 4)) & 0x030C30C3u;
+		v = (v | (v << 2)) & 0x09249249u;
+		return v;
+	}
+
+	// m^-1 by Gauss-Jordan elimination; false when m is singular
+	bool Invert(const float m[16], double inverse[16]) noexcept
+	{
+		double a[4][8];
+		for (int r = 0; r < 4; r++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				a[r][c] = m[r * 4 + c];
+				a[r][c + 4] = r == c ? 1.0 : 0.0;
+			}
+		}
+		for (int c = 0; c < 4; c++)
+		{
+			int pivot = c;
+			for (int r = c + 1; r < 4; r++)
+			{
+				if (std::fabs(a[r][c]) > std::fabs(a[pivot][c]))
+				{
+					pivot = r;
+				}
+			}
+			if (a[pivot][c] == 0.0)
+			{
+				return false;
+			}
+			std::swap(a[pivot], a[c]);
+			const double scale = 1.0 / a[c][c];
+			for (double& x : a[c])
+			{
+				x *= scale;
+			}
+			for (int r = 0; r < 4; r++)
+			{
+				if (r != c)
+				{
+					const double factor = a[r][c];
+					for (int k = 0; k < 8; k++)
+					{
+						a[r][k] -= factor * a[c][k];
+					}
+				}
+			}
+		}
+		for (int r = 0; r < 4; r++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				inverse[r * 4 + c] = a[r][c + 4];
+			}
+		}
+		return true;
+	}
+
+	// Möller-Trumbore against the 8 triangles of a cluster, both faces.
+	// Returns the distance of the closest hit below maxDistance, Infinity for
+	// none, with its lane and the weights of vertices 1 and 2.
+	float IntersectCluster(const float* pCluster, const Picker::Ray& ray, float maxDistance, int& lane, float& u, float& v) noexcept
+	{
+		auto load = [pCluster](int component)
+		{
+			return SimdFloat::Load(pCluster + component * SimdWidth);
+		};
+		const SimdFloat e1x = load(3), e1y = load(4), e1z = load(5);
+		const SimdFloat e2x = load(6), e2y = load(7), e2z = load(8);
+		const SimdFloat dx(ray.direction[0]), dy(ray.direction[1]), dz(ray.direction[2]);
+
+		// p = d x e2, det = e1 . p
+		const SimdFloat px = dy * e2z - dz * e2y;
+		const SimdFloat py = dz * e2x - dx * e2z;
+		const SimdFloat pz = dx * e2y - dy * e2x;
+		const SimdFloat det = MulAdd(e1x, px, MulAdd(e1y, py, e1z * pz));
+		const SimdFloat invDet = SimdFloat(1.0f) / det;
+
+		const SimdFloat tx = SimdFloat(ray.origin[0]) - load(0);
+		const SimdFloat ty = SimdFloat(ray.origin[1]) - load(1);
+		const SimdFloat tz = SimdFloat(ray.origin[2]) - load(2);
+		const SimdFloat uu = MulAdd(tx, px, MulAdd(ty, py, tz * pz)) * invDet;
+		// q = t x e1
+		const SimdFloat qx = ty * e1z - tz * e1y;
+		const SimdFloat qy = tz * e1x - tx * e1z;
+		const SimdFloat qz = tx * e1y - ty * e1x;
+		const SimdFloat vv = MulAdd(dx, qx, MulAdd(dy, qy, dz * qz)) * invDet;
+		const SimdFloat distance = MulAdd(e2x, qx, MulAdd(e2y, qy, e2z * qz)) * invDet;
+
+		// degenerate triangles and rays in their plane have det == 0
+		const SimdInt miss = CmpLe(Abs(det), SimdFloat(0.0f)) | CmpLt(uu, SimdFloat(0.0f)) | CmpLt(vv, SimdFloat(0.0f)) |
+							 CmpGt(uu + vv, SimdFloat(1.0f)) | CmpLt(distance, SimdFloat(0.0f)) | CmpGe(distance, SimdFloat(maxDistance));
+		const SimdFloat hits = Select(miss, distance, SimdFloat(Infinity));
+		const float closest = HorizontalMin(hits);
+		if (!(closest < maxDistance))
+		{
+			return Infinity;
+		}
+		lane = std::countr_zero(unsigned(MoveMask(CmpLe(hits, SimdFloat(closest)))));
+		u = uu.Lane(lane);
+		v = vv.Lane(lane);
+		return closest;
+	}
+}
+
+struct Picker::Mesh
+{
+	explicit Mesh(JobSystem& jobs)
+		: clusters(jobs)
+	{
+	}
+
+	uint32_t				id				{ 0u };
+	Bvh::Handle				treeHandle		{ Bvh::InvalidHandle };
+	size_t					triangleCount	{ 0u };
+	// ids are cluster indices
+	Bvh						clusters;
+	// ClusterFloats per cluster
+	std::vector<float>		clusterData;
+	// the mesh's triangle index of every lane, NoTriangle for unused ones
+	std::vector<uint32_t>	laneTriangles;
+};
+
+Picker::Picker(JobSystem& jobs)
+	: jobs(jobs), meshTree(jobs)
+{
+}
+
+Picker::~Picker() = default;
+
+Picker::Handle Picker::AddMesh(uint32_t id, const float* pPositions, size_t vertexCount, const uint32_t* pIndices, size_t indexCount)
+{
+	const size_t triangleCount = indexCount / 3u;
+	auto pMesh = std::make_unique<Mesh>(jobs);
+	pMesh->id = id;
+	pMesh->triangleCount = triangleCount;
+
+	// Morton order of the triangle centers over the box of the vertices
+	Bvh::Aabb bounds = { { Infinity, Infinity, Infinity }, { -Infinity, -Infinity, -Infinity } };
+	for (size_t i = 0u; i < vertexCount; i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			bounds.min[c] = std::min(bounds.min[c], pPositions[i * 3u + c]);
+			bounds.max[c] = std::max(bounds.max[c], pPositions[i * 3u + c]);
+		}
+	}
+	float scale[3];
+	for (int c = 0; c < 3; c++)
+	{
+		const float extent = bounds.max[c] - bounds.min[c];
+		// centers are summed, not averaged: 3 * 1023 / (3 * extent)
+		scale[c] = extent > 0.0f ? 1023.0f / (3.0f * extent) : 0.0f;
+	}
+	std::vector<uint64_t> order(triangleCount);
+	for (size_t t = 0u; t < triangleCount; t++)
+	{
+		uint32_t code = 0u;
+		for (int c = 0; c < 3; c++)
+		{
+			float sum = 0.0f;
+			for (size_t k = 0u; k < 3u; k++)
+			{
+				sum += pPositions[pIndices[t * 3u + k] * 3u + c];
+			}
+			code |= SpreadBits(uint32_t((sum - 3.0f * bounds.min[c]) * scale[c])) << c;
+		}
+		order[t] = uint64_t(code) << 32 | t;
+	}
+	std::sort(order.begin(), order.end());
+
+	const size_t clusterCount = (triangleCount + ClusterSize - 1u) / ClusterSize;
+	pMesh->clusterData.assign(clusterCount * ClusterFloats, 0.0f);
+	pMesh->laneTriangles.assign(clusterCount * ClusterSize, NoTriangle);
+	for (size_t cluster = 0u; cluster < clusterCount; cluster++)
+	{
+		float* pCluster = &pMesh->clusterData[cluster * ClusterFloats];
+		Bvh::Aabb box = { { Infinity, Infinity, Infinity }, { -Infinity, -Infinity, -Infinity } };
+		for (size_t lane = 0u; lane < ClusterSize && cluster * ClusterSize + lane < triangleCount; lane++)
+		{
+			const uint32_t t = uint32_t(order[cluster * ClusterSize + lane]);
+			pMesh->laneTriangles[cluster * ClusterSize + lane] = t;
+			const float* pV[3];
+			for (size_t k = 0u; k < 3u; k++)
+			{
+				pV[k] = &pPositions[pIndices[t * 3u + k] * 3u];
+				for (int c = 0; c < 3; c++)
+				{
+					box.min[c] = std::min(box.min[c], pV[k][c]);
+					box.max[c] = std::max(box.max[c], pV[k][c]);
+				}
+			}
+			for (int c = 0; c < 3; c++)
+			{
+				pCluster[c * ClusterSize + lane] = pV[0][c];
+				pCluster[(3 + c) * ClusterSize + lane] = pV[1][c] - pV[0][c];
+				pCluster[(6 + c) * ClusterSize + lane] = pV[2][c] - pV[0][c];
+			}
+		}
+		pMesh->clusters.Insert(uint32_t(cluster), box);
+	}
+	pMesh->clusters.Update();
+
+	Handle handle = Handle(std::find(meshes.begin(), meshes.end(), nullptr) - meshes.begin());
+	if (handle == meshes.size())
+	{
+		meshes.emplace_back();
+	}
+	pMesh->treeHandle = meshTree.Insert(handle, bounds);
+	meshes[handle] = std::move(pMesh);
+	stats.triangles += triangleCount;
+	return handle;
+}
+
+void Picker::RemoveMesh(Handle handle) noexcept
+{
+	meshTree.Remove(meshes[handle]->treeHandle);
+	stats.triangles -= meshes[handle]->triangleCount;
+	meshes[handle].reset();
+}
+
+Picker::Ray Picker::ScreenRay(int x, int y, unsigned int width, unsigned int height, const float toClip[16]) noexcept
+{
+	Ray ray = {};
+	double inverse[16];
+	if (!Invert(toClip, inverse))
+	{
+		return ray;
+	}
+	// pixel centers; NDC y points up, pixel rows down
+	const double ndcX = 2.0 * (double(x) + 0.5) / double(width) - 1.0;
+	const double ndcY = 1.0 - 2.0 * (double(y) + 0.5) / double(height);
+	// homogeneous points on the near (z = 1) and far (z = 0) planes; the far
+	// one has w = 0 for an infinite projection, a direction rather than a point
+	double nearPoint[4];
+	double farPoint[4];
+	for (int r = 0; r < 4; r++)
+	{
+		const double* row = inverse + r * 4;
+		const double xy = row[0] * ndcX + row[1] * ndcY + row[3];
+		nearPoint[r] = xy + row[2];
+		farPoint[r] = xy;
+	}
+	double direction[3];
+	double length = 0.0;
+	for (int c = 0; c < 3; c++)
+	{
+		ray.origin[c] = float(nearPoint[c] / nearPoint[3]);
+		// far.w * (far - origin), whatever far.w is
+		direction[c] = farPoint[c] - nearPoint[c] / nearPoint[3] * farPoint[3];
+		length += direction[c] * direction[c];
+	}
+	length = std::sqrt(length);
+	for (int c = 0; c < 3; c++)
+	{
+		ray.direction[c] = length > 0.0 ? float(direction[c] / length) : 0.0f;
+	}
+	return ray;
+}
+
+std::optional<Picker::Hit> Picker::Pick(const Mouse::Event& event, unsigned int width, unsigned int height, const float toClip[16])
+{
+	const auto [x, y] = event.GetPos();
+	return Raycast(ScreenRay(x, y, width, height, toClip));
+}
+
+std::optional<Picker::Hit> Picker::Raycast(const Ray& ray, float maxDistance)
+{
+	const auto start = std::chrono::steady_clock::now();
+	meshTree.Update();
+
+	// both trees only ask about boxes entered before the closest hit so far,
+	// so every triangle hit they report is the new closest
+	std::optional<Hit> closest;
+	uint64_t clustersTested = 0u;
+	const auto hitMesh = [&](uint32_t handle, float meshMaxDistance)
+	{
+		const Mesh& mesh = *meshes[handle];
+		const auto hitCluster = [&](uint32_t cluster, float clusterMaxDistance)
+		{
+			clustersTested++;
+			int lane = -1;
+			float u = 0.0f, v = 0.0f;
+			const float distance = IntersectCluster(&mesh.clusterData[cluster * ClusterFloats], ray, clusterMaxDistance, lane, u, v);
+			if (distance < clusterMaxDistance)
+			{
+				closest = Hit{ mesh.id, mesh.laneTriangles[cluster * ClusterSize + lane], distance, { 1.0f - u - v, u, v } };
+			}
+			return distance;
+		};
+		const auto hit = mesh.clusters.Raycast(ray.origin, ray.direction, meshMaxDistance, hitCluster);
+		return hit ? hit->distance : Infinity;
+	};
+	meshTree.Raycast(ray.origin, ray.direction, maxDistance, hitMesh);
+
+	stats.picks++;
+	stats.hits += closest ? 1u : 0u;
+	stats.clustersTested += clustersTested;
+	stats.lastPickSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return closest;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include "Bvh.h"
+#include "JobSystem.h"
+#include "Mouse.h"
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <vector>
+
+// Mouse picking: which triangle of which mesh is under a pixel.
+//
+// Meshes are added once with their world space triangles. Each one gets a
+// Bvh over clusters of 8 spatially close triangles (sorted along a Morton
+// curve), and the picker keeps a Bvh over the mesh boxes on top. A ray goes
+// down the top tree into the mesh trees nearest first; a cluster is tested
+// with one 8-wide Möller-Trumbore intersection (Möller and Trumbore, "Fast,
+// Minimum Storage Ray/Triangle Intersection", 1997). Only clusters entered
+// before the closest hit so far are tested, so a pick touches a few dozen
+// clusters out of millions.
+//
+// The camera is the matrix that takes world positions to clip space, the
+// one handed to the cullers (row major, column vectors, reversed Z).
+// Infinite far planes are fine: the ray is built from homogeneous points.
+//
+//	while (const auto e = wnd.mouse.Read())
+//	{
+//		if (e->GetType() == Mouse::Event::Type::LPress)
+//		{
+//			if (const auto hit = picker.Pick(*e, width, height, toClip))
+//			{
+//				... hit->id, hit->triangle, hit->barycentrics
+//			}
+//		}
+//	}
+class Picker
+{
+public:
+	using Handle = uint32_t;
+
+	struct Ray
+	{
+		float origin[3];
+		float direction[3];	// unit length
+	};
+
+	struct Hit
+	{
+		uint32_t	id;				// of the mesh
+		uint32_t	triangle;		// index of the triangle in the mesh
+		float		distance;		// along the ray
+		// weights of the triangle's vertices at the hit point
+		float		barycentrics[3];
+	};
+
+	struct Stats
+	{
+		uint64_t	picks				{ 0u };	// Raycast() calls, through Pick() or not
+		uint64_t	hits				{ 0u };
+		uint64_t	clustersTested		{ 0u };
+		double		lastPickSeconds		{ 0.0 };
+		size_t		triangles			{ 0u };
+	};
+
+	static constexpr unsigned int ClusterSize = 8u;	// triangles, one per SIMD lane
+
+public:
+	explicit Picker(JobSystem& jobs);
+	Picker(const Picker&) = delete;
+	Picker& operator=(const Picker&) = delete;
+	~Picker();
+
+	// pPositions holds vertexCount xyz triples in world space, pIndices three
+	// indices (below vertexCount) per triangle; both are copied
+	Handle	AddMesh(uint32_t id, const float* pPositions, size_t vertexCount, const uint32_t* pIndices, size_t indexCount);
+	void	RemoveMesh(Handle handle) noexcept;
+
+	// the ray through the center of pixel (x, y) of a width x height
+	// viewport, from the near plane on; toClip must be invertible
+	static Ray	ScreenRay(int x, int y, unsigned int width, unsigned int height, const float toClip[16]) noexcept;
+
+	// the closest triangle under the event's position
+	std::optional<Hit>	Pick(const Mouse::Event& event, unsigned int width, unsigned int height, const float toClip[16]);
+	std::optional<Hit>	Raycast(const Ray& ray, float maxDistance = std::numeric_limits<float>::infinity());
+
+	const Stats&	GetStats() const noexcept { return stats; }
+
+private:
+	struct Mesh;
+
+private:
+	JobSystem&	jobs;
+
+	Bvh									meshTree;	// ids are Handles
+	std::vector<std::unique_ptr<Mesh>>	meshes;		// by Handle, null when free
+
+	Stats	stats;
+};
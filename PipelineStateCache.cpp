@@ -0,0 +1,230 @@
+#include "PipelineStateCache.h"
+#include "Hash.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+PipelineStateCache::Table::Table(size_t capacity)
+	: mask(capacity - 1u), slots(new std::atomic<const Record*>[capacity])
+{
+	for (size_t i = 0; i < capacity; i++)
+	{
+		slots[i].store(nullptr, std::memory_order_relaxed);
+	}
+}
+
+PipelineStateCache::PipelineStateCache(IRenderDevice& device, size_t initialCapacity)
+	: device(device)
+{
+	// power of two so probing can mask instead of divide
+	size_t capacity = 16u;
+	while (capacity < initialCapacity)
+	{
+		capacity *= 2u;
+	}
+	tables.push_back(std::make_unique<Table>(capacity));
+	pTable.store(tables.back().get(), std::memory_order_release);
+}
+
+const PipelineState& PipelineStateCache::GetPipelineState(const PipelineStateDesc& desc)
+{
+	lookups.fetch_add(1u, std::memory_order_relaxed);
+	const Key key = MakeKey(desc);
+	if (const Record* pRecord = Find(*pTable.load(std::memory_order_acquire), key, desc))
+	{
+		return pRecord->state;
+	}
+	return Create(key, desc);
+}
+
+size_t PipelineStateCache::GetStateCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return records.size();
+}
+
+PipelineStateCache::Stats PipelineStateCache::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	Stats result = stats;
+	result.lookups = lookups.load(std::memory_order_relaxed);
+	return result;
+}
+
+const PipelineState& PipelineStateCache::Create(const Key& key, const PipelineStateDesc& desc)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// another thread may have created it since the lock free probe
+	Table& table = *tables.back();
+	if (const Record* pRecord = Find(table, key, desc))
+	{
+		return pRecord->state;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+
+	auto pRecord = std::make_unique<Record>();
+	Record& record = *pRecord;
+	record.vsHash = key.vsHash;
+	record.vsSize = desc.vertexShader.size;
+	record.psHash = key.psHash;
+	record.psSize = desc.pixelShader.size;
+	record.layoutHash = key.layoutHash;
+	record.semantics.reserve(desc.inputElementCount);
+	for (unsigned int i = 0; i < desc.inputElementCount; i++)
+	{
+		record.semantics.emplace_back(desc.pInputElements[i].semanticName);
+	}
+	record.elements.assign(desc.pInputElements, desc.pInputElements + desc.inputElementCount);
+	for (unsigned int i = 0; i < desc.inputElementCount; i++)
+	{
+		record.elements[i].semanticName = record.semantics[i].c_str();
+	}
+
+	PipelineState& state = record.state;
+	state.topology = desc.topology;
+	state.hash = key.hash;
+
+	const uint64_t vsKey = HashCombine(record.vsHash, record.vsSize);
+	if (const auto it = vertexShaders.find(vsKey); it != vertexShaders.end())
+	{
+		state.vertexShader = it->second;
+	}
+	else
+	{
+		state.vertexShader = device.CreateVertexShader(desc.vertexShader);
+		vertexShaders.emplace(vsKey, state.vertexShader);
+	}
+
+	// a pipeline without pixel shader (depth only) keeps the invalid handle
+	if (desc.pixelShader.pData || desc.pixelShader.name)
+	{
+		const uint64_t psKey = HashCombine(record.psHash, record.psSize);
+		if (const auto it = pixelShaders.find(psKey); it != pixelShaders.end())
+		{
+			state.pixelShader = it->second;
+		}
+		else
+		{
+			state.pixelShader = device.CreatePixelShader(desc.pixelShader);
+			pixelShaders.emplace(psKey, state.pixelShader);
+		}
+	}
+
+	// layouts are validated against the vertex shader, so its code is part of the key
+	const uint64_t layoutKey = HashCombine(vsKey, key.layoutHash);
+	if (const auto it = inputLayouts.find(layoutKey); it != inputLayouts.end())
+	{
+		state.inputLayout = it->second;
+	}
+	else
+	{
+		state.inputLayout = device.CreateInputLayout(record.elements.data(), desc.inputElementCount, desc.vertexShader);
+		inputLayouts.emplace(layoutKey, state.inputLayout);
+	}
+
+	// keep the load factor under 3/4 so probe sequences stay short and
+	// always end at an empty slot
+	if ((records.size() + 1u) * 4u > (table.mask + 1u) * 3u)
+	{
+		auto pGrown = std::make_unique<Table>((table.mask + 1u) * 2u);
+		for (const auto& pOld : records)
+		{
+			Insert(*pGrown, pOld.get());
+		}
+		tables.push_back(std::move(pGrown));
+	}
+	Table& current = *tables.back();
+	Insert(current, pRecord.get());
+	records.push_back(std::move(pRecord));
+	pTable.store(&current, std::memory_order_release);
+
+	const auto micros = uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - start).count());
+	stats.creations++;
+	stats.creationMicroseconds += micros;
+	stats.maxCreationMicroseconds = std::max(stats.maxCreationMicroseconds, micros);
+	return state;
+}
+
+uint64_t PipelineStateCache::BytecodeHash(const ShaderBytecode& bytecode) noexcept
+{
+	if (bytecode.hash != 0u || !bytecode.pData)
+	{
+		return bytecode.hash;
+	}
+	return HashBytes(bytecode.pData, bytecode.size);
+}
+
+PipelineStateCache::Key PipelineStateCache::MakeKey(const PipelineStateDesc& desc) noexcept
+{
+	Key key;
+	key.vsHash = BytecodeHash(desc.vertexShader);
+	key.psHash = BytecodeHash(desc.pixelShader);
+	key.layoutHash = desc.inputLayoutHash != 0u ? desc.inputLayoutHash :
+		HashInputElements(desc.pInputElements, desc.inputElementCount);
+
+	uint64_t hash = HashCombine(key.vsHash, desc.vertexShader.size);
+	hash = HashCombine(hash, key.psHash);
+	hash = HashCombine(hash, desc.pixelShader.size);
+	hash = HashCombine(hash, key.layoutHash);
+	key.hash = HashCombine(hash, uint64_t(desc.topology));
+	return key;
+}
+
+bool PipelineStateCache::Matches(const Record& record, const Key& key, const PipelineStateDesc& desc) noexcept
+{
+	if (record.state.topology != desc.topology ||
+		record.vsSize != desc.vertexShader.size || record.vsHash != key.vsHash ||
+		record.psSize != desc.pixelShader.size || record.psHash != key.psHash ||
+		record.layoutHash != key.layoutHash || record.elements.size() != desc.inputElementCount)
+	{
+		return false;
+	}
+	// a given layout hash comes from a VertexFormat and is trusted like the
+	// shader hashes; hand built element lists are compared in full
+	if (desc.inputLayoutHash != 0u)
+	{
+		return true;
+	}
+	for (unsigned int i = 0; i < desc.inputElementCount; i++)
+	{
+		const InputElementDesc& a = record.elements[i];
+		const InputElementDesc& b = desc.pInputElements[i];
+		if (a.semanticIndex != b.semanticIndex || a.format != b.format || a.inputSlot != b.inputSlot ||
+			a.alignedByteOffset != b.alignedByteOffset || a.classification != b.classification ||
+			a.instanceDataStepRate != b.instanceDataStepRate || std::strcmp(a.semanticName, b.semanticName) != 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+const PipelineStateCache::Record* PipelineStateCache::Find(const Table& table, const Key& key, const PipelineStateDesc& desc) noexcept
+{
+	for (size_t i = size_t(key.hash) & table.mask;; i = (i + 1u) & table.mask)
+	{
+		const Record* pRecord = table.slots[i].load(std::memory_order_acquire);
+		if (!pRecord)
+		{
+			return nullptr;
+		}
+		if (pRecord->state.hash == key.hash && Matches(*pRecord, key, desc))
+		{
+			return pRecord;
+		}
+	}
+}
+
+void PipelineStateCache::Insert(Table& table, const Record* pRecord) noexcept
+{
+	size_t i = size_t(pRecord->state.hash) & table.mask;
+	while (table.slots[i].load(std::memory_order_relaxed))
+	{
+		i = (i + 1u) & table.mask;
+	}
+	// publishes the record's contents to lock free readers
+	table.slots[i].store(pRecord, std::memory_order_release);
+}
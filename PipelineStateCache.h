@@ -0,0 +1,138 @@
+#pragma once
+#include "RenderDevice.h"
+#include "VertexFormat.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Everything a draw's pipeline is made of. Shaders are passed as code and
+// identified by their content, not by file name or handle, so descs built
+// from the same bytes share one state object wherever the bytes came from.
+struct PipelineStateDesc
+{
+	ShaderBytecode			vertexShader;
+	ShaderBytecode			pixelShader;
+	const InputElementDesc*	pInputElements		{ nullptr };
+	unsigned int			inputElementCount	{ 0u };
+	// HashInputElements() of the elements, 0 = not computed; when set the
+	// elements themselves are not hashed or compared on lookup
+	uint64_t				inputLayoutHash		{ 0u };
+	PrimitiveTopology		topology			{ PrimitiveTopology::TriangleList };
+
+	template<typename Vertex>
+	void SetVertexFormat() noexcept
+	{
+		pInputElements = VertexFormat<Vertex>::pElements;
+		inputElementCount = VertexFormat<Vertex>::count;
+		inputLayoutHash = VertexFormat<Vertex>::hash;
+	}
+};
+
+// Device objects of one pipeline. Immutable, lives as long as the cache.
+struct PipelineState
+{
+	VertexShaderHandle	vertexShader;
+	PixelShaderHandle	pixelShader;
+	InputLayoutHandle	inputLayout;
+	PrimitiveTopology	topology	{ PrimitiveTopology::TriangleList };
+	uint64_t			hash		{ 0u };	// of the desc it was created from
+};
+
+// Deduplicates pipeline states by the content hash of their desc.
+//
+// A lookup hashes the desc (the shader code and the elements only when their
+// hashes were not given) and probes an open addressing table without taking
+// a lock; a state that is found was published with a release store and never
+// changes again.
+// A miss takes the lock, checks again and creates the device objects. Shaders
+// and input layouts are shared between states that use the same code and
+// elements. When the table fills up a twice as large one replaces it; old
+// tables stay alive until the cache dies because readers may still probe them.
+//
+// Any number of threads may look states up at the same time. Creation calls
+// the device from the thread that missed, so with a device whose create calls
+// are not free threaded (everything but D3D11) warm the cache up on the
+// render thread first.
+class PipelineStateCache
+{
+public:
+	struct Stats
+	{
+		uint64_t lookups				{ 0u };
+		uint64_t creations				{ 0u };	// misses that created a state
+		uint64_t creationMicroseconds	{ 0u };	// summed over all creations
+		uint64_t maxCreationMicroseconds	{ 0u };
+
+		double GetHitRate() const noexcept { return lookups ? 1.0 - double(creations) / double(lookups) : 0.0; }
+	};
+
+public:
+	explicit PipelineStateCache(IRenderDevice& device, size_t initialCapacity = 256u);
+	PipelineStateCache(const PipelineStateCache&) = delete;
+	PipelineStateCache& operator=(const PipelineStateCache&) = delete;
+
+	const PipelineState&	GetPipelineState(const PipelineStateDesc& desc);
+
+	size_t	GetStateCount() const;
+	Stats	GetStats() const;
+
+private:
+	// the desc a state was created from, with copies of everything the desc
+	// only pointed to
+	struct Record
+	{
+		PipelineState					state;
+		uint64_t						vsHash		{ 0u };
+		size_t							vsSize		{ 0u };
+		uint64_t						psHash		{ 0u };
+		size_t							psSize		{ 0u };
+		uint64_t						layoutHash	{ 0u };
+		std::vector<std::string>		semantics;
+		std::vector<InputElementDesc>	elements;	// semanticName points into semantics
+	};
+
+	// hashes of a desc's parts, computed once per lookup
+	struct Key
+	{
+		uint64_t vsHash;
+		uint64_t psHash;
+		uint64_t layoutHash;
+		uint64_t hash;	// of everything
+	};
+
+	struct Table
+	{
+		explicit Table(size_t capacity);
+
+		size_t mask;
+		std::unique_ptr<std::atomic<const Record*>[]> slots;
+	};
+
+private:
+	static uint64_t			BytecodeHash(const ShaderBytecode& bytecode) noexcept;
+	static Key				MakeKey(const PipelineStateDesc& desc) noexcept;
+	static bool				Matches(const Record& record, const Key& key, const PipelineStateDesc& desc) noexcept;
+	static const Record*	Find(const Table& table, const Key& key, const PipelineStateDesc& desc) noexcept;
+	static void				Insert(Table& table, const Record* pRecord) noexcept;
+
+	const PipelineState&	Create(const Key& key, const PipelineStateDesc& desc);
+
+private:
+	IRenderDevice& device;
+
+	std::atomic<const Table*>	pTable { nullptr };
+	std::atomic<uint64_t>		lookups { 0u };
+
+	// everything below is guarded by mutex
+	mutable std::mutex					mutex;
+	std::vector<std::unique_ptr<Table>>	tables;		// back() is the current one
+	std::vector<std::unique_ptr<Record>>	records;
+	std::unordered_map<uint64_t, VertexShaderHandle>	vertexShaders;	// by code hash
+	std::unordered_map<uint64_t, PixelShaderHandle>		pixelShaders;	// by code hash
+	std::unordered_map<uint64_t, InputLayoutHandle>		inputLayouts;	// by vs code and elements hash
+	Stats stats;
+};
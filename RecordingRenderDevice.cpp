@@ -0,0 +1,184 @@
+#include "RecordingRenderDevice.h"
+
+RecordingRenderDevice::RecordingRenderDevice(unsigned int width, unsigned int height) noexcept
+	: swapChain{ width, height, 2u }
+{}
+
+BufferHandle RecordingRenderDevice::CreateBuffer(const BufferDesc& desc)
+{
+	const BufferHandle buffer { nextId++ };
+	Record(CallType::CreateBuffer, 0u, buffer.id);
+	if (desc.usage == BufferUsage::Dynamic)
+	{
+		dynamicBuffers[buffer.id].resize(desc.byteWidth);
+	}
+	return buffer;
+}
+
+VertexShaderHandle RecordingRenderDevice::CreateVertexShader(const ShaderBytecode&)
+{
+	const VertexShaderHandle shader { nextId++ };
+	Record(CallType::CreateVertexShader, 0u, shader.id);
+	return shader;
+}
+
+PixelShaderHandle RecordingRenderDevice::CreatePixelShader(const ShaderBytecode&)
+{
+	const PixelShaderHandle shader { nextId++ };
+	Record(CallType::CreatePixelShader, 0u, shader.id);
+	return shader;
+}
+
+InputLayoutHandle RecordingRenderDevice::CreateInputLayout(const InputElementDesc*, unsigned int,
+														   const ShaderBytecode&)
+{
+	const InputLayoutHandle layout { nextId++ };
+	Record(CallType::CreateInputLayout, 0u, layout.id);
+	return layout;
+}
+
+void RecordingRenderDevice::SetVertexBuffer(unsigned int slot, BufferHandle buffer, unsigned int, unsigned int)
+{
+	Record(CallType::SetVertexBuffer, slot, buffer.id);
+}
+
+void RecordingRenderDevice::SetIndexBuffer(BufferHandle buffer, IndexFormat, unsigned int)
+{
+	Record(CallType::SetIndexBuffer, 0u, buffer.id);
+}
+
+void RecordingRenderDevice::SetVertexShader(VertexShaderHandle shader)
+{
+	Record(CallType::SetVertexShader, 0u, shader.id);
+}
+
+void RecordingRenderDevice::SetPixelShader(PixelShaderHandle shader)
+{
+	Record(CallType::SetPixelShader, 0u, shader.id);
+}
+
+void RecordingRenderDevice::SetInputLayout(InputLayoutHandle layout)
+{
+	Record(CallType::SetInputLayout, 0u, layout.id);
+}
+
+void RecordingRenderDevice::SetBackBufferTarget()
+{
+	Record(CallType::SetBackBufferTarget, 0u, 0u);
+}
+
+void RecordingRenderDevice::SetDepthOnlyTarget()
+{
+	Record(CallType::SetDepthOnlyTarget, 0u, 0u);
+}
+
+void RecordingRenderDevice::SetDepthMode(DepthMode mode)
+{
+	Record(CallType::SetDepthMode, 0u, uint32_t(mode));
+}
+
+void RecordingRenderDevice::SetPrimitiveTopology(PrimitiveTopology topology)
+{
+	Record(CallType::SetPrimitiveTopology, 0u, uint32_t(topology));
+}
+
+void RecordingRenderDevice::SetViewport(const Viewport&)
+{
+	Record(CallType::SetViewport, 0u, 0u);
+}
+
+void* RecordingRenderDevice::Map(BufferHandle buffer, MapMode mode)
+{
+	Record(CallType::Map, uint32_t(mode), buffer.id);
+	const auto it = dynamicBuffers.find(buffer.id);
+	return it != dynamicBuffers.end() ? it->second.data() : nullptr;
+}
+
+void RecordingRenderDevice::Unmap(BufferHandle buffer)
+{
+	Record(CallType::Unmap, 0u, buffer.id);
+}
+
+void RecordingRenderDevice::ClearBackBuffer(const float[4])
+{
+	Record(CallType::ClearBackBuffer, 0u, 0u);
+}
+
+void RecordingRenderDevice::ClearDepth(float)
+{
+	Record(CallType::ClearDepth, 0u, 0u);
+}
+
+void RecordingRenderDevice::DrawIndexed(unsigned int indexCount, unsigned int, int)
+{
+	Record(CallType::DrawIndexed, 0u, indexCount);
+}
+
+void RecordingRenderDevice::DrawIndexedInstanced(unsigned int indexCountPerInstance, unsigned int instanceCount,
+												 unsigned int, int, unsigned int)
+{
+	Record(CallType::DrawIndexedInstanced, instanceCount, indexCountPerInstance);
+}
+
+void RecordingRenderDevice::DrawIndexedInstancedIndirect(BufferHandle args, unsigned int byteOffset)
+{
+	Record(CallType::DrawIndexedInstancedIndirect, byteOffset, args.id);
+}
+
+void RecordingRenderDevice::Present()
+{
+	Record(CallType::Present, 0u, 0u);
+}
+
+void RecordingRenderDevice::SetPresentMode(PresentMode mode, unsigned int maxFrameLatency)
+{
+	Record(CallType::SetPresentMode, maxFrameLatency, uint32_t(mode));
+}
+
+void RecordingRenderDevice::Resize(unsigned int width, unsigned int height)
+{
+	swapChain.width = width;
+	swapChain.height = height;
+	Record(CallType::ResizeSwapChain, width, height);
+}
+
+unsigned int RecordingRenderDevice::SetSampleCount(unsigned int sampleCount)
+{
+	// any count is "supported"
+	swapChain.sampleCount = sampleCount > 0u ? sampleCount : 1u;
+	Record(CallType::SetSampleCount, 0u, swapChain.sampleCount);
+	return swapChain.sampleCount;
+}
+
+void RecordingRenderDevice::ResetFrame() noexcept
+{
+	frame = {};
+	calls.clear();
+}
+
+void RecordingRenderDevice::Record(CallType type, uint32_t slot, uint32_t id)
+{
+	calls.push_back({ type, slot, id });
+	callCounts[size_t(type)]++;
+
+	Counters* const counters[] = { &frame, &total };
+	for (Counters* c : counters)
+	{
+		if (type <= CallType::CreateInputLayout || type == CallType::ResizeSwapChain ||
+			type == CallType::SetSampleCount)
+			c->creates++;
+		else if (type == CallType::DrawIndexed || type == CallType::DrawIndexedInstanced ||
+				 type == CallType::DrawIndexedInstancedIndirect)
+			c->draws++;
+		else if (type == CallType::ClearBackBuffer || type == CallType::ClearDepth)
+			c->clears++;
+		else if (type == CallType::Present)
+			c->presents++;
+		else if (type == CallType::SetPresentMode)
+			continue;	// configuration, not work of the frame
+		else if (type == CallType::Map || type == CallType::Unmap)
+			c->maps++;
+		else
+			c->binds++;
+	}
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include "RenderDevice.h"
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+// A render device that executes nothing and only records what it was asked
+// to do. It is used to run the frame code without a GPU (e.g. on the Linux
+// build machines) and to check how much work a frame really submits: the
+// counters separate resource creation from binding so a frame that creates
+// objects shows up immediately. Its swap chain only has a size and a sample
+// count; changing either is recorded and counted as creation, because the
+// views are recreated.
+class RecordingRenderDevice : public IRenderDevice, public ISwapChain
+{
+public:
+	enum class CallType
+	{
+		CreateBuffer,
+		CreateVertexShader,
+		CreatePixelShader,
+		CreateInputLayout,
+		SetVertexBuffer,
+		SetIndexBuffer,
+		SetVertexShader,
+		SetPixelShader,
+		SetInputLayout,
+		SetBackBufferTarget,
+		SetPrimitiveTopology,
+		SetViewport,
+		SetDepthOnlyTarget,
+		SetDepthMode,
+		Map,
+		Unmap,
+		ClearBackBuffer,
+		ClearDepth,
+		DrawIndexed,
+		DrawIndexedInstanced,
+		DrawIndexedInstancedIndirect,
+		Present,
+		SetPresentMode,
+		ResizeSwapChain,
+		SetSampleCount,
+		Count,
+	};
+
+	struct Call
+	{
+		CallType	type;
+		uint32_t	slot;	// input slot for SetVertexBuffer, MapMode for Map,
+							// frame latency for SetPresentMode, width for
+							// ResizeSwapChain, instance count for
+							// DrawIndexedInstanced, byte offset for
+							// DrawIndexedInstancedIndirect, 0 otherwise
+		uint32_t	id;		// handle id, index count, PresentMode, DepthMode,
+							// height or sample count, depending on type
+	};
+
+	struct Counters
+	{
+		unsigned int creates	{ 0u };
+		unsigned int binds		{ 0u };
+		unsigned int maps		{ 0u };
+		unsigned int draws		{ 0u };
+		unsigned int clears		{ 0u };
+		unsigned int presents	{ 0u };
+	};
+
+public:
+	RecordingRenderDevice(unsigned int width = 1280u, unsigned int height = 720u) noexcept;
+	RecordingRenderDevice(const RecordingRenderDevice&) = delete;
+	RecordingRenderDevice& operator=(const RecordingRenderDevice&) = delete;
+
+	BufferHandle		CreateBuffer(const BufferDesc& desc) override;
+	VertexShaderHandle	CreateVertexShader(const ShaderBytecode& bytecode) override;
+	PixelShaderHandle	CreatePixelShader(const ShaderBytecode& bytecode) override;
+	InputLayoutHandle	CreateInputLayout(const InputElementDesc* pElements, unsigned int count,
+										  const ShaderBytecode& vsBytecode) override;
+
+	void SetVertexBuffer(unsigned int slot, BufferHandle buffer, unsigned int stride, unsigned int offset) override;
+	void SetIndexBuffer(BufferHandle buffer, IndexFormat format, unsigned int offset) override;
+	void SetVertexShader(VertexShaderHandle shader) override;
+	void SetPixelShader(PixelShaderHandle shader) override;
+	void SetInputLayout(InputLayoutHandle layout) override;
+	void SetBackBufferTarget() override;
+	void SetDepthOnlyTarget() override;
+	void SetDepthMode(DepthMode mode) override;
+	void SetPrimitiveTopology(PrimitiveTopology topology) override;
+	void SetViewport(const Viewport& viewport) override;
+
+	void* Map(BufferHandle buffer, MapMode mode) override;
+	void Unmap(BufferHandle buffer) override;
+
+	void ClearBackBuffer(const float color[4]) override;
+	void ClearDepth(float depth) override;
+	void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex) override;
+	void DrawIndexedInstanced(unsigned int indexCountPerInstance, unsigned int instanceCount,
+							  unsigned int startIndex, int baseVertex, unsigned int startInstance) override;
+	void DrawIndexedInstancedIndirect(BufferHandle args, unsigned int byteOffset) override;
+	void Present() override;
+	void SetPresentMode(PresentMode mode, unsigned int maxFrameLatency) override;
+	ISwapChain& GetSwapChain() noexcept override { return *this; }
+	// nothing is drawn, so there is no depth to build a pyramid of
+	const HiZPyramid* GetDepthPyramid() const noexcept override { return nullptr; }
+	bool NeedsShaderBytecode() const noexcept override { return false; }
+
+	SwapChainDesc GetDesc() const noexcept override { return swapChain; }
+	void Resize(unsigned int width, unsigned int height) override;
+	unsigned int SetSampleCount(unsigned int sampleCount) override;
+
+	// starts a new recording window; totals are kept. Present() does not
+	// reset on its own so a caller can inspect the frame it just finished.
+	void ResetFrame() noexcept;
+
+	const Counters&				GetFrameCounters()	const noexcept { return frame; }
+	const Counters&				GetTotalCounters()	const noexcept { return total; }
+	const std::vector<Call>&	GetFrameCalls()		const noexcept { return calls; }
+	unsigned int				GetCallCount(CallType type) const noexcept { return callCounts[size_t(type)]; }
+
+private:
+	void Record(CallType type, uint32_t slot, uint32_t id);
+
+private:
+	uint32_t nextId { 0u };
+	SwapChainDesc swapChain;
+	Counters frame;
+	Counters total;
+	std::vector<Call> calls;
+	// backing memory of dynamic buffers so Map() returns writable memory
+	std::unordered_map<uint32_t, std::vector<unsigned char>> dynamicBuffers;
+	std::array<unsigned int, size_t(CallType::Count)> callCounts {};
+};
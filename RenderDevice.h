@@ -0,0 +1,237 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "SwapChain.h"
+
+class HiZPyramid;
+
+// The render device is the thin layer between Graphics and the API that
+// actually executes the work. Everything in this header is plain C++ so the
+// interface (and any device that does not need Direct3D) compiles on every
+// platform we build on.
+//
+// Resources are referred to by small typed handles instead of COM pointers.
+// A handle stays valid for the lifetime of the device that created it, which
+// lets callers create their buffers/shaders once and only bind them per frame.
+
+template<typename Tag>
+struct ResourceHandle
+{
+	static constexpr uint32_t InvalidId = 0xFFFFFFFFu;
+
+	uint32_t id { InvalidId };
+
+	bool IsValid() const noexcept { return id != InvalidId; }
+	bool operator==(ResourceHandle rhs) const noexcept { return id == rhs.id; }
+	bool operator!=(ResourceHandle rhs) const noexcept { return id != rhs.id; }
+};
+
+struct BufferTag;
+struct VertexShaderTag;
+struct PixelShaderTag;
+struct InputLayoutTag;
+
+using BufferHandle			= ResourceHandle<BufferTag>;
+using VertexShaderHandle	= ResourceHandle<VertexShaderTag>;
+using PixelShaderHandle		= ResourceHandle<PixelShaderTag>;
+using InputLayoutHandle		= ResourceHandle<InputLayoutTag>;
+
+enum class BufferType
+{
+	Vertex,
+	Index,
+	Constant,
+	IndirectArgs,	// DrawIndexedIndirectArgs for DrawIndexedInstancedIndirect()
+};
+
+enum class BufferUsage
+{
+	Default,	// written once at creation (initial data), GPU only afterwards
+	Dynamic,	// rewritten by the CPU through Map(); dynamic vertex and
+				// index buffers can be bound as either
+};
+
+// How a Map() treats the previous content of a dynamic buffer (D3D11_MAP).
+enum class MapMode
+{
+	WriteDiscard,		// content is thrown away, draws already issued keep theirs
+	WriteNoOverwrite,	// caller promises not to touch ranges in-flight draws use
+};
+
+struct BufferDesc
+{
+	BufferType		type			{ BufferType::Vertex };
+	BufferUsage		usage			{ BufferUsage::Default };
+	unsigned int	byteWidth		{ 0u };
+	unsigned int	stride			{ 0u };
+	const void*		pInitialData	{ nullptr };
+};
+
+// Subset of DXGI_FORMAT that vertex elements are allowed to use.
+enum class ElementFormat
+{
+	R32G32_Float,
+	R32G32B32_Float,
+	R32G32B32A32_Float,
+	R8G8B8A8_UNorm,
+	// compressed vertices, see VertexCompression.h
+	R8G8B8A8_SNorm,
+	R16G16_SNorm,
+	R16G16_Float,
+	R16G16B16A16_UNorm,
+};
+
+enum class IndexFormat
+{
+	R16_UInt,
+	R32_UInt,
+};
+
+enum class PrimitiveTopology
+{
+	TriangleList,
+};
+
+// What an input slot's buffer holds, D3D11_INPUT_CLASSIFICATION.
+enum class InputClassification
+{
+	PerVertex,
+	PerInstance,	// indexed by the instance, see InputElementDesc
+};
+
+// Mirrors D3D11_INPUT_ELEMENT_DESC.
+struct InputElementDesc
+{
+	const char*			semanticName		{ nullptr };
+	unsigned int		semanticIndex		{ 0u };
+	ElementFormat		format				{ ElementFormat::R32G32_Float };
+	unsigned int		inputSlot			{ 0u };
+	unsigned int		alignedByteOffset	{ 0u };
+	InputClassification	classification		{ InputClassification::PerVertex };
+	// per-instance elements advance every instanceDataStepRate instances
+	// (0 for per-vertex data)
+	unsigned int		instanceDataStepRate	{ 0u };
+};
+
+// Arguments of one DrawIndexedInstancedIndirect(), laid out exactly as
+// D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS: five 32 bit values, no
+// padding. Whatever fills an IndirectArgs buffer, a compute pass or the
+// CPU (see IndirectDrawBuilder), writes these bytes.
+struct DrawIndexedIndirectArgs
+{
+	uint32_t	indexCountPerInstance;
+	uint32_t	instanceCount;
+	uint32_t	startIndexLocation;
+	int32_t		baseVertexLocation;
+	uint32_t	startInstanceLocation;
+};
+static_assert(sizeof(DrawIndexedIndirectArgs) == 20u, "GPU argument layout");
+static_assert(offsetof(DrawIndexedIndirectArgs, instanceCount) == 4u &&
+			  offsetof(DrawIndexedIndirectArgs, startIndexLocation) == 8u &&
+			  offsetof(DrawIndexedIndirectArgs, baseVertexLocation) == 12u &&
+			  offsetof(DrawIndexedIndirectArgs, startInstanceLocation) == 16u, "GPU argument layout");
+
+// Compiled shader code. The device only reads the bytes during the create
+// call, it does not keep the pointer around. `name` is where the code was
+// loaded from (e.g. "VertexShader.cso"); devices that cannot execute
+// bytecode use it to find an equivalent shader (see CpuShader.h) and may be
+// given the name alone (pData = nullptr, see NeedsShaderBytecode()).
+// `hash` is HashBytes() of the code (0 = not computed yet), so caches can key
+// on the content without rehashing it on every lookup.
+struct ShaderBytecode
+{
+	const void*	pData	{ nullptr };
+	size_t		size	{ 0u };
+	const char*	name	{ nullptr };
+	uint64_t	hash	{ 0u };
+};
+
+// How Present() waits for the display (the DXGI sync interval).
+enum class PresentMode
+{
+	VSync,		// on the next vertical blank
+	Immediate,	// at once, may tear
+};
+
+// How draws use the depth buffer that comes with the back buffer. Depth is
+// a 32 bit float with reversed Z: projections map the near plane to 1 and
+// the far plane to 0, ClearDepth(0) empties the buffer and a fragment passes
+// when it is at least as near as what is stored (>=). Floats are densest
+// near 0, reversed Z spends that precision on distant geometry, where a
+// standard 0 = near mapping runs out of it.
+enum class DepthMode
+{
+	Disabled,	// no test, no write
+	TestWrite,	// greater-equal, written; normal opaque drawing and the depth prepass
+	TestEqual,	// equal, not written; the color pass after a depth prepass
+};
+
+struct Viewport
+{
+	float topLeftX	{ 0.0f };
+	float topLeftY	{ 0.0f };
+	float width		{ 0.0f };
+	float height	{ 0.0f };
+	float minDepth	{ 0.0f };
+	float maxDepth	{ 1.0f };
+};
+
+class IRenderDevice
+{
+public:
+	virtual ~IRenderDevice() = default;
+
+	// resource creation (expected once per resource, not per frame)
+	virtual BufferHandle		CreateBuffer(const BufferDesc& desc) = 0;
+	virtual VertexShaderHandle	CreateVertexShader(const ShaderBytecode& bytecode) = 0;
+	virtual PixelShaderHandle	CreatePixelShader(const ShaderBytecode& bytecode) = 0;
+	virtual InputLayoutHandle	CreateInputLayout(const InputElementDesc* pElements, unsigned int count,
+												  const ShaderBytecode& vsBytecode) = 0;
+
+	// pipeline binding (cheap, issued every frame)
+	virtual void SetVertexBuffer(unsigned int slot, BufferHandle buffer, unsigned int stride, unsigned int offset) = 0;
+	virtual void SetIndexBuffer(BufferHandle buffer, IndexFormat format, unsigned int offset) = 0;
+	virtual void SetVertexShader(VertexShaderHandle shader) = 0;
+	// an invalid handle unbinds the stage (depth only drawing)
+	virtual void SetPixelShader(PixelShaderHandle shader) = 0;
+	virtual void SetInputLayout(InputLayoutHandle layout) = 0;
+	// back buffer and its depth buffer
+	virtual void SetBackBufferTarget() = 0;
+	// the depth buffer alone, draws write no color (depth prepass)
+	virtual void SetDepthOnlyTarget() = 0;
+	virtual void SetDepthMode(DepthMode mode) = 0;
+	virtual void SetPrimitiveTopology(PrimitiveTopology topology) = 0;
+	virtual void SetViewport(const Viewport& viewport) = 0;
+
+	// CPU access to BufferUsage::Dynamic buffers; a buffer has to be unmapped
+	// before a draw that uses it is issued
+	virtual void* Map(BufferHandle buffer, MapMode mode) = 0;
+	virtual void Unmap(BufferHandle buffer) = 0;
+
+	// work
+	virtual void ClearBackBuffer(const float color[4]) = 0;
+	virtual void ClearDepth(float depth) = 0;
+	virtual void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex) = 0;
+	// instanceCount copies of the draw; per-instance elements are read for
+	// instance startInstance + i (divided by their step rate)
+	virtual void DrawIndexedInstanced(unsigned int indexCountPerInstance, unsigned int instanceCount,
+									  unsigned int startIndex, int baseVertex, unsigned int startInstance) = 0;
+	// DrawIndexedInstanced() with the DrawIndexedIndirectArgs at byteOffset
+	// (a multiple of 4) in an IndirectArgs buffer, read when the draw runs
+	virtual void DrawIndexedInstancedIndirect(BufferHandle args, unsigned int byteOffset) = 0;
+
+	// hands the finished back buffer to the display (or whatever the device
+	// uses as its output) and starts a new frame
+	virtual void Present() = 0;
+	// maxFrameLatency = frames the CPU may queue ahead of the display
+	virtual void SetPresentMode(PresentMode mode, unsigned int maxFrameLatency) = 0;
+	// the buffers Present() hands out; lives as long as the device
+	virtual ISwapChain& GetSwapChain() noexcept = 0;
+	// Hi-Z pyramid of the depth buffer as of the last Present() that had
+	// depth drawn since the one before (the previous frame when culling the
+	// next); nullptr on devices that do not build one on the CPU
+	virtual const HiZPyramid* GetDepthPyramid() const noexcept = 0;
+	// false when the create calls only look at ShaderBytecode::name, so the
+	// compiled code does not have to be loaded (or exist) for this device
+	virtual bool NeedsShaderBytecode() const noexcept = 0;
+};
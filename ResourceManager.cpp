@@ -0,0 +1,90 @@
+#include "ResourceManager.h"
+#include "Hash.h"
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#define RES_LOAD_EXCEPT(path) ResourceManager::LoadException( __LINE__,__FILE__,(path) )
+
+ResourceManager::ResourceManager(IRenderDevice& device) noexcept
+	: device(device)
+{}
+
+bool ResourceManager::OpenShaderArchive(const std::string& path)
+{
+	return shaderStore.Open(path);
+}
+
+ShaderBytecode ResourceManager::LoadShaderBytecode(const std::string& path)
+{
+	// zero copy from the mapped archive
+	if (const ShaderBytecode code = shaderStore.Find(path); code.pData)
+	{
+		return code;
+	}
+
+	// the name is all the device looks at
+	if (!device.NeedsShaderBytecode())
+	{
+		auto it = shaderNames.find(path);
+		if (it == shaderNames.end())
+		{
+			it = shaderNames.emplace(path, HashBytes(path.data(), path.size())).first;
+		}
+		return { nullptr, 0u, it->first.c_str(), it->second };
+	}
+
+	// development fallback: loose .cso next to the executable
+	auto it = shaderCode.find(path);
+	if (it == shaderCode.end())
+	{
+		LoadedBytecode code;
+		code.bytes = ReadFile(path);
+		code.hash = HashBytes(code.bytes.data(), code.bytes.size());
+		it = shaderCode.emplace(path, std::move(code)).first;
+	}
+	return { it->second.bytes.data(), it->second.bytes.size(), it->first.c_str(), it->second.hash };
+}
+
+BufferHandle ResourceManager::GetBuffer(const std::string& name, const BufferDesc& desc)
+{
+	if (const auto it = buffers.find(name); it != buffers.end())
+	{
+		return it->second;
+	}
+
+	const BufferHandle buffer = device.CreateBuffer(desc);
+	createCount++;
+	buffers.emplace(name, buffer);
+	return buffer;
+}
+
+std::vector<unsigned char> ResourceManager::ReadFile(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		throw RES_LOAD_EXCEPT(path);
+	}
+	return { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+}
+
+// ResourceManager exception stuff
+ResourceManager::LoadException::LoadException(int line, const char* file, std::string path) noexcept
+	: GenixException(line, file), path(std::move(path))
+{}
+
+const char* ResourceManager::LoadException::what() const noexcept
+{
+	std::ostringstream oss;
+	oss << GetType() << std::endl
+		<< "[Path] " << GetPath() << std::endl
+		<< GetOriginString();
+	whatBuffer = oss.str();
+	return whatBuffer.c_str();
+}
+
+const char* ResourceManager::LoadException::GetType() const noexcept
+{
+	return "Genix Resource Exception [Load Failed]";
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "GenixException.h"
+#include "RenderDevice.h"
+#include "ShaderStore.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Owns the buffers Graphics creates and the shader code it loads. Buffers
+// are created through the render device the first time they are requested
+// and the handle is cached under a name. Shader code comes from the mapped
+// shader archive when one is open; shaders the archive does not have are
+// read from loose files once and kept in memory, so asking for
+// "VertexShader.cso" a second time does not touch the disk. Devices that only
+// look at shader names (NeedsShaderBytecode()) get the name and no code, and
+// no file is read for them. Shader and input layout objects are created from
+// that code by the PipelineStateCache.
+class ResourceManager
+{
+public:
+	class LoadException : public GenixException
+	{
+	public:
+		LoadException(int line, const char* file, std::string path) noexcept;
+		const char* what()		const noexcept override;
+		const char* GetType()	const noexcept override;
+		const std::string& GetPath() const noexcept { return path; }
+	private:
+		std::string path;
+	};
+
+public:
+	explicit ResourceManager(IRenderDevice& device) noexcept;
+	ResourceManager(const ResourceManager&) = delete;
+	ResourceManager& operator=(const ResourceManager&) = delete;
+
+	// maps a ShaderStore archive; false (and loose files only) when there is
+	// no valid archive at path
+	bool				OpenShaderArchive(const std::string& path);
+	// compiled shader code with its content hash; the bytes stay valid as
+	// long as the manager. Without an archive entry and on a device that does
+	// not need the code, pData is nullptr and hash is that of the path.
+	ShaderBytecode		LoadShaderBytecode(const std::string& path);
+	BufferHandle		GetBuffer(const std::string& name, const BufferDesc& desc);
+
+	// number of buffers created so far
+	unsigned int		GetCreateCount() const noexcept { return createCount; }
+	const ShaderStore&	GetShaderStore() const noexcept { return shaderStore; }
+	// shaders that were not in the archive and had to be read from disk
+	unsigned int		GetLooseShaderCount() const noexcept { return unsigned(shaderCode.size()); }
+
+private:
+	struct LoadedBytecode
+	{
+		std::vector<unsigned char> bytes;
+		uint64_t hash { 0u };
+	};
+
+private:
+	static std::vector<unsigned char> ReadFile(const std::string& path);
+
+private:
+	IRenderDevice& device;
+	unsigned int createCount { 0u };
+
+	std::unordered_map<std::string, BufferHandle>	buffers;
+	ShaderStore										shaderStore;
+	// loose shader files by path; node based, so the path strings handed out as
+	// ShaderBytecode::name do not move
+	std::unordered_map<std::string, LoadedBytecode>	shaderCode;
+	// paths handed out without code, with the hash of the path
+	std::unordered_map<std::string, uint64_t>		shaderNames;
+};
@@ -0,0 +1,81 @@
+#include "RingAllocator.h"
+
+namespace
+{
+	size_t AlignUp(size_t value, size_t align) noexcept
+	{
+		return align > 1u ? (value + align - 1u) & ~(align - 1u) : value;
+	}
+}
+
+RingAllocator::RingAllocator(size_t capacity) noexcept
+	: capacity(capacity)
+{}
+
+size_t RingAllocator::Allocate(size_t size, size_t align) noexcept
+{
+	if (used == 0u)
+	{
+		// empty: start over at the beginning to get the largest free run
+		head = 0u;
+		tail = 0u;
+	}
+
+	size_t offset = InvalidOffset;
+	const size_t aligned = AlignUp(head, align);
+	if (used != 0u && head == tail)
+	{
+		// completely full
+	}
+	else if (head >= tail)
+	{
+		// free space is [head, capacity) followed by [0, tail)
+		if (size <= capacity && aligned <= capacity - size)
+		{
+			offset = aligned;
+		}
+		else if (size <= tail)
+		{
+			// skip the end of the ring and start over at 0; the skipped bytes
+			// are freed together with this frame
+			offset = 0u;
+			stats.wraps++;
+		}
+	}
+	else if (aligned <= tail && size <= tail - aligned)
+	{
+		// free space is [head, tail)
+		offset = aligned;
+	}
+
+	if (offset == InvalidOffset)
+	{
+		stats.failures++;
+		return InvalidOffset;
+	}
+
+	const size_t taken = offset >= head ? offset + size - head : (capacity - head) + size;
+	head = offset + size == capacity ? 0u : offset + size;
+	used += taken;
+	openBytes += taken;
+	stats.allocations++;
+	stats.bytes += size;
+	return offset;
+}
+
+void RingAllocator::EndFrame(uint64_t fence)
+{
+	frames.push_back({ fence, openBytes });
+	openBytes = 0u;
+}
+
+void RingAllocator::Retire(uint64_t completedFence) noexcept
+{
+	while (!frames.empty() && frames.front().fence <= completedFence)
+	{
+		const size_t bytes = frames.front().bytes;
+		tail = (tail + bytes) % capacity;
+		used -= bytes;
+		frames.pop_front();
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+// Hands out ranges of a fixed-size ring (e.g. a dynamic GPU buffer) for data
+// that only lives for one frame. Allocation is a pointer bump; memory comes
+// back a whole frame at a time once the GPU is known to be done with it:
+//
+//	offset = ring.Allocate(size, align);	// any number of times per frame
+//	ring.EndFrame(frameFence);				// closes the frame's allocations
+//	ring.Retire(completedFence);			// frees frames with fence <= completed
+//
+// An allocation is always contiguous; when it does not fit before the end of
+// the ring the rest of the ring is skipped and it starts over at offset 0.
+// The allocator only manages offsets, it never touches the memory itself.
+class RingAllocator
+{
+public:
+	static constexpr size_t InvalidOffset = SIZE_MAX;
+
+	struct Stats
+	{
+		uint64_t allocations	{ 0u };
+		uint64_t bytes			{ 0u };	// requested
+		uint64_t failures		{ 0u };	// ring full, nothing allocated
+		uint64_t wraps			{ 0u };
+	};
+
+public:
+	explicit RingAllocator(size_t capacity) noexcept;
+
+	// align must be a power of two (or 0/1); returns InvalidOffset when the
+	// ring is too full until more frames are retired
+	size_t	Allocate(size_t size, size_t align) noexcept;
+	void	EndFrame(uint64_t fence);
+	void	Retire(uint64_t completedFence) noexcept;
+
+	size_t	GetCapacity()	const noexcept { return capacity; }
+	// bytes held by pending frames and the open one, alignment padding included
+	size_t	GetUsed()		const noexcept { return used; }
+	size_t	GetPendingFrames() const noexcept { return frames.size(); }
+	const Stats& GetStats() const noexcept { return stats; }
+
+private:
+	struct Frame
+	{
+		uint64_t	fence;
+		size_t		bytes;
+	};
+
+private:
+	size_t	capacity;
+	size_t	head		{ 0u };		// next free byte
+	size_t	tail		{ 0u };		// oldest byte still in use
+	size_t	used		{ 0u };
+	size_t	openBytes	{ 0u };		// taken by the frame that has not ended yet
+	std::deque<Frame> frames;
+	Stats	stats;
+};
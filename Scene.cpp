@@ -0,0 +1,99 @@
+#include "Scene.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// planets around the screen center and moons around every planet
+	constexpr int PlanetCount = 6;
+	constexpr int MoonsPerPlanet = 2;
+	// the test triangle fits in a circle of this radius
+	constexpr float TestTriangleRadius = 0.8f;
+
+	Quat RotationZ(float angle) noexcept
+	{
+		return Quat::RotationAxis(Vec3(0.0f, 0.0f, 1.0f), angle);
+	}
+}
+
+Scene::Scene()
+	// a few dozen nodes, not worth waking threads for
+	: jobs(1u)
+{
+	// the root keeps the orbits round on the 16:9 screen and puts the
+	// system in front of the test triangle
+	const TransformHierarchy::Node root = transforms.AddNode(TransformHierarchy::InvalidNode, Vec3(0.0f, 0.0f, 0.5f),
+		Quat::Identity(), Vec3(float(Graphics::ScreenHeight) / float(Graphics::ScreenWidth), 1.0f, 1.0f));
+
+	// added depth first, so the hierarchy never needs a reorder
+	for (int p = 0; p < PlanetCount; p++)
+	{
+		Body planet { 0u, 0.75f, 0.4f + 0.1f * float(p), 2.0f * Pi * float(p) / float(PlanetCount),
+					  { 255u, (unsigned char)(64 + 32 * p), 64u, 255u } };
+		planet.node = transforms.AddNode(root, Vec3(0.0f), Quat::Identity(), Vec3(0.12f));
+		bodies.push_back(planet);
+		for (int m = 0; m < MoonsPerPlanet; m++)
+		{
+			// in the planet's space, which is scaled down with the planet
+			Body moon { 0u, 1.6f, 1.5f * float(m + 1), Pi * float(m), { 160u, 160u, 255u, 255u } };
+			moon.node = transforms.AddNode(planet.node, Vec3(0.0f), Quat::Identity(), Vec3(0.35f));
+			bodies.push_back(moon);
+		}
+	}
+	Update(0.0f);
+}
+
+void Scene::Update(float dt)
+{
+	time += dt;
+	for (const Body& body : bodies)
+	{
+		// orbit the parent and spin with the orbit
+		const float angle = body.phase + body.orbitSpeed * time;
+		transforms.SetTranslation(body.node, Vec3(body.orbitRadius * std::cos(angle), body.orbitRadius * std::sin(angle), 0.0f));
+		transforms.SetRotation(body.node, RotationZ(angle));
+	}
+	transforms.Update();
+}
+
+void Scene::Draw(Graphics& gfx)
+{
+	gfx.ClearBuffer(0.f, 0.f, 1.0f);
+	gfx.DrawTestTriangle();
+
+	// world matrices to instances: the transform rows and a bounding sphere
+	// around the transformed triangle (the scale is bounded by the length of
+	// the 3x3 part)
+	const bool add = instances.GetDrawCount() == 0u;
+	const uint32_t draw = add ? instances.AddDraw(gfx.GetTestTriangleIndexCount(), 0u, 0) : 0u;
+	for (size_t i = 0u; i < bodies.size(); i++)
+	{
+		const Mat4& world = transforms.GetWorld(bodies[i].node);
+		InstanceData instance;
+		world.rows[0].Store(instance.transform0);
+		world.rows[1].Store(instance.transform1);
+		world.rows[2].Store(instance.transform2);
+		std::copy_n(bodies[i].color, 4, instance.color);
+
+		float scale = 0.0f;
+		for (int r = 0; r < 3; r++)
+		{
+			const Vec4 axis = world.rows[r] * Vec4(1.0f, 1.0f, 1.0f, 0.0f);
+			scale += Dot(axis, axis);
+		}
+		scale = std::sqrt(scale);
+		const float center[3] = { world.rows[0].W(), world.rows[1].W(), world.rows[2].W() };
+		if (add)
+		{
+			instances.AddInstance(draw, center, TestTriangleRadius * scale, &instance);
+		}
+		else
+		{
+			instances.SetInstance(uint32_t(i), center, TestTriangleRadius * scale, &instance);
+		}
+	}
+
+	// the test triangles are drawn straight to clip space
+	const float toClip[16] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+	gfx.DrawTestTriangles(instances, toClip);
+}
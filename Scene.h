@@ -0,0 +1,45 @@
+#pragma once
+#include "Graphics.h"
+#include "JobSystem.h"
+#include "TransformHierarchy.h"
+#include "IndirectDrawBuilder.h"
+#include <vector>
+
+// Everything D3DApp draws in a frame. It only depends on Graphics (and not
+// on the Win32 window D3DApp owns), so the very same frame can be rendered
+// headless, e.g. through a Graphics built on the SoftwareRenderDevice:
+//
+//	auto pDevice = std::make_unique<SoftwareRenderDevice>(Graphics::ScreenWidth, Graphics::ScreenHeight);
+//	Graphics gfx(std::move(pDevice));
+//	Scene scene;
+//	scene.Update(dt);
+//	scene.Draw(gfx);
+//	gfx.EndFrame();
+//
+// Around the test triangle a small system of test triangles orbits, nodes
+// of a TransformHierarchy; their world matrices become instances of an
+// IndirectDrawBuilder, culled and drawn with one indirect draw.
+class Scene
+{
+public:
+	Scene();
+	// advances the animation by dt seconds
+	void Update(float dt);
+	void Draw(Graphics& gfx);
+
+private:
+	JobSystem			jobs;
+	TransformHierarchy	transforms { jobs };
+	IndirectDrawBuilder	instances { jobs, unsigned(sizeof(InstanceData)) };
+
+	struct Body
+	{
+		TransformHierarchy::Node	node;
+		float						orbitRadius;
+		float						orbitSpeed;	// radians per second
+		float						phase;
+		unsigned char				color[4];
+	};
+	std::vector<Body>	bodies;
+	float				time	{ 0.0f };
+};
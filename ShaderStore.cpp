@@ -0,0 +1,282 @@
+#include "ShaderStore.h"
+#include "ResourceManager.h"
+#include "Hash.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <unordered_map>
+#ifdef _WIN32
+#include "Genix.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	constexpr size_t BlobAlignment = 16u;
+
+	size_t AlignUp(size_t value, size_t align) noexcept
+	{
+		return (value + align - 1u) & ~(align - 1u);
+	}
+}
+
+ShaderStore::~ShaderStore()
+{
+	Close();
+}
+
+bool ShaderStore::Open(const std::string& path)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	hFile = file;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart < LONGLONG(sizeof(Header)))
+	{
+		Close();
+		return false;
+	}
+	hMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!hMapping)
+	{
+		Close();
+		return false;
+	}
+	pBase = static_cast<const unsigned char*>(MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0));
+	mappedSize = size_t(size.QuadPart);
+#else
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(Header))
+	{
+		close(fd);
+		return false;
+	}
+	// the mapping keeps the file alive, the descriptor is not needed any more
+	void* p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (p != MAP_FAILED)
+	{
+		pBase = static_cast<const unsigned char*>(p);
+		mappedSize = size_t(st.st_size);
+	}
+#endif
+	if (!pBase || !Validate())
+	{
+		Close();
+		return false;
+	}
+
+	const Header& header = *reinterpret_cast<const Header*>(pBase);
+	nameCount = header.nameCount;
+	blobCount = header.blobCount;
+	pNames = reinterpret_cast<const NameEntry*>(pBase + sizeof(Header));
+	pBlobs = reinterpret_cast<const BlobEntry*>(pNames + nameCount);
+	return true;
+}
+
+void ShaderStore::Close() noexcept
+{
+#ifdef _WIN32
+	if (pBase)
+	{
+		UnmapViewOfFile(pBase);
+	}
+	if (hMapping)
+	{
+		CloseHandle(hMapping);
+	}
+	if (hFile)
+	{
+		CloseHandle(hFile);
+	}
+	hMapping = nullptr;
+	hFile = nullptr;
+#else
+	if (pBase)
+	{
+		munmap(const_cast<unsigned char*>(pBase), mappedSize);
+	}
+#endif
+	pBase = nullptr;
+	mappedSize = 0u;
+	pNames = nullptr;
+	pBlobs = nullptr;
+	nameCount = 0u;
+	blobCount = 0u;
+}
+
+ShaderBytecode ShaderStore::Find(const std::string& name) noexcept
+{
+	stats.lookups++;
+	const uint64_t nameHash = HashBytes(name.data(), name.size());
+	const NameEntry* pEnd = pNames + nameCount;
+	// names with equal hashes are adjacent, compare the strings of all of them
+	for (const NameEntry* p = std::lower_bound(pNames, pEnd, nameHash,
+			[](const NameEntry& e, uint64_t h) { return e.nameHash < h; });
+		p != pEnd && p->nameHash == nameHash; p++)
+	{
+		const char* pName = reinterpret_cast<const char*>(pBase) + p->nameOffset;
+		if (name == pName)
+		{
+			stats.hits++;
+			return MakeBytecode(pBlobs[p->blob], pName);
+		}
+	}
+	return {};
+}
+
+ShaderBytecode ShaderStore::FindByHash(uint64_t contentHash) noexcept
+{
+	stats.lookups++;
+	const BlobEntry* pEnd = pBlobs + blobCount;
+	const BlobEntry* p = std::lower_bound(pBlobs, pEnd, contentHash,
+		[](const BlobEntry& e, uint64_t h) { return e.contentHash < h; });
+	if (p == pEnd || p->contentHash != contentHash)
+	{
+		return {};
+	}
+	stats.hits++;
+	return MakeBytecode(*p, nullptr);
+}
+
+ShaderBytecode ShaderStore::MakeBytecode(const BlobEntry& blob, const char* name) const noexcept
+{
+	return { pBase + blob.offset, size_t(blob.size), name, blob.contentHash };
+}
+
+bool ShaderStore::Validate() const noexcept
+{
+	// everything is checked once here so lookups can trust the tables
+	const Header& header = *reinterpret_cast<const Header*>(pBase);
+	if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != Version ||
+		header.fileSize != mappedSize)
+	{
+		return false;
+	}
+	const uint64_t tablesEnd = sizeof(Header) +
+		uint64_t(header.nameCount) * sizeof(NameEntry) + uint64_t(header.blobCount) * sizeof(BlobEntry);
+	if (tablesEnd > mappedSize)
+	{
+		return false;
+	}
+
+	const NameEntry* pNameTable = reinterpret_cast<const NameEntry*>(pBase + sizeof(Header));
+	const BlobEntry* pBlobTable = reinterpret_cast<const BlobEntry*>(pNameTable + header.nameCount);
+	for (uint32_t i = 0; i < header.nameCount; i++)
+	{
+		const NameEntry& e = pNameTable[i];
+		if (e.blob >= header.blobCount || e.nameOffset < tablesEnd || e.nameOffset >= mappedSize ||
+			!std::memchr(pBase + e.nameOffset, '\0', mappedSize - e.nameOffset) ||
+			(i > 0u && pNameTable[i - 1u].nameHash > e.nameHash))
+		{
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < header.blobCount; i++)
+	{
+		const BlobEntry& e = pBlobTable[i];
+		if (e.offset < tablesEnd || e.offset > mappedSize || e.size > mappedSize - e.offset ||
+			(i > 0u && pBlobTable[i - 1u].contentHash >= e.contentHash))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void ShaderStore::Write(const std::string& archivePath, const std::vector<std::string>& shaderPaths)
+{
+	struct Blob
+	{
+		uint64_t					hash;
+		std::vector<unsigned char>	bytes;
+	};
+
+	// read everything and drop duplicate code
+	std::vector<Blob> blobs;
+	std::unordered_map<uint64_t, uint32_t> blobByHash;
+	std::vector<std::pair<std::string, uint64_t>> names;
+	for (const std::string& path : shaderPaths)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+		{
+			throw ResourceManager::LoadException(__LINE__, __FILE__, path);
+		}
+		std::vector<unsigned char> bytes{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+		const uint64_t hash = HashBytes(bytes.data(), bytes.size());
+		if (blobByHash.emplace(hash, uint32_t(blobs.size())).second)
+		{
+			blobs.push_back({ hash, std::move(bytes) });
+		}
+		names.emplace_back(path, hash);
+	}
+	std::sort(blobs.begin(), blobs.end(), [](const Blob& a, const Blob& b) { return a.hash < b.hash; });
+	for (uint32_t i = 0; i < uint32_t(blobs.size()); i++)
+	{
+		blobByHash[blobs[i].hash] = i;
+	}
+
+	std::vector<NameEntry> nameTable;
+	std::vector<BlobEntry> blobTable;
+	std::vector<char> nameText;
+	const size_t tablesEnd = sizeof(Header) + names.size() * sizeof(NameEntry) + blobs.size() * sizeof(BlobEntry);
+	for (const auto& [name, hash] : names)
+	{
+		nameTable.push_back({ HashBytes(name.data(), name.size()), uint32_t(tablesEnd + nameText.size()), blobByHash[hash] });
+		nameText.insert(nameText.end(), name.c_str(), name.c_str() + name.size() + 1u);
+	}
+	std::sort(nameTable.begin(), nameTable.end(), [](const NameEntry& a, const NameEntry& b) { return a.nameHash < b.nameHash; });
+
+	size_t offset = AlignUp(tablesEnd + nameText.size(), BlobAlignment);
+	for (const Blob& blob : blobs)
+	{
+		blobTable.push_back({ blob.hash, offset, blob.bytes.size() });
+		offset = AlignUp(offset + blob.bytes.size(), BlobAlignment);
+	}
+
+	Header header;
+	std::memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = Version;
+	header.nameCount = uint32_t(nameTable.size());
+	header.blobCount = uint32_t(blobTable.size());
+	header.fileSize = offset;
+
+	std::vector<unsigned char> image(offset, 0u);
+	std::memcpy(image.data(), &header, sizeof(header));
+	std::memcpy(image.data() + sizeof(Header), nameTable.data(), nameTable.size() * sizeof(NameEntry));
+	std::memcpy(image.data() + sizeof(Header) + nameTable.size() * sizeof(NameEntry), blobTable.data(),
+		blobTable.size() * sizeof(BlobEntry));
+	std::memcpy(image.data() + tablesEnd, nameText.data(), nameText.size());
+	for (size_t i = 0; i < blobs.size(); i++)
+	{
+		if (blobs[i].bytes.empty())
+		{
+			continue;
+		}
+		std::memcpy(image.data() + blobTable[i].offset, blobs[i].bytes.data(), blobs[i].bytes.size());
+	}
+
+	std::ofstream file(archivePath, std::ios::binary | std::ios::trunc);
+	if (!file.write(reinterpret_cast<const char*>(image.data()), std::streamsize(image.size())))
+	{
+		throw ResourceManager::LoadException(__LINE__, __FILE__, archivePath);
+	}
+}
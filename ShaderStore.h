@@ -0,0 +1,107 @@
+#pragma once
+#include "RenderDevice.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Read-only view of a shader archive: all compiled shaders of the game packed
+// into one file that is memory mapped when opened. Lookups hand out pointers
+// into the mapping, nothing is copied or read up front; the OS pages the code
+// in the first time a device reads it.
+//
+// The archive is content addressed. Every distinct bytecode is stored once,
+// keyed by its HashBytes() hash, and any number of names can refer to it
+// (permutations that compile to the same code share the bytes). Both names
+// and hashes are found by binary search over sorted tables in the file.
+//
+// Layout (little endian, offsets from the start of the file):
+//
+//	Header
+//	NameEntry[nameCount]	sorted by nameHash
+//	BlobEntry[blobCount]	sorted by contentHash
+//	names					NUL terminated
+//	bytecode				every blob 16 byte aligned
+//
+// Archives are written by Write(), e.g. from a build step or a development
+// menu. ResourceManager falls back to loose .cso files for names the
+// archive does not have.
+class ShaderStore
+{
+public:
+	struct Stats
+	{
+		uint64_t lookups	{ 0u };
+		uint64_t hits		{ 0u };
+	};
+
+public:
+	ShaderStore() = default;
+	~ShaderStore();
+	ShaderStore(const ShaderStore&) = delete;
+	ShaderStore& operator=(const ShaderStore&) = delete;
+
+	// maps an archive, replacing the one open before; returns false when the
+	// file is missing or not a valid archive (the store is empty then)
+	bool	Open(const std::string& path);
+	void	Close() noexcept;
+	bool	IsOpen() const noexcept { return pBase != nullptr; }
+
+	// pData is nullptr when the archive has no such shader; name and bytes
+	// point into the mapping and stay valid until Close()
+	ShaderBytecode	Find(const std::string& name) noexcept;
+	ShaderBytecode	FindByHash(uint64_t contentHash) noexcept;
+
+	size_t			GetShaderCount() const noexcept { return nameCount; }
+	size_t			GetBlobCount() const noexcept { return blobCount; }
+	const Stats&	GetStats() const noexcept { return stats; }
+
+	// packs the given .cso files into a new archive, stored under the paths
+	// as given; throws ResourceManager::LoadException for unreadable files
+	static void		Write(const std::string& archivePath, const std::vector<std::string>& shaderPaths);
+
+private:
+	struct Header
+	{
+		char		magic[4];
+		uint32_t	version;
+		uint32_t	nameCount;
+		uint32_t	blobCount;
+		uint64_t	fileSize;
+	};
+
+	struct NameEntry
+	{
+		uint64_t	nameHash;
+		uint32_t	nameOffset;
+		uint32_t	blob;
+	};
+
+	struct BlobEntry
+	{
+		uint64_t	contentHash;
+		uint64_t	offset;
+		uint64_t	size;
+	};
+
+	static constexpr char		Magic[4]	= { 'G', 'X', 'S', 'H' };
+	static constexpr uint32_t	Version		= 1u;
+
+private:
+	bool			Validate() const noexcept;
+	ShaderBytecode	MakeBytecode(const BlobEntry& blob, const char* name) const noexcept;
+
+private:
+	const unsigned char*	pBase		{ nullptr };
+	size_t					mappedSize	{ 0u };
+	const NameEntry*		pNames		{ nullptr };
+	const BlobEntry*		pBlobs		{ nullptr };
+	size_t					nameCount	{ 0u };
+	size_t					blobCount	{ 0u };
+	Stats					stats;
+
+	// platform handles of the mapping
+#ifdef _WIN32
+	void*	hFile		{ nullptr };
+	void*	hMapping	{ nullptr };
+#endif
+};
@@ -0,0 +1,424 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+// 8-lane SIMD types used by the CPU rendering code (software rasterizer,
+// culling, ...). One source, three implementations picked at compile time:
+//  - AVX2:   one __m256 / __m256i register          (/arch:AVX2, -mavx2)
+//  - SSE2:   two __m128 / __m128i registers         (any x64 build)
+//  - scalar: plain arrays, left to the auto-vectorizer
+// The lane count is always 8 so code written against these types does not
+// change with the instruction set, only its speed does. Define
+// GENIX_SIMD_NO_INTRINSICS to force the scalar path (handy for debugging).
+
+#if defined(GENIX_SIMD_NO_INTRINSICS)
+#define GENIX_SIMD_SCALAR 1
+#elif defined(__AVX2__)
+#define GENIX_SIMD_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GENIX_SIMD_SSE2 1
+#include <emmintrin.h>
+#else
+#define GENIX_SIMD_SCALAR 1
+#endif
+
+#if defined(_MSC_VER)
+#define SIMD_INLINE __forceinline
+#else
+#define SIMD_INLINE inline __attribute__((always_inline))
+#endif
+
+constexpr int SimdWidth = 8;
+
+struct SimdInt;
+
+struct SimdFloat
+{
+#if GENIX_SIMD_AVX2
+	__m256 v;
+#elif GENIX_SIMD_SSE2
+	__m128 lo, hi;
+#else
+	float v[SimdWidth];
+#endif
+
+	SimdFloat() = default;
+	SIMD_INLINE SimdFloat(float s) noexcept;
+
+	SIMD_INLINE static SimdFloat Load(const float* p) noexcept;	// unaligned
+	SIMD_INLINE void Store(float* p) const noexcept;				// unaligned
+	SIMD_INLINE static SimdFloat Ramp() noexcept;					// 0,1,...,7
+	SIMD_INLINE float Lane(int i) const noexcept { float t[SimdWidth]; Store(t); return t[i]; }
+};
+
+struct SimdInt
+{
+#if GENIX_SIMD_AVX2
+	__m256i v;
+#elif GENIX_SIMD_SSE2
+	__m128i lo, hi;
+#else
+	int32_t v[SimdWidth];
+#endif
+
+	SimdInt() = default;
+	SIMD_INLINE SimdInt(int32_t s) noexcept;
+
+	SIMD_INLINE static SimdInt Load(const int32_t* p) noexcept;
+	SIMD_INLINE void Store(int32_t* p) const noexcept;
+	SIMD_INLINE void Store(uint32_t* p) const noexcept { Store(reinterpret_cast<int32_t*>(p)); }
+	SIMD_INLINE static SimdInt Ramp() noexcept;
+	SIMD_INLINE int32_t Lane(int i) const noexcept { int32_t t[SimdWidth]; Store(t); return t[i]; }
+};
+
+#if GENIX_SIMD_AVX2
+
+SIMD_INLINE SimdFloat::SimdFloat(float s) noexcept : v(_mm256_set1_ps(s)) {}
+SIMD_INLINE SimdFloat SimdFloat::Load(const float* p) noexcept { SimdFloat r; r.v = _mm256_loadu_ps(p); return r; }
+SIMD_INLINE void SimdFloat::Store(float* p) const noexcept { _mm256_storeu_ps(p, v); }
+SIMD_INLINE SimdFloat SimdFloat::Ramp() noexcept { SimdFloat r; r.v = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7); return r; }
+
+SIMD_INLINE SimdInt::SimdInt(int32_t s) noexcept : v(_mm256_set1_epi32(s)) {}
+SIMD_INLINE SimdInt SimdInt::Load(const int32_t* p) noexcept { SimdInt r; r.v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); return r; }
+SIMD_INLINE void SimdInt::Store(int32_t* p) const noexcept { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+SIMD_INLINE SimdInt SimdInt::Ramp() noexcept { SimdInt r; r.v = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7); return r; }
+
+#define SIMD_F_BINOP(op, intrin) \
+	SIMD_INLINE SimdFloat op(SimdFloat a, SimdFloat b) noexcept { SimdFloat r; r.v = intrin(a.v, b.v); return r; }
+#define SIMD_I_BINOP(op, intrin) \
+	SIMD_INLINE SimdInt op(SimdInt a, SimdInt b) noexcept { SimdInt r; r.v = intrin(a.v, b.v); return r; }
+
+SIMD_F_BINOP(operator+, _mm256_add_ps)
+SIMD_F_BINOP(operator-, _mm256_sub_ps)
+SIMD_F_BINOP(operator*, _mm256_mul_ps)
+SIMD_F_BINOP(operator/, _mm256_div_ps)
+SIMD_F_BINOP(Min, _mm256_min_ps)
+SIMD_F_BINOP(Max, _mm256_max_ps)
+SIMD_F_BINOP(And, _mm256_and_ps)
+SIMD_F_BINOP(Or, _mm256_or_ps)
+
+SIMD_I_BINOP(operator+, _mm256_add_epi32)
+SIMD_I_BINOP(operator-, _mm256_sub_epi32)
+SIMD_I_BINOP(operator&, _mm256_and_si256)
+SIMD_I_BINOP(operator|, _mm256_or_si256)
+SIMD_I_BINOP(operator^, _mm256_xor_si256)
+SIMD_I_BINOP(Min, _mm256_min_epi32)
+SIMD_I_BINOP(Max, _mm256_max_epi32)
+SIMD_I_BINOP(CmpGt, _mm256_cmpgt_epi32)
+SIMD_I_BINOP(CmpEq, _mm256_cmpeq_epi32)
+SIMD_I_BINOP(MulLo, _mm256_mullo_epi32)
+
+SIMD_INLINE SimdInt AndNot(SimdInt a, SimdInt b) noexcept { SimdInt r; r.v = _mm256_andnot_si256(a.v, b.v); return r; }	// ~a & b
+SIMD_INLINE SimdFloat Sqrt(SimdFloat a) noexcept { SimdFloat r; r.v = _mm256_sqrt_ps(a.v); return r; }
+SIMD_INLINE SimdFloat Floor(SimdFloat a) noexcept { SimdFloat r; r.v = _mm256_floor_ps(a.v); return r; }
+SIMD_INLINE SimdFloat MulAdd(SimdFloat a, SimdFloat b, SimdFloat c) noexcept
+{
+	SimdFloat r;
+#if defined(__FMA__)
+	r.v = _mm256_fmadd_ps(a.v, b.v, c.v);
+#else
+	r.v = _mm256_add_ps(_mm256_mul_ps(a.v, b.v), c.v);
+#endif
+	return r;
+}
+
+template<int N> SIMD_INLINE SimdInt ShiftRightArith(SimdInt a) noexcept { SimdInt r; r.v = _mm256_srai_epi32(a.v, N); return r; }
+template<int N> SIMD_INLINE SimdInt ShiftRightLogic(SimdInt a) noexcept { SimdInt r; r.v = _mm256_srli_epi32(a.v, N); return r; }
+template<int N> SIMD_INLINE SimdInt ShiftLeft(SimdInt a) noexcept { SimdInt r; r.v = _mm256_slli_epi32(a.v, N); return r; }
+// per lane shift counts; counts of 32 and above give 0
+SIMD_INLINE SimdInt ShiftRightLogic(SimdInt a, SimdInt count) noexcept { SimdInt r; r.v = _mm256_srlv_epi32(a.v, count.v); return r; }
+
+SIMD_INLINE SimdInt CmpLt(SimdFloat a, SimdFloat b) noexcept { SimdInt r; r.v = _mm256_castps_si256(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)); return r; }
+SIMD_INLINE SimdInt CmpLe(SimdFloat a, SimdFloat b) noexcept { SimdInt r; r.v = _mm256_castps_si256(_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)); return r; }
+SIMD_INLINE SimdInt CmpGt(SimdFloat a, SimdFloat b) noexcept { return CmpLt(b, a); }
+SIMD_INLINE SimdInt CmpGe(SimdFloat a, SimdFloat b) noexcept { return CmpLe(b, a); }
+
+SIMD_INLINE SimdInt AsInt(SimdFloat a) noexcept { SimdInt r; r.v = _mm256_castps_si256(a.v); return r; }
+SIMD_INLINE SimdFloat AsFloat(SimdInt a) noexcept { SimdFloat r; r.v = _mm256_castsi256_ps(a.v); return r; }
+SIMD_INLINE SimdInt ToInt(SimdFloat a) noexcept { SimdInt r; r.v = _mm256_cvtps_epi32(a.v); return r; }		// round to nearest
+SIMD_INLINE SimdInt TruncToInt(SimdFloat a) noexcept { SimdInt r; r.v = _mm256_cvttps_epi32(a.v); return r; }
+SIMD_INLINE SimdFloat ToFloat(SimdInt a) noexcept { SimdFloat r; r.v = _mm256_cvtepi32_ps(a.v); return r; }
+
+// picks b where the mask lane is set, a elsewhere
+SIMD_INLINE SimdFloat Select(SimdInt mask, SimdFloat a, SimdFloat b) noexcept { SimdFloat r; r.v = _mm256_blendv_ps(a.v, b.v, _mm256_castsi256_ps(mask.v)); return r; }
+SIMD_INLINE SimdInt Select(SimdInt mask, SimdInt a, SimdInt b) noexcept { SimdInt r; r.v = _mm256_blendv_epi8(a.v, b.v, mask.v); return r; }
+
+// one bit per lane, taken from the lane's sign bit
+SIMD_INLINE int MoveMask(SimdInt a) noexcept { return _mm256_movemask_ps(_mm256_castsi256_ps(a.v)); }
+SIMD_INLINE int MoveMask(SimdFloat a) noexcept { return _mm256_movemask_ps(a.v); }
+
+SIMD_INLINE float HorizontalMin(SimdFloat a) noexcept
+{
+	__m128 m = _mm_min_ps(_mm256_castps256_ps128(a.v), _mm256_extractf128_ps(a.v, 1));
+	m = _mm_min_ps(m, _mm_movehl_ps(m, m));
+	m = _mm_min_ss(m, _mm_shuffle_ps(m, m, 1));
+	return _mm_cvtss_f32(m);
+}
+SIMD_INLINE float HorizontalMax(SimdFloat a) noexcept
+{
+	__m128 m = _mm_max_ps(_mm256_castps256_ps128(a.v), _mm256_extractf128_ps(a.v, 1));
+	m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+	m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+	return _mm_cvtss_f32(m);
+}
+
+// min / max of neighbouring lanes of the 16 values a:b, in order:
+// { op(a0,a1), op(a2,a3), ..., op(b6,b7) }
+SIMD_INLINE SimdFloat PairwiseMin(SimdFloat a, SimdFloat b) noexcept
+{
+	const __m256 even = _mm256_shuffle_ps(a.v, b.v, _MM_SHUFFLE(2, 0, 2, 0));
+	const __m256 odd = _mm256_shuffle_ps(a.v, b.v, _MM_SHUFFLE(3, 1, 3, 1));
+	SimdFloat r; r.v = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_min_ps(even, odd)), _MM_SHUFFLE(3, 1, 2, 0))); return r;
+}
+SIMD_INLINE SimdFloat PairwiseMax(SimdFloat a, SimdFloat b) noexcept
+{
+	const __m256 even = _mm256_shuffle_ps(a.v, b.v, _MM_SHUFFLE(2, 0, 2, 0));
+	const __m256 odd = _mm256_shuffle_ps(a.v, b.v, _MM_SHUFFLE(3, 1, 3, 1));
+	SimdFloat r; r.v = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_max_ps(even, odd)), _MM_SHUFFLE(3, 1, 2, 0))); return r;
+}
+
+// lanes 4-7 followed by lanes 0-3
+SIMD_INLINE SimdFloat SwapHalves(SimdFloat a) noexcept { SimdFloat r; r.v = _mm256_permute2f128_ps(a.v, a.v, 1); return r; }
+
+#undef SIMD_F_BINOP
+#undef SIMD_I_BINOP
+
+#elif GENIX_SIMD_SSE2
+
+SIMD_INLINE SimdFloat::SimdFloat(float s) noexcept : lo(_mm_set1_ps(s)), hi(_mm_set1_ps(s)) {}
+SIMD_INLINE SimdFloat SimdFloat::Load(const float* p) noexcept { SimdFloat r; r.lo = _mm_loadu_ps(p); r.hi = _mm_loadu_ps(p + 4); return r; }
+SIMD_INLINE void SimdFloat::Store(float* p) const noexcept { _mm_storeu_ps(p, lo); _mm_storeu_ps(p + 4, hi); }
+SIMD_INLINE SimdFloat SimdFloat::Ramp() noexcept { SimdFloat r; r.lo = _mm_setr_ps(0, 1, 2, 3); r.hi = _mm_setr_ps(4, 5, 6, 7); return r; }
+
+SIMD_INLINE SimdInt::SimdInt(int32_t s) noexcept : lo(_mm_set1_epi32(s)), hi(_mm_set1_epi32(s)) {}
+SIMD_INLINE SimdInt SimdInt::Load(const int32_t* p) noexcept
+{
+	SimdInt r;
+	r.lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+	r.hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 4));
+	return r;
+}
+SIMD_INLINE void SimdInt::Store(int32_t* p) const noexcept
+{
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(p), lo);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(p + 4), hi);
+}
+SIMD_INLINE SimdInt SimdInt::Ramp() noexcept { SimdInt r; r.lo = _mm_setr_epi32(0, 1, 2, 3); r.hi = _mm_setr_epi32(4, 5, 6, 7); return r; }
+
+#define SIMD_F_BINOP(op, intrin) \
+	SIMD_INLINE SimdFloat op(SimdFloat a, SimdFloat b) noexcept { SimdFloat r; r.lo = intrin(a.lo, b.lo); r.hi = intrin(a.hi, b.hi); return r; }
+#define SIMD_I_BINOP(op, intrin) \
+	SIMD_INLINE SimdInt op(SimdInt a, SimdInt b) noexcept { SimdInt r; r.lo = intrin(a.lo, b.lo); r.hi = intrin(a.hi, b.hi); return r; }
+
+SIMD_F_BINOP(operator+, _mm_add_ps)
+SIMD_F_BINOP(operator-, _mm_sub_ps)
+SIMD_F_BINOP(operator*, _mm_mul_ps)
+SIMD_F_BINOP(operator/, _mm_div_ps)
+SIMD_F_BINOP(Min, _mm_min_ps)
+SIMD_F_BINOP(Max, _mm_max_ps)
+SIMD_F_BINOP(And, _mm_and_ps)
+SIMD_F_BINOP(Or, _mm_or_ps)
+
+SIMD_I_BINOP(operator+, _mm_add_epi32)
+SIMD_I_BINOP(operator-, _mm_sub_epi32)
+SIMD_I_BINOP(operator&, _mm_and_si128)
+SIMD_I_BINOP(operator|, _mm_or_si128)
+SIMD_I_BINOP(operator^, _mm_xor_si128)
+SIMD_I_BINOP(CmpGt, _mm_cmpgt_epi32)
+SIMD_I_BINOP(CmpEq, _mm_cmpeq_epi32)
+
+SIMD_INLINE SimdInt AndNot(SimdInt a, SimdInt b) noexcept { SimdInt r; r.lo = _mm_andnot_si128(a.lo, b.lo); r.hi = _mm_andnot_si128(a.hi, b.hi); return r; }
+SIMD_INLINE SimdInt Select(SimdInt mask, SimdInt a, SimdInt b) noexcept { return (mask & b) | AndNot(mask, a); }
+SIMD_INLINE SimdInt Min(SimdInt a, SimdInt b) noexcept { return Select(CmpGt(a, b), a, b); }
+SIMD_INLINE SimdInt Max(SimdInt a, SimdInt b) noexcept { return Select(CmpGt(a, b), b, a); }
+SIMD_INLINE SimdInt MulLo(SimdInt a, SimdInt b) noexcept
+{
+	// SSE2 has no 32 bit multiply-low; multiply even and odd lanes separately
+	auto mul4 = [](__m128i x, __m128i y)
+	{
+		const __m128i even = _mm_mul_epu32(x, y);
+		const __m128i odd = _mm_mul_epu32(_mm_srli_si128(x, 4), _mm_srli_si128(y, 4));
+		return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+	};
+	SimdInt r; r.lo = mul4(a.lo, b.lo); r.hi = mul4(a.hi, b.hi); return r;
+}
+
+SIMD_INLINE SimdFloat Sqrt(SimdFloat a) noexcept { SimdFloat r; r.lo = _mm_sqrt_ps(a.lo); r.hi = _mm_sqrt_ps(a.hi); return r; }
+SIMD_INLINE SimdFloat MulAdd(SimdFloat a, SimdFloat b, SimdFloat c) noexcept { return a * b + c; }
+
+template<int N> SIMD_INLINE SimdInt ShiftRightArith(SimdInt a) noexcept { SimdInt r; r.lo = _mm_srai_epi32(a.lo, N); r.hi = _mm_srai_epi32(a.hi, N); return r; }
+template<int N> SIMD_INLINE SimdInt ShiftRightLogic(SimdInt a) noexcept { SimdInt r; r.lo = _mm_srli_epi32(a.lo, N); r.hi = _mm_srli_epi32(a.hi, N); return r; }
+template<int N> SIMD_INLINE SimdInt ShiftLeft(SimdInt a) noexcept { SimdInt r; r.lo = _mm_slli_epi32(a.lo, N); r.hi = _mm_slli_epi32(a.hi, N); return r; }
+SIMD_INLINE SimdInt ShiftRightLogic(SimdInt a, SimdInt count) noexcept
+{
+	// SSE2 only shifts all lanes by the same count
+	alignas(16) uint32_t values[SimdWidth];
+	alignas(16) uint32_t counts[SimdWidth];
+	a.Store(values);
+	count.Store(counts);
+	for (int i = 0; i < SimdWidth; i++)
+	{
+		values[i] = counts[i] < 32u ? values[i] >> counts[i] : 0u;
+	}
+	return SimdInt::Load(reinterpret_cast<const int32_t*>(values));
+}
+
+SIMD_INLINE SimdInt CmpLt(SimdFloat a, SimdFloat b) noexcept { SimdInt r; r.lo = _mm_castps_si128(_mm_cmplt_ps(a.lo, b.lo)); r.hi = _mm_castps_si128(_mm_cmplt_ps(a.hi, b.hi)); return r; }
+SIMD_INLINE SimdInt CmpLe(SimdFloat a, SimdFloat b) noexcept { SimdInt r; r.lo = _mm_castps_si128(_mm_cmple_ps(a.lo, b.lo)); r.hi = _mm_castps_si128(_mm_cmple_ps(a.hi, b.hi)); return r; }
+SIMD_INLINE SimdInt CmpGt(SimdFloat a, SimdFloat b) noexcept { return CmpLt(b, a); }
+SIMD_INLINE SimdInt CmpGe(SimdFloat a, SimdFloat b) noexcept { return CmpLe(b, a); }
+
+SIMD_INLINE SimdInt AsInt(SimdFloat a) noexcept { SimdInt r; r.lo = _mm_castps_si128(a.lo); r.hi = _mm_castps_si128(a.hi); return r; }
+SIMD_INLINE SimdFloat AsFloat(SimdInt a) noexcept { SimdFloat r; r.lo = _mm_castsi128_ps(a.lo); r.hi = _mm_castsi128_ps(a.hi); return r; }
+SIMD_INLINE SimdInt ToInt(SimdFloat a) noexcept { SimdInt r; r.lo = _mm_cvtps_epi32(a.lo); r.hi = _mm_cvtps_epi32(a.hi); return r; }
+SIMD_INLINE SimdInt TruncToInt(SimdFloat a) noexcept { SimdInt r; r.lo = _mm_cvttps_epi32(a.lo); r.hi = _mm_cvttps_epi32(a.hi); return r; }
+SIMD_INLINE SimdFloat ToFloat(SimdInt a) noexcept { SimdFloat r; r.lo = _mm_cvtepi32_ps(a.lo); r.hi = _mm_cvtepi32_ps(a.hi); return r; }
+
+SIMD_INLINE SimdFloat Select(SimdInt mask, SimdFloat a, SimdFloat b) noexcept { return AsFloat(Select(mask, AsInt(a), AsInt(b))); }
+
+SIMD_INLINE SimdFloat Floor(SimdFloat a) noexcept
+{
+	// truncate, then step down where truncation rounded up (negative values);
+	// only valid for |a| < 2^31, which is all the renderer needs
+	const SimdFloat t = ToFloat(TruncToInt(a));
+	return t - And(AsFloat(CmpGt(t, a)), SimdFloat(1.0f));
+}
+
+SIMD_INLINE int MoveMask(SimdInt a) noexcept { return _mm_movemask_ps(_mm_castsi128_ps(a.lo)) | (_mm_movemask_ps(_mm_castsi128_ps(a.hi)) << 4); }
+SIMD_INLINE int MoveMask(SimdFloat a) noexcept { return _mm_movemask_ps(a.lo) | (_mm_movemask_ps(a.hi) << 4); }
+
+SIMD_INLINE float HorizontalMin(SimdFloat a) noexcept
+{
+	__m128 m = _mm_min_ps(a.lo, a.hi);
+	m = _mm_min_ps(m, _mm_movehl_ps(m, m));
+	m = _mm_min_ss(m, _mm_shuffle_ps(m, m, 1));
+	return _mm_cvtss_f32(m);
+}
+SIMD_INLINE float HorizontalMax(SimdFloat a) noexcept
+{
+	__m128 m = _mm_max_ps(a.lo, a.hi);
+	m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+	m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+	return _mm_cvtss_f32(m);
+}
+
+SIMD_INLINE SimdFloat PairwiseMin(SimdFloat a, SimdFloat b) noexcept
+{
+	SimdFloat r;
+	r.lo = _mm_min_ps(_mm_shuffle_ps(a.lo, a.hi, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(a.lo, a.hi, _MM_SHUFFLE(3, 1, 3, 1)));
+	r.hi = _mm_min_ps(_mm_shuffle_ps(b.lo, b.hi, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(b.lo, b.hi, _MM_SHUFFLE(3, 1, 3, 1)));
+	return r;
+}
+SIMD_INLINE SimdFloat PairwiseMax(SimdFloat a, SimdFloat b) noexcept
+{
+	SimdFloat r;
+	r.lo = _mm_max_ps(_mm_shuffle_ps(a.lo, a.hi, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(a.lo, a.hi, _MM_SHUFFLE(3, 1, 3, 1)));
+	r.hi = _mm_max_ps(_mm_shuffle_ps(b.lo, b.hi, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(b.lo, b.hi, _MM_SHUFFLE(3, 1, 3, 1)));
+	return r;
+}
+
+SIMD_INLINE SimdFloat SwapHalves(SimdFloat a) noexcept { SimdFloat r; r.lo = a.hi; r.hi = a.lo; return r; }
+
+#undef SIMD_F_BINOP
+#undef SIMD_I_BINOP
+
+#else // GENIX_SIMD_SCALAR
+
+SIMD_INLINE SimdFloat::SimdFloat(float s) noexcept { for (int i = 0; i < SimdWidth; i++) v[i] = s; }
+SIMD_INLINE SimdFloat SimdFloat::Load(const float* p) noexcept { SimdFloat r; std::memcpy(r.v, p, sizeof(r.v)); return r; }
+SIMD_INLINE void SimdFloat::Store(float* p) const noexcept { std::memcpy(p, v, sizeof(v)); }
+SIMD_INLINE SimdFloat SimdFloat::Ramp() noexcept { SimdFloat r; for (int i = 0; i < SimdWidth; i++) r.v[i] = float(i); return r; }
+
+SIMD_INLINE SimdInt::SimdInt(int32_t s) noexcept { for (int i = 0; i < SimdWidth; i++) v[i] = s; }
+SIMD_INLINE SimdInt SimdInt::Load(const int32_t* p) noexcept { SimdInt r; std::memcpy(r.v, p, sizeof(r.v)); return r; }
+SIMD_INLINE void SimdInt::Store(int32_t* p) const noexcept { std::memcpy(p, v, sizeof(v)); }
+SIMD_INLINE SimdInt SimdInt::Ramp() noexcept { SimdInt r; for (int i = 0; i < SimdWidth; i++) r.v[i] = i; return r; }
+
+#define SIMD_F_BINOP(op, expr) \
+	SIMD_INLINE SimdFloat op(SimdFloat a, SimdFloat b) noexcept { SimdFloat r; for (int i = 0; i < SimdWidth; i++) { const float x = a.v[i], y = b.v[i]; r.v[i] = (expr); } return r; }
+#define SIMD_I_BINOP(op, expr) \
+	SIMD_INLINE SimdInt op(SimdInt a, SimdInt b) noexcept { SimdInt r; for (int i = 0; i < SimdWidth; i++) { const int32_t x = a.v[i], y = b.v[i]; r.v[i] = (expr); } return r; }
+
+SIMD_F_BINOP(operator+, x + y)
+SIMD_F_BINOP(operator-, x - y)
+SIMD_F_BINOP(operator*, x * y)
+SIMD_F_BINOP(operator/, x / y)
+SIMD_F_BINOP(Min, y < x ? y : x)
+SIMD_F_BINOP(Max, y > x ? y : x)
+
+SIMD_I_BINOP(operator+, int32_t(uint32_t(x) + uint32_t(y)))
+SIMD_I_BINOP(operator-, int32_t(uint32_t(x) - uint32_t(y)))
+SIMD_I_BINOP(operator&, x & y)
+SIMD_I_BINOP(operator|, x | y)
+SIMD_I_BINOP(operator^, x ^ y)
+SIMD_I_BINOP(Min, y < x ? y : x)
+SIMD_I_BINOP(Max, y > x ? y : x)
+SIMD_I_BINOP(CmpGt, x > y ? -1 : 0)
+SIMD_I_BINOP(CmpEq, x == y ? -1 : 0)
+SIMD_I_BINOP(MulLo, int32_t(uint32_t(x) * uint32_t(y)))
+SIMD_I_BINOP(AndNot, ~x & y)
+
+SIMD_INLINE SimdInt AsInt(SimdFloat a) noexcept { SimdInt r; std::memcpy(r.v, a.v, sizeof(r.v)); return r; }
+SIMD_INLINE SimdFloat AsFloat(SimdInt a) noexcept { SimdFloat r; std::memcpy(r.v, a.v, sizeof(r.v)); return r; }
+SIMD_INLINE SimdFloat And(SimdFloat a, SimdFloat b) noexcept { return AsFloat(AsInt(a) & AsInt(b)); }
+SIMD_INLINE SimdFloat Or(SimdFloat a, SimdFloat b) noexcept { return AsFloat(AsInt(a) | AsInt(b)); }
+
+SIMD_INLINE SimdFloat Sqrt(SimdFloat a) noexcept { SimdFloat r; for (int i = 0; i < SimdWidth; i++) r.v[i] = std::sqrt(a.v[i]); return r; }
+SIMD_INLINE SimdFloat Floor(SimdFloat a) noexcept { SimdFloat r; for (int i = 0; i < SimdWidth; i++) r.v[i] = std::floor(a.v[i]); return r; }
+SIMD_INLINE SimdFloat MulAdd(SimdFloat a, SimdFloat b, SimdFloat c) noexcept { return a * b + c; }
+
+template<int N> SIMD_INLINE SimdInt ShiftRightArith(SimdInt a) noexcept { SimdInt r; for (int i = 0; i < SimdWidth; i++) r.v[i] = a.v[i] >> N; return r; }
+template<int N> SIMD_INLINE SimdInt ShiftRightLogic(SimdInt a) noexcept { SimdInt r; for (int i = 0; i < SimdWidth; i++) r.v[i] = int32_t(uint32_t(a.v[i]) >> N); return r; }
+template<int N> SIMD_INLINE SimdInt ShiftLeft(SimdInt a) noexcept { SimdInt r; for (int i = 0; i < SimdWidth; i++) r.v[i] = int32_t(uint32_t(a.v[i]) << N); return r; }
+SIMD_INLINE SimdInt ShiftRightLogic(SimdInt a, SimdInt count) noexcept { SimdInt r; for (int i = 0; i < SimdWidth; i++) r.v[i] = uint32_t(count.v[i]) < 32u ? int32_t(uint32_t(a.v[i]) >> count.v[i]) : 0; return r; }
+
+SIMD_INLINE SimdInt CmpLt(SimdFloat a, SimdFloat b) noexcept { SimdInt r; for (int i = 0; i < SimdWidth; i++) r.v[i] = a.v[i] < b.v[i] ? -1 : 0; return r; }
+SIMD_INLINE SimdInt CmpLe(SimdFloat a, SimdFloat b) noexcept { SimdInt r; for (int i = 0; i < SimdWidth; i++) r.v[i] = a.v[i] <= b.v[i] ? -1 : 0; return r; }
+SIMD_INLINE SimdInt CmpGt(SimdFloat a, SimdFloat b) noexcept { return CmpLt(b, a); }
+SIMD_INLINE SimdInt CmpGe(SimdFloat a, SimdFloat b) noexcept { return CmpLe(b, a); }
+
+SIMD_INLINE SimdInt ToInt(SimdFloat a) noexcept { SimdInt r; for (int i = 0; i < SimdWidth; i++) r.v[i] = int32_t(std::nearbyint(a.v[i])); return r; }
+SIMD_INLINE SimdInt TruncToInt(SimdFloat a) noexcept { SimdInt r; for (int i = 0; i < SimdWidth; i++) r.v[i] = int32_t(a.v[i]); return r; }
+SIMD_INLINE SimdFloat ToFloat(SimdInt a) noexcept { SimdFloat r; for (int i = 0; i < SimdWidth; i++) r.v[i] = float(a.v[i]); return r; }
+
+SIMD_INLINE SimdInt Select(SimdInt mask, SimdInt a, SimdInt b) noexcept { return (mask & b) | AndNot(mask, a); }
+SIMD_INLINE SimdFloat Select(SimdInt mask, SimdFloat a, SimdFloat b) noexcept { return AsFloat(Select(mask, AsInt(a), AsInt(b))); }
+
+SIMD_INLINE int MoveMask(SimdInt a) noexcept { int m = 0; for (int i = 0; i < SimdWidth; i++) m |= (a.v[i] < 0 ? 1 : 0) << i; return m; }
+SIMD_INLINE int MoveMask(SimdFloat a) noexcept { return MoveMask(AsInt(a)); }
+
+SIMD_INLINE float HorizontalMin(SimdFloat a) noexcept { float m = a.v[0]; for (int i = 1; i < SimdWidth; i++) m = a.v[i] < m ? a.v[i] : m; return m; }
+SIMD_INLINE float HorizontalMax(SimdFloat a) noexcept { float m = a.v[0]; for (int i = 1; i < SimdWidth; i++) m = a.v[i] > m ? a.v[i] : m; return m; }
+
+SIMD_INLINE SimdFloat PairwiseMin(SimdFloat a, SimdFloat b) noexcept
+{
+	SimdFloat r;
+	for (int i = 0; i < SimdWidth / 2; i++) { r.v[i] = a.v[2 * i + 1] < a.v[2 * i] ? a.v[2 * i + 1] : a.v[2 * i]; r.v[i + 4] = b.v[2 * i + 1] < b.v[2 * i] ? b.v[2 * i + 1] : b.v[2 * i]; }
+	return r;
+}
+SIMD_INLINE SimdFloat PairwiseMax(SimdFloat a, SimdFloat b) noexcept
+{
+	SimdFloat r;
+	for (int i = 0; i < SimdWidth / 2; i++) { r.v[i] = a.v[2 * i + 1] > a.v[2 * i] ? a.v[2 * i + 1] : a.v[2 * i]; r.v[i + 4] = b.v[2 * i + 1] > b.v[2 * i] ? b.v[2 * i + 1] : b.v[2 * i]; }
+	return r;
+}
+
+SIMD_INLINE SimdFloat SwapHalves(SimdFloat a) noexcept { SimdFloat r; for (int i = 0; i < SimdWidth; i++) r.v[i] = a.v[(i + SimdWidth / 2) % SimdWidth]; return r; }
+
+#undef SIMD_F_BINOP
+#undef SIMD_I_BINOP
+
+#endif
+
+SIMD_INLINE SimdFloat operator-(SimdFloat a) noexcept { return SimdFloat(0.0f) - a; }
+SIMD_INLINE SimdFloat Abs(SimdFloat a) noexcept { return AsFloat(AsInt(a) & SimdInt(0x7FFFFFFF)); }
+SIMD_INLINE SimdFloat Clamp(SimdFloat a, SimdFloat lo, SimdFloat hi) noexcept { return Min(Max(a, lo), hi); }
+SIMD_INLINE SimdFloat& operator+=(SimdFloat& a, SimdFloat b) noexcept { a = a + b; return a; }
+SIMD_INLINE SimdFloat& operator-=(SimdFloat& a, SimdFloat b) noexcept { a = a - b; return a; }
+SIMD_INLINE SimdFloat& operator*=(SimdFloat& a, SimdFloat b) noexcept { a = a * b; return a; }
+SIMD_INLINE SimdInt& operator+=(SimdInt& a, SimdInt b) noexcept { a = a + b; return a; }
+SIMD_INLINE SimdInt& operator-=(SimdInt& a, SimdInt b) noexcept { a = a - b; return a; }
+SIMD_INLINE SimdInt& operator&=(SimdInt& a, SimdInt b) noexcept { a = a & b; return a; }
+SIMD_INLINE SimdInt& operator|=(SimdInt& a, SimdInt b) noexcept { a = a | b; return a; }
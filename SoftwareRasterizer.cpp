@@ -0,0 +1,800 @@
+#include "SoftwareRasterizer.h"
+#include "Simd.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace
+{
+	constexpr int64_t SubPixelScale = 1 << SoftwareRasterizer::SubPixelBits;
+
+	// triangles are set up and binned in batches of this many; a batch is the
+	// unit of parallelism of the setup phase
+	constexpr size_t BatchSize = 256u;
+	// batches set up before the tiles are rasterized; large draws go in
+	// passes of this many, so the set up triangles (about 200 bytes each)
+	// are still in the cache when the tiles read them
+	constexpr size_t PassBatches = 32u;
+
+	// Clip-space guard band: triangles are only clipped against x and y once
+	// they reach further than this many viewport widths/heights off screen.
+	// Together with the viewport size limit of 16384 this keeps the snapped
+	// coordinates small enough for the 32 bit edge stepping inside a block.
+	constexpr float GuardBand = 8.0f;
+	constexpr float MinW = 1e-6f;
+
+	// inside a block edge values are clamped to this before going 32 bit;
+	// a block step never exceeds it so clamped values keep their sign
+	constexpr int64_t EdgeClamp = int64_t(1) << 30;
+
+	// clip planes in homogeneous space, inside when Distance() >= 0
+	enum ClipPlane
+	{
+		ClipNear,	// z >= 0
+		ClipFar,	// z <= w
+		ClipLeft,
+		ClipRight,
+		ClipTop,
+		ClipBottom,
+		ClipW,		// w >= MinW, keeps the perspective divide finite
+		ClipPlaneCount,
+	};
+
+	float Distance(ClipPlane plane, const float p[4]) noexcept
+	{
+		switch (plane)
+		{
+		case ClipNear:		return p[2];
+		case ClipFar:		return p[3] - p[2];
+		case ClipLeft:		return GuardBand * p[3] + p[0];
+		case ClipRight:		return GuardBand * p[3] - p[0];
+		case ClipTop:		return GuardBand * p[3] - p[1];
+		case ClipBottom:	return GuardBand * p[3] + p[1];
+		case ClipW:			return p[3] - MinW;
+		default:			return 0.0f;
+		}
+	}
+
+	unsigned int OutCode(const float p[4]) noexcept
+	{
+		unsigned int code = 0u;
+		for (int plane = 0; plane < ClipPlaneCount; plane++)
+		{
+			if (Distance(ClipPlane(plane), p) < 0.0f)
+				code |= 1u << plane;
+		}
+		return code;
+	}
+
+	// std::llround without the library call, exact for |v| < 2^31: adding
+	// the float just below 0.5 rounds ties away from zero, the conversion
+	// truncates
+	int64_t RoundToInt64(float v) noexcept
+	{
+		return int64_t(v + std::copysign(0.49999997f, v));
+	}
+
+	int64_t FloorDiv(int64_t a, int64_t b) noexcept
+	{
+		return a >= 0 ? a / b : -((-a + b - 1) / b);
+	}
+
+	int64_t CeilDiv(int64_t a, int64_t b) noexcept
+	{
+		return -FloorDiv(-a, b);
+	}
+
+	// all bits set in lane i where bit i of coverage is set
+	SimdInt CoverageMask(int coverage) noexcept
+	{
+		alignas(32) static constexpr int32_t LaneBits[SimdWidth] = { 1, 2, 4, 8, 16, 32, 64, 128 };
+		const SimdInt bits = SimdInt::Load(LaneBits);
+		return CmpEq(SimdInt(coverage) & bits, bits);
+	}
+}
+
+SoftwareRasterizer::SoftwareRasterizer(JobSystem& jobs)
+	: jobs(jobs),
+	threadStats(jobs.GetThreadCount())
+{}
+
+void SoftwareRasterizer::SetRenderTarget(uint32_t* pTarget, unsigned int targetWidth, unsigned int targetHeight)
+{
+	pColor = pTarget;
+	width = targetWidth;
+	height = targetHeight;
+	tilesX = (width + TileSize - 1u) / TileSize;
+	tilesY = (height + TileSize - 1u) / TileSize;
+	SetViewport(viewport);
+}
+
+void SoftwareRasterizer::SetViewport(const Viewport& vp) noexcept
+{
+	viewport = vp;
+	scissorX0 = std::max(0, int(std::ceil(vp.topLeftX)));
+	scissorY0 = std::max(0, int(std::ceil(vp.topLeftY)));
+	scissorX1 = std::min(int(width), int(vp.topLeftX + vp.width));
+	scissorY1 = std::min(int(height), int(vp.topLeftY + vp.height));
+}
+
+void SoftwareRasterizer::DrawTriangles(const Vertex* pVertices, const uint32_t* pIndices, size_t triangleCount,
+									   unsigned int count)
+{
+	// a draw either shades or at least writes depth
+	const bool shades = pColor && pPixelShader;
+	const bool writesDepth = pDepth && depthMode == DepthMode::TestWrite;
+	if ((!shades && !writesDepth) || triangleCount == 0u || scissorX0 >= scissorX1 || scissorY0 >= scissorY1)
+	{
+		return;
+	}
+	varyingCount = std::min(count, unsigned(MaxVaryings));
+
+	// one pass after the other, so later triangles still land on top
+	const size_t passTriangles = PassBatches * BatchSize;
+	for (size_t pass = 0u; pass < triangleCount; pass += passTriangles)
+	{
+		const size_t passCount = std::min(passTriangles, triangleCount - pass);
+		const uint32_t* pPassIndices = pIndices + pass * 3u;
+		const size_t batchCount = (passCount + BatchSize - 1u) / BatchSize;
+		if (batches.size() < batchCount)
+		{
+			batches.resize(batchCount);
+		}
+
+		jobs.ParallelFor(batchCount, 1u, [&](size_t begin, size_t end, unsigned int threadIndex)
+		{
+			for (size_t b = begin; b < end; b++)
+			{
+				const size_t first = b * BatchSize;
+				SetupBatch(batches[b], pVertices, pPassIndices, first, std::min(first + BatchSize, passCount),
+						   threadStats[threadIndex].stats);
+			}
+		});
+
+		jobs.ParallelFor(size_t(tilesX) * tilesY, 1u, [&](size_t begin, size_t end, unsigned int threadIndex)
+		{
+			for (size_t tile = begin; tile < end; tile++)
+			{
+				RasterizeTile(unsigned(tile), batchCount, threadStats[threadIndex].stats);
+			}
+		});
+	}
+}
+
+SoftwareRasterizer::Stats SoftwareRasterizer::GetStats() const noexcept
+{
+	Stats total;
+	for (const ThreadStats& t : threadStats)
+	{
+		total.trianglesSubmitted	+= t.stats.trianglesSubmitted;
+		total.trianglesCulled		+= t.stats.trianglesCulled;
+		total.trianglesClipped		+= t.stats.trianglesClipped;
+		total.trianglesSetup		+= t.stats.trianglesSetup;
+		total.binEntries			+= t.stats.binEntries;
+		total.blocksRejected		+= t.stats.blocksRejected;
+		total.blocksFull			+= t.stats.blocksFull;
+		total.blocksPartial			+= t.stats.blocksPartial;
+		total.pixelsWritten			+= t.stats.pixelsWritten;
+		total.pixelsDepthFailed		+= t.stats.pixelsDepthFailed;
+	}
+	return total;
+}
+
+void SoftwareRasterizer::ResetStats() noexcept
+{
+	for (ThreadStats& t : threadStats)
+	{
+		t.stats = {};
+	}
+}
+
+void SoftwareRasterizer::SetupBatch(Batch& batch, const Vertex* pVertices, const uint32_t* pIndices,
+									size_t begin, size_t end, Stats& stats)
+{
+	batch.triangles.clear();
+	batch.bins.resize(size_t(tilesX) * tilesY);
+	for (std::vector<uint32_t>& bin : batch.bins)
+	{
+		bin.clear();
+	}
+
+	for (size_t t = begin; t < end; t++)
+	{
+		stats.trianglesSubmitted++;
+		const Vertex& v0 = pVertices[pIndices[t * 3u + 0u]];
+		const Vertex& v1 = pVertices[pIndices[t * 3u + 1u]];
+		const Vertex& v2 = pVertices[pIndices[t * 3u + 2u]];
+
+		const unsigned int code0 = OutCode(v0.position);
+		const unsigned int code1 = OutCode(v1.position);
+		const unsigned int code2 = OutCode(v2.position);
+		if ((code0 & code1 & code2) != 0u)
+		{
+			// all vertices outside the same plane
+			stats.trianglesCulled++;
+			continue;
+		}
+		if ((code0 | code1 | code2) == 0u)
+		{
+			SetupTriangle(batch, v0, v1, v2, stats);
+			continue;
+		}
+
+		// Sutherland-Hodgman against every plane that is crossed; each plane
+		// adds at most one vertex
+		stats.trianglesClipped++;
+		Vertex polygon[2][3 + ClipPlaneCount];
+		int vertexCount = 3;
+		polygon[0][0] = v0;
+		polygon[0][1] = v1;
+		polygon[0][2] = v2;
+		int current = 0;
+		const unsigned int crossed = code0 | code1 | code2;
+		for (int plane = 0; plane < ClipPlaneCount && vertexCount >= 3; plane++)
+		{
+			if ((crossed & (1u << plane)) == 0u)
+				continue;
+
+			const Vertex* pIn = polygon[current];
+			Vertex* pOut = polygon[current ^ 1];
+			int outCount = 0;
+			for (int i = 0; i < vertexCount; i++)
+			{
+				const Vertex& a = pIn[i];
+				const Vertex& b = pIn[(i + 1) % vertexCount];
+				const float da = Distance(ClipPlane(plane), a.position);
+				const float db = Distance(ClipPlane(plane), b.position);
+				if (da >= 0.0f)
+				{
+					pOut[outCount++] = a;
+				}
+				if ((da >= 0.0f) != (db >= 0.0f))
+				{
+					const float s = da / (da - db);
+					Vertex& v = pOut[outCount++];
+					for (int c = 0; c < 4; c++)
+						v.position[c] = a.position[c] + (b.position[c] - a.position[c]) * s;
+					for (unsigned int c = 0; c < varyingCount; c++)
+						v.varyings[c] = a.varyings[c] + (b.varyings[c] - a.varyings[c]) * s;
+				}
+			}
+			vertexCount = outCount;
+			current ^= 1;
+		}
+
+		// fan keeps the winding of the source triangle
+		for (int i = 1; i + 1 < vertexCount; i++)
+		{
+			SetupTriangle(batch, polygon[current][0], polygon[current][i], polygon[current][i + 1], stats);
+		}
+	}
+}
+
+void SoftwareRasterizer::SetupTriangle(Batch& batch, const Vertex& v0, const Vertex& v1, const Vertex& v2, Stats& stats)
+{
+	const Vertex* v[3] = { &v0, &v1, &v2 };
+	int64_t x[3], y[3];
+	double invW[3], depth[3];
+	for (int i = 0; i < 3; i++)
+	{
+		// the viewport transform is float math like in D3D, positions are
+		// then snapped to 1/16 pixel
+		const float rcpW = 1.0f / v[i]->position[3];
+		const float sx = viewport.topLeftX + (v[i]->position[0] * rcpW * 0.5f + 0.5f) * viewport.width;
+		const float sy = viewport.topLeftY + (0.5f - v[i]->position[1] * rcpW * 0.5f) * viewport.height;
+		invW[i] = rcpW;
+		depth[i] = v[i]->position[2] * rcpW;
+		x[i] = RoundToInt64(sx * SubPixelScale);
+		y[i] = RoundToInt64(sy * SubPixelScale);
+	}
+
+	// twice the signed area; positive for clockwise triangles on screen,
+	// which are the front faces under the default D3D rasterizer state
+	const int64_t area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+	if (area <= 0)
+	{
+		stats.trianglesCulled++;
+		return;
+	}
+
+	// pixel centers inside the bounding box, clipped to the scissor rectangle
+	const int64_t half = SubPixelScale / 2;
+	Triangle tri;
+	tri.minX = int32_t(std::max<int64_t>(scissorX0, CeilDiv(std::min({ x[0], x[1], x[2] }) - half, SubPixelScale)));
+	tri.maxX = int32_t(std::min<int64_t>(scissorX1 - 1, FloorDiv(std::max({ x[0], x[1], x[2] }) - half, SubPixelScale)));
+	tri.minY = int32_t(std::max<int64_t>(scissorY0, CeilDiv(std::min({ y[0], y[1], y[2] }) - half, SubPixelScale)));
+	tri.maxY = int32_t(std::min<int64_t>(scissorY1 - 1, FloorDiv(std::max({ y[0], y[1], y[2] }) - half, SubPixelScale)));
+	if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+	{
+		// off screen or too thin to cover a pixel center
+		stats.trianglesCulled++;
+		return;
+	}
+
+	// edge i is opposite vertex i, so edge i divided by the area is the
+	// barycentric weight of vertex i
+	int64_t c[3];
+	for (int i = 0; i < 3; i++)
+	{
+		const int from = (i + 1) % 3;
+		const int to = (i + 2) % 3;
+		const int64_t dx = x[to] - x[from];
+		const int64_t dy = y[to] - y[from];
+		// in sub-pixel units: e = -dy*sx + dx*sy + (dy*x0 - dx*y0); converted
+		// to pixel indices through sx = 16*px + 8
+		tri.a[i] = -dy * SubPixelScale;
+		tri.b[i] = dx * SubPixelScale;
+		c[i] = (dy * x[from] - dx * y[from]) + (-dy + dx) * half;
+	}
+
+	// top-left fill rule: samples exactly on an edge belong to the triangle
+	// only if it is a top or a left edge; folding the bias into c turns the
+	// test into e >= 0 for every edge
+	for (int i = 0; i < 3; i++)
+	{
+		const int64_t dx = tri.b[i];
+		const int64_t dy = -tri.a[i];
+		const bool topLeft = (dy == 0 && dx > 0) || dy < 0;
+		tri.c[i] = c[i] + (topLeft ? 0 : -1);
+	}
+
+	// small triangles are culled here when they miss every pixel center,
+	// before the planes are set up
+	const bool small = tri.maxX - tri.minX < BlockSize && tri.maxY - tri.minY < BlockSize &&
+		tri.minX / TileSize == tri.maxX / TileSize && tri.minY / TileSize == tri.maxY / TileSize;
+	tri.coverage = small ? SmallTriangleCoverage(tri) : 0u;
+	if (small && tri.coverage == 0u)
+	{
+		stats.trianglesCulled++;
+		return;
+	}
+
+	// attribute planes, set up from the unbiased edges in double precision
+	const double invArea = 1.0 / double(area);
+	double e[3];
+	for (int i = 0; i < 3; i++)
+	{
+		e[i] = double(tri.a[i] * tri.minX + tri.b[i] * tri.minY + c[i]);
+	}
+	auto setupPlane = [&](const double q[3], float& base, float& dx, float& dy)
+	{
+		double sumDx = 0.0, sumDy = 0.0, sumBase = 0.0;
+		for (int i = 0; i < 3; i++)
+		{
+			sumDx += q[i] * double(tri.a[i]);
+			sumDy += q[i] * double(tri.b[i]);
+			sumBase += q[i] * e[i];
+		}
+		dx = float(sumDx * invArea);
+		dy = float(sumDy * invArea);
+		base = float(sumBase * invArea);
+	};
+	const int planeCount = 1 + int(varyingCount);
+	for (int p = 0; p < planeCount; p++)
+	{
+		double q[3];
+		for (int i = 0; i < 3; i++)
+		{
+			q[i] = p == 0 ? invW[i] : v[i]->varyings[p - 1] * invW[i];
+		}
+		setupPlane(q, tri.planeBase[p], tri.planeDx[p], tri.planeDy[p]);
+	}
+	// z/w is affine in screen space as it is, no perspective divide per pixel
+	if (pDepth && depthMode != DepthMode::Disabled)
+	{
+		setupPlane(depth, tri.depthBase, tri.depthDx, tri.depthDy);
+	}
+
+	stats.trianglesSetup++;
+	batch.triangles.push_back(tri);
+	if (small)
+	{
+		// one tile, nothing to test
+		batch.bins[size_t(tri.minY / TileSize) * tilesX + tri.minX / TileSize].push_back(uint32_t(batch.triangles.size() - 1u));
+		stats.binEntries++;
+		return;
+	}
+	BinTriangle(batch, batch.triangles.back(), stats);
+}
+
+uint64_t SoftwareRasterizer::SmallTriangleCoverage(const Triangle& tri) noexcept
+{
+	// the rows of the bounding box, 8 pixels from minX; like a partial block
+	// with minX,minY as its corner
+	const int columns = (1 << (tri.maxX - tri.minX + 1)) - 1;
+	SimdInt edge[3];
+	for (int i = 0; i < 3; i++)
+	{
+		const int64_t start = tri.a[i] * tri.minX + tri.b[i] * tri.minY + tri.c[i];
+		edge[i] = SimdInt(int32_t(std::clamp(start, -EdgeClamp, EdgeClamp))) + MulLo(SimdInt(int32_t(tri.a[i])), SimdInt::Ramp());
+	}
+	// all 8 rows without a branch, the ones below maxY are masked off
+	uint64_t coverage = 0u;
+	for (int row = 0; row < BlockSize; row++)
+	{
+		coverage |= uint64_t(~MoveMask(edge[0] | edge[1] | edge[2]) & columns) << (row * BlockSize);
+		for (int i = 0; i < 3; i++)
+		{
+			edge[i] += SimdInt(int32_t(tri.b[i]));
+		}
+	}
+	return coverage & (~uint64_t(0) >> ((BlockSize - 1 - (tri.maxY - tri.minY)) * BlockSize));
+}
+
+void SoftwareRasterizer::BinTriangle(Batch& batch, const Triangle& tri, Stats& stats)
+{
+	const uint32_t index = uint32_t(batch.triangles.size() - 1u);
+	const int tx0 = tri.minX / TileSize;
+	const int tx1 = tri.maxX / TileSize;
+	const int ty0 = tri.minY / TileSize;
+	const int ty1 = tri.maxY / TileSize;
+	const bool singleTile = tx0 == tx1 && ty0 == ty1;
+
+	for (int ty = ty0; ty <= ty1; ty++)
+	{
+		for (int tx = tx0; tx <= tx1; tx++)
+		{
+			if (!singleTile)
+			{
+				// skip tiles the bounding box touches but an edge excludes
+				// (large, thin diagonal triangles)
+				const int64_t px = int64_t(tx) * TileSize;
+				const int64_t py = int64_t(ty) * TileSize;
+				bool outside = false;
+				for (int i = 0; i < 3 && !outside; i++)
+				{
+					const int64_t maxCorner = tri.a[i] * px + tri.b[i] * py + tri.c[i] +
+						std::max<int64_t>(0, tri.a[i] * (TileSize - 1)) + std::max<int64_t>(0, tri.b[i] * (TileSize - 1));
+					outside = maxCorner < 0;
+				}
+				if (outside)
+					continue;
+			}
+			batch.bins[size_t(ty) * tilesX + tx].push_back(index);
+			stats.binEntries++;
+		}
+	}
+}
+
+void SoftwareRasterizer::RasterizeTile(unsigned int tile, size_t batchCount, Stats& stats) noexcept
+{
+	const int tileX0 = int(tile % tilesX) * TileSize;
+	const int tileY0 = int(tile / tilesX) * TileSize;
+	const int tileX1 = std::min(tileX0 + TileSize, scissorX1) - 1;
+	const int tileY1 = std::min(tileY0 + TileSize, scissorY1) - 1;
+
+	// batches in submission order keep the draw order of overlapping triangles
+	PendingPixels pending;
+	pending.count = 0;
+	pending.runCount = 0;
+	for (size_t b = 0; b < batchCount; b++)
+	{
+		const Batch& batch = batches[b];
+		for (const uint32_t index : batch.bins[tile])
+		{
+			const Triangle& tri = batch.triangles[index];
+			if (tri.coverage != 0u)
+			{
+				RasterizeSmallTriangle(tri, pending, stats);
+				continue;
+			}
+			// the pixels of earlier small triangles go first
+			ShadePending(pending);
+			RasterizeTriangle(tri, tileX0, tileY0, tileX1, tileY1, stats);
+		}
+	}
+	ShadePending(pending);
+}
+
+void SoftwareRasterizer::RasterizeTriangle(const Triangle& tri, int tileX0, int tileY0, int tileX1, int tileY1, Stats& stats) noexcept
+{
+	const int x0 = std::max(tri.minX, tileX0);
+	const int y0 = std::max(tri.minY, tileY0);
+	const int x1 = std::min(tri.maxX, tileX1);
+	const int y1 = std::min(tri.maxY, tileY1);
+	if (x0 > x1 || y0 > y1)
+	{
+		return;
+	}
+
+	// per lane offsets along a block row and the corner offsets used to
+	// classify a whole block
+	constexpr int64_t BlockSpan = BlockSize - 1;
+	SimdInt laneStep[3];
+	int64_t blockMax[3], blockMin[3];
+	for (int i = 0; i < 3; i++)
+	{
+		laneStep[i] = MulLo(SimdInt(int32_t(tri.a[i])), SimdInt::Ramp());
+		blockMax[i] = std::max<int64_t>(0, tri.a[i] * BlockSpan) + std::max<int64_t>(0, tri.b[i] * BlockSpan);
+		blockMin[i] = std::min<int64_t>(0, tri.a[i] * BlockSpan) + std::min<int64_t>(0, tri.b[i] * BlockSpan);
+	}
+
+	// tiles start on a block boundary, so blocks are aligned to 8 pixels
+	for (int by = y0 & ~(BlockSize - 1); by <= y1; by += BlockSize)
+	{
+		const int rowBegin = std::max(by, y0);
+		const int rowEnd = std::min(by + BlockSize - 1, y1);
+
+		for (int bx = x0 & ~(BlockSize - 1); bx <= x1; bx += BlockSize)
+		{
+			int64_t e[3];
+			bool reject = false;
+			bool full = true;
+			for (int i = 0; i < 3; i++)
+			{
+				e[i] = tri.a[i] * bx + tri.b[i] * by + tri.c[i];
+				reject |= e[i] + blockMax[i] < 0;
+				full &= e[i] + blockMin[i] >= 0;
+			}
+			if (reject)
+			{
+				stats.blocksRejected++;
+				continue;
+			}
+
+			// lanes of the block that are inside the bounding box
+			const int laneBegin = std::max(x0 - bx, 0);
+			const int laneEnd = std::min(x1 - bx, BlockSize - 1);
+			const int columns = ((1 << (laneEnd + 1)) - 1) & ~((1 << laneBegin) - 1);
+
+			if (full)
+			{
+				stats.blocksFull++;
+				for (int y = rowBegin; y <= rowEnd; y++)
+				{
+					ShadeRow(tri, bx, y, columns, stats);
+				}
+				continue;
+			}
+
+			// partial block: edge values for the 8 pixels of a row, stepped
+			// down the block; the sign bit of e0|e1|e2 marks outside pixels
+			stats.blocksPartial++;
+			SimdInt edge[3];
+			for (int i = 0; i < 3; i++)
+			{
+				const int64_t start = e[i] + tri.b[i] * (rowBegin - by);
+				edge[i] = SimdInt(int32_t(std::clamp(start, -EdgeClamp, EdgeClamp))) + laneStep[i];
+			}
+			for (int y = rowBegin; y <= rowEnd; y++)
+			{
+				const int coverage = ~MoveMask(edge[0] | edge[1] | edge[2]) & columns;
+				if (coverage != 0)
+				{
+					ShadeRow(tri, bx, y, coverage, stats);
+				}
+				for (int i = 0; i < 3; i++)
+				{
+					edge[i] += SimdInt(int32_t(tri.b[i]));
+				}
+			}
+		}
+	}
+}
+
+void SoftwareRasterizer::RasterizeSmallTriangle(const Triangle& tri, PendingPixels& pending, Stats& stats) noexcept
+{
+	// a small triangle lies in one tile, its coverage is known from setup
+	stats.blocksPartial++;
+	uint64_t coverage = tri.coverage;
+	if (pDepth && depthMode != DepthMode::Disabled)
+	{
+		uint64_t passed = 0u;
+		for (uint64_t rows = coverage; rows != 0u; )
+		{
+			const int row = std::countr_zero(rows) / BlockSize;
+			const int rowCoverage = int(rows >> (row * BlockSize)) & 0xFF;
+			rows &= ~(uint64_t(0xFF) << (row * BlockSize));
+			const int rowPassed = DepthTestRow(tri, tri.minX, tri.minY + row, rowCoverage, stats);
+			passed |= uint64_t(rowPassed) << (row * BlockSize);
+		}
+		coverage = passed;
+	}
+	stats.pixelsWritten += unsigned(std::popcount(coverage));
+	if (!pColor || !pPixelShader)
+	{
+		return;
+	}
+
+	// every pixel gets the inputs ShadeRow would give its lane; the planes
+	// are spread over the lanes of the triangle's run when they are shaded
+	if (coverage == 0u)
+	{
+		return;
+	}
+	pending.runTriangle[pending.runCount] = &tri;
+	pending.runStart[pending.runCount++] = pending.count;
+	for (; coverage != 0u; coverage &= coverage - 1u)
+	{
+		const int bit = std::countr_zero(coverage);
+		const int row = bit / BlockSize;
+		const int column = bit % BlockSize;
+		const int slot = pending.count;
+		pending.px[slot] = float(column);
+		pending.py[slot] = float(row);
+		pending.pTarget[slot] = pColor + size_t(tri.minY + row) * width + tri.minX + column;
+		if (++pending.count == SimdWidth)
+		{
+			ShadePending(pending);
+			if ((coverage & (coverage - 1u)) != 0u)
+			{
+				pending.runTriangle[pending.runCount] = &tri;
+				pending.runStart[pending.runCount++] = 0;
+			}
+		}
+	}
+}
+
+void SoftwareRasterizer::ShadePending(PendingPixels& pending) noexcept
+{
+	const int count = pending.count;
+	if (count == 0)
+	{
+		return;
+	}
+	const int runCount = pending.runCount;
+	pending.count = 0;
+	pending.runCount = 0;
+	// unused lanes repeat the last pixel, they belong to the last run
+	for (int slot = count; slot < SimdWidth; slot++)
+	{
+		pending.px[slot] = pending.px[count - 1];
+		pending.py[slot] = pending.py[count - 1];
+	}
+
+	// the first run starts at lane 0, every later one overwrites the lanes
+	// from its start on
+	SimdInt runMask[SimdWidth];
+	for (int r = 1; r < runCount; r++)
+	{
+		runMask[r] = CmpGt(SimdInt::Ramp(), SimdInt(pending.runStart[r] - 1));
+	}
+	auto spread = [&](auto value)
+	{
+		SimdFloat v(value(*pending.runTriangle[0]));
+		for (int r = 1; r < runCount; r++)
+		{
+			v = Select(runMask[r], v, SimdFloat(value(*pending.runTriangle[r])));
+		}
+		return v;
+	};
+
+	const SimdFloat px = SimdFloat::Load(pending.px);
+	const SimdFloat py = SimdFloat::Load(pending.py);
+	auto plane = [&](unsigned int p)
+	{
+		return MulAdd(spread([p](const Triangle& tri) { return tri.planeDx[p]; }), px,
+					  MulAdd(spread([p](const Triangle& tri) { return tri.planeDy[p]; }), py,
+							 spread([p](const Triangle& tri) { return tri.planeBase[p]; })));
+	};
+	const SimdFloat w = SimdFloat(1.0f) / plane(0u);
+
+	CpuPixelInput in;
+	in.position[0] = px + spread([](const Triangle& tri) { return float(tri.minX) + 0.5f; });
+	in.position[1] = (py + spread([](const Triangle& tri) { return float(tri.minY); })) + 0.5f;
+	for (unsigned int v = 0; v < varyingCount; v++)
+	{
+		in.varyings[v] = plane(v + 1u) * w;
+	}
+	int32_t pixels[SimdWidth];
+	RunPixelShader(in).Store(pixels);
+	for (int slot = 0; slot < count; slot++)
+	{
+		*pending.pTarget[slot] = uint32_t(pixels[slot]);
+	}
+}
+
+int SoftwareRasterizer::DepthTestRow(const Triangle& tri, int x, int y, int coverage, Stats& stats) noexcept
+{
+	const SimdFloat px = SimdFloat::Ramp() + SimdFloat(float(x - tri.minX));
+	const SimdFloat py = SimdFloat(float(y - tri.minY));
+	const bool rowInside = x + BlockSize <= int(width);
+
+	const SimdFloat z = MulAdd(SimdFloat(tri.depthDx), px, MulAdd(SimdFloat(tri.depthDy), py, SimdFloat(tri.depthBase)));
+	float* pDepthRow = pDepth + size_t(y) * width + x;
+	// rows reaching past the right edge of the target go through a copy
+	float edgeRow[SimdWidth] = {};
+	if (!rowInside)
+	{
+		std::copy(pDepthRow, pDepthRow + (int(width) - x), edgeRow);
+	}
+	const SimdFloat stored = SimdFloat::Load(rowInside ? pDepthRow : edgeRow);
+
+	// reversed Z: nearer is greater
+	const SimdInt pass = depthMode == DepthMode::TestEqual ? CmpGe(z, stored) & CmpLe(z, stored) : CmpGe(z, stored);
+	const int passed = coverage & MoveMask(pass);
+	stats.pixelsDepthFailed += unsigned(std::popcount(unsigned(coverage & ~passed)));
+	if (passed != 0 && depthMode == DepthMode::TestWrite)
+	{
+		const SimdFloat written = Select(CoverageMask(passed), stored, z);
+		if (rowInside)
+		{
+			written.Store(pDepthRow);
+		}
+		else
+		{
+			written.Store(edgeRow);
+			std::copy(edgeRow, edgeRow + (int(width) - x), pDepthRow);
+		}
+	}
+	return passed;
+}
+
+SimdInt SoftwareRasterizer::RunPixelShader(CpuPixelInput& in) const noexcept
+{
+	// inputs the vertex shader did not write
+	for (unsigned int v = varyingCount; v < pPixelShader->varyingCount; v++)
+	{
+		in.varyings[v] = SimdFloat(0.0f);
+	}
+	CpuPixelOutput out;
+	pPixelShader->main(in, out);
+
+	// SV_Target to the B8G8R8A8_UNORM target
+	auto toUNorm = [](SimdFloat c)
+	{
+		return TruncToInt(MulAdd(Clamp(c, SimdFloat(0.0f), SimdFloat(1.0f)), SimdFloat(255.0f), SimdFloat(0.5f)));
+	};
+	return toUNorm(out.color[2]) | ShiftLeft<8>(toUNorm(out.color[1])) |
+		ShiftLeft<16>(toUNorm(out.color[0])) | ShiftLeft<24>(toUNorm(out.color[3]));
+}
+
+void SoftwareRasterizer::ShadeRow(const Triangle& tri, int x, int y, int coverage, Stats& stats) noexcept
+{
+	if (pDepth && depthMode != DepthMode::Disabled)
+	{
+		coverage = DepthTestRow(tri, x, y, coverage, stats);
+		if (coverage == 0)
+		{
+			return;
+		}
+	}
+	stats.pixelsWritten += unsigned(std::popcount(unsigned(coverage)));
+	if (!pColor || !pPixelShader)
+	{
+		return;
+	}
+
+	// perspective correct interpolation: 1/w and varying/w are affine in
+	// screen space, divide by the interpolated 1/w per pixel
+	const SimdFloat px = SimdFloat::Ramp() + SimdFloat(float(x - tri.minX));
+	const SimdFloat py = SimdFloat(float(y - tri.minY));
+	auto plane = [&](unsigned int p)
+	{
+		return MulAdd(SimdFloat(tri.planeDx[p]), px, MulAdd(SimdFloat(tri.planeDy[p]), py, SimdFloat(tri.planeBase[p])));
+	};
+	const SimdFloat w = SimdFloat(1.0f) / plane(0u);
+
+	CpuPixelInput in;
+	in.position[0] = SimdFloat::Ramp() + SimdFloat(float(x) + 0.5f);
+	in.position[1] = SimdFloat(float(y) + 0.5f);
+	for (unsigned int v = 0; v < varyingCount; v++)
+	{
+		in.varyings[v] = plane(v + 1u) * w;
+	}
+	const SimdInt color = RunPixelShader(in);
+
+	uint32_t* pRow = pColor + size_t(y) * width + x;
+	if (coverage == 0xFF)
+	{
+		color.Store(pRow);
+		return;
+	}
+	if (x + BlockSize <= int(width))
+	{
+		// read-modify-write of the whole row, lane i is replaced when bit i
+		// of coverage is set
+		const SimdInt old = SimdInt::Load(reinterpret_cast<const int32_t*>(pRow));
+		Select(CoverageMask(coverage), old, color).Store(pRow);
+		return;
+	}
+
+	// the row reaches past the right edge of the target
+	int32_t pixels[SimdWidth];
+	color.Store(pixels);
+	for (int mask = coverage; mask != 0; mask &= mask - 1)
+	{
+		const int lane = std::countr_zero(unsigned(mask));
+		pRow[lane] = uint32_t(pixels[lane]);
+	}
+}
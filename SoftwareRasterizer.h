@@ -0,0 +1,182 @@
+#pragma once
+#include "RenderDevice.h"
+#include "CpuShader.h"
+#include "JobSystem.h"
+#include <cstdint>
+#include <vector>
+
+// Tile based triangle rasterizer used by the SoftwareRenderDevice.
+//
+// A draw goes through three phases:
+//  1. setup   - triangles are clipped (depth range and a guard band), snapped
+//               to 1/16 pixel, culled and turned into edge equations and
+//               interpolation planes. Batches of triangles are set up in
+//               parallel and each batch bins its triangles into the 64x64
+//               screen tiles they touch.
+//  2. raster  - tiles are handed out to the worker threads. A thread walks
+//               the bins of its tile in submission order, so the result does
+//               not depend on the thread count.
+//  3. inside a tile every triangle is visited in 8x8 pixel blocks. A block
+//               is rejected or accepted as a whole from its corners, and only
+//               blocks straddling an edge evaluate the edge functions per
+//               pixel, 8 pixels (one row of the block) at a time with the
+//               SIMD types from Simd.h. Covered rows are interpolated once and
+//               shaded with one call of the CpuPixelShader.
+//
+// Small triangles, whose pixel bounds are at most 8x8 and inside one tile,
+// take a shorter way: setup finds their coverage right away (and culls them
+// when it is empty, before the attribute planes) and puts them in their
+// tile's bin directly. The tile skips the block walk for them and packs the
+// covered pixels of consecutive small triangles into the lanes of one
+// pixel shader call.
+//
+// Draws of more than a few thousand triangles go through setup and raster
+// in passes of that many, so the set up triangles are still in the cache
+// when the tiles read them.
+//
+// With a depth buffer and a DepthMode other than Disabled every row is
+// depth tested before it is shaded (early Z; the CPU pixel shaders cannot
+// discard or write depth, so the result is the same as testing late). Depth
+// is z/w, interpolated linearly in screen space like D3D does. Without a
+// color target only depth is written, which is what a depth prepass needs.
+//
+// Edge functions are exact integer math (64 bit during setup, 32 bit inside
+// a block), so shared edges never crack or double-hit. Rules follow D3D:
+// clockwise front faces, back faces culled, top-left fill convention.
+class SoftwareRasterizer
+{
+public:
+	static constexpr int TileSize		= 64;
+	static constexpr int BlockSize		= 8;
+	static constexpr int SubPixelBits	= 4;
+	static constexpr int MaxVaryings	= CpuShaderMaxVaryings;
+
+	// clip-space vertex as produced by the vertex stage
+	struct Vertex
+	{
+		float position[4];
+		float varyings[MaxVaryings];
+	};
+
+	struct Stats
+	{
+		uint64_t trianglesSubmitted	{ 0u };
+		uint64_t trianglesClipped	{ 0u };	// needed polygon clipping
+		// after clipping (one clipped triangle can become several):
+		uint64_t trianglesCulled	{ 0u };	// back-facing, degenerate, outside or between pixel centers
+		uint64_t trianglesSetup		{ 0u };	// reached binning
+		uint64_t binEntries			{ 0u };	// (triangle, tile) pairs
+		uint64_t blocksRejected		{ 0u };
+		uint64_t blocksFull			{ 0u };
+		uint64_t blocksPartial		{ 0u };
+		uint64_t pixelsWritten		{ 0u };	// passed the depth test
+		uint64_t pixelsDepthFailed	{ 0u };
+	};
+
+public:
+	explicit SoftwareRasterizer(JobSystem& jobs);
+	SoftwareRasterizer(const SoftwareRasterizer&) = delete;
+	SoftwareRasterizer& operator=(const SoftwareRasterizer&) = delete;
+
+	// BGRA8 color target, rows are `width` pixels apart; nullptr draws depth only
+	void SetRenderTarget(uint32_t* pColor, unsigned int width, unsigned int height);
+	// float depth buffer the size of the render target, nullptr = none
+	void SetDepthBuffer(float* pDepth) noexcept { this->pDepth = pDepth; }
+	void SetDepthMode(DepthMode mode) noexcept { depthMode = mode; }
+	void SetViewport(const Viewport& viewport) noexcept;
+	void SetPixelShader(const CpuPixelShader* pShader) noexcept { pPixelShader = pShader; }
+
+	// rasterizes an indexed triangle list; the first varyingCount varyings
+	// are clipped, interpolated and handed to the pixel shader
+	void DrawTriangles(const Vertex* pVertices, const uint32_t* pIndices, size_t triangleCount, unsigned int varyingCount);
+
+	Stats	GetStats() const noexcept;
+	void	ResetStats() noexcept;
+
+private:
+	// interpolated quantities: 1/w followed by varying/w
+	static constexpr int MaxPlanes = MaxVaryings + 1;
+
+	struct Triangle
+	{
+		// inclusive pixel bounds, already clipped to the scissor rectangle
+		int32_t minX, minY, maxX, maxY;
+		// edge functions in pixel units: e = a*px + b*py + c, inside when >= 0;
+		// c includes the pixel center offset and the fill rule bias
+		int64_t a[3], b[3], c[3];
+		// planes relative to (minX,minY): q = base + dx*(px-minX) + dy*(py-minY)
+		float planeBase[MaxPlanes];
+		float planeDx[MaxPlanes];
+		float planeDy[MaxPlanes];
+		// z/w, relative to (minX,minY) like the planes
+		float depthBase, depthDx, depthDy;
+		// small triangles only: byte r holds the coverage of row minY+r, bit i
+		// pixel minX+i; 0 for triangles that go through the block walk
+		uint64_t coverage;
+	};
+
+	// per setup batch output: triangles and per-tile lists into them
+	struct Batch
+	{
+		std::vector<Triangle> triangles;
+		std::vector<std::vector<uint32_t>> bins;
+	};
+
+	// pixels of small triangles waiting for the pixel shader, one per lane;
+	// the lanes from runStart[r] on belong to runTriangle[r], so one shader
+	// call serves several triangles
+	struct alignas(32) PendingPixels
+	{
+		float px[SimdWidth];	// relative to the triangle's minX,minY
+		float py[SimdWidth];
+		uint32_t* pTarget[SimdWidth];
+		const Triangle* runTriangle[SimdWidth];
+		int runStart[SimdWidth];
+		int runCount;
+		int count;
+	};
+
+	// per thread counters, padded so threads do not share cache lines
+	struct alignas(64) ThreadStats
+	{
+		Stats stats;
+	};
+
+private:
+	void SetupBatch(Batch& batch, const Vertex* pVertices, const uint32_t* pIndices,
+					size_t begin, size_t end, Stats& stats);
+	void SetupTriangle(Batch& batch, const Vertex& v0, const Vertex& v1, const Vertex& v2, Stats& stats);
+	static uint64_t SmallTriangleCoverage(const Triangle& tri) noexcept;
+	void BinTriangle(Batch& batch, const Triangle& tri, Stats& stats);
+	void RasterizeTile(unsigned int tile, size_t batchCount, Stats& stats) noexcept;
+	void RasterizeTriangle(const Triangle& tri, int tileX0, int tileY0, int tileX1, int tileY1, Stats& stats) noexcept;
+	void RasterizeSmallTriangle(const Triangle& tri, PendingPixels& pending, Stats& stats) noexcept;
+	void ShadeRow(const Triangle& tri, int x, int y, int coverage, Stats& stats) noexcept;
+	void ShadePending(PendingPixels& pending) noexcept;
+	int DepthTestRow(const Triangle& tri, int x, int y, int coverage, Stats& stats) noexcept;
+	SimdInt RunPixelShader(CpuPixelInput& in) const noexcept;
+
+private:
+	JobSystem& jobs;
+
+	uint32_t*		pColor		{ nullptr };
+	unsigned int	width		{ 0u };
+	unsigned int	height		{ 0u };
+	unsigned int	tilesX		{ 0u };
+	unsigned int	tilesY		{ 0u };
+	float*			pDepth		{ nullptr };
+	DepthMode		depthMode	{ DepthMode::Disabled };
+
+	Viewport		viewport;
+	// scissor rectangle = viewport clipped to the target, [x0,x1) x [y0,y1)
+	int				scissorX0	{ 0 };
+	int				scissorY0	{ 0 };
+	int				scissorX1	{ 0 };
+	int				scissorY1	{ 0 };
+
+	const CpuPixelShader*	pPixelShader	{ nullptr };
+	unsigned int			varyingCount	{ 0u };
+
+	std::vector<Batch>			batches;
+	std::vector<ThreadStats>	threadStats;
+};
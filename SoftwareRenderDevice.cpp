@@ -0,0 +1,536 @@
+#include "SoftwareRenderDevice.h"
+#include "Half.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	// Reads one vertex element and expands it to 4 components the way the
+	// input assembler does: missing components default to (0,0,0,1).
+	void ReadElement(ElementFormat format, const unsigned char* pData, float out[4]) noexcept
+	{
+		out[0] = 0.0f; out[1] = 0.0f; out[2] = 0.0f; out[3] = 1.0f;
+		switch (format)
+		{
+		case ElementFormat::R32G32_Float:
+			std::memcpy(out, pData, 2 * sizeof(float));
+			break;
+		case ElementFormat::R32G32B32_Float:
+			std::memcpy(out, pData, 3 * sizeof(float));
+			break;
+		case ElementFormat::R32G32B32A32_Float:
+			std::memcpy(out, pData, 4 * sizeof(float));
+			break;
+		case ElementFormat::R8G8B8A8_UNorm:
+			for (int i = 0; i < 4; i++)
+			{
+				out[i] = pData[i] * (1.0f / 255.0f);
+			}
+			break;
+		// signed normalized: both -MAX and -MAX - 1 are -1
+		case ElementFormat::R8G8B8A8_SNorm:
+			for (int i = 0; i < 4; i++)
+			{
+				out[i] = std::max(float(int8_t(pData[i])) * (1.0f / 127.0f), -1.0f);
+			}
+			break;
+		case ElementFormat::R16G16_SNorm:
+			for (int i = 0; i < 2; i++)
+			{
+				int16_t v;
+				std::memcpy(&v, pData + i * sizeof(v), sizeof(v));
+				out[i] = std::max(float(v) * (1.0f / 32767.0f), -1.0f);
+			}
+			break;
+		case ElementFormat::R16G16_Float:
+			for (int i = 0; i < 2; i++)
+			{
+				Half v;
+				std::memcpy(&v.bits, pData + i * sizeof(v.bits), sizeof(v.bits));
+				out[i] = HalfToFloat(v);
+			}
+			break;
+		case ElementFormat::R16G16B16A16_UNorm:
+			for (int i = 0; i < 4; i++)
+			{
+				uint16_t v;
+				std::memcpy(&v, pData + i * sizeof(v), sizeof(v));
+				out[i] = float(v) * (1.0f / 65535.0f);
+			}
+			break;
+		}
+	}
+
+	size_t ElementSize(ElementFormat format) noexcept
+	{
+		switch (format)
+		{
+		case ElementFormat::R32G32_Float:		return 2 * sizeof(float);
+		case ElementFormat::R32G32B32_Float:	return 3 * sizeof(float);
+		case ElementFormat::R32G32B32A32_Float:	return 4 * sizeof(float);
+		case ElementFormat::R8G8B8A8_UNorm:		return 4u;
+		case ElementFormat::R8G8B8A8_SNorm:		return 4u;
+		case ElementFormat::R16G16_SNorm:		return 4u;
+		case ElementFormat::R16G16_Float:		return 4u;
+		case ElementFormat::R16G16B16A16_UNorm:	return 8u;
+		}
+		return 0u;
+	}
+
+	// vertices per vertex-stage job
+	constexpr size_t VertexGrain = 1024u;
+	// vertices of the instances drawn together by one DrawIndexedInstanced()
+	// step; more instances than fit are drawn in several
+	constexpr size_t InstanceChunkVertices = 65536u;
+	// output rows per resolve job
+	constexpr size_t ResolveGrain = 16u;
+}
+
+SoftwareRenderDevice::SoftwareRenderDevice(unsigned int width, unsigned int height, unsigned int threadCount)
+	: width(width), height(height),
+	backBuffer(size_t(width) * height, 0u),
+	frontBuffer(size_t(width) * height, 0u),
+	depthBuffer(size_t(width) * height, 0.0f),
+	jobs(threadCount),
+	rasterizer(jobs)
+{
+	viewport.width = float(width);
+	viewport.height = float(height);
+	BindRasterTarget();
+}
+
+BufferHandle SoftwareRenderDevice::CreateBuffer(const BufferDesc& desc)
+{
+	Buffer buffer;
+	buffer.type = desc.type;
+	buffer.data.resize(desc.byteWidth);
+	if (desc.pInitialData)
+	{
+		std::memcpy(buffer.data.data(), desc.pInitialData, desc.byteWidth);
+	}
+	buffers.push_back(std::move(buffer));
+	return BufferHandle{ uint32_t(buffers.size() - 1) };
+}
+
+VertexShaderHandle SoftwareRenderDevice::CreateVertexShader(const ShaderBytecode& bytecode)
+{
+	// the bytecode itself is not run, only its C++ port
+	vertexShaders.push_back(CpuShaderRegistry::FindVertexShader(bytecode.name));
+	return VertexShaderHandle{ uint32_t(vertexShaders.size() - 1) };
+}
+
+PixelShaderHandle SoftwareRenderDevice::CreatePixelShader(const ShaderBytecode& bytecode)
+{
+	pixelShaders.push_back(CpuShaderRegistry::FindPixelShader(bytecode.name));
+	return PixelShaderHandle{ uint32_t(pixelShaders.size() - 1) };
+}
+
+InputLayoutHandle SoftwareRenderDevice::CreateInputLayout(const InputElementDesc* pElements, unsigned int count,
+														  const ShaderBytecode&)
+{
+	InputLayout layout;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const InputElementDesc& e = pElements[i];
+		layout.elements.push_back({ e.semanticName, e.semanticIndex, e.format, e.inputSlot, e.alignedByteOffset,
+									e.classification == InputClassification::PerInstance, e.instanceDataStepRate });
+	}
+	inputLayouts.push_back(std::move(layout));
+	return InputLayoutHandle{ uint32_t(inputLayouts.size() - 1) };
+}
+
+void SoftwareRenderDevice::SetVertexBuffer(unsigned int slot, BufferHandle buffer, unsigned int stride, unsigned int offset)
+{
+	vertexBuffers[slot] = { buffer, stride, offset };
+}
+
+void SoftwareRenderDevice::SetIndexBuffer(BufferHandle buffer, IndexFormat format, unsigned int offset)
+{
+	indexBuffer = buffer;
+	indexFormat = format;
+	indexOffset = offset;
+}
+
+void SoftwareRenderDevice::SetVertexShader(VertexShaderHandle shader)
+{
+	vertexShader = shader;
+}
+
+void SoftwareRenderDevice::SetPixelShader(PixelShaderHandle shader)
+{
+	pixelShader = shader;
+}
+
+void SoftwareRenderDevice::SetInputLayout(InputLayoutHandle layout)
+{
+	inputLayout = layout;
+}
+
+void SoftwareRenderDevice::SetBackBufferTarget()
+{
+	targetBound = true;
+	depthOnly = false;
+	BindRasterTarget();
+}
+
+void SoftwareRenderDevice::SetDepthOnlyTarget()
+{
+	targetBound = true;
+	depthOnly = true;
+	BindRasterTarget();
+}
+
+void SoftwareRenderDevice::SetDepthMode(DepthMode mode)
+{
+	depthMode = mode;
+	rasterizer.SetDepthMode(mode);
+}
+
+void SoftwareRenderDevice::SetPrimitiveTopology(PrimitiveTopology)
+{}
+
+void SoftwareRenderDevice::SetViewport(const Viewport& vp)
+{
+	viewport = vp;
+	BindRasterTarget();
+}
+
+void* SoftwareRenderDevice::Map(BufferHandle buffer, MapMode)
+{
+	// draws complete before DrawIndexed() returns, so nothing is ever in
+	// flight and both modes can write the storage directly
+	return buffers[buffer.id].data.data();
+}
+
+void SoftwareRenderDevice::Unmap(BufferHandle)
+{}
+
+void SoftwareRenderDevice::ClearBackBuffer(const float color[4])
+{
+	std::vector<uint32_t>& target = sampleCount > 1u ? sampleBuffer : backBuffer;
+	std::fill(target.begin(), target.end(), PackColor(color[0], color[1], color[2], color[3]));
+}
+
+void SoftwareRenderDevice::ClearDepth(float depth)
+{
+	std::fill(depthBuffer.begin(), depthBuffer.end(), depth);
+}
+
+void SoftwareRenderDevice::DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+{
+	// per-instance elements read instance 0, as in D3D
+	DrawIndexedInstanced(indexCount, 1u, startIndex, baseVertex, 0u);
+}
+
+void SoftwareRenderDevice::DrawIndexedInstancedIndirect(BufferHandle args, unsigned int byteOffset)
+{
+	// the arguments are read when the draw runs, as on the GPU; out of range
+	// reads draw nothing
+	if (!args.IsValid() || size_t(byteOffset) + sizeof(DrawIndexedIndirectArgs) > buffers[args.id].data.size())
+	{
+		return;
+	}
+	DrawIndexedIndirectArgs a;
+	std::memcpy(&a, buffers[args.id].data.data() + byteOffset, sizeof(a));
+	DrawIndexedInstanced(a.indexCountPerInstance, a.instanceCount, a.startIndexLocation, a.baseVertexLocation,
+						 a.startInstanceLocation);
+}
+
+void SoftwareRenderDevice::DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount,
+												unsigned int startIndex, int baseVertex, unsigned int startInstance)
+{
+	// like D3D, drawing without the required state bound is a no-op; a
+	// depth only target needs no pixel shader and runs none
+	if (!targetBound || !inputLayout.IsValid() || !indexBuffer.IsValid() ||
+		!vertexShader.IsValid() || (!pixelShader.IsValid() && !depthOnly))
+	{
+		return;
+	}
+	const CpuVertexShader* pVS = vertexShaders[vertexShader.id];
+	const CpuPixelShader* pPS = depthOnly ? nullptr : pixelShaders[pixelShader.id];
+	if (!pVS || (!pPS && !depthOnly))
+	{
+		return;
+	}
+
+	// match the shader inputs to the layout by semantic, as the input
+	// assembler does
+	const InputLayout& layout = inputLayouts[inputLayout.id];
+	int inputElements[CpuShaderMaxInputs];
+	for (unsigned int i = 0; i < pVS->inputCount; i++)
+	{
+		inputElements[i] = -1;
+		for (size_t e = 0; e < layout.elements.size(); e++)
+		{
+			if (layout.elements[e].semanticIndex == pVS->inputSemanticIndices[i] &&
+				layout.elements[e].semanticName == pVS->inputSemantics[i])
+			{
+				inputElements[i] = int(e);
+				break;
+			}
+		}
+	}
+
+	const std::vector<unsigned char>& indexData = buffers[indexBuffer.id].data;
+	const size_t indexSize = indexFormat == IndexFormat::R16_UInt ? 2u : 4u;
+	const unsigned int triangleCount = indexCount / 3u;
+	if (triangleCount == 0u || instanceCount == 0u)
+	{
+		return;
+	}
+
+	// resolve the indices first so every referenced vertex is shaded exactly
+	// once, then only the [minIndex,maxIndex] range the draw touches
+	drawIndices.resize(size_t(triangleCount) * 3u);
+	uint32_t minIndex = UINT32_MAX;
+	uint32_t maxIndex = 0u;
+	for (size_t i = 0; i < drawIndices.size(); i++)
+	{
+		const size_t at = indexOffset + (startIndex + i) * indexSize;
+		uint32_t index = 0u;
+		if (at + indexSize <= indexData.size())
+		{
+			if (indexSize == 2u)
+			{
+				uint16_t index16;
+				std::memcpy(&index16, &indexData[at], sizeof(index16));
+				index = index16;
+			}
+			else
+			{
+				std::memcpy(&index, &indexData[at], sizeof(index));
+			}
+		}
+		index = uint32_t(int64_t(index) + baseVertex);
+		drawIndices[i] = index;
+		minIndex = std::min(minIndex, index);
+		maxIndex = std::max(maxIndex, index);
+	}
+	for (uint32_t& index : drawIndices)
+	{
+		index -= minIndex;
+	}
+
+	// the back buffer moves on every Present()
+	BindRasterTarget();
+	rasterizer.SetPixelShader(pPS);
+
+	// Instances are drawn in chunks of several: their vertices shaded
+	// side by side, their triangles rasterized by one DrawTriangles() call,
+	// in instance order as on a GPU.
+	const size_t vertexCount = size_t(maxIndex - minIndex) + 1u;
+	const unsigned int chunkInstances = unsigned(std::clamp<size_t>(InstanceChunkVertices / vertexCount, 1u, instanceCount));
+	const size_t blocksPerInstance = (vertexCount + SimdWidth - 1u) / SimdWidth;
+	drawVertices.resize(vertexCount * chunkInstances);
+	if (chunkInstances > 1u)
+	{
+		const size_t indices = drawIndices.size();
+		drawIndices.resize(indices * chunkInstances);
+		for (unsigned int instance = 1u; instance < chunkInstances; instance++)
+		{
+			const uint32_t first = uint32_t(instance * vertexCount);
+			for (size_t i = 0; i < indices; i++)
+			{
+				drawIndices[instance * indices + i] = drawIndices[i] + first;
+			}
+		}
+	}
+	drawStartInstance = startInstance;
+	for (unsigned int firstInstance = 0u; firstInstance < instanceCount; firstInstance += chunkInstances)
+	{
+		const unsigned int instances = std::min(chunkInstances, instanceCount - firstInstance);
+		jobs.ParallelFor(blocksPerInstance * instances, VertexGrain / SimdWidth, [&](size_t begin, size_t end, unsigned int)
+		{
+			for (size_t block = begin; block < end; block++)
+			{
+				const size_t instance = block / blocksPerInstance;
+				const size_t v = (block % blocksPerInstance) * SimdWidth;
+				ShadeVertices(*pVS, layout, inputElements, minIndex + uint32_t(v), firstInstance + unsigned(instance),
+							  std::min<size_t>(SimdWidth, vertexCount - v), &drawVertices[instance * vertexCount + v]);
+			}
+		});
+		rasterizer.DrawTriangles(drawVertices.data(), drawIndices.data(), triangleCount * instances,
+								 pPS ? std::min(pVS->varyingCount, pPS->varyingCount) : 0u);
+	}
+	depthWritten |= depthMode == DepthMode::TestWrite;
+}
+
+void SoftwareRenderDevice::Present()
+{
+	if (sampleCount > 1u)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		jobs.ParallelFor(height, ResolveGrain, [this](size_t begin, size_t end, unsigned int)
+		{
+			ResolveSamples(sampleBuffer.data(), backBuffer.data(), width, height, sampleCount, resolveFilter,
+						   unsigned(begin), unsigned(end));
+		});
+		resolveStats.resolves++;
+		resolveStats.pixels += uint64_t(width) * height;
+		resolveStats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+	if (depthWritten)
+	{
+		const SampleGrid grid = GetSampleGrid(sampleCount);
+		depthPyramid.Build(depthBuffer.data(), width * grid.x, height * grid.y, &jobs);
+		depthWritten = false;
+	}
+
+	// the back buffer content is undefined after a present (DISCARD)
+	backBuffer.swap(frontBuffer);
+	presentCount++;
+}
+
+void SoftwareRenderDevice::SetPresentMode(PresentMode mode, unsigned int)
+{
+	presentMode = mode;
+}
+
+void SoftwareRenderDevice::Resize(unsigned int width, unsigned int height)
+{
+	this->width = width;
+	this->height = height;
+	// both buffers start out black, the content is not scaled over
+	backBuffer.assign(size_t(width) * height, 0u);
+	frontBuffer.assign(size_t(width) * height, 0u);
+	backBuffer.shrink_to_fit();
+	frontBuffer.shrink_to_fit();
+	// the sample image follows, SetSampleCount() also unbinds the target
+	SetSampleCount(sampleCount);
+}
+
+unsigned int SoftwareRenderDevice::SetSampleCount(unsigned int count)
+{
+	sampleCount = 8u;
+	while (sampleCount > count && sampleCount > 1u)
+	{
+		sampleCount /= 2u;
+	}
+
+	// only the sample image depends on the count
+	const SampleGrid grid = GetSampleGrid(sampleCount);
+	sampleBuffer.assign(sampleCount > 1u ? size_t(width) * grid.x * height * grid.y : 0u, 0u);
+	sampleBuffer.shrink_to_fit();
+	depthBuffer.assign(size_t(width) * grid.x * height * grid.y, 0.0f);
+	depthBuffer.shrink_to_fit();
+	BindRasterTarget();
+	targetBound = false;
+	return sampleCount;
+}
+
+void SoftwareRenderDevice::BindRasterTarget()
+{
+	const SampleGrid grid = GetSampleGrid(sampleCount);
+	uint32_t* pColor = sampleCount > 1u ? sampleBuffer.data() : backBuffer.data();
+	rasterizer.SetRenderTarget(depthOnly ? nullptr : pColor, width * grid.x, height * grid.y);
+	rasterizer.SetDepthBuffer(depthBuffer.data());
+	Viewport vp = viewport;
+	vp.topLeftX *= float(grid.x);
+	vp.width *= float(grid.x);
+	vp.topLeftY *= float(grid.y);
+	vp.height *= float(grid.y);
+	rasterizer.SetViewport(vp);
+}
+
+bool SoftwareRenderDevice::SaveFrontBuffer(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+
+	auto put16 = [&](uint16_t v) { file.put(char(v & 0xFF)).put(char(v >> 8)); };
+	auto put32 = [&](uint32_t v) { put16(uint16_t(v & 0xFFFF)); put16(uint16_t(v >> 16)); };
+
+	const uint32_t pixelBytes = uint32_t(frontBuffer.size() * sizeof(uint32_t));
+	// BITMAPFILEHEADER
+	put16(0x4D42); put32(14u + 40u + pixelBytes); put32(0u); put32(14u + 40u);
+	// BITMAPINFOHEADER, negative height = rows stored top-down
+	put32(40u); put32(width); put32(uint32_t(-int32_t(height)));
+	put16(1u); put16(32u); put32(0u); put32(pixelBytes);
+	put32(2835u); put32(2835u); put32(0u); put32(0u);
+
+	// BGRA8 is exactly the byte order a 32 bit bitmap uses
+	for (const uint32_t pixel : frontBuffer)
+	{
+		put32(pixel);
+	}
+	return bool(file);
+}
+
+uint32_t SoftwareRenderDevice::PackColor(float r, float g, float b, float a) noexcept
+{
+	auto toUNorm = [](float v) -> uint32_t
+	{
+		return uint32_t(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+	};
+	return toUNorm(b) | (toUNorm(g) << 8) | (toUNorm(r) << 16) | (toUNorm(a) << 24);
+}
+
+void SoftwareRenderDevice::FetchElement(const InputLayout::Element& element, unsigned int index, unsigned int instance,
+										float out[4]) const noexcept
+{
+	const VertexBufferBinding& binding = vertexBuffers[element.inputSlot];
+	out[0] = 0.0f; out[1] = 0.0f; out[2] = 0.0f; out[3] = 1.0f;
+	if (!binding.buffer.IsValid())
+		return;
+	if (element.perInstance)
+	{
+		// the step rate divides the instance's number within the draw
+		index = drawStartInstance + (element.instanceDataStepRate ? instance / element.instanceDataStepRate : 0u);
+	}
+	const std::vector<unsigned char>& data = buffers[binding.buffer.id].data;
+	const size_t at = binding.offset + size_t(index) * binding.stride + element.alignedByteOffset;
+	if (at + ElementSize(element.format) <= data.size())
+		ReadElement(element.format, &data[at], out);
+}
+
+void SoftwareRenderDevice::ShadeVertices(const CpuVertexShader& shader, const InputLayout& layout, const int* inputElements,
+										 unsigned int firstIndex, unsigned int instance, size_t count,
+										 SoftwareRasterizer::Vertex* pOut) const noexcept
+{
+	// gather AoS vertex data into one register per input component; unused
+	// lanes repeat the last vertex
+	CpuVertexInput in;
+	for (unsigned int i = 0; i < shader.inputCount; i++)
+	{
+		float lanes[4][SimdWidth];
+		for (size_t lane = 0; lane < SimdWidth; lane++)
+		{
+			float value[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+			if (inputElements[i] >= 0)
+			{
+				FetchElement(layout.elements[inputElements[i]], firstIndex + unsigned(std::min(lane, count - 1u)), instance, value);
+			}
+			for (int c = 0; c < 4; c++)
+			{
+				lanes[c][lane] = value[c];
+			}
+		}
+		for (int c = 0; c < 4; c++)
+		{
+			in.attributes[i][c] = SimdFloat::Load(lanes[c]);
+		}
+	}
+
+	CpuVertexOutput out;
+	shader.main(in, out);
+
+	// scatter back to the AoS vertices the rasterizer clips
+	float lanes[SimdWidth];
+	for (int c = 0; c < 4; c++)
+	{
+		out.position[c].Store(lanes);
+		for (size_t lane = 0; lane < count; lane++)
+			pOut[lane].position[c] = lanes[lane];
+	}
+	for (unsigned int v = 0; v < shader.varyingCount; v++)
+	{
+		out.varyings[v].Store(lanes);
+		for (size_t lane = 0; lane < count; lane++)
+			pOut[lane].varyings[v] = lanes[lane];
+	}
+}
@@ -0,0 +1,212 @@
+#pragma once
+#include "RenderDevice.h"
+#include "CpuShader.h"
+#include "HiZPyramid.h"
+#include "JobSystem.h"
+#include "MsaaResolve.h"
+#include "SoftwareRasterizer.h"
+#include <array>
+#include <string>
+#include <vector>
+
+// IRenderDevice that rasterizes on the CPU into an in-memory back buffer
+// laid out like the DXGI_FORMAT_B8G8R8A8_UNORM swap chain buffer of the
+// D3D11 device (one uint32_t per pixel, blue in the low byte). It needs no
+// window and no GPU, which makes it usable for running and timing the frame
+// code headless and for diffing rendered images.
+//
+// Shaders run as their C++ ports from CpuShader.h, found by the name the
+// bytecode was loaded under, so the compiled .cso files are not read;
+// drawing with a shader that has no port is a no-op. Rasterization follows the D3D rules: clockwise triangles are front
+// facing, back faces are culled and pixel centers on a shared edge are owned
+// by one triangle (top-left rule).
+//
+// Vertex processing and rasterization (see SoftwareRasterizer) are spread
+// over a JobSystem; the image is the same for any thread count.
+//
+// The swap chain is the back and front buffer pair; Resize() reallocates
+// both and unbinds the target, like ResizeBuffers() on the D3D11 device.
+//
+// MSAA renders the frame into a sample image of GetSampleGrid() times the
+// size, which Present() resolves with the ResolveSamples() kernels, spread
+// over the JobSystem. The rasterizer has no per sample coverage, so this
+// shades every sample (supersampling); the resolve is the same work a GPU
+// does. SV_Position reaches the pixel shaders in sample image coordinates.
+//
+// The depth buffer matches the image draws go to, the sample image with
+// MSAA. Present() reduces it into a HiZPyramid over the JobSystem whenever
+// depth was written since the last Present(); with MSAA the pyramid covers
+// the sample image too, its GetWidth() / GetHeight() tell the scale.
+class SoftwareRenderDevice : public IRenderDevice, public ISwapChain
+{
+public:
+	// threadCount includes the calling thread; 0 picks the number of cores
+	SoftwareRenderDevice(unsigned int width, unsigned int height, unsigned int threadCount = 0u);
+	SoftwareRenderDevice(const SoftwareRenderDevice&) = delete;
+	SoftwareRenderDevice& operator=(const SoftwareRenderDevice&) = delete;
+
+	BufferHandle		CreateBuffer(const BufferDesc& desc) override;
+	VertexShaderHandle	CreateVertexShader(const ShaderBytecode& bytecode) override;
+	PixelShaderHandle	CreatePixelShader(const ShaderBytecode& bytecode) override;
+	InputLayoutHandle	CreateInputLayout(const InputElementDesc* pElements, unsigned int count,
+										  const ShaderBytecode& vsBytecode) override;
+
+	void SetVertexBuffer(unsigned int slot, BufferHandle buffer, unsigned int stride, unsigned int offset) override;
+	void SetIndexBuffer(BufferHandle buffer, IndexFormat format, unsigned int offset) override;
+	void SetVertexShader(VertexShaderHandle shader) override;
+	void SetPixelShader(PixelShaderHandle shader) override;
+	void SetInputLayout(InputLayoutHandle layout) override;
+	void SetBackBufferTarget() override;
+	void SetDepthOnlyTarget() override;
+	void SetDepthMode(DepthMode mode) override;
+	void SetPrimitiveTopology(PrimitiveTopology topology) override;
+	void SetViewport(const Viewport& viewport) override;
+
+	void* Map(BufferHandle buffer, MapMode mode) override;
+	void Unmap(BufferHandle buffer) override;
+
+	void ClearBackBuffer(const float color[4]) override;
+	void ClearDepth(float depth) override;
+	void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex) override;
+	void DrawIndexedInstanced(unsigned int indexCountPerInstance, unsigned int instanceCount,
+							  unsigned int startIndex, int baseVertex, unsigned int startInstance) override;
+	void DrawIndexedInstancedIndirect(BufferHandle args, unsigned int byteOffset) override;
+	void Present() override;
+	void SetPresentMode(PresentMode mode, unsigned int maxFrameLatency) override;
+	ISwapChain& GetSwapChain() noexcept override { return *this; }
+	const HiZPyramid* GetDepthPyramid() const noexcept override { return &depthPyramid; }
+	// the shaders are found by name
+	bool NeedsShaderBytecode() const noexcept override { return false; }
+
+	SwapChainDesc GetDesc() const noexcept override { return { width, height, 2u, sampleCount }; }
+	void Resize(unsigned int width, unsigned int height) override;
+	unsigned int SetSampleCount(unsigned int sampleCount) override;
+
+	// box by default, like ResolveSubresource()
+	void			SetResolveFilter(ResolveFilter filter) noexcept { resolveFilter = filter; }
+	ResolveFilter	GetResolveFilter() const noexcept { return resolveFilter; }
+
+	// time spent in the resolves of Present(); pixels / seconds is the
+	// throughput of the kernels at the current sample count
+	struct ResolveStats
+	{
+		uint64_t	resolves	{ 0u };
+		uint64_t	pixels		{ 0u };
+		double		seconds		{ 0.0 };
+	};
+	const ResolveStats&	GetResolveStats() const noexcept { return resolveStats; }
+	void				ResetResolveStats() noexcept { resolveStats = {}; }
+
+	unsigned int	GetWidth()			const noexcept { return width; }
+	unsigned int	GetHeight()			const noexcept { return height; }
+	unsigned int	GetPresentCount()	const noexcept { return presentCount; }
+	// nothing waits for a display here, the mode is only remembered
+	PresentMode		GetPresentMode()	const noexcept { return presentMode; }
+
+	// counters accumulated since construction or the last ResetRasterStats()
+	SoftwareRasterizer::Stats	GetRasterStats() const noexcept { return rasterizer.GetStats(); }
+	void						ResetRasterStats() noexcept { rasterizer.ResetStats(); }
+
+	// depth of the image draws go to, see the class comment
+	const float*	GetDepthBuffer()	const noexcept { return depthBuffer.data(); }
+	// BGRA8 pixels, rows are GetWidth() pixels apart
+	const uint32_t*	GetBackBuffer()		const noexcept { return backBuffer.data(); }
+	const uint32_t*	GetFrontBuffer()	const noexcept { return frontBuffer.data(); }
+
+	// writes the last presented frame as a 32 bit top-down .bmp
+	bool			SaveFrontBuffer(const std::string& path) const;
+
+	static uint32_t	PackColor(float r, float g, float b, float a) noexcept;
+
+private:
+	struct Buffer
+	{
+		BufferType type;
+		std::vector<unsigned char> data;
+	};
+
+	struct InputLayout
+	{
+		struct Element
+		{
+			std::string		semanticName;
+			unsigned int	semanticIndex;
+			ElementFormat	format;
+			unsigned int	inputSlot;
+			unsigned int	alignedByteOffset;
+			bool			perInstance;
+			unsigned int	instanceDataStepRate;
+		};
+		std::vector<Element> elements;
+	};
+
+	struct VertexBufferBinding
+	{
+		BufferHandle	buffer;
+		unsigned int	stride { 0u };
+		unsigned int	offset { 0u };
+	};
+
+	static constexpr unsigned int MaxVertexBuffers = 16u;
+
+private:
+	// points the rasterizer at the image draws go to (the sample image with
+	// MSAA) and its depth buffer and scales the viewport to them
+	void BindRasterTarget();
+	// reads one element of one vertex of the draw's instance'th instance,
+	// expanded to 4 components
+	void FetchElement(const InputLayout::Element& element, unsigned int index, unsigned int instance,
+					  float out[4]) const noexcept;
+	// runs the vertex shader on up to SimdWidth vertices of an instance
+	// starting at firstIndex; inputElements maps shader inputs to layout
+	// elements (-1 = not present)
+	void ShadeVertices(const CpuVertexShader& shader, const InputLayout& layout, const int* inputElements,
+					   unsigned int firstIndex, unsigned int instance, size_t count,
+					   SoftwareRasterizer::Vertex* pOut) const noexcept;
+
+private:
+	unsigned int width;
+	unsigned int height;
+	unsigned int presentCount { 0u };
+	PresentMode presentMode { PresentMode::VSync };
+
+	std::vector<uint32_t> backBuffer;
+	std::vector<uint32_t> frontBuffer;
+
+	unsigned int			sampleCount		{ 1u };
+	ResolveFilter			resolveFilter	{ ResolveFilter::Box };
+	std::vector<uint32_t>	sampleBuffer;	// empty without MSAA
+	ResolveStats			resolveStats;
+
+	std::vector<float>		depthBuffer;
+	HiZPyramid				depthPyramid;
+	// depth was written since the last Present(), the pyramid is out of date
+	bool					depthWritten	{ false };
+
+	std::vector<Buffer>			buffers;
+	std::vector<InputLayout>	inputLayouts;
+	// nullptr where no C++ port was found
+	std::vector<const CpuVertexShader*>	vertexShaders;
+	std::vector<const CpuPixelShader*>	pixelShaders;
+
+	// currently bound state
+	std::array<VertexBufferBinding, MaxVertexBuffers> vertexBuffers;
+	BufferHandle		indexBuffer;
+	IndexFormat			indexFormat		{ IndexFormat::R16_UInt };
+	unsigned int		indexOffset		{ 0u };
+	InputLayoutHandle	inputLayout;
+	VertexShaderHandle	vertexShader;
+	PixelShaderHandle	pixelShader;
+	Viewport			viewport;
+	bool				targetBound		{ false };
+	bool				depthOnly		{ false };
+	DepthMode			depthMode		{ DepthMode::Disabled };
+
+	JobSystem			jobs;
+	SoftwareRasterizer	rasterizer;
+
+	// per draw scratch, kept to avoid reallocating every frame
+	std::vector<uint32_t>					drawIndices;
+	std::vector<SoftwareRasterizer::Vertex>	drawVertices;
+	unsigned int							drawStartInstance	{ 0u };
+};
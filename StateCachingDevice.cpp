@@ -0,0 +1,236 @@
+#include "StateCachingDevice.h"
+
+StateCachingDevice::StateCachingDevice(IRenderDevice& device) noexcept
+	: device(device)
+{}
+
+BufferHandle StateCachingDevice::CreateBuffer(const BufferDesc& desc)
+{
+	return device.CreateBuffer(desc);
+}
+
+VertexShaderHandle StateCachingDevice::CreateVertexShader(const ShaderBytecode& bytecode)
+{
+	return device.CreateVertexShader(bytecode);
+}
+
+PixelShaderHandle StateCachingDevice::CreatePixelShader(const ShaderBytecode& bytecode)
+{
+	return device.CreatePixelShader(bytecode);
+}
+
+InputLayoutHandle StateCachingDevice::CreateInputLayout(const InputElementDesc* pElements, unsigned int count,
+														const ShaderBytecode& vsBytecode)
+{
+	return device.CreateInputLayout(pElements, count, vsBytecode);
+}
+
+void StateCachingDevice::SetVertexBuffer(unsigned int slot, BufferHandle buffer, unsigned int stride, unsigned int offset)
+{
+	if (slot >= MaxVertexBuffers)
+	{
+		// not shadowed, let the device deal with it
+		device.SetVertexBuffer(slot, buffer, stride, offset);
+		return;
+	}
+	VertexBufferSlot& s = vertexBuffers[slot];
+	if (Changed(!s.known || s.buffer != buffer || s.stride != stride || s.offset != offset))
+	{
+		s = { buffer, stride, offset, true };
+		device.SetVertexBuffer(slot, buffer, stride, offset);
+	}
+}
+
+void StateCachingDevice::SetIndexBuffer(BufferHandle buffer, IndexFormat format, unsigned int offset)
+{
+	if (Changed(!indexBufferKnown || indexBuffer != buffer || indexFormat != format || indexOffset != offset))
+	{
+		indexBuffer = buffer;
+		indexFormat = format;
+		indexOffset = offset;
+		indexBufferKnown = true;
+		device.SetIndexBuffer(buffer, format, offset);
+	}
+}
+
+void StateCachingDevice::SetVertexShader(VertexShaderHandle shader)
+{
+	if (Changed(!vertexShaderKnown || vertexShader != shader))
+	{
+		vertexShader = shader;
+		vertexShaderKnown = true;
+		device.SetVertexShader(shader);
+	}
+}
+
+void StateCachingDevice::SetPixelShader(PixelShaderHandle shader)
+{
+	if (Changed(!pixelShaderKnown || pixelShader != shader))
+	{
+		pixelShader = shader;
+		pixelShaderKnown = true;
+		device.SetPixelShader(shader);
+	}
+}
+
+void StateCachingDevice::SetInputLayout(InputLayoutHandle layout)
+{
+	if (Changed(!inputLayoutKnown || inputLayout != layout))
+	{
+		inputLayout = layout;
+		inputLayoutKnown = true;
+		device.SetInputLayout(layout);
+	}
+}
+
+void StateCachingDevice::SetBackBufferTarget()
+{
+	if (Changed(target != Target::BackBuffer))
+	{
+		target = Target::BackBuffer;
+		device.SetBackBufferTarget();
+	}
+}
+
+void StateCachingDevice::SetDepthOnlyTarget()
+{
+	if (Changed(target != Target::DepthOnly))
+	{
+		target = Target::DepthOnly;
+		device.SetDepthOnlyTarget();
+	}
+}
+
+void StateCachingDevice::SetDepthMode(DepthMode mode)
+{
+	if (Changed(!depthModeKnown || depthMode != mode))
+	{
+		depthMode = mode;
+		depthModeKnown = true;
+		device.SetDepthMode(mode);
+	}
+}
+
+void StateCachingDevice::SetPrimitiveTopology(PrimitiveTopology value)
+{
+	if (Changed(!topologyKnown || topology != value))
+	{
+		topology = value;
+		topologyKnown = true;
+		device.SetPrimitiveTopology(value);
+	}
+}
+
+void StateCachingDevice::SetViewport(const Viewport& vp)
+{
+	const bool same = viewportKnown &&
+		vp.topLeftX == viewport.topLeftX && vp.topLeftY == viewport.topLeftY &&
+		vp.width == viewport.width && vp.height == viewport.height &&
+		vp.minDepth == viewport.minDepth && vp.maxDepth == viewport.maxDepth;
+	if (Changed(!same))
+	{
+		viewport = vp;
+		viewportKnown = true;
+		device.SetViewport(vp);
+	}
+}
+
+void* StateCachingDevice::Map(BufferHandle buffer, MapMode mode)
+{
+	return device.Map(buffer, mode);
+}
+
+void StateCachingDevice::Unmap(BufferHandle buffer)
+{
+	device.Unmap(buffer);
+}
+
+void StateCachingDevice::ClearBackBuffer(const float color[4])
+{
+	device.ClearBackBuffer(color);
+}
+
+void StateCachingDevice::ClearDepth(float depth)
+{
+	device.ClearDepth(depth);
+}
+
+void StateCachingDevice::DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+{
+	device.DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+void StateCachingDevice::DrawIndexedInstanced(unsigned int indexCountPerInstance, unsigned int instanceCount,
+											  unsigned int startIndex, int baseVertex, unsigned int startInstance)
+{
+	device.DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+void StateCachingDevice::DrawIndexedInstancedIndirect(BufferHandle args, unsigned int byteOffset)
+{
+	device.DrawIndexedInstancedIndirect(args, byteOffset);
+}
+
+void StateCachingDevice::Present()
+{
+	device.Present();
+	// the flip model unbinds the back buffer on present
+	target = Target::Unknown;
+
+	lastFrame = frame;
+	frame = {};
+}
+
+void StateCachingDevice::SetPresentMode(PresentMode mode, unsigned int maxFrameLatency)
+{
+	device.SetPresentMode(mode, maxFrameLatency);
+}
+
+SwapChainDesc StateCachingDevice::GetDesc() const noexcept
+{
+	return device.GetSwapChain().GetDesc();
+}
+
+void StateCachingDevice::Resize(unsigned int width, unsigned int height)
+{
+	device.GetSwapChain().Resize(width, height);
+	target = Target::Unknown;
+}
+
+unsigned int StateCachingDevice::SetSampleCount(unsigned int sampleCount)
+{
+	const unsigned int count = device.GetSwapChain().SetSampleCount(sampleCount);
+	target = Target::Unknown;
+	return count;
+}
+
+void StateCachingDevice::Invalidate() noexcept
+{
+	for (VertexBufferSlot& s : vertexBuffers)
+	{
+		s.known = false;
+	}
+	indexBufferKnown = false;
+	vertexShaderKnown = false;
+	pixelShaderKnown = false;
+	inputLayoutKnown = false;
+	target = Target::Unknown;
+	depthModeKnown = false;
+	topologyKnown = false;
+	viewportKnown = false;
+}
+
+bool StateCachingDevice::Changed(bool changed) noexcept
+{
+	if (changed)
+	{
+		frame.issued++;
+		total.issued++;
+	}
+	else
+	{
+		frame.filtered++;
+		total.filtered++;
+	}
+	return changed;
+}
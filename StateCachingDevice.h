@@ -0,0 +1,127 @@
+#pragma once
+#include "RenderDevice.h"
+#include <array>
+
+// Sits between Graphics and the real render device and drops bind calls that
+// would set state that is already bound. It keeps a shadow copy of every
+// pipeline slot the interface can set; a bind is only forwarded when it
+// changes that copy. Everything else (creation, clears, draws, present) is
+// passed through untouched.
+//
+// The shadow state starts out unknown, so the first bind of every slot is
+// always issued. Present() forgets the render target binding because a
+// flip-model swap chain unbinds the back buffer, and so do resizing and
+// changing the sample count through GetSwapChain(). Call Invalidate() if the
+// wrapped device was used directly behind this layer's back.
+//
+// Any IRenderDevice can be wrapped, which makes the filter testable against
+// the RecordingRenderDevice without a GPU.
+class StateCachingDevice : public IRenderDevice, public ISwapChain
+{
+public:
+	struct Counters
+	{
+		unsigned int issued		{ 0u };	// binds forwarded to the device
+		unsigned int filtered	{ 0u };	// redundant binds dropped
+	};
+
+public:
+	explicit StateCachingDevice(IRenderDevice& device) noexcept;
+	StateCachingDevice(const StateCachingDevice&) = delete;
+	StateCachingDevice& operator=(const StateCachingDevice&) = delete;
+
+	BufferHandle		CreateBuffer(const BufferDesc& desc) override;
+	VertexShaderHandle	CreateVertexShader(const ShaderBytecode& bytecode) override;
+	PixelShaderHandle	CreatePixelShader(const ShaderBytecode& bytecode) override;
+	InputLayoutHandle	CreateInputLayout(const InputElementDesc* pElements, unsigned int count,
+										  const ShaderBytecode& vsBytecode) override;
+
+	void SetVertexBuffer(unsigned int slot, BufferHandle buffer, unsigned int stride, unsigned int offset) override;
+	void SetIndexBuffer(BufferHandle buffer, IndexFormat format, unsigned int offset) override;
+	void SetVertexShader(VertexShaderHandle shader) override;
+	void SetPixelShader(PixelShaderHandle shader) override;
+	void SetInputLayout(InputLayoutHandle layout) override;
+	void SetBackBufferTarget() override;
+	void SetDepthOnlyTarget() override;
+	void SetDepthMode(DepthMode mode) override;
+	void SetPrimitiveTopology(PrimitiveTopology topology) override;
+	void SetViewport(const Viewport& viewport) override;
+
+	void* Map(BufferHandle buffer, MapMode mode) override;
+	void Unmap(BufferHandle buffer) override;
+
+	void ClearBackBuffer(const float color[4]) override;
+	void ClearDepth(float depth) override;
+	void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex) override;
+	void DrawIndexedInstanced(unsigned int indexCountPerInstance, unsigned int instanceCount,
+							  unsigned int startIndex, int baseVertex, unsigned int startInstance) override;
+	void DrawIndexedInstancedIndirect(BufferHandle args, unsigned int byteOffset) override;
+	void Present() override;
+	void SetPresentMode(PresentMode mode, unsigned int maxFrameLatency) override;
+	ISwapChain& GetSwapChain() noexcept override { return *this; }
+	const HiZPyramid* GetDepthPyramid() const noexcept override { return device.GetDepthPyramid(); }
+	bool NeedsShaderBytecode() const noexcept override { return device.NeedsShaderBytecode(); }
+
+	SwapChainDesc GetDesc() const noexcept override;
+	void Resize(unsigned int width, unsigned int height) override;
+	unsigned int SetSampleCount(unsigned int sampleCount) override;
+
+	// forget all shadow state; the next bind of every slot is issued
+	void Invalidate() noexcept;
+
+	// counters of the last presented frame, of the frame in progress and of
+	// the whole lifetime
+	const Counters& GetFrameCounters()		const noexcept { return lastFrame; }
+	const Counters& GetCurrentCounters()	const noexcept { return frame; }
+	const Counters& GetTotalCounters()		const noexcept { return total; }
+
+	IRenderDevice&	GetDevice() const noexcept { return device; }
+
+private:
+	// counts a bind and tells whether it has to be forwarded
+	bool Changed(bool changed) noexcept;
+
+	static constexpr unsigned int MaxVertexBuffers = 16u;
+
+	enum class Target
+	{
+		Unknown,
+		BackBuffer,
+		DepthOnly,
+	};
+
+	struct VertexBufferSlot
+	{
+		BufferHandle	buffer;
+		unsigned int	stride { 0u };
+		unsigned int	offset { 0u };
+		bool			known  { false };
+	};
+
+private:
+	IRenderDevice& device;
+
+	// shadow state; `known` flags are false until the slot was bound once
+	std::array<VertexBufferSlot, MaxVertexBuffers> vertexBuffers;
+	BufferHandle		indexBuffer;
+	IndexFormat			indexFormat			{ IndexFormat::R16_UInt };
+	unsigned int		indexOffset			{ 0u };
+	bool				indexBufferKnown	{ false };
+	VertexShaderHandle	vertexShader;
+	bool				vertexShaderKnown	{ false };
+	PixelShaderHandle	pixelShader;
+	bool				pixelShaderKnown	{ false };
+	InputLayoutHandle	inputLayout;
+	bool				inputLayoutKnown	{ false };
+	Target				target				{ Target::Unknown };
+	DepthMode			depthMode			{ DepthMode::Disabled };
+	bool				depthModeKnown		{ false };
+	PrimitiveTopology	topology			{ PrimitiveTopology::TriangleList };
+	bool				topologyKnown		{ false };
+	Viewport			viewport;
+	bool				viewportKnown		{ false };
+
+	Counters frame;
+	Counters lastFrame;
+	Counters total;
+};
@@ -0,0 +1,27 @@
+#include "SwapChain.h"
+
+void SwapChainResizer::Request(unsigned int width, unsigned int height) noexcept
+{
+	this->width = width;
+	this->height = height;
+	pending = true;
+	stats.requests++;
+}
+
+bool SwapChainResizer::Apply(ISwapChain& swapChain)
+{
+	if (!pending)
+	{
+		return false;
+	}
+	pending = false;
+
+	const SwapChainDesc desc = swapChain.GetDesc();
+	if (IsMinimized() || (desc.width == width && desc.height == height))
+	{
+		return false;
+	}
+	swapChain.Resize(width, height);
+	stats.resizes++;
+	return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+
+struct SwapChainDesc
+{
+	unsigned int width			{ 0u };
+	unsigned int height			{ 0u };
+	unsigned int bufferCount	{ 0u };
+	unsigned int sampleCount	{ 1u };
+};
+
+// The buffers a render device presents from. Resize() changes the size of
+// every buffer in place and recreates only what depends on it (the views of
+// the back buffer); shaders, buffers and layouts are untouched. It unbinds
+// the back buffer, so the target has to be bound again afterwards.
+//
+// With a sample count above 1 draws go to a multisampled target of the same
+// size, which Present() resolves into the back buffer. SetSampleCount()
+// rebuilds only that target (unbinding it like Resize()); counts the device
+// cannot do fall back to the next lower power of two, the count in effect
+// is returned.
+//
+// Plain C++ like RenderDevice.h, so code that drives a swap chain can run
+// against the software or recording device.
+class ISwapChain
+{
+public:
+	virtual ~ISwapChain() = default;
+
+	virtual SwapChainDesc	GetDesc() const noexcept = 0;
+	virtual void			Resize(unsigned int width, unsigned int height) = 0;
+	virtual unsigned int	SetSampleCount(unsigned int sampleCount) = 0;
+};
+
+// Turns the stream of size changes a window reports into at most one
+// ISwapChain::Resize() per frame. Request() only remembers the latest size,
+// so a burst of WM_SIZE messages (dragging the border, maximize, restore)
+// costs nothing until Apply() runs between two frames. Sizes with a zero
+// dimension (minimized) are never applied, the buffers keep their size until
+// the window comes back.
+class SwapChainResizer
+{
+public:
+	struct Stats
+	{
+		uint64_t requests	{ 0u };
+		uint64_t resizes	{ 0u };	// Resize() calls that were issued
+	};
+
+public:
+	void	Request(unsigned int width, unsigned int height) noexcept;
+	// resizes when the latest requested size differs from the swap chain;
+	// returns whether it did
+	bool	Apply(ISwapChain& swapChain);
+
+	bool	IsPending() const noexcept { return pending; }
+	// the last requested size has no area; there is nothing to present to
+	bool	IsMinimized() const noexcept { return width == 0u || height == 0u; }
+	const Stats& GetStats() const noexcept { return stats; }
+
+private:
+	unsigned int	width	{ 1u };
+	unsigned int	height	{ 1u };
+	bool			pending	{ false };
+	Stats			stats;
+};
@@ -0,0 +1,312 @@
+#include "TransformHierarchy.h"
+#include <algorithm>
+#include <chrono>
+#include <type_traits>
+#include <utility>
+
+namespace
+{
+	// world matrices per job; subtrees larger than this are split
+	constexpr size_t UpdateGrain = 4096u;
+	// up to one flagged node in this many the flagged ones are sorted,
+	// beyond that all flags are scanned
+	constexpr size_t SortedDirtyRatio = 32u;
+}
+
+TransformHierarchy::TransformHierarchy(JobSystem& jobs)
+	: jobs(jobs)
+{
+}
+
+TransformHierarchy::Node TransformHierarchy::AddNode(Node parent, Vec3 translation, Quat rotation, Vec3 scale)
+{
+	const uint32_t index = uint32_t(parents.size());
+	const uint32_t parentIndex = parent == InvalidNode ? InvalidNode : indices[parent];
+
+	// appending keeps the subtrees contiguous when the parent's subtree ends
+	// at the end of the arrays; its ancestors' subtrees end there as well
+	if (parentIndex != InvalidNode)
+	{
+		if (subtreeEnds[parentIndex] == index)
+		{
+			for (uint32_t i = parentIndex; i != InvalidNode; i = parents[i])
+			{
+				subtreeEnds[i] = index + 1u;
+			}
+		}
+		else
+		{
+			ordered = false;
+		}
+	}
+
+	const Node node = Node(indices.size());
+	parents.push_back(parentIndex);
+	subtreeEnds.push_back(index + 1u);
+	translations.emplace_back();
+	translation.Store(translations.back());
+	rotations.emplace_back();
+	rotation.Store(rotations.back());
+	scales.emplace_back();
+	scale.Store(scales.back());
+	worlds.push_back(Mat4::Identity());
+	dirtyFlags.push_back(0u);
+	handles.push_back(node);
+	indices.push_back(index);
+	MarkDirty(index);
+	return node;
+}
+
+void TransformHierarchy::SetLocal(Node node, Vec3 translation, Quat rotation, Vec3 scale) noexcept
+{
+	const uint32_t index = indices[node];
+	translation.Store(translations[index]);
+	rotation.Store(rotations[index]);
+	scale.Store(scales[index]);
+	MarkDirty(index);
+}
+
+void TransformHierarchy::SetTranslation(Node node, Vec3 translation) noexcept
+{
+	const uint32_t index = indices[node];
+	translation.Store(translations[index]);
+	MarkDirty(index);
+}
+
+void TransformHierarchy::SetRotation(Node node, Quat rotation) noexcept
+{
+	const uint32_t index = indices[node];
+	rotation.Store(rotations[index]);
+	MarkDirty(index);
+}
+
+void TransformHierarchy::Reserve(size_t nodeCount)
+{
+	parents.reserve(nodeCount);
+	subtreeEnds.reserve(nodeCount);
+	translations.reserve(nodeCount);
+	rotations.reserve(nodeCount);
+	scales.reserve(nodeCount);
+	worlds.reserve(nodeCount);
+	dirtyFlags.reserve(nodeCount);
+	handles.reserve(nodeCount);
+	indices.reserve(nodeCount);
+}
+
+void TransformHierarchy::Clear() noexcept
+{
+	parents.clear();
+	subtreeEnds.clear();
+	translations.clear();
+	rotations.clear();
+	scales.clear();
+	worlds.clear();
+	dirtyFlags.clear();
+	handles.clear();
+	indices.clear();
+	dirtyNodes.clear();
+	ordered = true;
+}
+
+TransformHierarchy::Node TransformHierarchy::GetParent(Node node) const noexcept
+{
+	const uint32_t parent = parents[indices[node]];
+	return parent == InvalidNode ? InvalidNode : handles[parent];
+}
+
+void TransformHierarchy::MarkDirty(uint32_t index) noexcept
+{
+	if (!dirtyFlags[index])
+	{
+		dirtyFlags[index] = 1u;
+		dirtyNodes.push_back(handles[index]);
+	}
+}
+
+void TransformHierarchy::Reorder()
+{
+	// children of every node by counting sort on the parent, in the order
+	// they are in now; the roots are counted under the extra slot n
+	const uint32_t n = uint32_t(parents.size());
+	std::vector<uint32_t> firstChild(n + 3u, 0u);
+	for (uint32_t i = 0u; i < n; i++)
+	{
+		firstChild[(parents[i] == InvalidNode ? n : parents[i]) + 2u]++;
+	}
+	for (uint32_t i = 2u; i < n + 3u; i++)
+	{
+		firstChild[i] += firstChild[i - 1u];
+	}
+	std::vector<uint32_t> children(n);
+	for (uint32_t i = 0u; i < n; i++)
+	{
+		children[firstChild[(parents[i] == InvalidNode ? n : parents[i]) + 1u]++] = i;
+	}
+	// children of p are now [firstChild[p], firstChild[p + 1])
+
+	// depth first from every root; a node's subtree ends where the order is
+	// when the walk leaves it
+	std::vector<uint32_t> order;
+	order.reserve(n);
+	std::vector<uint32_t> newIndices(n);
+	std::vector<uint32_t> newEnds(n);
+	std::vector<std::pair<uint32_t, uint32_t>> walk;	// node, next child
+	for (uint32_t r = firstChild[n]; r < firstChild[n + 1u]; r++)
+	{
+		walk.push_back({ children[r], firstChild[children[r]] });
+		newIndices[children[r]] = uint32_t(order.size());
+		order.push_back(children[r]);
+		while (!walk.empty())
+		{
+			auto& top = walk.back();
+			if (top.second < firstChild[top.first + 1u])
+			{
+				const uint32_t child = children[top.second++];
+				newIndices[child] = uint32_t(order.size());
+				order.push_back(child);
+				walk.push_back({ child, firstChild[child] });
+			}
+			else
+			{
+				newEnds[top.first] = uint32_t(order.size());
+				walk.pop_back();
+			}
+		}
+	}
+
+	auto permute = [&](auto& values)
+	{
+		std::remove_reference_t<decltype(values)> sorted(n);
+		for (uint32_t i = 0u; i < n; i++)
+		{
+			sorted[i] = values[order[i]];
+		}
+		values.swap(sorted);
+	};
+	permute(translations);
+	permute(rotations);
+	permute(scales);
+	permute(worlds);
+	permute(dirtyFlags);
+	permute(handles);
+	for (uint32_t i = 0u; i < n; i++)
+	{
+		const uint32_t old = order[i];
+		subtreeEnds[i] = newEnds[old];
+		indices[handles[i]] = i;
+	}
+	std::vector<uint32_t> newParents(n);
+	for (uint32_t i = 0u; i < n; i++)
+	{
+		const uint32_t parent = parents[order[i]];
+		newParents[i] = parent == InvalidNode ? InvalidNode : newIndices[parent];
+	}
+	parents.swap(newParents);
+
+	ordered = true;
+	stats.reorders++;
+}
+
+void TransformHierarchy::UpdateRange(uint32_t begin, uint32_t end) noexcept
+{
+	for (uint32_t i = begin; i < end; i++)
+	{
+		const Mat4 local = Mat4::Transform(Vec3::Load(translations[i]), Quat::Load(rotations[i]), Vec3::Load(scales[i]));
+		worlds[i] = parents[i] == InvalidNode ? local : worlds[parents[i]] * local;
+	}
+}
+
+void TransformHierarchy::Update()
+{
+	if (dirtyNodes.empty())
+	{
+		return;
+	}
+	const auto start = std::chrono::steady_clock::now();
+
+	if (!ordered)
+	{
+		Reorder();
+	}
+
+	// flagged nodes front to back; one inside the subtree of an earlier one
+	// is updated with it. Many of them are found faster by a pass over the
+	// flags than by sorting.
+	dirtyIndices.clear();
+	if (dirtyNodes.size() > parents.size() / SortedDirtyRatio)
+	{
+		for (uint32_t i = 0u; i < uint32_t(dirtyFlags.size()); i++)
+		{
+			if (dirtyFlags[i])
+			{
+				dirtyIndices.push_back(i);
+				dirtyFlags[i] = 0u;
+			}
+		}
+	}
+	else
+	{
+		for (Node node : dirtyNodes)
+		{
+			dirtyIndices.push_back(indices[node]);
+			dirtyFlags[indices[node]] = 0u;
+		}
+		std::sort(dirtyIndices.begin(), dirtyIndices.end());
+	}
+	dirtyNodes.clear();
+
+	// subtrees up to UpdateGrain nodes become jobs, larger ones have their
+	// root computed here and their child subtrees looked at in turn;
+	// neighbouring ranges are merged until a job has UpdateGrain nodes
+	blocks.clear();
+	uint32_t covered = 0u;
+	for (uint32_t index : dirtyIndices)
+	{
+		if (index < covered)
+		{
+			continue;
+		}
+		covered = subtreeEnds[index];
+		stats.subtrees++;
+		stats.nodesUpdated += covered - index;
+
+		stack.push_back({ index, covered });
+		while (!stack.empty())
+		{
+			const Range range = stack.back();
+			stack.pop_back();
+			if (range.end - range.begin <= UpdateGrain)
+			{
+				if (!blocks.empty() && blocks.back().end == range.begin && blocks.back().end - blocks.back().begin < UpdateGrain)
+				{
+					blocks.back().end = range.end;
+				}
+				else
+				{
+					blocks.push_back(range);
+				}
+				continue;
+			}
+			UpdateRange(range.begin, range.begin + 1u);
+			// pushed last to first, so they come off the stack in order
+			const size_t first = stack.size();
+			for (uint32_t child = range.begin + 1u; child < range.end; child = subtreeEnds[child])
+			{
+				stack.push_back({ child, subtreeEnds[child] });
+			}
+			std::reverse(stack.begin() + first, stack.end());
+		}
+	}
+
+	jobs.ParallelFor(blocks.size(), 1u, [this](size_t begin, size_t end, unsigned int)
+	{
+		for (size_t b = begin; b < end; b++)
+		{
+			UpdateRange(blocks[b].begin, blocks[b].end);
+		}
+	});
+
+	stats.updates++;
+	stats.lastSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	stats.seconds += stats.lastSeconds;
+}
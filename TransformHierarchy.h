@@ -0,0 +1,107 @@
+#pragma once
+#include "JobSystem.h"
+#include "VectorMath.h"
+#include <cstdint>
+#include <vector>
+
+// Parent/child transforms of the scene with world matrices that are only
+// recomputed where something moved.
+//
+// Every node has a local transform (translation, rotation, scale) relative
+// to its parent; its world matrix is the parent's world matrix times the
+// local one. The nodes are kept in arrays per attribute (parents, local
+// parts, world matrices, ...) sorted depth first, so a parent always comes
+// before its children and every subtree is one contiguous range of the
+// arrays: [index, subtreeEnd). Changing a local transform flags the node,
+// and Update() walks the flagged subtrees front to back, each one a linear
+// pass that finds the parent's world matrix already computed.
+//
+// Nodes are referred to by handles that stay valid while the arrays are
+// reordered. Adding a node below the one added last (or below one of its
+// ancestors) keeps the order; other additions reorder all nodes once, in
+// the next Update().
+//
+// Large subtrees are split for the JobSystem: the root of the subtree is
+// computed first, then its child subtrees are independent ranges, which
+// are split again until they are small, and neighbouring small ranges are
+// merged into jobs of about the same size. The results do not depend on
+// the thread count.
+class TransformHierarchy
+{
+public:
+	using Node = uint32_t;
+	static constexpr Node InvalidNode = 0xFFFFFFFFu;
+
+	struct Stats
+	{
+		uint64_t	updates			{ 0u };
+		uint64_t	nodesUpdated	{ 0u };	// world matrices computed
+		uint64_t	subtrees		{ 0u };	// dirty subtrees walked
+		uint64_t	reorders		{ 0u };
+		double		seconds			{ 0.0 };	// all Update() calls
+		double		lastSeconds		{ 0.0 };
+	};
+
+public:
+	explicit TransformHierarchy(JobSystem& jobs);
+	TransformHierarchy(const TransformHierarchy&) = delete;
+	TransformHierarchy& operator=(const TransformHierarchy&) = delete;
+
+	// parent = InvalidNode adds a root; the world matrix is valid after the
+	// next Update()
+	Node	AddNode(Node parent, Vec3 translation, Quat rotation, Vec3 scale);
+	void	SetLocal(Node node, Vec3 translation, Quat rotation, Vec3 scale) noexcept;
+	void	SetTranslation(Node node, Vec3 translation) noexcept;
+	void	SetRotation(Node node, Quat rotation) noexcept;
+	void	Reserve(size_t nodeCount);
+	void	Clear() noexcept;
+
+	// recomputes the world matrices of the flagged nodes and their
+	// descendants
+	void	Update();
+
+	size_t			GetNodeCount()	const noexcept { return parents.size(); }
+	Node			GetParent(Node node) const noexcept;
+	Vec3			GetTranslation(Node node) const noexcept { return Vec3::Load(translations[indices[node]]); }
+	Quat			GetRotation(Node node) const noexcept { return Quat::Load(rotations[indices[node]]); }
+	const Mat4&		GetWorld(Node node) const noexcept { return worlds[indices[node]]; }
+
+	const Stats&	GetStats() const noexcept { return stats; }
+	void			ResetStats() noexcept { stats = {}; }
+
+private:
+	struct Range
+	{
+		uint32_t	begin;
+		uint32_t	end;
+	};
+
+private:
+	void	MarkDirty(uint32_t index) noexcept;
+	void	Reorder();
+	void	UpdateRange(uint32_t begin, uint32_t end) noexcept;
+
+private:
+	JobSystem&	jobs;
+
+	// per node, in depth first order
+	std::vector<uint32_t>	parents;		// index, InvalidNode for roots
+	std::vector<uint32_t>	subtreeEnds;	// one past the last descendant
+	std::vector<Float3>		translations;
+	std::vector<Float4>		rotations;
+	std::vector<Float3>		scales;
+	std::vector<Mat4>		worlds;
+	std::vector<uint8_t>	dirtyFlags;
+	std::vector<Node>		handles;		// index -> node
+
+	std::vector<uint32_t>	indices;		// node -> index
+	std::vector<Node>		dirtyNodes;		// flagged since the last Update()
+	bool					ordered		{ true };	// subtree ranges are valid
+
+	// Update() scratch
+	std::vector<uint32_t>	dirtyIndices;
+	std::vector<Range>		stack;
+	std::vector<Range>		blocks;
+
+	Stats stats;
+};
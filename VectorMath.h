@@ -0,0 +1,674 @@
+#pragma once
+#include "Simd.h"
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+// Vectors, matrices and quaternions for the engine, header only.
+//
+// Vec3, Vec4 and Quat are one 128 bit register each, Mat4 is four of them
+// (its rows). Like Simd.h there is one source and an implementation per
+// instruction set, picked at compile time:
+//  - SSE:    __m128, with FMA where the build has AVX2     (any x64 build)
+//  - NEON:   float32x4_t                                   (AArch64)
+//  - scalar: float[4]                                      (GENIX_SIMD_NO_INTRINSICS)
+// Vec3 keeps w at 0 so that 4 lane operations can serve it as well.
+//
+// The register types are for computing. Members of vertices, instances and
+// other data that is stored or uploaded are Float2, Float3 and Float4,
+// which are plain floats (no alignment, no padding) and convert with
+// Load()/Store().
+//
+// Conventions are the renderer's: matrices are row major and applied to
+// column vectors (p' = M * p, a translation is in the last column, A * B
+// applies B first), view space looks down +z, projections map depth with
+// reversed Z (1 = near plane, 0 = far plane) and clockwise triangles face
+// the viewer.
+//
+// Arrays of points and of matrices go through the SoA types Vec3x8 and
+// Mat4x8: 8 of them at a time, every component in a SimdFloat, so the
+// batch loops run at the full width of Simd.h (8 lanes with AVX2).
+
+#if defined(GENIX_SIMD_NO_INTRINSICS)
+#define GENIX_MATH_SCALAR 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define GENIX_MATH_NEON 1
+#include <arm_neon.h>
+#elif GENIX_SIMD_AVX2 || GENIX_SIMD_SSE2
+#define GENIX_MATH_SSE 1
+#else
+#define GENIX_MATH_SCALAR 1
+#endif
+
+// storage types
+struct Float2 { float x, y; };
+struct Float3 { float x, y, z; };
+struct Float4 { float x, y, z, w; };
+
+constexpr float Pi = 3.14159265358979323846f;
+
+// Register level operations the vector types are built from; not meant to
+// be used outside this header.
+namespace VectorMath
+{
+#if GENIX_MATH_SSE
+	using Reg = __m128;
+
+	SIMD_INLINE Reg Set(float x, float y, float z, float w) noexcept { return _mm_setr_ps(x, y, z, w); }
+	SIMD_INLINE Reg Splat(float s) noexcept { return _mm_set1_ps(s); }
+	SIMD_INLINE Reg Load(const float* p) noexcept { return _mm_loadu_ps(p); }
+	SIMD_INLINE void Store(float* p, Reg a) noexcept { _mm_storeu_ps(p, a); }
+	SIMD_INLINE Reg Add(Reg a, Reg b) noexcept { return _mm_add_ps(a, b); }
+	SIMD_INLINE Reg Sub(Reg a, Reg b) noexcept { return _mm_sub_ps(a, b); }
+	SIMD_INLINE Reg Mul(Reg a, Reg b) noexcept { return _mm_mul_ps(a, b); }
+	SIMD_INLINE Reg Div(Reg a, Reg b) noexcept { return _mm_div_ps(a, b); }
+	SIMD_INLINE Reg Min(Reg a, Reg b) noexcept { return _mm_min_ps(a, b); }
+	SIMD_INLINE Reg Max(Reg a, Reg b) noexcept { return _mm_max_ps(a, b); }
+	SIMD_INLINE Reg Sqrt(Reg a) noexcept { return _mm_sqrt_ps(a); }
+	// a * b + c
+	SIMD_INLINE Reg MulAdd(Reg a, Reg b, Reg c) noexcept
+	{
+#if GENIX_SIMD_AVX2
+		return _mm_fmadd_ps(a, b, c);
+#else
+		return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+	}
+	// lanes a, b, c, d of r
+	template<int A, int B, int C, int D>
+	SIMD_INLINE Reg Permute(Reg r) noexcept { return _mm_shuffle_ps(r, r, _MM_SHUFFLE(D, C, B, A)); }
+	template<int I>
+	SIMD_INLINE float Lane(Reg r) noexcept { return _mm_cvtss_f32(Permute<I, I, I, I>(r)); }
+	// sum of all lanes in every lane
+	SIMD_INLINE Reg HorizontalSum(Reg a) noexcept
+	{
+		const Reg pairs = _mm_add_ps(a, Permute<1, 0, 3, 2>(a));
+		return _mm_add_ps(pairs, Permute<2, 3, 0, 1>(pairs));
+	}
+	SIMD_INLINE void Transpose(Reg& r0, Reg& r1, Reg& r2, Reg& r3) noexcept { _MM_TRANSPOSE4_PS(r0, r1, r2, r3); }
+
+#elif GENIX_MATH_NEON
+	using Reg = float32x4_t;
+
+	SIMD_INLINE Reg Set(float x, float y, float z, float w) noexcept { const float f[4] = { x, y, z, w }; return vld1q_f32(f); }
+	SIMD_INLINE Reg Splat(float s) noexcept { return vdupq_n_f32(s); }
+	SIMD_INLINE Reg Load(const float* p) noexcept { return vld1q_f32(p); }
+	SIMD_INLINE void Store(float* p, Reg a) noexcept { vst1q_f32(p, a); }
+	SIMD_INLINE Reg Add(Reg a, Reg b) noexcept { return vaddq_f32(a, b); }
+	SIMD_INLINE Reg Sub(Reg a, Reg b) noexcept { return vsubq_f32(a, b); }
+	SIMD_INLINE Reg Mul(Reg a, Reg b) noexcept { return vmulq_f32(a, b); }
+	SIMD_INLINE Reg Div(Reg a, Reg b) noexcept { return vdivq_f32(a, b); }
+	SIMD_INLINE Reg Min(Reg a, Reg b) noexcept { return vminq_f32(a, b); }
+	SIMD_INLINE Reg Max(Reg a, Reg b) noexcept { return vmaxq_f32(a, b); }
+	SIMD_INLINE Reg Sqrt(Reg a) noexcept { return vsqrtq_f32(a); }
+	SIMD_INLINE Reg MulAdd(Reg a, Reg b, Reg c) noexcept { return vfmaq_f32(c, a, b); }
+	// a byte table lookup does any permutation
+	template<int A, int B, int C, int D>
+	SIMD_INLINE Reg Permute(Reg r) noexcept
+	{
+		static constexpr uint8_t bytes[16] =
+		{
+			uint8_t(4 * A), uint8_t(4 * A + 1), uint8_t(4 * A + 2), uint8_t(4 * A + 3),
+			uint8_t(4 * B), uint8_t(4 * B + 1), uint8_t(4 * B + 2), uint8_t(4 * B + 3),
+			uint8_t(4 * C), uint8_t(4 * C + 1), uint8_t(4 * C + 2), uint8_t(4 * C + 3),
+			uint8_t(4 * D), uint8_t(4 * D + 1), uint8_t(4 * D + 2), uint8_t(4 * D + 3),
+		};
+		return vreinterpretq_f32_u8(vqtbl1q_u8(vreinterpretq_u8_f32(r), vld1q_u8(bytes)));
+	}
+	template<int I>
+	SIMD_INLINE float Lane(Reg r) noexcept { return vgetq_lane_f32(r, I); }
+	SIMD_INLINE Reg HorizontalSum(Reg a) noexcept { return vdupq_n_f32(vaddvq_f32(a)); }
+	SIMD_INLINE void Transpose(Reg& r0, Reg& r1, Reg& r2, Reg& r3) noexcept
+	{
+		const float64x2_t a = vreinterpretq_f64_f32(vtrn1q_f32(r0, r1));
+		const float64x2_t b = vreinterpretq_f64_f32(vtrn2q_f32(r0, r1));
+		const float64x2_t c = vreinterpretq_f64_f32(vtrn1q_f32(r2, r3));
+		const float64x2_t d = vreinterpretq_f64_f32(vtrn2q_f32(r2, r3));
+		r0 = vreinterpretq_f32_f64(vtrn1q_f64(a, c));
+		r1 = vreinterpretq_f32_f64(vtrn1q_f64(b, d));
+		r2 = vreinterpretq_f32_f64(vtrn2q_f64(a, c));
+		r3 = vreinterpretq_f32_f64(vtrn2q_f64(b, d));
+	}
+
+#else
+	struct Reg { float f[4]; };
+
+	SIMD_INLINE Reg Set(float x, float y, float z, float w) noexcept { return { { x, y, z, w } }; }
+	SIMD_INLINE Reg Splat(float s) noexcept { return { { s, s, s, s } }; }
+	// p is usually &Float4::x; copying bytes instead of indexing past x keeps
+	// GCC's -Wstringop-overflow quiet when the callers are inlined
+	SIMD_INLINE Reg Load(const float* p) noexcept { Reg r; std::memcpy(r.f, p, sizeof(r.f)); return r; }
+	SIMD_INLINE void Store(float* p, Reg a) noexcept { std::memcpy(p, a.f, sizeof(a.f)); }
+#define GENIX_MATH_LANEWISE(name, expr) \
+	SIMD_INLINE Reg name(Reg a, Reg b) noexcept { Reg r; for (int i = 0; i < 4; i++) r.f[i] = expr; return r; }
+	GENIX_MATH_LANEWISE(Add, a.f[i] + b.f[i])
+	GENIX_MATH_LANEWISE(Sub, a.f[i] - b.f[i])
+	GENIX_MATH_LANEWISE(Mul, a.f[i] * b.f[i])
+	GENIX_MATH_LANEWISE(Div, a.f[i] / b.f[i])
+	GENIX_MATH_LANEWISE(Min, b.f[i] < a.f[i] ? b.f[i] : a.f[i])
+	GENIX_MATH_LANEWISE(Max, a.f[i] < b.f[i] ? b.f[i] : a.f[i])
+#undef GENIX_MATH_LANEWISE
+	SIMD_INLINE Reg Sqrt(Reg a) noexcept { Reg r; for (int i = 0; i < 4; i++) r.f[i] = std::sqrt(a.f[i]); return r; }
+	SIMD_INLINE Reg MulAdd(Reg a, Reg b, Reg c) noexcept { Reg r; for (int i = 0; i < 4; i++) r.f[i] = a.f[i] * b.f[i] + c.f[i]; return r; }
+	template<int A, int B, int C, int D>
+	SIMD_INLINE Reg Permute(Reg r) noexcept { return { { r.f[A], r.f[B], r.f[C], r.f[D] } }; }
+	template<int I>
+	SIMD_INLINE float Lane(Reg r) noexcept { return r.f[I]; }
+	SIMD_INLINE Reg HorizontalSum(Reg a) noexcept { return Splat((a.f[0] + a.f[1]) + (a.f[2] + a.f[3])); }
+	SIMD_INLINE void Transpose(Reg& r0, Reg& r1, Reg& r2, Reg& r3) noexcept
+	{
+		Reg* rows[4] = { &r0, &r1, &r2, &r3 };
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = i + 1; j < 4; j++)
+			{
+				const float t = rows[i]->f[j];
+				rows[i]->f[j] = rows[j]->f[i];
+				rows[j]->f[i] = t;
+			}
+		}
+	}
+#endif
+
+	template<int I>
+	SIMD_INLINE Reg SplatLane(Reg r) noexcept { return Permute<I, I, I, I>(r); }
+	SIMD_INLINE Reg Dot4(Reg a, Reg b) noexcept { return HorizontalSum(Mul(a, b)); }
+	// a.yzx * b.zxy - a.zxy * b.yzx; w stays 0 when it is 0 in both
+	SIMD_INLINE Reg Cross3(Reg a, Reg b) noexcept
+	{
+		const Reg r = Sub(Mul(a, Permute<1, 2, 0, 3>(b)), Mul(Permute<1, 2, 0, 3>(a), b));
+		return Permute<1, 2, 0, 3>(r);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Vec4
+
+struct Vec4
+{
+	VectorMath::Reg v;
+
+	Vec4() = default;
+	SIMD_INLINE explicit Vec4(VectorMath::Reg v) noexcept : v(v) {}
+	SIMD_INLINE Vec4(float x, float y, float z, float w) noexcept : v(VectorMath::Set(x, y, z, w)) {}
+	SIMD_INLINE explicit Vec4(float s) noexcept : v(VectorMath::Splat(s)) {}
+
+	SIMD_INLINE static Vec4 Load(const Float4& f) noexcept { return Vec4(VectorMath::Load(&f.x)); }
+	SIMD_INLINE static Vec4 Load(const float* p) noexcept { return Vec4(VectorMath::Load(p)); }
+	SIMD_INLINE void Store(Float4& f) const noexcept { VectorMath::Store(&f.x, v); }
+	SIMD_INLINE void Store(float* p) const noexcept { VectorMath::Store(p, v); }
+
+	SIMD_INLINE float X() const noexcept { return VectorMath::Lane<0>(v); }
+	SIMD_INLINE float Y() const noexcept { return VectorMath::Lane<1>(v); }
+	SIMD_INLINE float Z() const noexcept { return VectorMath::Lane<2>(v); }
+	SIMD_INLINE float W() const noexcept { return VectorMath::Lane<3>(v); }
+};
+
+SIMD_INLINE Vec4 operator+(Vec4 a, Vec4 b) noexcept { return Vec4(VectorMath::Add(a.v, b.v)); }
+SIMD_INLINE Vec4 operator-(Vec4 a, Vec4 b) noexcept { return Vec4(VectorMath::Sub(a.v, b.v)); }
+SIMD_INLINE Vec4 operator*(Vec4 a, Vec4 b) noexcept { return Vec4(VectorMath::Mul(a.v, b.v)); }
+SIMD_INLINE Vec4 operator/(Vec4 a, Vec4 b) noexcept { return Vec4(VectorMath::Div(a.v, b.v)); }
+SIMD_INLINE Vec4 operator*(Vec4 a, float s) noexcept { return Vec4(VectorMath::Mul(a.v, VectorMath::Splat(s))); }
+SIMD_INLINE Vec4 operator*(float s, Vec4 a) noexcept { return a * s; }
+SIMD_INLINE Vec4 operator-(Vec4 a) noexcept { return Vec4(VectorMath::Sub(VectorMath::Splat(0.0f), a.v)); }
+SIMD_INLINE Vec4 MulAdd(Vec4 a, Vec4 b, Vec4 c) noexcept { return Vec4(VectorMath::MulAdd(a.v, b.v, c.v)); }
+SIMD_INLINE Vec4 Min(Vec4 a, Vec4 b) noexcept { return Vec4(VectorMath::Min(a.v, b.v)); }
+SIMD_INLINE Vec4 Max(Vec4 a, Vec4 b) noexcept { return Vec4(VectorMath::Max(a.v, b.v)); }
+SIMD_INLINE float Dot(Vec4 a, Vec4 b) noexcept { return VectorMath::Lane<0>(VectorMath::Dot4(a.v, b.v)); }
+SIMD_INLINE float Length(Vec4 a) noexcept { return std::sqrt(Dot(a, a)); }
+SIMD_INLINE Vec4 Normalize(Vec4 a) noexcept { return Vec4(VectorMath::Div(a.v, VectorMath::Sqrt(VectorMath::Dot4(a.v, a.v)))); }
+SIMD_INLINE Vec4 Lerp(Vec4 a, Vec4 b, float t) noexcept { return MulAdd(b - a, Vec4(t), a); }
+
+////////////////////////////////////////////////////////////////////////////////////
+// Vec3
+
+struct Vec3
+{
+	VectorMath::Reg v;	// w = 0
+
+	Vec3() = default;
+	SIMD_INLINE explicit Vec3(VectorMath::Reg v) noexcept : v(v) {}
+	SIMD_INLINE Vec3(float x, float y, float z) noexcept : v(VectorMath::Set(x, y, z, 0.0f)) {}
+	SIMD_INLINE explicit Vec3(float s) noexcept : v(VectorMath::Set(s, s, s, 0.0f)) {}
+
+	SIMD_INLINE static Vec3 Load(const Float3& f) noexcept { return Vec3(f.x, f.y, f.z); }
+	SIMD_INLINE static Vec3 Load(const float* p) noexcept { return Vec3(p[0], p[1], p[2]); }
+	SIMD_INLINE void Store(Float3& f) const noexcept { float t[4]; VectorMath::Store(t, v); f = { t[0], t[1], t[2] }; }
+	SIMD_INLINE void Store(float* p) const noexcept { float t[4]; VectorMath::Store(t, v); p[0] = t[0]; p[1] = t[1]; p[2] = t[2]; }
+
+	SIMD_INLINE float X() const noexcept { return VectorMath::Lane<0>(v); }
+	SIMD_INLINE float Y() const noexcept { return VectorMath::Lane<1>(v); }
+	SIMD_INLINE float Z() const noexcept { return VectorMath::Lane<2>(v); }
+};
+
+SIMD_INLINE Vec3 operator+(Vec3 a, Vec3 b) noexcept { return Vec3(VectorMath::Add(a.v, b.v)); }
+SIMD_INLINE Vec3 operator-(Vec3 a, Vec3 b) noexcept { return Vec3(VectorMath::Sub(a.v, b.v)); }
+SIMD_INLINE Vec3 operator*(Vec3 a, Vec3 b) noexcept { return Vec3(VectorMath::Mul(a.v, b.v)); }
+SIMD_INLINE Vec3 operator*(Vec3 a, float s) noexcept { return Vec3(VectorMath::Mul(a.v, VectorMath::Splat(s))); }
+SIMD_INLINE Vec3 operator*(float s, Vec3 a) noexcept { return a * s; }
+SIMD_INLINE Vec3 operator-(Vec3 a) noexcept { return Vec3(VectorMath::Sub(VectorMath::Splat(0.0f), a.v)); }
+SIMD_INLINE Vec3 MulAdd(Vec3 a, Vec3 b, Vec3 c) noexcept { return Vec3(VectorMath::MulAdd(a.v, b.v, c.v)); }
+SIMD_INLINE Vec3 Min(Vec3 a, Vec3 b) noexcept { return Vec3(VectorMath::Min(a.v, b.v)); }
+SIMD_INLINE Vec3 Max(Vec3 a, Vec3 b) noexcept { return Vec3(VectorMath::Max(a.v, b.v)); }
+// w is 0 on both sides, the 4 lane dot product is the 3 lane one
+SIMD_INLINE float Dot(Vec3 a, Vec3 b) noexcept { return VectorMath::Lane<0>(VectorMath::Dot4(a.v, b.v)); }
+SIMD_INLINE Vec3 Cross(Vec3 a, Vec3 b) noexcept { return Vec3(VectorMath::Cross3(a.v, b.v)); }
+SIMD_INLINE float Length(Vec3 a) noexcept { return std::sqrt(Dot(a, a)); }
+SIMD_INLINE Vec3 Normalize(Vec3 a) noexcept { return Vec3(VectorMath::Div(a.v, VectorMath::Sqrt(VectorMath::Dot4(a.v, a.v)))); }
+SIMD_INLINE Vec3 Lerp(Vec3 a, Vec3 b, float t) noexcept { return MulAdd(b - a, Vec3(t), a); }
+
+////////////////////////////////////////////////////////////////////////////////////
+// Quat
+
+// Unit quaternion (x, y, z, w) for rotations; w is the real part.
+struct Quat
+{
+	VectorMath::Reg v;
+
+	Quat() = default;
+	SIMD_INLINE explicit Quat(VectorMath::Reg v) noexcept : v(v) {}
+	SIMD_INLINE Quat(float x, float y, float z, float w) noexcept : v(VectorMath::Set(x, y, z, w)) {}
+
+	SIMD_INLINE static Quat Identity() noexcept { return Quat(0.0f, 0.0f, 0.0f, 1.0f); }
+	// axis is unit length; positive angles turn y toward z about x, z
+	// toward x about y and x toward y about z
+	SIMD_INLINE static Quat RotationAxis(Vec3 axis, float angle) noexcept
+	{
+		const float s = std::sin(0.5f * angle);
+		return Quat(VectorMath::Add(VectorMath::Mul(axis.v, VectorMath::Splat(s)), VectorMath::Set(0.0f, 0.0f, 0.0f, std::cos(0.5f * angle))));
+	}
+	SIMD_INLINE static Quat Load(const Float4& f) noexcept { return Quat(VectorMath::Load(&f.x)); }
+	SIMD_INLINE void Store(Float4& f) const noexcept { VectorMath::Store(&f.x, v); }
+
+	SIMD_INLINE float X() const noexcept { return VectorMath::Lane<0>(v); }
+	SIMD_INLINE float Y() const noexcept { return VectorMath::Lane<1>(v); }
+	SIMD_INLINE float Z() const noexcept { return VectorMath::Lane<2>(v); }
+	SIMD_INLINE float W() const noexcept { return VectorMath::Lane<3>(v); }
+};
+
+// a * b rotates by b first, then by a
+SIMD_INLINE Quat operator*(Quat a, Quat b) noexcept
+{
+	using namespace VectorMath;
+	// w1 * b + x1 * (w2,-z2,y2,-x2) + y1 * (z2,w2,-x2,-y2) + z1 * (-y2,x2,w2,-z2)
+	Reg r = Mul(SplatLane<3>(a.v), b.v);
+	r = MulAdd(SplatLane<0>(a.v), Mul(Permute<3, 2, 1, 0>(b.v), Set(1.0f, -1.0f, 1.0f, -1.0f)), r);
+	r = MulAdd(SplatLane<1>(a.v), Mul(Permute<2, 3, 0, 1>(b.v), Set(1.0f, 1.0f, -1.0f, -1.0f)), r);
+	r = MulAdd(SplatLane<2>(a.v), Mul(Permute<1, 0, 3, 2>(b.v), Set(-1.0f, 1.0f, 1.0f, -1.0f)), r);
+	return Quat(r);
+}
+SIMD_INLINE Quat Conjugate(Quat q) noexcept { return Quat(VectorMath::Mul(q.v, VectorMath::Set(-1.0f, -1.0f, -1.0f, 1.0f))); }
+SIMD_INLINE float Dot(Quat a, Quat b) noexcept { return VectorMath::Lane<0>(VectorMath::Dot4(a.v, b.v)); }
+SIMD_INLINE Quat Normalize(Quat q) noexcept { return Quat(VectorMath::Div(q.v, VectorMath::Sqrt(VectorMath::Dot4(q.v, q.v)))); }
+
+// q * p * conjugate(q) as v + w * t + cross(q.xyz, t) with t = 2 * cross(q.xyz, v)
+SIMD_INLINE Vec3 Rotate(Quat q, Vec3 p) noexcept
+{
+	using namespace VectorMath;
+	const Reg axis = Mul(q.v, Set(1.0f, 1.0f, 1.0f, 0.0f));
+	const Reg t = Mul(Cross3(axis, p.v), Splat(2.0f));
+	return Vec3(Add(MulAdd(SplatLane<3>(q.v), t, p.v), Cross3(axis, t)));
+}
+
+// Spherical interpolation along the shorter arc, constant angular speed in
+// t. Nearly equal rotations fall back to normalized linear interpolation,
+// where the sin() ratios lose their precision.
+SIMD_INLINE Quat Slerp(Quat a, Quat b, float t) noexcept
+{
+	using namespace VectorMath;
+	float cosAngle = Dot(a, b);
+	Reg to = b.v;
+	if (cosAngle < 0.0f)
+	{
+		cosAngle = -cosAngle;
+		to = Sub(Splat(0.0f), to);
+	}
+	if (cosAngle > 0.9995f)
+	{
+		return Normalize(Quat(MulAdd(Sub(to, a.v), Splat(t), a.v)));
+	}
+	const float angle = std::acos(cosAngle);
+	const float invSin = 1.0f / std::sin(angle);
+	const float wa = std::sin((1.0f - t) * angle) * invSin;
+	const float wb = std::sin(t * angle) * invSin;
+	return Quat(MulAdd(a.v, Splat(wa), Mul(to, Splat(wb))));
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// Mat4
+
+struct Mat4
+{
+	Vec4 rows[4];
+
+	SIMD_INLINE static Mat4 Identity() noexcept
+	{
+		return { { Vec4(1.0f, 0.0f, 0.0f, 0.0f), Vec4(0.0f, 1.0f, 0.0f, 0.0f),
+				   Vec4(0.0f, 0.0f, 1.0f, 0.0f), Vec4(0.0f, 0.0f, 0.0f, 1.0f) } };
+	}
+	SIMD_INLINE static Mat4 Translation(Vec3 t) noexcept
+	{
+		return { { Vec4(1.0f, 0.0f, 0.0f, t.X()), Vec4(0.0f, 1.0f, 0.0f, t.Y()),
+				   Vec4(0.0f, 0.0f, 1.0f, t.Z()), Vec4(0.0f, 0.0f, 0.0f, 1.0f) } };
+	}
+	SIMD_INLINE static Mat4 Scaling(Vec3 s) noexcept
+	{
+		return { { Vec4(s.X(), 0.0f, 0.0f, 0.0f), Vec4(0.0f, s.Y(), 0.0f, 0.0f),
+				   Vec4(0.0f, 0.0f, s.Z(), 0.0f), Vec4(0.0f, 0.0f, 0.0f, 1.0f) } };
+	}
+	static Mat4 Rotation(Quat q) noexcept;
+	// scale, then rotate, then translate
+	static Mat4 Transform(Vec3 translation, Quat rotation, Vec3 scale) noexcept;
+	// view space camera at eye looking at target (+z forward, +y up)
+	static Mat4 LookAt(Vec3 eye, Vec3 target, Vec3 up) noexcept;
+	// view to clip space, reversed Z; farZ may be INFINITY
+	static Mat4 Perspective(float fovY, float aspect, float nearZ, float farZ) noexcept;
+
+	// 16 floats, row after row (the float[16] matrices of the culling code)
+	SIMD_INLINE static Mat4 Load(const float m[16]) noexcept
+	{
+		return { { Vec4::Load(m), Vec4::Load(m + 4), Vec4::Load(m + 8), Vec4::Load(m + 12) } };
+	}
+	SIMD_INLINE void Store(float m[16]) const noexcept
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			rows[i].Store(m + 4 * i);
+		}
+	}
+};
+
+SIMD_INLINE Mat4 Transpose(const Mat4& m) noexcept
+{
+	Mat4 t = m;
+	VectorMath::Transpose(t.rows[0].v, t.rows[1].v, t.rows[2].v, t.rows[3].v);
+	return t;
+}
+
+// row i of a * b is sum_k a[i][k] * row k of b
+SIMD_INLINE Mat4 operator*(const Mat4& a, const Mat4& b) noexcept
+{
+	using namespace VectorMath;
+	Mat4 r;
+	for (int i = 0; i < 4; i++)
+	{
+		const Reg row = a.rows[i].v;
+		Reg sum = Mul(SplatLane<0>(row), b.rows[0].v);
+		sum = MulAdd(SplatLane<1>(row), b.rows[1].v, sum);
+		sum = MulAdd(SplatLane<2>(row), b.rows[2].v, sum);
+		r.rows[i].v = MulAdd(SplatLane<3>(row), b.rows[3].v, sum);
+	}
+	return r;
+}
+
+// the products of the rows transposed and summed give the 4 dot products
+SIMD_INLINE Vec4 operator*(const Mat4& m, Vec4 p) noexcept
+{
+	using namespace VectorMath;
+	Reg x = Mul(m.rows[0].v, p.v);
+	Reg y = Mul(m.rows[1].v, p.v);
+	Reg z = Mul(m.rows[2].v, p.v);
+	Reg w = Mul(m.rows[3].v, p.v);
+	Transpose(x, y, z, w);
+	return Vec4(Add(Add(x, y), Add(z, w)));
+}
+
+// (m * (p, 1)).xyz, no division by w: for affine transforms
+SIMD_INLINE Vec3 TransformPoint(const Mat4& m, Vec3 p) noexcept
+{
+	const Vec4 r = m * Vec4(VectorMath::Add(p.v, VectorMath::Set(0.0f, 0.0f, 0.0f, 1.0f)));
+	return Vec3(VectorMath::Mul(r.v, VectorMath::Set(1.0f, 1.0f, 1.0f, 0.0f)));
+}
+// (m * (v, 0)).xyz, directions are not translated
+SIMD_INLINE Vec3 TransformVector(const Mat4& m, Vec3 v) noexcept
+{
+	const Vec4 r = m * Vec4(v.v);
+	return Vec3(VectorMath::Mul(r.v, VectorMath::Set(1.0f, 1.0f, 1.0f, 0.0f)));
+}
+
+// General inverse by cofactors; the result of a singular matrix is not
+// finite. pDeterminant receives the determinant when not nullptr.
+Mat4 Inverse(const Mat4& m, float* pDeterminant = nullptr) noexcept;
+
+inline Mat4 Mat4::Rotation(Quat q) noexcept
+{
+	const float x = q.X(), y = q.Y(), z = q.Z(), w = q.W();
+	const float xx = x * x, yy = y * y, zz = z * z;
+	const float xy = x * y, xz = x * z, yz = y * z;
+	const float wx = w * x, wy = w * y, wz = w * z;
+	return { { Vec4(1.0f - 2.0f * (yy + zz), 2.0f * (xy - wz), 2.0f * (xz + wy), 0.0f),
+			   Vec4(2.0f * (xy + wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz - wx), 0.0f),
+			   Vec4(2.0f * (xz - wy), 2.0f * (yz + wx), 1.0f - 2.0f * (xx + yy), 0.0f),
+			   Vec4(0.0f, 0.0f, 0.0f, 1.0f) } };
+}
+
+inline Mat4 Mat4::Transform(Vec3 translation, Quat rotation, Vec3 scale) noexcept
+{
+	// R * S scales the columns of R, the translation is the last column
+	using namespace VectorMath;
+	const Mat4 r = Rotation(rotation);
+	return { { Vec4(MulAdd(r.rows[0].v, scale.v, Set(0.0f, 0.0f, 0.0f, translation.X()))),
+			   Vec4(MulAdd(r.rows[1].v, scale.v, Set(0.0f, 0.0f, 0.0f, translation.Y()))),
+			   Vec4(MulAdd(r.rows[2].v, scale.v, Set(0.0f, 0.0f, 0.0f, translation.Z()))),
+			   Vec4(0.0f, 0.0f, 0.0f, 1.0f) } };
+}
+
+inline Mat4 Mat4::LookAt(Vec3 eye, Vec3 target, Vec3 up) noexcept
+{
+	const Vec3 z = Normalize(target - eye);
+	const Vec3 x = Normalize(Cross(up, z));
+	const Vec3 y = Cross(z, x);
+	return { { Vec4(x.X(), x.Y(), x.Z(), -Dot(x, eye)), Vec4(y.X(), y.Y(), y.Z(), -Dot(y, eye)),
+			   Vec4(z.X(), z.Y(), z.Z(), -Dot(z, eye)), Vec4(0.0f, 0.0f, 0.0f, 1.0f) } };
+}
+
+inline Mat4 Mat4::Perspective(float fovY, float aspect, float nearZ, float farZ) noexcept
+{
+	// clip.w = z and clip.z = a * z + b with z / w = 1 at nearZ and 0 at farZ
+	const float yScale = 1.0f / std::tan(0.5f * fovY);
+	const float xScale = yScale / aspect;
+	const float a = std::isinf(farZ) ? 0.0f : nearZ / (nearZ - farZ);
+	const float b = std::isinf(farZ) ? nearZ : -a * farZ;
+	return { { Vec4(xScale, 0.0f, 0.0f, 0.0f), Vec4(0.0f, yScale, 0.0f, 0.0f),
+			   Vec4(0.0f, 0.0f, a, b), Vec4(0.0f, 0.0f, 1.0f, 0.0f) } };
+}
+
+inline Mat4 Inverse(const Mat4& matrix, float* pDeterminant) noexcept
+{
+	float m[16];
+	matrix.Store(m);
+	// 2x2 minors of the upper and lower two rows
+	const float s0 = m[0] * m[5] - m[4] * m[1];
+	const float s1 = m[0] * m[6] - m[4] * m[2];
+	const float s2 = m[0] * m[7] - m[4] * m[3];
+	const float s3 = m[1] * m[6] - m[5] * m[2];
+	const float s4 = m[1] * m[7] - m[5] * m[3];
+	const float s5 = m[2] * m[7] - m[6] * m[3];
+	const float c5 = m[10] * m[15] - m[14] * m[11];
+	const float c4 = m[9] * m[15] - m[13] * m[11];
+	const float c3 = m[9] * m[14] - m[13] * m[10];
+	const float c2 = m[8] * m[15] - m[12] * m[11];
+	const float c1 = m[8] * m[14] - m[12] * m[10];
+	const float c0 = m[8] * m[13] - m[12] * m[9];
+
+	const float determinant = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+	if (pDeterminant)
+	{
+		*pDeterminant = determinant;
+	}
+	const float d = 1.0f / determinant;
+	const float r[16] =
+	{
+		( m[5] * c5 - m[6] * c4 + m[7] * c3) * d,
+		(-m[1] * c5 + m[2] * c4 - m[3] * c3) * d,
+		( m[13] * s5 - m[14] * s4 + m[15] * s3) * d,
+		(-m[9] * s5 + m[10] * s4 - m[11] * s3) * d,
+
+		(-m[4] * c5 + m[6] * c2 - m[7] * c1) * d,
+		( m[0] * c5 - m[2] * c2 + m[3] * c1) * d,
+		(-m[12] * s5 + m[14] * s2 - m[15] * s1) * d,
+		( m[8] * s5 - m[10] * s2 + m[11] * s1) * d,
+
+		( m[4] * c4 - m[5] * c2 + m[7] * c0) * d,
+		(-m[0] * c4 + m[1] * c2 - m[3] * c0) * d,
+		( m[12] * s4 - m[13] * s2 + m[15] * s0) * d,
+		(-m[8] * s4 + m[9] * s2 - m[11] * s0) * d,
+
+		(-m[4] * c3 + m[5] * c1 - m[6] * c0) * d,
+		( m[0] * c3 - m[1] * c1 + m[2] * c0) * d,
+		(-m[12] * s3 + m[13] * s1 - m[14] * s0) * d,
+		( m[8] * s3 - m[9] * s1 + m[10] * s0) * d,
+	};
+	return Mat4::Load(r);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+// SoA batches
+
+// 8 points, one SimdFloat per component
+struct Vec3x8
+{
+	SimdFloat x, y, z;
+};
+
+// 8 matrices, one SimdFloat per element, m[4 * row + column]
+struct Mat4x8
+{
+	SimdFloat m[16];
+
+	// every lane the same matrix
+	SIMD_INLINE static Mat4x8 Splat(const Mat4& matrix) noexcept
+	{
+		float f[16];
+		matrix.Store(f);
+		Mat4x8 r;
+		for (int i = 0; i < 16; i++)
+		{
+			r.m[i] = SimdFloat(f[i]);
+		}
+		return r;
+	}
+	// matrices p[0..7] into the lanes and back
+	SIMD_INLINE static Mat4x8 Load(const Mat4* p) noexcept
+	{
+		float lanes[16][SimdWidth];
+		for (int lane = 0; lane < SimdWidth; lane++)
+		{
+			float f[16];
+			p[lane].Store(f);
+			for (int i = 0; i < 16; i++)
+			{
+				lanes[i][lane] = f[i];
+			}
+		}
+		Mat4x8 r;
+		for (int i = 0; i < 16; i++)
+		{
+			r.m[i] = SimdFloat::Load(lanes[i]);
+		}
+		return r;
+	}
+	SIMD_INLINE void Store(Mat4* p) const noexcept
+	{
+		float lanes[16][SimdWidth];
+		for (int i = 0; i < 16; i++)
+		{
+			m[i].Store(lanes[i]);
+		}
+		for (int lane = 0; lane < SimdWidth; lane++)
+		{
+			float f[16];
+			for (int i = 0; i < 16; i++)
+			{
+				f[i] = lanes[i][lane];
+			}
+			p[lane] = Mat4::Load(f);
+		}
+	}
+};
+
+SIMD_INLINE Mat4x8 operator*(const Mat4x8& a, const Mat4x8& b) noexcept
+{
+	Mat4x8 r;
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			SimdFloat sum = a.m[4 * i] * b.m[j];
+			sum = MulAdd(a.m[4 * i + 1], b.m[4 + j], sum);
+			sum = MulAdd(a.m[4 * i + 2], b.m[8 + j], sum);
+			r.m[4 * i + j] = MulAdd(a.m[4 * i + 3], b.m[12 + j], sum);
+		}
+	}
+	return r;
+}
+
+// (m * (p, 1)).xyz per lane
+SIMD_INLINE Vec3x8 TransformPoint(const Mat4x8& m, const Vec3x8& p) noexcept
+{
+	return { MulAdd(m.m[0], p.x, MulAdd(m.m[1], p.y, MulAdd(m.m[2], p.z, m.m[3]))),
+			 MulAdd(m.m[4], p.x, MulAdd(m.m[5], p.y, MulAdd(m.m[6], p.z, m.m[7]))),
+			 MulAdd(m.m[8], p.x, MulAdd(m.m[9], p.y, MulAdd(m.m[10], p.z, m.m[11]))) };
+}
+
+// Points given as separate x, y and z arrays through m. outW receives w of
+// the result (clip space) and may be nullptr for affine m. The last
+// partial block goes through a copy, no array is read or written past
+// count.
+inline void TransformPoints(const Mat4& m, const float* x, const float* y, const float* z, size_t count,
+							float* outX, float* outY, float* outZ, float* outW = nullptr) noexcept
+{
+	const Mat4x8 matrix = Mat4x8::Splat(m);
+	auto transform = [&](const float* px, const float* py, const float* pz, float* ox, float* oy, float* oz, float* ow)
+	{
+		const Vec3x8 p = { SimdFloat::Load(px), SimdFloat::Load(py), SimdFloat::Load(pz) };
+		const Vec3x8 r = TransformPoint(matrix, p);
+		r.x.Store(ox);
+		r.y.Store(oy);
+		r.z.Store(oz);
+		if (ow)
+		{
+			MulAdd(matrix.m[12], p.x, MulAdd(matrix.m[13], p.y, MulAdd(matrix.m[14], p.z, matrix.m[15]))).Store(ow);
+		}
+	};
+
+	size_t i = 0u;
+	for (; i + SimdWidth <= count; i += SimdWidth)
+	{
+		transform(x + i, y + i, z + i, outX + i, outY + i, outZ + i, outW ? outW + i : nullptr);
+	}
+	if (i < count)
+	{
+		const size_t rest = count - i;
+		float in[3][SimdWidth] = {}, out[4][SimdWidth];
+		std::memcpy(in[0], x + i, rest * sizeof(float));
+		std::memcpy(in[1], y + i, rest * sizeof(float));
+		std::memcpy(in[2], z + i, rest * sizeof(float));
+		transform(in[0], in[1], in[2], out[0], out[1], out[2], outW ? out[3] : nullptr);
+		std::memcpy(outX + i, out[0], rest * sizeof(float));
+		std::memcpy(outY + i, out[1], rest * sizeof(float));
+		std::memcpy(outZ + i, out[2], rest * sizeof(float));
+		if (outW)
+		{
+			std::memcpy(outW + i, out[3], rest * sizeof(float));
+		}
+	}
+}
+
+// out[i] = a * b[i], e.g. a parent's world matrix times its children's
+// local ones; out may be b
+inline void MultiplyMatrices(const Mat4& a, const Mat4* b, Mat4* out, size_t count) noexcept
+{
+	for (size_t i = 0u; i < count; i++)
+	{
+		out[i] = a * b[i];
+	}
+}
+// out[i] = a[i] * b[i]; out may be a or b
+inline void MultiplyMatrices(const Mat4* a, const Mat4* b, Mat4* out, size_t count) noexcept
+{
+	for (size_t i = 0u; i < count; i++)
+	{
+		out[i] = a[i] * b[i];
+	}
+}
@@ -0,0 +1,185 @@
+#include "VertexCompression.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+	float SignNotZero(float value) noexcept
+	{
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	// snorm as the input assembler reads it: the most negative value is -1 too
+	float FromSnorm(int value, float max) noexcept
+	{
+		return std::max(float(value) / max, -1.0f);
+	}
+
+	// octahedral coordinates of a unit vector at max = 2^(bits - 1) - 1 steps
+	// per unit. Of the four grid points around the exact encoding the one
+	// that decodes closest to the vector wins, which at 8 bits halves the
+	// worst error of plain rounding.
+	void QuantizeOctahedral(const float vector[3], float max, int out[2]) noexcept
+	{
+		float encoded[2];
+		VertexCompressor::EncodeOctahedral(vector, encoded);
+		const float base[2] = { std::floor(encoded[0] * max), std::floor(encoded[1] * max) };
+		// by distance rather than dot product: at 16 bits the dot products of
+		// the candidates differ below float precision
+		float bestDistance = std::numeric_limits<float>::infinity();
+		for (int candidate = 0; candidate < 4; candidate++)
+		{
+			const int x = int(std::clamp(base[0] + float(candidate & 1), -max, max));
+			const int y = int(std::clamp(base[1] + float(candidate >> 1), -max, max));
+			float decoded[3];
+			VertexCompressor::DecodeOctahedral(FromSnorm(x, max), FromSnorm(y, max), decoded);
+			const float d[3] = { decoded[0] - vector[0], decoded[1] - vector[1], decoded[2] - vector[2] };
+			const float distance = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+			if (distance < bestDistance)
+			{
+				bestDistance = distance;
+				out[0] = x;
+				out[1] = y;
+			}
+		}
+	}
+}
+
+void VertexCompressor::EncodeOctahedral(const float vector[3], float out[2]) noexcept
+{
+	const float l1 = std::abs(vector[0]) + std::abs(vector[1]) + std::abs(vector[2]);
+	if (!(l1 > 0.0f))
+	{
+		out[0] = out[1] = 0.0f;
+		return;
+	}
+	const float x = vector[0] / l1;
+	const float y = vector[1] / l1;
+	if (vector[2] >= 0.0f)
+	{
+		out[0] = x;
+		out[1] = y;
+	}
+	else
+	{
+		// the lower half folds over the diagonals
+		out[0] = (1.0f - std::abs(y)) * SignNotZero(x);
+		out[1] = (1.0f - std::abs(x)) * SignNotZero(y);
+	}
+}
+
+void VertexCompressor::DecodeOctahedral(float x, float y, float out[3]) noexcept
+{
+	const float z = 1.0f - std::abs(x) - std::abs(y);
+	const float t = std::max(-z, 0.0f);
+	x += x >= 0.0f ? -t : t;
+	y += y >= 0.0f ? -t : t;
+	const float length = std::sqrt(x * x + y * y + z * z);
+	out[0] = x / length;
+	out[1] = y / length;
+	out[2] = z / length;
+}
+
+VertexCompressor::Mesh VertexCompressor::Compress(const Source& source)
+{
+	Mesh mesh;
+	const size_t count = source.vertexCount;
+	mesh.positions.resize(count);
+	mesh.attributes.resize(count);
+	if (count == 0u)
+	{
+		return mesh;
+	}
+
+	if (source.pPositions)
+	{
+		float max[3];
+		for (int c = 0; c < 3; c++)
+		{
+			mesh.boundsMin[c] = max[c] = source.pPositions[c];
+		}
+		for (size_t i = 1u; i < count; i++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				mesh.boundsMin[c] = std::min(mesh.boundsMin[c], source.pPositions[i * 3u + c]);
+				max[c] = std::max(max[c], source.pPositions[i * 3u + c]);
+			}
+		}
+		for (int c = 0; c < 3; c++)
+		{
+			mesh.boundsExtent[c] = max[c] - mesh.boundsMin[c];
+		}
+	}
+	float scale[3];
+	for (int c = 0; c < 3; c++)
+	{
+		scale[c] = mesh.boundsExtent[c] > 0.0f ? 65535.0f / mesh.boundsExtent[c] : 0.0f;
+	}
+
+	for (size_t i = 0u; i < count; i++)
+	{
+		PackedPosition& position = mesh.positions[i];
+		for (int c = 0; c < 3; c++)
+		{
+			const float p = source.pPositions ? source.pPositions[i * 3u + c] : 0.0f;
+			position.position[c] = uint16_t(std::clamp(std::round((p - mesh.boundsMin[c]) * scale[c]), 0.0f, 65535.0f));
+		}
+		position.position[3] = 65535u;
+
+		PackedAttributes& attributes = mesh.attributes[i];
+		attributes = {};
+		int quantized[2];
+		if (source.pNormals)
+		{
+			QuantizeOctahedral(source.pNormals + i * 3u, 32767.0f, quantized);
+			attributes.normal[0] = int16_t(quantized[0]);
+			attributes.normal[1] = int16_t(quantized[1]);
+		}
+		if (source.pTangents)
+		{
+			const float* pTangent = source.pTangents + i * 4u;
+			QuantizeOctahedral(pTangent, 127.0f, quantized);
+			attributes.tangent[0] = static_cast<signed char>(quantized[0]);
+			attributes.tangent[1] = static_cast<signed char>(quantized[1]);
+			attributes.tangent[2] = static_cast<signed char>(pTangent[3] < 0.0f ? -127 : 127);
+		}
+		if (source.pUvs)
+		{
+			attributes.uv[0] = FloatToHalf(source.pUvs[i * 2u]);
+			attributes.uv[1] = FloatToHalf(source.pUvs[i * 2u + 1u]);
+		}
+	}
+	return mesh;
+}
+
+void VertexCompressor::GetDequantizeMatrix(const Mesh& mesh, float out[16]) noexcept
+{
+	std::fill(out, out + 16, 0.0f);
+	for (int c = 0; c < 3; c++)
+	{
+		out[c * 4 + c] = mesh.boundsExtent[c];
+		out[c * 4 + 3] = mesh.boundsMin[c];
+	}
+	out[15] = 1.0f;
+}
+
+void VertexCompressor::Decode(const Mesh& mesh, size_t first, size_t count, DecodedVertex* pOut) noexcept
+{
+	for (size_t i = 0u; i < count; i++)
+	{
+		const PackedPosition& position = mesh.positions[first + i];
+		const PackedAttributes& attributes = mesh.attributes[first + i];
+		DecodedVertex& vertex = pOut[i];
+		for (int c = 0; c < 3; c++)
+		{
+			vertex.position[c] = mesh.boundsMin[c] + float(position.position[c]) * (1.0f / 65535.0f) * mesh.boundsExtent[c];
+		}
+		DecodeOctahedral(FromSnorm(attributes.normal[0], 32767.0f), FromSnorm(attributes.normal[1], 32767.0f), vertex.normal);
+		DecodeOctahedral(FromSnorm(attributes.tangent[0], 127.0f), FromSnorm(attributes.tangent[1], 127.0f), vertex.tangent);
+		vertex.tangent[3] = FromSnorm(attributes.tangent[2], 127.0f);
+		vertex.uv[0] = HalfToFloat(attributes.uv[0]);
+		vertex.uv[1] = HalfToFloat(attributes.uv[1]);
+	}
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include "VertexFormat.h"
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+// Compressed mesh vertices in two streams, 20 bytes instead of the 48 of
+// float position, normal, tangent and uv:
+//
+//	stream 0, PackedPosition (8 bytes):
+//		position	16 bit unorm x, y, z over the mesh bounds, w = 1
+//	stream 1, PackedAttributes (12 bytes):
+//		normal		16 bit snorm, octahedral
+//		tangent		8 bit snorm, octahedral in x, y; handedness in z (+-1)
+//		uv			half floats
+//
+// Octahedral vectors are unit vectors projected onto the octahedron and
+// its lower half folded over the upper, two components that spread their
+// precision evenly over the sphere (Cigolle et al., "A Survey of Efficient
+// Representations for Independent Unit Vectors", JCGT 2014). A shader
+// decodes them as DecodeOctahedral() does:
+//
+//	float3 n = float3(e.xy, 1 - abs(e.x) - abs(e.y));
+//	float t = saturate(-n.z);
+//	n.xy += n.xy >= 0 ? -t : t;
+//	n = normalize(n);
+//
+// and folds GetDequantizeMatrix() into its world matrix for positions.
+//
+// Positions have a stream of their own so depth-only passes fetch 8 bytes
+// per vertex: give the DrawPacket the attributes as its attributeBuffer and
+// an input layout of VertexFormat<PackedPosition> as its depthInputLayout.
+// The shading passes use Elements, which reads both streams.
+struct PackedPosition
+{
+	uint16_t	position[4];
+};
+
+template<> struct VertexLayout<PackedPosition>
+{
+	static constexpr InputElementDesc elements[] =
+	{
+		VERTEX_ELEMENT(PackedPosition, position, "Position", 0),
+	};
+};
+
+struct PackedAttributes
+{
+	int16_t		normal[2];
+	signed char	tangent[4];
+	Half		uv[2];
+};
+
+class VertexCompressor
+{
+public:
+	// both streams, for PipelineStateDesc::pInputElements
+	static constexpr InputElementDesc Elements[] =
+	{
+		VERTEX_STREAM_ELEMENT(PackedPosition, position, "Position", 0, 0u),
+		VERTEX_STREAM_ELEMENT(PackedAttributes, normal, "Normal", 0, 1u),
+		VERTEX_STREAM_ELEMENT(PackedAttributes, tangent, "Tangent", 0, 1u),
+		VERTEX_STREAM_ELEMENT(PackedAttributes, uv, "TexCoord", 0, 1u),
+	};
+	static constexpr unsigned int	ElementCount	= unsigned(std::size(Elements));
+	static constexpr uint64_t		ElementsHash	= HashInputElements(Elements, ElementCount);
+
+	// vertexCount entries each; null arrays are stored as zero
+	struct Source
+	{
+		const float*	pPositions	{ nullptr };	// x, y, z
+		const float*	pNormals	{ nullptr };	// x, y, z, unit length
+		const float*	pTangents	{ nullptr };	// x, y, z, unit length, w = +-1 handedness
+		const float*	pUvs		{ nullptr };	// u, v
+		size_t			vertexCount	{ 0u };
+	};
+
+	struct Mesh
+	{
+		std::vector<PackedPosition>		positions;
+		std::vector<PackedAttributes>	attributes;
+		float							boundsMin[3]	{};
+		float							boundsExtent[3]	{};
+	};
+
+	struct DecodedVertex
+	{
+		float	position[3];
+		float	normal[3];
+		float	tangent[4];
+		float	uv[2];
+	};
+
+public:
+	static Mesh		Compress(const Source& source);
+
+	// unorm stream 0 positions (w = 1) to the mesh's space; row major,
+	// applied to column vectors like every matrix of the renderer
+	static void		GetDequantizeMatrix(const Mesh& mesh, float out[16]) noexcept;
+
+	// what the input assembler and a shader make of vertices [first,
+	// first + count)
+	static void		Decode(const Mesh& mesh, size_t first, size_t count, DecodedVertex* pOut) noexcept;
+
+	// unit vector to octahedral coordinates in [-1,1]^2 and back
+	static void		EncodeOctahedral(const float vector[3], float out[2]) noexcept;
+	static void		DecodeOctahedral(float x, float y, float out[3]) noexcept;
+};
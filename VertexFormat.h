@@ -0,0 +1,138 @@
+#pragma once
+#include "RenderDevice.h"
+#include "Half.h"
+#include "Hash.h"
+#include "VectorMath.h"
+#include <cstddef>
+#include <iterator>
+
+// Compile time vertex formats. A vertex type declares its elements once, next
+// to the struct, and everything the pipeline needs is derived from the struct
+// itself:
+//
+//	struct ColorVertex
+//	{
+//		float			pos[2];
+//		unsigned char	color[4];
+//	};
+//	template<> struct VertexLayout<ColorVertex>
+//	{
+//		static constexpr InputElementDesc elements[] =
+//		{
+//			VERTEX_ELEMENT(ColorVertex, pos, "Position", 0),
+//			VERTEX_ELEMENT(ColorVertex, color, "Color", 0),
+//		};
+//	};
+//
+// The element format comes from the member's type (VertexElementFormat), the
+// offset from offsetof and the stride from sizeof, so the description cannot
+// drift from the struct. VertexFormat<ColorVertex> then provides the element
+// array, count, stride and a 64 bit hash, all constants. The hash equals
+// HashInputElements() of the same elements at run time, so caches keyed by it
+// agree with descs that were put together by hand.
+//
+// VertexFormat<> describes one vertex buffer, slot 0. Layouts that read
+// several streams list their elements with VERTEX_STREAM_ELEMENT instead
+// (see VertexCompression.h), and VERTEX_INSTANCE_ELEMENT for per-instance
+// streams (see InstanceData in DrawQueue.h).
+
+// C++ type of a vertex member -> ElementFormat; specialize for math types
+template<typename T>
+struct VertexElementFormat;
+
+template<> struct VertexElementFormat<float[2]>			{ static constexpr ElementFormat value = ElementFormat::R32G32_Float; };
+template<> struct VertexElementFormat<float[3]>			{ static constexpr ElementFormat value = ElementFormat::R32G32B32_Float; };
+template<> struct VertexElementFormat<float[4]>			{ static constexpr ElementFormat value = ElementFormat::R32G32B32A32_Float; };
+template<> struct VertexElementFormat<Float2>			{ static constexpr ElementFormat value = ElementFormat::R32G32_Float; };
+template<> struct VertexElementFormat<Float3>			{ static constexpr ElementFormat value = ElementFormat::R32G32B32_Float; };
+template<> struct VertexElementFormat<Float4>			{ static constexpr ElementFormat value = ElementFormat::R32G32B32A32_Float; };
+template<> struct VertexElementFormat<unsigned char[4]>	{ static constexpr ElementFormat value = ElementFormat::R8G8B8A8_UNorm; };
+// integers are normalized, as the colors above
+template<> struct VertexElementFormat<signed char[4]>	{ static constexpr ElementFormat value = ElementFormat::R8G8B8A8_SNorm; };
+template<> struct VertexElementFormat<int16_t[2]>		{ static constexpr ElementFormat value = ElementFormat::R16G16_SNorm; };
+template<> struct VertexElementFormat<Half[2]>			{ static constexpr ElementFormat value = ElementFormat::R16G16_Float; };
+template<> struct VertexElementFormat<uint16_t[4]>		{ static constexpr ElementFormat value = ElementFormat::R16G16B16A16_UNorm; };
+
+constexpr unsigned int ElementFormatSize(ElementFormat format) noexcept
+{
+	switch (format)
+	{
+	case ElementFormat::R32G32_Float:		return 8u;
+	case ElementFormat::R32G32B32_Float:	return 12u;
+	case ElementFormat::R32G32B32A32_Float:	return 16u;
+	case ElementFormat::R8G8B8A8_UNorm:		return 4u;
+	case ElementFormat::R8G8B8A8_SNorm:		return 4u;
+	case ElementFormat::R16G16_SNorm:		return 4u;
+	case ElementFormat::R16G16_Float:		return 4u;
+	case ElementFormat::R16G16B16A16_UNorm:	return 8u;
+	}
+	return 0u;
+}
+
+// the mapping above agrees with the sizes
+static_assert(ElementFormatSize(VertexElementFormat<float[2]>::value) == sizeof(float[2]));
+static_assert(ElementFormatSize(VertexElementFormat<float[3]>::value) == sizeof(float[3]));
+static_assert(ElementFormatSize(VertexElementFormat<float[4]>::value) == sizeof(float[4]));
+static_assert(ElementFormatSize(VertexElementFormat<Float2>::value) == sizeof(Float2));
+static_assert(ElementFormatSize(VertexElementFormat<Float3>::value) == sizeof(Float3));
+static_assert(ElementFormatSize(VertexElementFormat<Float4>::value) == sizeof(Float4));
+static_assert(ElementFormatSize(VertexElementFormat<unsigned char[4]>::value) == sizeof(unsigned char[4]));
+static_assert(ElementFormatSize(VertexElementFormat<signed char[4]>::value) == sizeof(signed char[4]));
+static_assert(ElementFormatSize(VertexElementFormat<int16_t[2]>::value) == sizeof(int16_t[2]));
+static_assert(ElementFormatSize(VertexElementFormat<Half[2]>::value) == sizeof(Half[2]));
+static_assert(ElementFormatSize(VertexElementFormat<uint16_t[4]>::value) == sizeof(uint16_t[4]));
+
+#define VERTEX_ELEMENT(type, member, semantic, index) \
+	VERTEX_STREAM_ELEMENT(type, member, semantic, index, 0u)
+// the same for a member of the vertex buffer bound to slot
+#define VERTEX_STREAM_ELEMENT(type, member, semantic, index, slot) \
+	InputElementDesc{ semantic, index, VertexElementFormat<decltype(type::member)>::value, slot, unsigned(offsetof(type, member)) }
+// a member of the per-instance buffer bound to slot, one value per instance
+#define VERTEX_INSTANCE_ELEMENT(type, member, semantic, index, slot) \
+	InputElementDesc{ semantic, index, VertexElementFormat<decltype(type::member)>::value, slot, unsigned(offsetof(type, member)), \
+					  InputClassification::PerInstance, 1u }
+
+// specialized per vertex type, see above
+template<typename Vertex>
+struct VertexLayout;
+
+// hash of an element list; everything that keys input layouts uses this
+constexpr uint64_t HashInputElements(const InputElementDesc* pElements, unsigned int count) noexcept
+{
+	uint64_t hash = HashCombine(HashSeed, count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const InputElementDesc& e = pElements[i];
+		hash = HashString(e.semanticName, hash);
+		hash = HashCombine(hash, e.semanticIndex);
+		hash = HashCombine(hash, uint64_t(e.format));
+		hash = HashCombine(hash, e.inputSlot);
+		hash = HashCombine(hash, e.alignedByteOffset);
+		hash = HashCombine(hash, uint64_t(e.classification));
+		hash = HashCombine(hash, e.instanceDataStepRate);
+	}
+	return hash;
+}
+
+constexpr bool VertexElementsFit(const InputElementDesc* pElements, unsigned int count, unsigned int stride) noexcept
+{
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (pElements[i].alignedByteOffset + ElementFormatSize(pElements[i].format) > stride)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+template<typename Vertex>
+struct VertexFormat
+{
+	static constexpr const InputElementDesc*	pElements	= VertexLayout<Vertex>::elements;
+	static constexpr unsigned int				count		= unsigned(std::size(VertexLayout<Vertex>::elements));
+	static constexpr unsigned int				stride		= unsigned(sizeof(Vertex));
+	static constexpr uint64_t					hash		= HashInputElements(pElements, count);
+
+	static_assert(VertexElementsFit(pElements, count, stride), "vertex element does not fit into the vertex");
+};
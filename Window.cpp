@@ -81,7 +81,7 @@ Window::Window(HINSTANCE hInstance) : Window()
 	hWnd = CreateWindowEx(
 		0, pClassName,"Window",
 		// The style of the window being created. This parameter can be a combination
-		WS_CAPTION | WS_MINIMIZEBOX | WS_SYSMENU, 
+		WS_OVERLAPPEDWINDOW, 
 		CW_USEDEFAULT,CW_USEDEFAULT, width, height,
 		nullptr, nullptr, hInstance, 
 		this // Pointer to a value to be passed to the window through the 
@@ -122,7 +122,7 @@ Window::Window(int w, int h, const char* name) : Window()
 	// function also takes as parameters the window style flag of the window being
 	// created and a Boolean flag indicating whether or not the window has a menu,
 	// which affects the non-client area.
-	if (AdjustWindowRect(&wr, WS_CAPTION | WS_MINIMIZEBOX | WS_SYSMENU, FALSE) == 0)
+	if (AdjustWindowRect(&wr, WS_OVERLAPPEDWINDOW, FALSE) == 0)
 	{
 		throw GHWND_LAST_EXCEPT();
 	}
@@ -130,7 +130,7 @@ Window::Window(int w, int h, const char* name) : Window()
 	// The window is created next by calling the Win32 function CreateWindow.
 	hWnd = CreateWindow(
 		pClassName, name,
-		WS_CAPTION | WS_MINIMIZEBOX | WS_SYSMENU,
+		WS_OVERLAPPEDWINDOW,
 		CW_USEDEFAULT, CW_USEDEFAULT, wr.right - wr.left, wr.bottom - wr.top,
 		nullptr, nullptr, hInst, this
 	);
@@ -412,7 +412,12 @@ Graphics& Window::Gfx()
 
 void Window::OnResize()
 {
-
+	// WM_SIZE can arrive while the window is created, before pGfx exists;
+	// Graphics coalesces the rest into one resize per frame
+	if (pGfx)
+	{
+		pGfx->Resize(unsigned(width), unsigned(height));
+	}
 }
 
 void Window::SetTitle(const std::string& title)
@@ -0,0 +1,58 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+// Timing helpers of the benchmarks. Every benchmark prints one line per
+// measurement, name, value and unit, so runs can be diffed:
+//
+//	const double seconds = BenchSeconds(10, [&] { queue.Issue(device); });
+//	BenchReport("sort + issue, 100k packets", seconds * 1e3, "ms");
+
+// runs fn once to warm up, then `runs` times; returns the fastest run in
+// seconds, which is the least disturbed by the rest of the machine
+template<typename Function>
+double BenchSeconds(int runs, Function&& fn)
+{
+	fn();
+	double best = 1e30;
+	for (int i = 0; i < runs; i++)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		fn();
+		best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	}
+	return best;
+}
+
+inline void BenchReport(const char* name, double value, const char* unit)
+{
+	std::printf("%-56s %12.3f %s\n", name, value, unit);
+	std::fflush(stdout);
+}
+
+// keeps results the benchmark does not otherwise use from being optimized away
+template<typename T>
+void BenchKeep(const T& value) noexcept
+{
+#if defined(__GNUC__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	static const void* volatile sink;
+	sink = &value;
+#endif
+}
+
+// 1, 2, 4, ... up to the hardware threads, and the hardware thread count
+// itself, for thread scaling runs
+template<typename Function>
+void BenchForThreadCounts(Function&& fn)
+{
+	const unsigned int hardware = std::max(1u, std::thread::hardware_concurrency());
+	for (unsigned int threads = 1u; threads < hardware; threads *= 2u)
+	{
+		fn(threads);
+	}
+	fn(hardware);
+}
@@ -0,0 +1,180 @@
+#include "Bvh.h"
+#include "VectorMath.h"
+#include "Bench.h"
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+// Builds (for each thread count), refits and queries a Bvh over 10k, 100k and 1M boxes spread
+// through a cube that grows with the count, so the density stays the same.
+// Refit moves every box a little, the queries are averaged over 1000 calls;
+// a linear scan over all boxes is the baseline for the box query.
+int main()
+{
+	constexpr int QueryCount = 1000;
+
+	for (const uint32_t objectCount : { 10000u, 100000u, 1000000u })
+	{
+		const float extent = 10.0f * std::cbrt(float(objectCount));
+		std::mt19937 rng(17u);
+		std::uniform_real_distribution<float> position(0.0f, extent);
+		std::uniform_real_distribution<float> size(0.5f, 2.0f);
+		std::uniform_real_distribution<float> jitter(-0.1f, 0.1f);
+		std::vector<Bvh::Aabb> boxes(objectCount);
+		for (Bvh::Aabb& box : boxes)
+		{
+			const float s = size(rng);
+			for (int c = 0; c < 3; c++)
+			{
+				box.min[c] = position(rng);
+				box.max[c] = box.min[c] + s;
+			}
+		}
+
+		const std::string count = std::to_string(objectCount / 1000u) + "k";
+		JobSystem jobs(1u);
+		Bvh bvh(jobs);
+		std::vector<Bvh::Handle> handles(objectCount);
+		for (uint32_t i = 0u; i < objectCount; i++)
+		{
+			handles[i] = bvh.Insert(i, boxes[i]);
+		}
+		bvh.Update();
+		BenchForThreadCounts([&](unsigned int threads)
+		{
+			JobSystem buildJobs(threads);
+			Bvh threaded(buildJobs);
+			for (uint32_t i = 0u; i < objectCount; i++)
+			{
+				threaded.Insert(i, boxes[i]);
+			}
+			const double build = BenchSeconds(3, [&] { threaded.Rebuild(); });
+			BenchReport(("build, " + count + ", " + std::to_string(threads) + " thread(s)").c_str(), build * 1e3, "ms");
+		});
+
+		const uint64_t builds = bvh.GetStats().builds;
+		double refit = 1e30;
+		for (int round = 0; round < 4; round++)
+		{
+			for (uint32_t i = 0u; i < objectCount; i++)
+			{
+				const float dx = jitter(rng);
+				Bvh::Aabb& box = boxes[i];
+				box.min[0] += dx;
+				box.max[0] += dx;
+				bvh.Move(handles[i], box);
+			}
+			bvh.Update();
+			refit = std::min(refit, bvh.GetStats().lastRefitSeconds);
+		}
+		BenchReport(("refit, " + count).c_str(), refit * 1e3, "ms");
+		BenchReport(("  rebuilds by refit, " + count).c_str(), double(bvh.GetStats().builds - builds), "");
+
+		struct Query
+		{
+			Bvh::Aabb	box;
+			float		center[3];
+			float		direction[3];
+		};
+		std::vector<Query> queries(QueryCount);
+		std::normal_distribution<float> normal;
+		for (Query& query : queries)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				query.center[c] = position(rng);
+				query.box.min[c] = query.center[c] - 5.0f;
+				query.box.max[c] = query.center[c] + 5.0f;
+				query.direction[c] = normal(rng);
+			}
+			const float length = std::sqrt(query.direction[0] * query.direction[0] + query.direction[1] * query.direction[1] +
+										   query.direction[2] * query.direction[2]);
+			for (float& d : query.direction)
+			{
+				d /= length;
+			}
+		}
+
+		std::vector<uint32_t> ids;
+		size_t found = 0u;
+		const double boxQuery = BenchSeconds(3, [&]
+		{
+			found = 0u;
+			for (const Query& query : queries)
+			{
+				ids.clear();
+				bvh.QueryBox(query.box, ids);
+				found += ids.size();
+			}
+		});
+		BenchReport(("box query, " + count).c_str(), boxQuery / QueryCount * 1e6, "us");
+		BenchReport(("  boxes found per query, " + count).c_str(), double(found) / QueryCount, "");
+
+		const double scan = BenchSeconds(1, [&]
+		{
+			size_t scanned = 0u;
+			for (int q = 0; q < QueryCount / 10; q++)
+			{
+				const Bvh::Aabb& query = queries[q].box;
+				for (const Bvh::Aabb& box : boxes)
+				{
+					scanned += box.min[0] <= query.max[0] && box.max[0] >= query.min[0] &&
+							   box.min[1] <= query.max[1] && box.max[1] >= query.min[1] &&
+							   box.min[2] <= query.max[2] && box.max[2] >= query.min[2];
+				}
+			}
+			BenchKeep(scanned);
+		});
+		BenchReport(("box query, linear scan, " + count).c_str(), scan / (QueryCount / 10) * 1e6, "us");
+
+		const double sphereQuery = BenchSeconds(3, [&]
+		{
+			for (const Query& query : queries)
+			{
+				ids.clear();
+				bvh.QuerySphere(query.center, 5.0f, ids);
+				BenchKeep(ids.size());
+			}
+		});
+		BenchReport(("sphere query, " + count).c_str(), sphereQuery / QueryCount * 1e6, "us");
+
+		size_t hits = 0u;
+		const double rayQuery = BenchSeconds(3, [&]
+		{
+			hits = 0u;
+			for (const Query& query : queries)
+			{
+				hits += bvh.Raycast(query.center, query.direction, 1e30f).has_value();
+			}
+		});
+		BenchReport(("ray, " + count).c_str(), rayQuery / QueryCount * 1e6, "us");
+		BenchReport(("  rays hitting, " + count).c_str(), double(hits), "");
+
+		const Mat4 projection = Mat4::Perspective(1.0f, 16.0f / 9.0f, 0.1f, 100.0f);
+		std::vector<FrustumCuller::Frustum> frustums(QueryCount / 10);
+		for (size_t f = 0u; f < frustums.size(); f++)
+		{
+			const Query& query = queries[f];
+			const Vec3 eye = Vec3::Load(query.center);
+			float toClip[16];
+			(projection * Mat4::LookAt(eye, eye + Vec3::Load(query.direction), Vec3(0.0f, 1.0f, 0.0f))).Store(toClip);
+			frustums[f] = FrustumCuller::ExtractFrustum(toClip);
+		}
+		found = 0u;
+		const double frustumQuery = BenchSeconds(3, [&]
+		{
+			found = 0u;
+			for (const FrustumCuller::Frustum& frustum : frustums)
+			{
+				ids.clear();
+				bvh.QueryFrustum(frustum, ids);
+				found += ids.size();
+			}
+		});
+		BenchReport(("frustum query, 100 m far plane, " + count).c_str(), frustumQuery / frustums.size() * 1e6, "us");
+		BenchReport(("  boxes found per frustum, " + count).c_str(), double(found) / frustums.size(), "");
+	}
+	return 0;
+}
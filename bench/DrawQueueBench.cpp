@@ -0,0 +1,93 @@
+#include "DrawQueue.h"
+#include "RecordingRenderDevice.h"
+#include "Bench.h"
+#include <random>
+#include <vector>
+
+// 100k draw packets of a frame spread over a few pipelines, materials and
+// meshes, queued in random order, then sorted and issued to the
+// RecordingRenderDevice. The baseline issues them as they come with every
+// bind, like drawing immediately did. The second half queues the same
+// draws as instances of the packets' meshes (EnqueueInstance()).
+int main()
+{
+	constexpr size_t PacketCount = 100000u;
+	constexpr uint32_t PipelineCount = 16u;
+	constexpr uint32_t MaterialCount = 64u;
+	constexpr uint32_t MeshCount = 256u;
+	constexpr int Rounds = 10;
+
+	std::mt19937 rng(5u);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::vector<DrawPacket> packets(PacketCount);
+	for (DrawPacket& p : packets)
+	{
+		const uint32_t pipeline = uint32_t(rng() % PipelineCount);
+		const uint32_t mesh = uint32_t(rng() % MeshCount);
+		p.vertexShader = VertexShaderHandle { pipeline / 4u };
+		p.pixelShader = PixelShaderHandle { pipeline };
+		p.inputLayout = InputLayoutHandle { pipeline / 4u };
+		p.vertexBuffer = BufferHandle { 2u * mesh };
+		p.stride = 32u;
+		p.indexBuffer = BufferHandle { 2u * mesh + 1u };
+		p.indexCount = 36u;
+		p.material = uint32_t(rng() % MaterialCount);
+		p.depth = unit(rng);
+	}
+
+	RecordingRenderDevice device;
+	const double immediate = BenchSeconds(Rounds, [&]
+	{
+		device.ResetFrame();
+		for (const DrawPacket& p : packets)
+		{
+			device.SetVertexBuffer(0u, p.vertexBuffer, p.stride, 0u);
+			device.SetIndexBuffer(p.indexBuffer, p.indexFormat, 0u);
+			device.SetVertexShader(p.vertexShader);
+			device.SetPixelShader(p.pixelShader);
+			device.SetInputLayout(p.inputLayout);
+			device.DrawIndexed(p.indexCount, p.startIndex, p.baseVertex);
+		}
+	});
+	BenchReport("100k packets, issued as queued", immediate * 1e3, "ms");
+	BenchReport("  binds", double(device.GetFrameCounters().binds), "");
+
+	DrawQueue queue;
+	const double sorted = BenchSeconds(Rounds, [&]
+	{
+		device.ResetFrame();
+		for (const DrawPacket& p : packets)
+		{
+			queue.Enqueue(p);
+		}
+		queue.Submit(device);
+	});
+	BenchReport("100k packets, enqueue + sort + issue", sorted * 1e3, "ms");
+	BenchReport("  binds", double(device.GetFrameCounters().binds), "");
+	BenchReport("  binds avoided", double(queue.GetStats().stateChangesAvoided), "");
+	BenchReport("  sort passes", double(queue.GetStats().sortPasses), "");
+
+	// one InstanceData per packet and a single material, so all instances
+	// of a mesh and pipeline can become one instanced draw
+	std::vector<InstanceData> instances(PacketCount);
+	std::vector<unsigned char> instanceMemory;
+	const BufferHandle instanceBuffer { 1000000u };
+	const double batched = BenchSeconds(Rounds, [&]
+	{
+		device.ResetFrame();
+		for (size_t i = 0u; i < PacketCount; i++)
+		{
+			DrawPacket p = packets[i];
+			p.material = 0u;
+			p.instanceStride = unsigned(sizeof(InstanceData));
+			queue.EnqueueInstance(p, &instances[i]);
+		}
+		instanceMemory.resize(queue.PrepareInstances());
+		queue.WriteInstances(instanceBuffer, 0u, instanceMemory.data());
+		queue.Submit(device);
+	});
+	BenchReport("100k instances, enqueue + batch + sort + issue", batched * 1e3, "ms");
+	BenchReport("  draws", double(device.GetFrameCounters().draws), "");
+	BenchReport("  binds", double(device.GetFrameCounters().binds), "");
+	return 0;
+}
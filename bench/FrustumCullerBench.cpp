@@ -0,0 +1,85 @@
+#include "FrustumCuller.h"
+#include "VectorMath.h"
+#include "Bench.h"
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+// Culls 1M objects scattered through a 200 m cube against the frustum of a
+// camera in its middle, turning through 64 views; the target is a whole
+// set under 1 ms. Spheres and boxes are timed apart, the scalar
+// CullReference() once as the baseline.
+int main()
+{
+	constexpr uint32_t ObjectCount = 1000000u;
+	constexpr int ViewCount = 64;
+	constexpr int Rounds = 3;
+
+	std::mt19937 rng(11u);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> size(0.1f, 2.0f);
+	std::vector<float> centers(3u * ObjectCount);
+	std::vector<float> radii(ObjectCount);
+	for (uint32_t i = 0u; i < ObjectCount; i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			centers[3u * i + c] = position(rng);
+		}
+		radii[i] = size(rng);
+	}
+
+	const Mat4 projection = Mat4::Perspective(1.0f, 16.0f / 9.0f, 0.1f, 150.0f);
+	std::vector<FrustumCuller::Frustum> frustums(ViewCount);
+	for (int v = 0; v < ViewCount; v++)
+	{
+		const float angle = 6.2831853f * float(v) / float(ViewCount);
+		const Mat4 view = Mat4::LookAt(Vec3(0.0f), Vec3(std::sin(angle), 0.3f * std::sin(3.0f * angle), std::cos(angle)), Vec3(0.0f, 1.0f, 0.0f));
+		float toClip[16];
+		(projection * view).Store(toClip);
+		frustums[v] = FrustumCuller::ExtractFrustum(toClip);
+	}
+
+	std::vector<uint32_t> visible(ObjectCount);
+	auto run = [&](const std::string& name, JobSystem& jobs, bool boxes, bool reference)
+	{
+		FrustumCuller culler(jobs);
+		for (uint32_t i = 0u; i < ObjectCount; i++)
+		{
+			const float* pCenter = &centers[3u * i];
+			if (boxes)
+			{
+				const float min[3] = { pCenter[0] - radii[i], pCenter[1] - radii[i], pCenter[2] - radii[i] };
+				const float max[3] = { pCenter[0] + radii[i], pCenter[1] + radii[i], pCenter[2] + radii[i] };
+				culler.AddBox(i, min, max);
+			}
+			else
+			{
+				culler.AddSphere(i, pCenter, radii[i]);
+			}
+		}
+		size_t visibleTotal = 0u;
+		const double seconds = BenchSeconds(Rounds, [&]
+		{
+			visibleTotal = 0u;
+			for (const FrustumCuller::Frustum& frustum : frustums)
+			{
+				visibleTotal += reference ? culler.CullReference(frustum, visible.data()) : culler.Cull(frustum, visible.data());
+			}
+		}) / ViewCount;
+		BenchReport(name.c_str(), seconds * 1e3, "ms");
+		BenchReport(("  visible, " + name).c_str(), 100.0 * double(visibleTotal) / (double(ViewCount) * ObjectCount), "%");
+	};
+
+	JobSystem serial(1u);
+	run("1M spheres, CullReference()", serial, false, true);
+	BenchForThreadCounts([&](unsigned int threads)
+	{
+		JobSystem jobs(threads);
+		const std::string suffix = ", " + std::to_string(threads) + " thread(s)";
+		run("1M spheres" + suffix, jobs, false, false);
+		run("1M boxes" + suffix, jobs, true, false);
+	});
+	return 0;
+}
@@ -0,0 +1,95 @@
+#include "Graphics.h"
+#include "RecordingRenderDevice.h"
+#include "Bench.h"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+// CPU cost of a test triangle frame (clear, draw, EndFrame()) on the
+// RecordingRenderDevice, which executes nothing, so what is timed is the
+// frame code itself. The baseline is the frame from before the
+// ResourceManager: it reads both shader files and creates the buffers,
+// shaders and input layout again every frame, straight on the device.
+int main()
+{
+	constexpr int Frames = 10000;
+	constexpr int Rounds = 5;
+
+	auto pDevice = std::make_unique<RecordingRenderDevice>(Graphics::ScreenWidth, Graphics::ScreenHeight);
+	RecordingRenderDevice& device = *pDevice;
+	Graphics gfx(std::move(pDevice));
+	const double seconds = BenchSeconds(Rounds, [&]
+	{
+		for (int f = 0; f < Frames; f++)
+		{
+			device.ResetFrame();
+			gfx.ClearBuffer(0.0f, 0.0f, 1.0f);
+			gfx.DrawTestTriangle();
+			gfx.EndFrame();
+		}
+	});
+	const RecordingRenderDevice::Counters& frame = device.GetFrameCounters();
+	BenchReport("frame, resources created once", seconds / Frames * 1e6, "us");
+	BenchReport("  creates per frame", double(frame.creates), "");
+	BenchReport("  binds per frame", double(frame.binds), "");
+
+	// the shader files are as large as the compiled test shaders
+	const std::filesystem::path directory = std::filesystem::temp_directory_path();
+	const std::string shaderPaths[] = { (directory / "GenixBenchVS.cso").string(), (directory / "GenixBenchPS.cso").string() };
+	for (const std::string& path : shaderPaths)
+	{
+		std::ofstream(path, std::ios::binary) << std::string(12u << 10, 'x');
+	}
+	auto readFile = [](const std::string& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		return std::vector<unsigned char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	};
+
+	const float vertices[6][3] = {};
+	const unsigned short indices[12] = {};
+	const InputElementDesc elements[] =
+	{
+		{ "Position", 0u, ElementFormat::R32G32_Float, 0u, 0u },
+		{ "Color", 0u, ElementFormat::R8G8B8A8_UNorm, 0u, 8u },
+	};
+	RecordingRenderDevice baselineDevice(Graphics::ScreenWidth, Graphics::ScreenHeight);
+	const float clearColor[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+	const double baseline = BenchSeconds(Rounds, [&]
+	{
+		for (int f = 0; f < Frames; f++)
+		{
+			baselineDevice.ResetFrame();
+			baselineDevice.ClearBackBuffer(clearColor);
+			const std::vector<unsigned char> vs = readFile(shaderPaths[0]);
+			const std::vector<unsigned char> ps = readFile(shaderPaths[1]);
+			const ShaderBytecode vsCode { vs.data(), vs.size(), "VertexShader.cso", 0u };
+			const ShaderBytecode psCode { ps.data(), ps.size(), "PixelShader.cso", 0u };
+			const BufferHandle vertexBuffer = baselineDevice.CreateBuffer({ BufferType::Vertex, BufferUsage::Default,
+																			unsigned(sizeof(vertices)), 12u, vertices });
+			const BufferHandle indexBuffer = baselineDevice.CreateBuffer({ BufferType::Index, BufferUsage::Default,
+																		   unsigned(sizeof(indices)), 2u, indices });
+			baselineDevice.SetVertexBuffer(0u, vertexBuffer, 12u, 0u);
+			baselineDevice.SetIndexBuffer(indexBuffer, IndexFormat::R16_UInt, 0u);
+			baselineDevice.SetVertexShader(baselineDevice.CreateVertexShader(vsCode));
+			baselineDevice.SetPixelShader(baselineDevice.CreatePixelShader(psCode));
+			baselineDevice.SetInputLayout(baselineDevice.CreateInputLayout(elements, 2u, vsCode));
+			baselineDevice.SetPrimitiveTopology(PrimitiveTopology::TriangleList);
+			baselineDevice.SetBackBufferTarget();
+			baselineDevice.SetViewport({ 0.0f, 0.0f, float(Graphics::ScreenWidth), float(Graphics::ScreenHeight), 0.0f, 1.0f });
+			baselineDevice.DrawIndexed(12u, 0u, 0);
+			baselineDevice.Present();
+		}
+	});
+	for (const std::string& path : shaderPaths)
+	{
+		std::filesystem::remove(path);
+	}
+	BenchReport("frame, everything created and read again", baseline / Frames * 1e6, "us");
+	BenchReport("  creates per frame", double(baselineDevice.GetFrameCounters().creates), "");
+	BenchReport("  binds per frame", double(baselineDevice.GetFrameCounters().binds), "");
+	return 0;
+}
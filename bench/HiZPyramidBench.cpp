@@ -0,0 +1,60 @@
+#include "HiZPyramid.h"
+#include "JobSystem.h"
+#include "Bench.h"
+#include <random>
+#include <string>
+#include <vector>
+
+// Hi-Z pyramid builds of random reversed-Z depth at 720p and 4K: the SIMD
+// build for every thread count against the per texel BuildReference(),
+// next to a plain pass reading the whole depth buffer, which bounds what
+// a build can take.
+int main()
+{
+	constexpr int Rounds = 10;
+	struct Size
+	{
+		const char*		name;
+		unsigned int	width;
+		unsigned int	height;
+	};
+	const Size sizes[] = { { "720p", 1280u, 720u }, { "4K", 3840u, 2160u } };
+
+	std::mt19937 rng(17u);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	for (const Size& size : sizes)
+	{
+		std::vector<float> depth(size_t(size.width) * size.height);
+		for (float& d : depth)
+		{
+			d = unit(rng);
+		}
+		const std::string name = size.name;
+
+		// independent sums, so adding does not limit the pass
+		float sums[16] = {};
+		const double read = BenchSeconds(Rounds, [&]
+		{
+			for (size_t i = 0u; i < depth.size(); i += 16u)
+			{
+				for (size_t k = 0u; k < 16u; k++)
+				{
+					sums[k] += depth[i + k];
+				}
+			}
+		});
+		BenchKeep(sums);
+		BenchReport((name + ", reading the depth buffer").c_str(), read * 1e3, "ms");
+
+		HiZPyramid pyramid;
+		const double reference = BenchSeconds(Rounds, [&] { pyramid.BuildReference(depth.data(), size.width, size.height); });
+		BenchReport((name + ", BuildReference()").c_str(), reference * 1e3, "ms");
+		BenchForThreadCounts([&](unsigned int threads)
+		{
+			JobSystem jobs(threads);
+			const double seconds = BenchSeconds(Rounds, [&] { pyramid.Build(depth.data(), size.width, size.height, &jobs); });
+			BenchReport((name + ", Build(), " + std::to_string(threads) + " thread(s)").c_str(), seconds * 1e3, "ms");
+		});
+	}
+	return 0;
+}
@@ -0,0 +1,142 @@
+#include "DrawQueue.h"
+#include "RecordingRenderDevice.h"
+#include "SoftwareRenderDevice.h"
+#include "Bench.h"
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct Vertex
+	{
+		float			position[2];
+		unsigned char	color[4];
+	};
+
+	constexpr InputElementDesc Elements[] =
+	{
+		{ "Position", 0u, ElementFormat::R32G32_Float, 0u, 0u },
+		{ "Color", 0u, ElementFormat::R8G8B8A8_UNorm, 0u, 8u },
+		DrawQueue::InstanceElements[0],
+		DrawQueue::InstanceElements[1],
+		DrawQueue::InstanceElements[2],
+		DrawQueue::InstanceElements[3],
+	};
+
+	// the instanced test triangle of Graphics, created straight on the device
+	DrawPacket CreateTriangle(IRenderDevice& device)
+	{
+		const Vertex vertices[] = { { { 0.0f, 0.5f }, { 255, 255, 0, 0 } }, { { 0.5f, -0.5f }, { 0, 255, 0, 0 } },
+									{ { -0.5f, -0.5f }, { 0, 0, 255, 0 } } };
+		const uint16_t indices[] = { 0u, 1u, 2u };
+		const ShaderBytecode vertexShader { nullptr, 0u, "InstancedVertexShader.cso", 1u };
+		const ShaderBytecode pixelShader { nullptr, 0u, "PixelShader.cso", 2u };
+		DrawPacket packet;
+		packet.vertexShader = device.CreateVertexShader(vertexShader);
+		packet.pixelShader = device.CreatePixelShader(pixelShader);
+		packet.inputLayout = device.CreateInputLayout(Elements, unsigned(std::size(Elements)), vertexShader);
+		packet.vertexBuffer = device.CreateBuffer({ BufferType::Vertex, BufferUsage::Default, unsigned(sizeof(vertices)),
+													unsigned(sizeof(Vertex)), vertices });
+		packet.stride = sizeof(Vertex);
+		packet.indexBuffer = device.CreateBuffer({ BufferType::Index, BufferUsage::Default, unsigned(sizeof(indices)),
+												   unsigned(sizeof(uint16_t)), indices });
+		packet.indexFormat = IndexFormat::R16_UInt;
+		packet.indexCount = 3u;
+		packet.instanceStride = sizeof(InstanceData);
+		return packet;
+	}
+
+	// one frame as Graphics::EndFrame() issues it, the copies either queued
+	// as instances (EnqueueInstance(), batched into one draw) or as one
+	// draw each reading its instance from the buffer
+	void DrawFrame(IRenderDevice& device, DrawQueue& queue, const DrawPacket& packet, BufferHandle instanceBuffer,
+				   const std::vector<InstanceData>& instances, bool instanced)
+	{
+		const float black[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		device.ClearBackBuffer(black);
+		device.ClearDepth(0.0f);
+		void* pInstances = device.Map(instanceBuffer, MapMode::WriteDiscard);
+		if (instanced)
+		{
+			for (const InstanceData& instance : instances)
+			{
+				queue.EnqueueInstance(packet, &instance);
+			}
+			queue.PrepareInstances();
+			queue.WriteInstances(instanceBuffer, 0u, pInstances);
+		}
+		else
+		{
+			std::memcpy(pInstances, instances.data(), instances.size() * sizeof(InstanceData));
+			DrawPacket draw = packet;
+			draw.instanceBuffer = instanceBuffer;
+			for (size_t i = 0u; i < instances.size(); i++)
+			{
+				draw.instanceOffset = unsigned(i * sizeof(InstanceData));
+				queue.Enqueue(draw);
+			}
+		}
+		device.Unmap(instanceBuffer);
+
+		device.SetPrimitiveTopology(PrimitiveTopology::TriangleList);
+		Viewport viewport;
+		viewport.width = 1280.0f;
+		viewport.height = 720.0f;
+		viewport.maxDepth = 1.0f;
+		device.SetViewport(viewport);
+		device.SetBackBufferTarget();
+		device.SetDepthMode(DepthMode::TestWrite);
+		queue.Submit(device);
+		device.Present();
+	}
+}
+
+// 100k small copies of a triangle in one 1280x720 frame, drawn as instances
+// of one batched draw against one draw per copy. On the
+// RecordingRenderDevice only the CPU side (queueing, batching, sorting,
+// issuing) is timed; the SoftwareRenderDevice renders the frame as well.
+int main()
+{
+	constexpr size_t InstanceCount = 100000u;
+	constexpr int Rounds = 5;
+
+	std::mt19937 rng(22u);
+	std::uniform_real_distribution<float> position(-1.0f, 1.0f);
+	std::vector<InstanceData> instances(InstanceCount);
+	for (InstanceData& instance : instances)
+	{
+		instance = { { 0.02f, 0.0f, 0.0f, position(rng) }, { 0.0f, 0.02f, 0.0f, position(rng) }, { 0.0f, 0.0f, 1.0f, 0.0f },
+					 { uint8_t(rng()), uint8_t(rng()), uint8_t(rng()), 255u } };
+	}
+
+	for (const bool software : { false, true })
+	{
+		std::unique_ptr<IRenderDevice> pDevice;
+		if (software)
+		{
+			pDevice = std::make_unique<SoftwareRenderDevice>(1280u, 720u);
+		}
+		else
+		{
+			pDevice = std::make_unique<RecordingRenderDevice>(1280u, 720u);
+		}
+		IRenderDevice& device = *pDevice;
+		const DrawPacket packet = CreateTriangle(device);
+		const BufferHandle instanceBuffer = device.CreateBuffer({ BufferType::Vertex, BufferUsage::Dynamic,
+																  unsigned(InstanceCount * sizeof(InstanceData)),
+																  unsigned(sizeof(InstanceData)), nullptr });
+		DrawQueue queue;
+		const std::string name = software ? "software" : "recording";
+		for (const bool instanced : { false, true })
+		{
+			const double seconds = BenchSeconds(Rounds, [&] { DrawFrame(device, queue, packet, instanceBuffer, instances, instanced); });
+			BenchReport(("100k triangles, " + std::string(instanced ? "instanced, " : "one draw each, ") + name).c_str(), seconds * 1e3, "ms");
+			BenchReport(("  draws, " + name).c_str(), double(queue.GetStats().packets), "");
+			BenchReport(("  binds, " + name).c_str(), double(queue.GetStats().stateChanges), "");
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,112 @@
+#include "MeshBuilder.h"
+#include "MeshOptimizer.h"
+#include "VectorMath.h"
+#include "Bench.h"
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// a UV sphere of about 2 * segments * rings triangles, clockwise seen
+	// from outside
+	void BuildSphere(unsigned int segments, unsigned int rings, std::vector<float>& positions, std::vector<uint32_t>& indices)
+	{
+		for (unsigned int r = 0u; r <= rings; r++)
+		{
+			const float theta = 3.14159265f * float(r) / float(rings);
+			for (unsigned int s = 0u; s <= segments; s++)
+			{
+				const float phi = 6.28318531f * float(s) / float(segments);
+				positions.push_back(std::sin(theta) * std::cos(phi));
+				positions.push_back(std::cos(theta));
+				positions.push_back(std::sin(theta) * std::sin(phi));
+			}
+		}
+		for (unsigned int r = 0u; r < rings; r++)
+		{
+			for (unsigned int s = 0u; s < segments; s++)
+			{
+				const uint32_t a = r * (segments + 1u) + s;
+				const uint32_t b = a + segments + 1u;
+				if (r != 0u)
+				{
+					indices.insert(indices.end(), { a, a + 1u, b });
+				}
+				if (r != rings - 1u)
+				{
+					indices.insert(indices.end(), { a + 1u, b + 1u, b });
+				}
+			}
+		}
+	}
+}
+
+// Builds the 16 bit chunks and the meshlets of spheres of 65k to 4M
+// triangles in vertex cache order, then culls the meshlets from a camera
+// close to the sphere: how long that takes, and how many meshlets the
+// normal cones and the frustum reject.
+int main()
+{
+	for (const unsigned int segments : { 256u, 1024u, 2048u })
+	{
+		std::vector<float> positions;
+		std::vector<uint32_t> indices;
+		BuildSphere(segments, segments / 2u, positions, indices);
+		const size_t vertexCount = positions.size() / 3u;
+		const size_t triangleCount = indices.size() / 3u;
+		MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), vertexCount);
+		const std::string name = std::to_string(triangleCount / 1000u) + "k triangles";
+
+		const double chunks = BenchSeconds(3, [&]
+		{
+			const MeshBuilder::IndexedMesh mesh = MeshBuilder::BuildIndexedMesh(positions.data(), vertexCount, 3u * sizeof(float),
+																				indices.data(), indices.size());
+			BenchKeep(mesh.chunks.size());
+		});
+		const MeshBuilder::IndexedMesh mesh = MeshBuilder::BuildIndexedMesh(positions.data(), vertexCount, 3u * sizeof(float),
+																			indices.data(), indices.size());
+		BenchReport(("16 bit chunks, " + name).c_str(), triangleCount / chunks * 1e-6, "Mtri/s");
+		BenchReport(("  chunks, " + name).c_str(), double(mesh.chunks.size()), "");
+		BenchReport(("  vertices copied, " + name).c_str(), double(mesh.vertices.size() / (3u * sizeof(float)) - vertexCount), "");
+
+		MeshBuilder::Meshlets meshlets;
+		const double build = BenchSeconds(3, [&]
+		{
+			meshlets = MeshBuilder::BuildMeshlets(indices.data(), indices.size(), positions.data(), 3u * sizeof(float), vertexCount);
+		});
+		BenchReport(("meshlet build, " + name).c_str(), triangleCount / build * 1e-6, "Mtri/s");
+		BenchReport(("  meshlets, " + name).c_str(), double(meshlets.meshlets.size()), "");
+		BenchReport(("  triangles per meshlet, " + name).c_str(), double(triangleCount) / meshlets.meshlets.size(), "");
+		BenchReport(("  vertices per meshlet, " + name).c_str(), double(meshlets.vertices.size()) / meshlets.meshlets.size(), "");
+
+		// close enough that the sphere overflows the view a little
+		const float camera[3] = { 0.0f, 0.3f, -1.8f };
+		float toClip[16];
+		(Mat4::Perspective(1.0f, 16.0f / 9.0f, 0.01f, 100.0f) *
+		 Mat4::LookAt(Vec3::Load(camera), Vec3(0.0f), Vec3(0.0f, 1.0f, 0.0f))).Store(toClip);
+		const FrustumCuller::Frustum frustum = FrustumCuller::ExtractFrustum(toClip);
+		std::vector<uint32_t> visible(meshlets.meshlets.size());
+		size_t visibleCount = 0u;
+		const double cull = BenchSeconds(10, [&]
+		{
+			visibleCount = MeshBuilder::CullMeshlets(meshlets, frustum, camera, visible.data());
+		});
+		size_t backfacing = 0u;
+		for (const MeshBuilder::Meshlet& meshlet : meshlets.meshlets)
+		{
+			backfacing += MeshBuilder::IsBackfacing(meshlet, camera) ? 1u : 0u;
+		}
+		size_t visibleTriangles = 0u;
+		for (size_t i = 0u; i < visibleCount; i++)
+		{
+			visibleTriangles += meshlets.meshlets[visible[i]].triangleCount;
+		}
+		BenchReport(("meshlet cull, " + name).c_str(), cull * 1e3, "ms");
+		BenchReport(("  per meshlet, " + name).c_str(), cull / meshlets.meshlets.size() * 1e9, "ns");
+		BenchReport(("  rejected by cone, " + name).c_str(), 100.0 * backfacing / meshlets.meshlets.size(), "%");
+		BenchReport(("  rejected in all, " + name).c_str(), 100.0 * (meshlets.meshlets.size() - visibleCount) / meshlets.meshlets.size(), "%");
+		BenchReport(("  triangles left, " + name).c_str(), 100.0 * visibleTriangles / triangleCount, "%");
+	}
+	return 0;
+}
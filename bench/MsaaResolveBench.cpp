@@ -0,0 +1,52 @@
+#include "MsaaResolve.h"
+#include "JobSystem.h"
+#include "Bench.h"
+#include <random>
+#include <string>
+#include <vector>
+
+// Resolve throughput of a 1280x720 target per sample count and filter, the
+// SIMD kernels against the per pixel reference, and spread over the
+// JobSystem in 16 row chunks like the software device's Present().
+int main()
+{
+	constexpr unsigned int Width = 1280u;
+	constexpr unsigned int Height = 720u;
+	constexpr unsigned int RowGrain = 16u;
+	constexpr int Rounds = 10;
+
+	std::mt19937 rng(13u);
+	std::vector<uint32_t> dest(Width * Height);
+	for (const unsigned int samples : { 2u, 4u, 8u })
+	{
+		const SampleGrid grid = GetSampleGrid(samples);
+		std::vector<uint32_t> image(size_t(Width) * grid.x * Height * grid.y);
+		for (uint32_t& sample : image)
+		{
+			sample = uint32_t(rng());
+		}
+		for (const ResolveFilter filter : { ResolveFilter::Box, ResolveFilter::Tent })
+		{
+			const std::string name = std::to_string(samples) + "x " + (filter == ResolveFilter::Box ? "box" : "tent");
+			const double reference = BenchSeconds(Rounds, [&]
+			{
+				ResolveSamplesReference(image.data(), dest.data(), Width, Height, samples, filter, 0u, Height);
+			});
+			BenchReport((name + ", reference").c_str(), Width * Height / reference * 1e-6, "Mpix/s");
+			BenchForThreadCounts([&](unsigned int threads)
+			{
+				JobSystem jobs(threads);
+				const double seconds = BenchSeconds(Rounds, [&]
+				{
+					jobs.ParallelFor(Height, RowGrain, [&](size_t begin, size_t end, unsigned int)
+					{
+						ResolveSamples(image.data(), dest.data(), Width, Height, samples, filter, unsigned(begin), unsigned(end));
+					});
+				});
+				BenchReport((name + ", " + std::to_string(threads) + " thread(s)").c_str(), Width * Height / seconds * 1e-6, "Mpix/s");
+			});
+			BenchKeep(dest[0]);
+		}
+	}
+	return 0;
+}
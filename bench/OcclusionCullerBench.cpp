@@ -0,0 +1,111 @@
+#include "OcclusionCuller.h"
+#include "VectorMath.h"
+#include "Bench.h"
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// the 12 triangles of a box, clockwise seen from outside
+	void AddBoxMesh(const OcclusionCuller::Aabb& box, std::vector<float>& positions, std::vector<uint32_t>& indices)
+	{
+		const uint32_t first = uint32_t(positions.size() / 3u);
+		for (int corner = 0; corner < 8; corner++)
+		{
+			positions.push_back(corner & 1 ? box.max[0] : box.min[0]);
+			positions.push_back(corner & 2 ? box.max[1] : box.min[1]);
+			positions.push_back(corner & 4 ? box.max[2] : box.min[2]);
+		}
+		static constexpr uint32_t Faces[12][3] =
+		{
+			{ 0, 2, 3 }, { 0, 3, 1 },	// -z
+			{ 4, 5, 7 }, { 4, 7, 6 },	// +z
+			{ 0, 4, 6 }, { 0, 6, 2 },	// -x
+			{ 1, 3, 7 }, { 1, 7, 5 },	// +x
+			{ 0, 1, 5 }, { 0, 5, 4 },	// -y
+			{ 2, 6, 7 }, { 2, 7, 3 },	// +y
+		};
+		for (const auto& face : Faces)
+		{
+			for (const uint32_t corner : face)
+			{
+				indices.push_back(first + corner);
+			}
+		}
+	}
+}
+
+// A city block seen from street level: 2000 buildings (24k occluder
+// triangles) and 10000 small objects between them, at two culling buffer
+// sizes. Reports the time to rasterize the occluders and to test the
+// boxes, and how many boxes are hidden.
+int main()
+{
+	constexpr size_t BuildingCount = 2000u;
+	constexpr size_t ObjectCount = 10000u;
+	constexpr int Rounds = 10;
+
+	std::mt19937 rng(19u);
+	std::uniform_real_distribution<float> ground(-200.0f, 200.0f);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::vector<float> positions;
+	std::vector<uint32_t> indices;
+	for (size_t i = 0u; i < BuildingCount; i++)
+	{
+		const float x = ground(rng);
+		const float z = ground(rng);
+		const float half = 3.0f + 7.0f * unit(rng);
+		const OcclusionCuller::Aabb building = { { x - half, 0.0f, z - half }, { x + half, 10.0f + 40.0f * unit(rng), z + half } };
+		AddBoxMesh(building, positions, indices);
+	}
+	std::vector<OcclusionCuller::Aabb> objects(ObjectCount);
+	for (OcclusionCuller::Aabb& object : objects)
+	{
+		const float x = ground(rng);
+		const float z = ground(rng);
+		const float size = 0.5f + 1.5f * unit(rng);
+		object = { { x, 0.0f, z }, { x + size, size, z + size } };
+	}
+
+	const Mat4 toClipMatrix = Mat4::Perspective(1.0f, 16.0f / 9.0f, 0.1f, 1000.0f) *
+		Mat4::LookAt(Vec3(0.0f, 2.0f, -220.0f), Vec3(0.0f, 2.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f));
+	float toClip[16];
+	toClipMatrix.Store(toClip);
+
+	struct Size
+	{
+		unsigned int width;
+		unsigned int height;
+	};
+	std::vector<uint32_t> visible(ObjectCount);
+	for (const Size size : { Size { OcclusionCuller::DefaultWidth, OcclusionCuller::DefaultHeight }, Size { 1280u, 720u } })
+	{
+		BenchForThreadCounts([&](unsigned int threads)
+		{
+			JobSystem jobs(threads);
+			OcclusionCuller culler(jobs, size.width, size.height);
+			const std::string name = std::to_string(size.width) + "x" + std::to_string(size.height) + ", " +
+									 std::to_string(threads) + " thread(s)";
+			const double raster = BenchSeconds(Rounds, [&]
+			{
+				culler.BeginFrame();
+				culler.AddOccluder(positions.data(), positions.size() / 3u, indices.data(), indices.size() / 3u, toClip);
+				culler.RasterizeOccluders();
+			});
+			const OcclusionCuller::Stats rasterStats = culler.GetStats();
+			size_t visibleCount = 0u;
+			const double cull = BenchSeconds(Rounds, [&]
+			{
+				visibleCount = culler.CullBoxes(objects.data(), objects.size(), toClip, visible.data());
+			});
+			BenchReport(("24k occluder triangles, " + name).c_str(), raster * 1e3, "ms");
+			BenchReport(("  triangles rasterized, " + name).c_str(), double(rasterStats.trianglesRasterized), "");
+			BenchReport(("10k boxes, " + name).c_str(), cull * 1e3, "ms");
+			BenchReport(("  per box, " + name).c_str(), cull / ObjectCount * 1e9, "ns");
+			BenchReport(("  boxes visible, " + name).c_str(), double(visibleCount), "");
+			BenchReport(("  boxes occluded, " + name).c_str(), double(culler.GetStats().boxesOccluded) / (Rounds + 1), "");
+		});
+	}
+	return 0;
+}
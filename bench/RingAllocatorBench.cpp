@@ -0,0 +1,49 @@
+#include "RingAllocator.h"
+#include "Bench.h"
+#include <random>
+#include <vector>
+
+// Suballocation throughput of the transient ring: frames of allocations of
+// typical dynamic vertex/index/constant sizes, retired three frames later
+// like Graphics does.
+int main()
+{
+	constexpr size_t Capacity = 32u << 20;
+	constexpr int FrameCount = 100;
+	constexpr int AllocationsPerFrame = 10000;
+
+	std::mt19937 rng(5u);
+	std::vector<size_t> sizes(AllocationsPerFrame);
+	std::vector<size_t> aligns(AllocationsPerFrame);
+	for (int i = 0; i < AllocationsPerFrame; i++)
+	{
+		sizes[i] = 16u + rng() % 1024u;
+		aligns[i] = i % 4 == 0 ? 256u : 16u;
+	}
+
+	RingAllocator ring(Capacity);
+	uint64_t fence = 0u;
+	size_t sum = 0u;
+	const double seconds = BenchSeconds(5, [&]
+	{
+		for (int f = 0; f < FrameCount; f++)
+		{
+			for (int i = 0; i < AllocationsPerFrame; i++)
+			{
+				sum += ring.Allocate(sizes[i], aligns[i]);
+			}
+			ring.EndFrame(++fence);
+			if (fence > 3u)
+			{
+				ring.Retire(fence - 3u);
+			}
+		}
+	});
+	BenchKeep(sum);
+
+	const double allocations = double(FrameCount) * AllocationsPerFrame;
+	BenchReport("allocations", allocations / seconds * 1e-6, "M/s");
+	BenchReport("per allocation", seconds / allocations * 1e9, "ns");
+	BenchReport("failed allocations", double(ring.GetStats().failures), "");
+	return 0;
+}
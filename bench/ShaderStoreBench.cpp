@@ -0,0 +1,109 @@
+#include "ResourceManager.h"
+#include "RecordingRenderDevice.h"
+#include "Bench.h"
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// the recording device with the D3D11 device's need for the code, so
+	// the ResourceManager takes the loose file path
+	class BytecodeDevice : public RecordingRenderDevice
+	{
+	public:
+		bool NeedsShaderBytecode() const noexcept override { return true; }
+	};
+
+	// every 64th byte of each shader, so mapped code is paged in as a
+	// device creating the shaders would
+	uint64_t TouchAll(ResourceManager& resources, const std::vector<std::string>& paths)
+	{
+		uint64_t sum = 0u;
+		for (const std::string& path : paths)
+		{
+			const ShaderBytecode code = resources.LoadShaderBytecode(path);
+			const unsigned char* pBytes = static_cast<const unsigned char*>(code.pData);
+			for (size_t i = 0u; i < code.size; i += 64u)
+			{
+				sum += pBytes[i];
+			}
+		}
+		return sum;
+	}
+}
+
+// Loading 600 shader permutations of 12 KB (a third of them duplicates of
+// others) by name, from loose .cso files and from a ShaderStore archive of
+// the same files, each with a new ResourceManager as at startup. The files
+// are in the OS cache after the first run, so disk latency is not part of
+// it.
+int main()
+{
+	constexpr size_t PermutationCount = 600u;
+	constexpr size_t ShaderSize = 12u << 10;
+	constexpr int Rounds = 10;
+
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() / "GenixShaderStoreBench";
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory);
+	std::mt19937 rng(9u);
+	std::vector<std::string> paths;
+	std::vector<std::string> contents;
+	for (size_t i = 0u; i < PermutationCount; i++)
+	{
+		if (i % 3u == 2u)
+		{
+			contents.push_back(contents[rng() % contents.size()]);
+		}
+		else
+		{
+			std::string bytes(ShaderSize, '\0');
+			for (char& c : bytes)
+			{
+				c = char(rng());
+			}
+			contents.push_back(std::move(bytes));
+		}
+		paths.push_back((directory / ("Permutation" + std::to_string(i) + ".cso")).string());
+		std::ofstream(paths.back(), std::ios::binary) << contents.back();
+	}
+	const std::string archive = (directory / "Shaders.pack").string();
+	ShaderStore::Write(archive, paths);
+
+	BytecodeDevice device;
+	uint64_t sum = 0u;
+	const double loose = BenchSeconds(Rounds, [&]
+	{
+		ResourceManager resources(device);
+		sum += TouchAll(resources, paths);
+	});
+	BenchReport("600 shaders, loose files", loose * 1e3, "ms");
+
+	const double mapped = BenchSeconds(Rounds, [&]
+	{
+		ResourceManager resources(device);
+		resources.OpenShaderArchive(archive);
+		sum += TouchAll(resources, paths);
+	});
+	BenchReport("600 shaders, open archive + lookups", mapped * 1e3, "ms");
+
+	ResourceManager resources(device);
+	resources.OpenShaderArchive(archive);
+	const double lookups = BenchSeconds(Rounds, [&]
+	{
+		for (const std::string& path : paths)
+		{
+			sum += resources.LoadShaderBytecode(path).hash;
+		}
+	});
+	BenchReport("600 lookups in an open archive", lookups * 1e3, "ms");
+	BenchReport("  archive blobs (distinct shaders)", double(resources.GetShaderStore().GetBlobCount()), "");
+	BenchReport("  loose files read", double(resources.GetLooseShaderCount()), "");
+	BenchKeep(sum);
+
+	std::filesystem::remove_all(directory);
+	return 0;
+}
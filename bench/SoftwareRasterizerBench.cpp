@@ -0,0 +1,201 @@
+#include "SoftwareRasterizer.h"
+#include "Bench.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	constexpr unsigned int Width = 1280u;
+	constexpr unsigned int Height = 720u;
+
+	struct Mesh
+	{
+		std::vector<SoftwareRasterizer::Vertex>	vertices;
+		std::vector<uint32_t>					indices;
+	};
+
+	// front facing triangles of about `size` pixels on a side, spread over
+	// the screen at random depths, colored by their vertices
+	Mesh MakeTriangles(size_t count, float size, unsigned int seed)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		const float sizeX = 2.0f * size / Width;
+		const float sizeY = 2.0f * size / Height;
+		Mesh mesh;
+		for (size_t t = 0u; t < count; t++)
+		{
+			const float x = -1.0f + 2.0f * unit(rng);
+			const float y = -1.0f + 2.0f * unit(rng);
+			const float z = unit(rng);
+			float corners[3][2];
+			for (auto& corner : corners)
+			{
+				corner[0] = x + sizeX * (unit(rng) - 0.5f);
+				corner[1] = y + sizeY * (unit(rng) - 0.5f);
+			}
+			// clockwise on screen is a negative area with clip space y up
+			const float area = (corners[1][0] - corners[0][0]) * (corners[2][1] - corners[0][1]) -
+							   (corners[1][1] - corners[0][1]) * (corners[2][0] - corners[0][0]);
+			if (area > 0.0f)
+			{
+				std::swap(corners[1], corners[2]);
+			}
+			for (int v = 0; v < 3; v++)
+			{
+				SoftwareRasterizer::Vertex vertex {};
+				vertex.position[0] = corners[v][0];
+				vertex.position[1] = corners[v][1];
+				vertex.position[2] = z;
+				vertex.position[3] = 1.0f;
+				vertex.varyings[v] = 1.0f;
+				mesh.indices.push_back(uint32_t(mesh.vertices.size()));
+				mesh.vertices.push_back(vertex);
+			}
+		}
+		return mesh;
+	}
+
+	int64_t FloorDiv(int64_t a, int64_t b) noexcept
+	{
+		return a >= 0 ? a / b : -((-a + b - 1) / b);
+	}
+
+	// the per pixel loop the software device had before the tile
+	// rasterizer: integer edge functions over the bounding box, one pixel at
+	// a time, perspective correct color, no depth
+	uint64_t RasterizeScalar(const Mesh& mesh, uint32_t* pColor) noexcept
+	{
+		constexpr int64_t SubPixelScale = 16;
+		constexpr int64_t Half = SubPixelScale / 2;
+		uint64_t pixels = 0u;
+		for (size_t t = 0u; t < mesh.indices.size(); t += 3u)
+		{
+			const SoftwareRasterizer::Vertex* v[3];
+			int64_t x[3], y[3];
+			float invW[3];
+			for (int i = 0; i < 3; i++)
+			{
+				v[i] = &mesh.vertices[mesh.indices[t + i]];
+				invW[i] = 1.0f / v[i]->position[3];
+				x[i] = std::llround((v[i]->position[0] * invW[i] * 0.5f + 0.5f) * Width * SubPixelScale);
+				y[i] = std::llround((0.5f - v[i]->position[1] * invW[i] * 0.5f) * Height * SubPixelScale);
+			}
+			const int64_t area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+			if (area <= 0)
+			{
+				continue;
+			}
+			int64_t a[3], b[3], c[3], bias[3];
+			for (int i = 0; i < 3; i++)
+			{
+				const int from = (i + 1) % 3;
+				const int to = (i + 2) % 3;
+				const int64_t dx = x[to] - x[from];
+				const int64_t dy = y[to] - y[from];
+				a[i] = -dy;
+				b[i] = dx;
+				c[i] = dy * x[from] - dx * y[from];
+				bias[i] = (dy == 0 && dx > 0) || dy < 0 ? 0 : -1;
+			}
+			const int64_t px0 = std::max<int64_t>(0, -FloorDiv(-(std::min({ x[0], x[1], x[2] }) - Half), SubPixelScale));
+			const int64_t px1 = std::min<int64_t>(Width - 1, FloorDiv(std::max({ x[0], x[1], x[2] }) - Half, SubPixelScale));
+			const int64_t py0 = std::max<int64_t>(0, -FloorDiv(-(std::min({ y[0], y[1], y[2] }) - Half), SubPixelScale));
+			const int64_t py1 = std::min<int64_t>(Height - 1, FloorDiv(std::max({ y[0], y[1], y[2] }) - Half, SubPixelScale));
+
+			const float invArea = 1.0f / float(area);
+			for (int64_t py = py0; py <= py1; py++)
+			{
+				const int64_t sy = py * SubPixelScale + Half;
+				for (int64_t px = px0; px <= px1; px++)
+				{
+					const int64_t sx = px * SubPixelScale + Half;
+					int64_t e[3];
+					for (int i = 0; i < 3; i++)
+					{
+						e[i] = a[i] * sx + b[i] * sy + c[i];
+					}
+					if (e[0] + bias[0] < 0 || e[1] + bias[1] < 0 || e[2] + bias[2] < 0)
+					{
+						continue;
+					}
+					const float w0 = float(e[0]) * invArea * invW[0];
+					const float w1 = float(e[1]) * invArea * invW[1];
+					const float w2 = float(e[2]) * invArea * invW[2];
+					const float norm = 1.0f / (w0 + w1 + w2);
+					float rgb[3];
+					for (int k = 0; k < 3; k++)
+					{
+						rgb[k] = (w0 * v[0]->varyings[k] + w1 * v[1]->varyings[k] + w2 * v[2]->varyings[k]) * norm;
+					}
+					pColor[py * Width + px] = 0xFF000000u | uint32_t(rgb[0] * 255.0f + 0.5f) << 16 |
+											  uint32_t(rgb[1] * 255.0f + 0.5f) << 8 | uint32_t(rgb[2] * 255.0f + 0.5f);
+					pixels++;
+				}
+			}
+		}
+		return pixels;
+	}
+}
+
+// Triangle and pixel rates of the tile rasterizer at 720p with the vertex
+// color pixel shader, for many small and a few large triangles, without
+// and with depth test, against the per pixel loop it replaced.
+int main()
+{
+	constexpr int Rounds = 5;
+	struct Case
+	{
+		const char*	name;
+		size_t		count;
+		float		size;	// pixels on a side
+	};
+	const Case cases[] =
+	{
+		{ "200k small triangles (4 px)", 200000u, 4.0f },
+		{ "20k medium triangles (32 px)", 20000u, 32.0f },
+		{ "2k large triangles (200 px)", 2000u, 200.0f },
+	};
+
+	std::vector<uint32_t> color(Width * Height);
+	std::vector<float> depth(Width * Height);
+	const CpuPixelShader* pShader = CpuShaderRegistry::FindPixelShader("PixelShader");
+	for (const Case& c : cases)
+	{
+		const Mesh mesh = MakeTriangles(c.count, c.size, 3u);
+		uint64_t scalarPixels = 0u;
+		const double scalar = BenchSeconds(Rounds, [&] { scalarPixels = RasterizeScalar(mesh, color.data()); });
+		const std::string scalarName = std::string(c.name) + ", per pixel loop";
+		BenchReport(scalarName.c_str(), double(c.count) / scalar * 1e-6, "Mtri/s");
+		BenchReport(("  " + scalarName).c_str(), double(scalarPixels) / scalar * 1e-6, "Mpix/s");
+
+		BenchForThreadCounts([&](unsigned int threads)
+		{
+			JobSystem jobs(threads);
+			SoftwareRasterizer rasterizer(jobs);
+			rasterizer.SetRenderTarget(color.data(), Width, Height);
+			rasterizer.SetViewport({ 0.0f, 0.0f, float(Width), float(Height), 0.0f, 1.0f });
+			rasterizer.SetPixelShader(pShader);
+			for (const bool depthTest : { false, true })
+			{
+				rasterizer.SetDepthBuffer(depthTest ? depth.data() : nullptr);
+				rasterizer.SetDepthMode(depthTest ? DepthMode::TestWrite : DepthMode::Disabled);
+				const double seconds = BenchSeconds(Rounds, [&]
+				{
+					std::fill(depth.begin(), depth.end(), 0.0f);
+					rasterizer.ResetStats();
+					rasterizer.DrawTriangles(mesh.vertices.data(), mesh.indices.data(), c.count, 3u);
+				});
+				const SoftwareRasterizer::Stats stats = rasterizer.GetStats();
+				const std::string name = std::string(c.name) + (depthTest ? ", depth test, " : ", ") +
+										 std::to_string(threads) + " thread(s)";
+				BenchReport(name.c_str(), double(c.count) / seconds * 1e-6, "Mtri/s");
+				BenchReport(("  " + name).c_str(), double(stats.pixelsWritten + stats.pixelsDepthFailed) / seconds * 1e-6, "Mpix/s");
+			}
+		});
+	}
+	return 0;
+}
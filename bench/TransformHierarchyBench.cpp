@@ -0,0 +1,89 @@
+#include "TransformHierarchy.h"
+#include "Bench.h"
+#include <random>
+#include <string>
+#include <vector>
+
+// World matrix updates of a 1M node scene graph: 1% of the nodes are roots,
+// the others hang below a random earlier node, at most 6 levels deep, and
+// are added in an order that makes the first Update() reorder them. Each
+// round moves 1%, 10% or all of the nodes and times Update(), against
+// recomputing every world matrix in creation order.
+int main()
+{
+	constexpr uint32_t NodeCount = 1000000u;
+	constexpr int MaxDepth = 6;
+	constexpr int Rounds = 5;
+
+	std::mt19937 rng(7u);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<uint32_t> parents(NodeCount, TransformHierarchy::InvalidNode);
+	std::vector<int> depths(NodeCount, 0);
+	std::vector<Float3> translations(NodeCount);
+	std::vector<Float4> rotations(NodeCount);
+	std::vector<Float3> scales(NodeCount);
+	for (uint32_t i = 0u; i < NodeCount; i++)
+	{
+		const uint32_t parent = i == 0u ? 0u : uint32_t(rng() % i);
+		if (i != 0u && rng() % 100u != 0u && depths[parent] < MaxDepth - 1)
+		{
+			parents[i] = parent;
+			depths[i] = depths[parent] + 1;
+		}
+		Vec3(unit(rng), unit(rng), unit(rng)).Store(translations[i]);
+		Quat::RotationAxis(Normalize(Vec3(unit(rng), unit(rng), unit(rng) + 2.0f)), unit(rng)).Store(rotations[i]);
+		Vec3(1.0f + 0.01f * unit(rng)).Store(scales[i]);
+	}
+
+	std::vector<Mat4> worlds(NodeCount);
+	const double naive = BenchSeconds(Rounds, [&]
+	{
+		for (uint32_t i = 0u; i < NodeCount; i++)
+		{
+			const Mat4 local = Mat4::Transform(Vec3::Load(translations[i]), Quat::Load(rotations[i]), Vec3::Load(scales[i]));
+			worlds[i] = parents[i] == TransformHierarchy::InvalidNode ? local : worlds[parents[i]] * local;
+		}
+	});
+	BenchKeep(worlds[NodeCount - 1u]);
+	BenchReport("all world matrices in creation order", naive * 1e3, "ms");
+
+	BenchForThreadCounts([&](unsigned int threads)
+	{
+		JobSystem jobs(threads);
+		TransformHierarchy hierarchy(jobs);
+		hierarchy.Reserve(NodeCount);
+		std::vector<TransformHierarchy::Node> nodes(NodeCount);
+		for (uint32_t i = 0u; i < NodeCount; i++)
+		{
+			const TransformHierarchy::Node parent = parents[i] == TransformHierarchy::InvalidNode ?
+				TransformHierarchy::InvalidNode : nodes[parents[i]];
+			nodes[i] = hierarchy.AddNode(parent, Vec3::Load(translations[i]), Quat::Load(rotations[i]), Vec3::Load(scales[i]));
+		}
+		hierarchy.Update();
+		const std::string suffix = ", " + std::to_string(threads) + " thread(s)";
+		BenchReport(("first update with reorder" + suffix).c_str(), hierarchy.GetStats().lastSeconds * 1e3, "ms");
+
+		for (const uint32_t percent : { 1u, 10u, 100u })
+		{
+			// only Update() is timed, not the moves that flag the nodes
+			const uint32_t moved = NodeCount / 100u * percent;
+			double best = 1e30;
+			hierarchy.ResetStats();
+			for (int round = 0; round < Rounds; round++)
+			{
+				for (uint32_t j = 0u; j < moved; j++)
+				{
+					const uint32_t i = percent == 100u ? j : uint32_t(rng() % NodeCount);
+					hierarchy.SetTranslation(nodes[i], hierarchy.GetTranslation(nodes[i]) + Vec3(0.001f));
+				}
+				hierarchy.Update();
+				best = std::min(best, hierarchy.GetStats().lastSeconds);
+			}
+			const std::string name = std::to_string(percent) + "% moved" + suffix;
+			BenchReport(name.c_str(), best * 1e3, "ms");
+			BenchReport(("  nodes recomputed, " + name).c_str(),
+						100.0 * double(hierarchy.GetStats().nodesUpdated) / (double(Rounds) * NodeCount), "%");
+		}
+	});
+	return 0;
+}
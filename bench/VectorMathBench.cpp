@@ -0,0 +1,229 @@
+#include "VectorMath.h"
+#include "Bench.h"
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// the scalar baselines: plain float arrays, the loops one would write
+	// without the library
+
+	struct ScalarMatrix
+	{
+		float m[16];
+	};
+
+	ScalarMatrix Multiply(const ScalarMatrix& a, const ScalarMatrix& b) noexcept
+	{
+		ScalarMatrix r;
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				float sum = 0.0f;
+				for (int k = 0; k < 4; k++)
+				{
+					sum += a.m[4 * i + k] * b.m[4 * k + j];
+				}
+				r.m[4 * i + j] = sum;
+			}
+		}
+		return r;
+	}
+
+	void TransformPointsScalar(const float m[16], const float* pIn, float* pOut, size_t count) noexcept
+	{
+		for (size_t i = 0u; i < count; i++)
+		{
+			const float* p = pIn + 3u * i;
+			for (int r = 0; r < 3; r++)
+			{
+				pOut[3u * i + r] = m[4 * r] * p[0] + m[4 * r + 1] * p[1] + m[4 * r + 2] * p[2] + m[4 * r + 3];
+			}
+		}
+	}
+
+	struct ScalarQuat
+	{
+		float q[4];
+	};
+
+	ScalarQuat SlerpScalar(const ScalarQuat& a, const ScalarQuat& b, float t) noexcept
+	{
+		float cosAngle = a.q[0] * b.q[0] + a.q[1] * b.q[1] + a.q[2] * b.q[2] + a.q[3] * b.q[3];
+		float sign = 1.0f;
+		if (cosAngle < 0.0f)
+		{
+			cosAngle = -cosAngle;
+			sign = -1.0f;
+		}
+		ScalarQuat r;
+		if (cosAngle > 0.9995f)
+		{
+			float length = 0.0f;
+			for (int c = 0; c < 4; c++)
+			{
+				r.q[c] = a.q[c] + t * (sign * b.q[c] - a.q[c]);
+				length += r.q[c] * r.q[c];
+			}
+			length = std::sqrt(length);
+			for (float& c : r.q)
+			{
+				c /= length;
+			}
+			return r;
+		}
+		const float angle = std::acos(cosAngle);
+		const float invSin = 1.0f / std::sin(angle);
+		const float wa = std::sin((1.0f - t) * angle) * invSin;
+		const float wb = sign * std::sin(t * angle) * invSin;
+		for (int c = 0; c < 4; c++)
+		{
+			r.q[c] = wa * a.q[c] + wb * b.q[c];
+		}
+		return r;
+	}
+}
+
+// The VectorMath kernels against scalar loops over plain floats, compiled
+// with the same flags: 4096 matrix products (a cache resident batch, like a
+// hierarchy's world matrices), 16k and 1M points through one matrix, and
+// 64k quaternion slerps. Times are per operation.
+int main()
+{
+	constexpr size_t MatrixCount = 4096u;
+	constexpr size_t QuatCount = 65536u;
+	constexpr int Rounds = 20;
+
+	std::mt19937 rng(24u);
+	std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+
+	std::vector<ScalarMatrix> scalarA(MatrixCount), scalarB(MatrixCount), scalarOut(MatrixCount);
+	std::vector<Mat4> a(MatrixCount), b(MatrixCount), out(MatrixCount);
+	for (size_t i = 0u; i < MatrixCount; i++)
+	{
+		for (int e = 0; e < 16; e++)
+		{
+			scalarA[i].m[e] = value(rng);
+			scalarB[i].m[e] = value(rng);
+		}
+		a[i] = Mat4::Load(scalarA[i].m);
+		b[i] = Mat4::Load(scalarB[i].m);
+	}
+	const double scalarMultiply = BenchSeconds(Rounds, [&]
+	{
+		for (size_t i = 0u; i < MatrixCount; i++)
+		{
+			scalarOut[i] = Multiply(scalarA[i], scalarB[i]);
+		}
+		BenchKeep(scalarOut[0].m[0]);
+	});
+	const double multiply = BenchSeconds(Rounds, [&]
+	{
+		MultiplyMatrices(a.data(), b.data(), out.data(), MatrixCount);
+		BenchKeep(out[0]);
+	});
+	const double multiply8 = BenchSeconds(Rounds, [&]
+	{
+		for (size_t i = 0u; i < MatrixCount; i += SimdWidth)
+		{
+			(Mat4x8::Load(&a[i]) * Mat4x8::Load(&b[i])).Store(&out[i]);
+		}
+		BenchKeep(out[0]);
+	});
+	// batches that stay in SoA form, as a system keeping its matrices in
+	// Mat4x8 would hold them
+	std::vector<Mat4x8> a8(MatrixCount / SimdWidth), b8(MatrixCount / SimdWidth), out8(MatrixCount / SimdWidth);
+	for (size_t i = 0u; i < a8.size(); i++)
+	{
+		a8[i] = Mat4x8::Load(&a[i * SimdWidth]);
+		b8[i] = Mat4x8::Load(&b[i * SimdWidth]);
+	}
+	const double multiplySoA = BenchSeconds(Rounds, [&]
+	{
+		for (size_t i = 0u; i < a8.size(); i++)
+		{
+			out8[i] = a8[i] * b8[i];
+		}
+		BenchKeep(out8[0]);
+	});
+	BenchReport("mat4 * mat4, scalar", scalarMultiply / MatrixCount * 1e9, "ns");
+	BenchReport("mat4 * mat4, Mat4", multiply / MatrixCount * 1e9, "ns");
+	BenchReport("mat4 * mat4, Mat4x8 with AoS <-> SoA", multiply8 / MatrixCount * 1e9, "ns");
+	BenchReport("mat4 * mat4, Mat4x8 kept in SoA", multiplySoA / MatrixCount * 1e9, "ns");
+
+	const Mat4 transform = Mat4::Transform(Vec3(1.0f, 2.0f, 3.0f), Quat::RotationAxis(Vec3(0.0f, 1.0f, 0.0f), 0.5f), Vec3(2.0f));
+	float transformFloats[16];
+	transform.Store(transformFloats);
+	for (const size_t pointCount : { size_t(16384u), size_t(1u) << 20 })
+	{
+		std::vector<float> aos(3u * pointCount), aosOut(3u * pointCount);
+		std::vector<float> x(pointCount), y(pointCount), z(pointCount), outX(pointCount), outY(pointCount), outZ(pointCount);
+		for (size_t i = 0u; i < pointCount; i++)
+		{
+			x[i] = aos[3u * i] = value(rng);
+			y[i] = aos[3u * i + 1u] = value(rng);
+			z[i] = aos[3u * i + 2u] = value(rng);
+		}
+		const int rounds = pointCount > 100000u ? 5 : Rounds;
+		const double scalarTransform = BenchSeconds(rounds, [&]
+		{
+			TransformPointsScalar(transformFloats, aos.data(), aosOut.data(), pointCount);
+			BenchKeep(aosOut[0]);
+		});
+		const double pointTransform = BenchSeconds(rounds, [&]
+		{
+			for (size_t i = 0u; i < pointCount; i++)
+			{
+				TransformPoint(transform, Vec3::Load(&aos[3u * i])).Store(&aosOut[3u * i]);
+			}
+			BenchKeep(aosOut[0]);
+		});
+		const double batchTransform = BenchSeconds(rounds, [&]
+		{
+			TransformPoints(transform, x.data(), y.data(), z.data(), pointCount, outX.data(), outY.data(), outZ.data());
+			BenchKeep(outX[0]);
+		});
+		const std::string count = pointCount > 100000u ? "1M" : "16k";
+		BenchReport(("transform points, scalar, " + count).c_str(), scalarTransform / pointCount * 1e9, "ns");
+		BenchReport(("transform points, Vec3 one by one, " + count).c_str(), pointTransform / pointCount * 1e9, "ns");
+		BenchReport(("transform points, TransformPoints, " + count).c_str(), batchTransform / pointCount * 1e9, "ns");
+	}
+
+	std::vector<ScalarQuat> scalarFrom(QuatCount), scalarTo(QuatCount), scalarResult(QuatCount);
+	std::vector<Quat> from(QuatCount), to(QuatCount), result(QuatCount);
+	std::vector<float> weights(QuatCount);
+	std::uniform_real_distribution<float> angle(-3.0f, 3.0f);
+	for (size_t i = 0u; i < QuatCount; i++)
+	{
+		from[i] = Quat::RotationAxis(Normalize(Vec3(value(rng), value(rng), value(rng))), angle(rng));
+		to[i] = Quat::RotationAxis(Normalize(Vec3(value(rng), value(rng), value(rng))), angle(rng));
+		Float4 f;
+		from[i].Store(f);
+		scalarFrom[i] = { { f.x, f.y, f.z, f.w } };
+		to[i].Store(f);
+		scalarTo[i] = { { f.x, f.y, f.z, f.w } };
+		weights[i] = 0.5f * (value(rng) + 1.0f);
+	}
+	const double scalarSlerp = BenchSeconds(Rounds, [&]
+	{
+		for (size_t i = 0u; i < QuatCount; i++)
+		{
+			scalarResult[i] = SlerpScalar(scalarFrom[i], scalarTo[i], weights[i]);
+		}
+		BenchKeep(scalarResult[0].q[0]);
+	});
+	const double slerp = BenchSeconds(Rounds, [&]
+	{
+		for (size_t i = 0u; i < QuatCount; i++)
+		{
+			result[i] = Slerp(from[i], to[i], weights[i]);
+		}
+		BenchKeep(result[0]);
+	});
+	BenchReport("slerp, scalar", scalarSlerp / QuatCount * 1e9, "ns");
+	BenchReport("slerp, Quat", slerp / QuatCount * 1e9, "ns");
+	return 0;
+}
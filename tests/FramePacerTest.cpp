@@ -0,0 +1,216 @@
+#include "FramePacer.h"
+#include "Test.h"
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// Time only moves when the pacer or the simulated frame says so. Sleeps
+	// wake on the next 1 ms tick like a coarse OS timer.
+	class SimulatedClock : public IFrameClock
+	{
+	public:
+		double Now() override { return now; }
+		void Sleep(double seconds) override
+		{
+			sleeps++;
+			now = std::ceil((now + seconds) / SleepQuantum) * SleepQuantum;
+		}
+		void Spin() override { now += SpinStep; }
+
+		void Advance(double seconds) noexcept { now += seconds; }
+
+		static constexpr double SleepQuantum = 0.001;
+		static constexpr double SpinStep = 1e-6;
+		double now { 1.0 };
+		int sleeps { 0 };
+	};
+
+	// Present() of a display refreshing at refreshRate: with vsync it returns
+	// on the next vertical blank, otherwise at once
+	class SimulatedPresenter
+	{
+	public:
+		SimulatedPresenter(SimulatedClock& clock, double refreshRate) noexcept
+			: clock(clock), period(1.0 / refreshRate) {}
+
+		void Present(PresentMode mode)
+		{
+			if (mode == PresentMode::VSync)
+			{
+				clock.now = (std::floor(clock.now / period) + 1.0) * period;
+			}
+			presents.push_back(clock.now);
+		}
+
+		SimulatedClock& clock;
+		double period;
+		std::vector<double> presents;
+	};
+
+	struct FrameLog
+	{
+		std::vector<double> starts;		// when the frame's CPU work began
+		std::vector<double> presents;
+	};
+
+	// frames of cpuTime +- jitter seconds through pacer and presenter
+	FrameLog RunFrames(FramePacer& pacer, SimulatedClock& clock, SimulatedPresenter& presenter,
+					   int frames, double cpuTime, double jitter = 0.0)
+	{
+		std::mt19937 rng(3u);
+		std::uniform_real_distribution<double> noise(-jitter, jitter);
+		FrameLog log;
+		for (int i = 0; i < frames; i++)
+		{
+			log.starts.push_back(clock.Now());
+			clock.Advance(cpuTime + noise(rng));
+			pacer.BeforePresent();
+			presenter.Present(pacer.GetPresentMode());
+			log.presents.push_back(clock.Now());
+			pacer.FrameEnd();
+		}
+		return log;
+	}
+
+	void TestPolicyDeviceSettings()
+	{
+		SimulatedClock clock;
+		FramePacer pacer(clock);
+		CHECK(pacer.GetPresentMode() == PresentMode::VSync);
+		pacer.SetPolicy(FramePacer::Policy::Uncapped);
+		CHECK(pacer.GetPresentMode() == PresentMode::Immediate);
+		pacer.SetPolicy(FramePacer::Policy::FixedRate, 100.0);
+		CHECK(pacer.GetPresentMode() == PresentMode::Immediate);
+		pacer.SetPolicy(FramePacer::Policy::LowLatency, 60.0);
+		CHECK(pacer.GetPresentMode() == PresentMode::VSync);
+		CHECK(pacer.GetMaxFrameLatency() == 1u);
+	}
+
+	void TestUncappedNeverWaits()
+	{
+		SimulatedClock clock;
+		SimulatedPresenter presenter(clock, 60.0);
+		FramePacer pacer(clock);
+		pacer.SetPolicy(FramePacer::Policy::Uncapped);
+		RunFrames(pacer, clock, presenter, 100, 0.003);
+		CHECK(clock.sleeps == 0);
+		CHECK(pacer.GetStats().sleepTime == 0.0);
+		CHECK(pacer.GetStats().spinTime == 0.0);
+		CHECK_NEAR(pacer.GetStats().meanFrameTime, 0.003, 1e-9);
+	}
+
+	void TestFixedRateHitsTarget()
+	{
+		SimulatedClock clock;
+		SimulatedPresenter presenter(clock, 60.0);
+		FramePacer pacer(clock);
+		pacer.SetPolicy(FramePacer::Policy::FixedRate, 100.0);
+		RunFrames(pacer, clock, presenter, 20, 0.004, 0.0005);
+		pacer.ResetStats();
+		const FrameLog log = RunFrames(pacer, clock, presenter, 500, 0.004, 0.0005);
+
+		const FramePacer::Stats& stats = pacer.GetStats();
+		CHECK(stats.missedDeadlines == 0u);
+		CHECK_NEAR(stats.meanFrameTime, 0.010, 1e-5);
+		// the spin step is the only error left
+		CHECK(std::sqrt(stats.frameTimeVariance) < 1e-5);
+		// sleeping does the bulk of the waiting, spinning the last bit
+		CHECK(stats.sleepTime > stats.spinTime);
+		CHECK_NEAR(log.presents.back() - log.presents.front(), 499 * 0.010, 1e-4);
+	}
+
+	void TestFixedRateMissRestartsSchedule()
+	{
+		SimulatedClock clock;
+		SimulatedPresenter presenter(clock, 60.0);
+		FramePacer pacer(clock);
+		pacer.SetPolicy(FramePacer::Policy::FixedRate, 100.0);
+		// every frame is too slow: no frame is delayed to catch up on the
+		// missed deadlines, so frames are as long as their CPU work
+		RunFrames(pacer, clock, presenter, 100, 0.015);
+		CHECK(pacer.GetStats().missedDeadlines >= 99u);
+		CHECK_NEAR(pacer.GetStats().meanFrameTime, 0.015, 1e-5);
+
+		// back under budget the rate recovers
+		RunFrames(pacer, clock, presenter, 20, 0.004);
+		pacer.ResetStats();
+		const uint64_t missed = pacer.GetStats().missedDeadlines;
+		RunFrames(pacer, clock, presenter, 100, 0.004);
+		CHECK(pacer.GetStats().missedDeadlines == missed);
+		CHECK_NEAR(pacer.GetStats().meanFrameTime, 0.010, 1e-5);
+	}
+
+	void TestLowLatencyStartsLate()
+	{
+		SimulatedClock clock;
+		SimulatedPresenter presenter(clock, 60.0);
+		FramePacer pacer(clock);
+		pacer.SetPolicy(FramePacer::Policy::LowLatency, 60.0);
+		constexpr double CpuTime = 0.004;
+		RunFrames(pacer, clock, presenter, 30, CpuTime);
+		pacer.ResetStats();
+		const FrameLog log = RunFrames(pacer, clock, presenter, 200, CpuTime);
+
+		// one frame per refresh, and from the start of a frame to its
+		// present much less than the refresh period (without pacing it
+		// would be the whole period)
+		CHECK_NEAR(pacer.GetStats().meanFrameTime, 1.0 / 60.0, 1e-5);
+		double worstLatency = 0.0;
+		for (size_t i = 0; i < log.starts.size(); i++)
+		{
+			worstLatency = std::max(worstLatency, log.presents[i] - log.starts[i]);
+		}
+		CHECK(worstLatency < 0.5 / 60.0);
+		CHECK(worstLatency >= CpuTime);
+		CHECK_NEAR(pacer.GetStats().predictedCpuTime, CpuTime, 1e-9);
+	}
+
+	void TestVarianceMatchesFrameTimes()
+	{
+		SimulatedClock clock;
+		SimulatedPresenter presenter(clock, 60.0);
+		FramePacer pacer(clock);
+		pacer.SetPolicy(FramePacer::Policy::Uncapped);
+		const FrameLog log = RunFrames(pacer, clock, presenter, 300, 0.005, 0.002);
+
+		// FrameEnd() to FrameEnd() is present to present here
+		std::vector<double> times;
+		for (size_t i = 1; i < log.presents.size(); i++)
+		{
+			times.push_back(log.presents[i] - log.presents[i - 1]);
+		}
+		double mean = 0.0;
+		for (double t : times)
+		{
+			mean += t;
+		}
+		mean /= double(times.size());
+		double variance = 0.0;
+		double maximum = 0.0;
+		for (double t : times)
+		{
+			variance += (t - mean) * (t - mean);
+			maximum = std::max(maximum, t);
+		}
+		variance /= double(times.size() - 1u);
+
+		const FramePacer::Stats& stats = pacer.GetStats();
+		CHECK(stats.frames == times.size());
+		CHECK_NEAR(stats.meanFrameTime, mean, 1e-12);
+		CHECK_NEAR(stats.frameTimeVariance, variance, 1e-12);
+		CHECK_NEAR(stats.maxFrameTime, maximum, 1e-12);
+	}
+}
+
+int main()
+{
+	TestPolicyDeviceSettings();
+	TestUncappedNeverWaits();
+	TestFixedRateHitsTarget();
+	TestFixedRateMissRestartsSchedule();
+	TestLowLatencyStartsLate();
+	TestVarianceMatchesFrameTimes();
+	return TestResult();
+}
@@ -0,0 +1,81 @@
+#include "Graphics.h"
+#include "RecordingRenderDevice.h"
+#include "Test.h"
+#include <memory>
+
+namespace
+{
+	using CallType = RecordingRenderDevice::CallType;
+
+	void Frame(Graphics& gfx)
+	{
+		gfx.ClearBuffer(0.0f, 0.0f, 1.0f);
+		gfx.DrawTestTriangle();
+		gfx.EndFrame();
+	}
+
+	unsigned int CountCalls(const RecordingRenderDevice& device, CallType type)
+	{
+		unsigned int count = 0u;
+		for (const RecordingRenderDevice::Call& call : device.GetFrameCalls())
+		{
+			count += call.type == type ? 1u : 0u;
+		}
+		return count;
+	}
+
+	// everything is created by the constructor; the first frame binds every
+	// slot it uses once, later ones only the back buffer again, which the
+	// flip model unbinds on present
+	void TestTestTriangleFrames()
+	{
+		auto pDevice = std::make_unique<RecordingRenderDevice>(Graphics::ScreenWidth, Graphics::ScreenHeight);
+		RecordingRenderDevice& device = *pDevice;
+		Graphics gfx(std::move(pDevice));
+		// vertex and index buffer, transient and indirect args buffer,
+		// both shaders and the input layout
+		CHECK(device.GetTotalCounters().creates == 7u);
+
+		// topology, viewport, back buffer, depth mode, both shaders, input
+		// layout, vertex and index buffer
+		device.ResetFrame();
+		Frame(gfx);
+		const RecordingRenderDevice::Counters& first = device.GetFrameCounters();
+		CHECK(first.creates == 0u);
+		CHECK(first.binds == 9u);
+		CHECK(first.maps == 0u);
+		CHECK(first.clears == 2u);
+		CHECK(first.draws == 1u);
+		CHECK(first.presents == 1u);
+		CHECK(gfx.GetStateStats().issued == 9u);
+		CHECK(gfx.GetStateStats().filtered == 0u);
+
+		device.ResetFrame();
+		Frame(gfx);
+		const RecordingRenderDevice::Counters& second = device.GetFrameCounters();
+		CHECK(second.creates == 0u);
+		CHECK(second.binds == 1u);
+		CHECK(CountCalls(device, CallType::SetBackBufferTarget) == 1u);
+		CHECK(second.draws == 1u);
+		CHECK(second.presents == 1u);
+		CHECK(gfx.GetStateStats().issued == 1u);
+		CHECK(gfx.GetStateStats().filtered == 8u);
+
+		// the draw is the whole test triangle
+		const std::vector<RecordingRenderDevice::Call>& calls = device.GetFrameCalls();
+		CHECK(calls.size() >= 2u);
+		if (calls.size() >= 2u)
+		{
+			CHECK(calls[calls.size() - 2u].type == CallType::DrawIndexed);
+			CHECK(calls[calls.size() - 2u].id == gfx.GetTestTriangleIndexCount());
+			CHECK(calls.back().type == CallType::Present);
+		}
+		CHECK(device.GetTotalCounters().creates == 7u);
+	}
+}
+
+int main()
+{
+	TestTestTriangleFrames();
+	return TestResult();
+}
@@ -0,0 +1,209 @@
+#include "DrawQueue.h"
+#include "IndirectDrawBuilder.h"
+#include "RecordingRenderDevice.h"
+#include "Test.h"
+#include <cstddef>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// clip space is the world: visible where -1 <= x, y <= 1 and 0 <= z <= 1
+	constexpr float Identity[16] =
+	{
+		1.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f,
+	};
+
+	struct Instance
+	{
+		uint32_t	id;
+		float		payload[4];
+	};
+
+	struct Scene
+	{
+		std::vector<uint32_t>	draws;			// per instance
+		std::vector<bool>		visible;		// per instance
+	};
+
+	// instances well inside or well outside the frustum, so which ones are
+	// visible does not depend on how exact the culling is
+	Scene Fill(IndirectDrawBuilder& builder, size_t drawCount, size_t instanceCount, unsigned int seed)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> inside(-0.5f, 0.5f);
+		for (size_t d = 0u; d < drawCount; d++)
+		{
+			builder.AddDraw(unsigned(3u * (d + 1u)), unsigned(100u * d), int(d) - 2);
+		}
+		Scene scene;
+		for (size_t i = 0u; i < instanceCount; i++)
+		{
+			const uint32_t draw = uint32_t(rng() % drawCount);
+			const bool visible = rng() % 3u != 0u;
+			const float center[3] = { visible ? inside(rng) : 4.0f + inside(rng), inside(rng), 0.5f + inside(rng) * 0.5f };
+			const Instance data = { uint32_t(i), { center[0], center[1], center[2], float(draw) } };
+			builder.AddInstance(draw, center, 0.01f, &data);
+			scene.draws.push_back(draw);
+			scene.visible.push_back(visible);
+		}
+		return scene;
+	}
+
+	void TestArgsLayout()
+	{
+		// the GPU reads the arguments as five consecutive 32 bit values
+		CHECK(sizeof(DrawIndexedIndirectArgs) == 20u);
+		CHECK(offsetof(DrawIndexedIndirectArgs, indexCountPerInstance) == 0u);
+		CHECK(offsetof(DrawIndexedIndirectArgs, instanceCount) == 4u);
+		CHECK(offsetof(DrawIndexedIndirectArgs, startIndexLocation) == 8u);
+		CHECK(offsetof(DrawIndexedIndirectArgs, baseVertexLocation) == 12u);
+		CHECK(offsetof(DrawIndexedIndirectArgs, startInstanceLocation) == 16u);
+	}
+
+	// Write() against a compaction done here, and bit for bit against
+	// WriteReference(), on enough instances for many chunks
+	void TestCompaction(unsigned int threads, size_t drawCount, size_t instanceCount)
+	{
+		JobSystem jobs(threads);
+		IndirectDrawBuilder builder(jobs, sizeof(Instance));
+		const Scene scene = Fill(builder, drawCount, instanceCount, 7u + threads);
+
+		const size_t visible = builder.Cull(Identity);
+		size_t expectedVisible = 0u;
+		std::vector<std::vector<uint32_t>> expected(drawCount);
+		for (size_t i = 0u; i < instanceCount; i++)
+		{
+			if (scene.visible[i])
+			{
+				expected[scene.draws[i]].push_back(uint32_t(i));
+				expectedVisible++;
+			}
+		}
+		CHECK(visible == expectedVisible);
+
+		// filled with garbage first, the writes must cover all of it
+		std::vector<DrawIndexedIndirectArgs> args(drawCount);
+		std::vector<Instance> instances(visible);
+		std::memset(args.data(), 0xCD, args.size() * sizeof(args[0]));
+		std::memset(instances.data(), 0xCD, instances.size() * sizeof(instances[0]));
+		builder.Write(args.data(), instances.data());
+
+		uint32_t first = 0u;
+		for (size_t d = 0u; d < drawCount; d++)
+		{
+			CHECK(args[d].indexCountPerInstance == 3u * (d + 1u));
+			CHECK(args[d].startIndexLocation == 100u * d);
+			CHECK(args[d].baseVertexLocation == int32_t(d) - 2);
+			CHECK(args[d].startInstanceLocation == first);
+			if (!CHECK(args[d].instanceCount == expected[d].size()))
+			{
+				return;
+			}
+			// each draw's instances in the order they were added
+			for (size_t k = 0u; k < expected[d].size(); k++)
+			{
+				const Instance& instance = instances[first + k];
+				CHECK(instance.id == expected[d][k]);
+				CHECK(instance.payload[3] == float(d));
+			}
+			first += args[d].instanceCount;
+		}
+		CHECK(first == visible);
+
+		std::vector<DrawIndexedIndirectArgs> referenceArgs(drawCount);
+		std::vector<Instance> referenceInstances(visible);
+		std::memset(referenceArgs.data(), 0x5A, referenceArgs.size() * sizeof(referenceArgs[0]));
+		std::memset(referenceInstances.data(), 0x5A, referenceInstances.size() * sizeof(referenceInstances[0]));
+		builder.WriteReference(referenceArgs.data(), referenceInstances.data());
+		CHECK(std::memcmp(args.data(), referenceArgs.data(), args.size() * sizeof(args[0])) == 0);
+		CHECK(std::memcmp(instances.data(), referenceInstances.data(), instances.size() * sizeof(instances[0])) == 0);
+
+		// a second Write() for the same Cull() gives the same bytes
+		std::vector<Instance> again(visible);
+		builder.Write(args.data(), again.data());
+		CHECK(std::memcmp(again.data(), instances.data(), again.size() * sizeof(again[0])) == 0);
+	}
+
+	// draws whose instances are all culled keep their arguments with an
+	// instance count of 0, and the draws after them still line up
+	void TestEmptyDraws()
+	{
+		JobSystem jobs(1u);
+		IndirectDrawBuilder builder(jobs, sizeof(Instance));
+		for (int d = 0; d < 3; d++)
+		{
+			builder.AddDraw(36u, 0u, 0);
+		}
+		const float in[3] = { 0.0f, 0.0f, 0.5f };
+		const float out[3] = { 0.0f, 9.0f, 0.5f };
+		const Instance data = {};
+		builder.AddInstance(0u, in, 0.1f, &data);
+		builder.AddInstance(1u, out, 0.1f, &data);
+		builder.AddInstance(2u, in, 0.1f, &data);
+		CHECK(builder.Cull(Identity) == 2u);
+		DrawIndexedIndirectArgs args[3];
+		Instance instances[2];
+		builder.Write(args, instances);
+		CHECK(args[0].instanceCount == 1u && args[0].startInstanceLocation == 0u);
+		CHECK(args[1].instanceCount == 0u && args[1].startInstanceLocation == 1u);
+		CHECK(args[2].instanceCount == 1u && args[2].startInstanceLocation == 1u);
+	}
+
+	// an indirect packet is drawn whatever its (unused) instanceCount says
+	void TestQueueIssuesIndirectPackets()
+	{
+		RecordingRenderDevice device;
+		const BufferHandle args = device.CreateBuffer({ BufferType::IndirectArgs, BufferUsage::Dynamic,
+														4u * sizeof(DrawIndexedIndirectArgs), 0u, nullptr });
+		DrawPacket packet;
+		packet.vertexBuffer = device.CreateBuffer({ BufferType::Vertex, BufferUsage::Default, 64u, 16u, nullptr });
+		packet.indexBuffer = device.CreateBuffer({ BufferType::Index, BufferUsage::Default, 64u, 2u, nullptr });
+		packet.stride = 16u;
+		packet.instanceBuffer = device.CreateBuffer({ BufferType::Vertex, BufferUsage::Dynamic, 1024u, 0u, nullptr });
+		packet.instanceStride = sizeof(InstanceData);
+		packet.argsBuffer = args;
+		DrawQueue queue;
+		for (unsigned int d = 0u; d < 4u; d++)
+		{
+			packet.argsOffset = d * unsigned(sizeof(DrawIndexedIndirectArgs));
+			packet.instanceCount = d % 2u;
+			queue.Enqueue(packet);
+		}
+		device.ResetFrame();
+		queue.Submit(device);
+		CHECK(device.GetCallCount(RecordingRenderDevice::CallType::DrawIndexedInstancedIndirect) == 4u);
+		CHECK(queue.GetStats().indirectDraws == 4u);
+		std::vector<uint32_t> offsets;
+		for (const RecordingRenderDevice::Call& call : device.GetFrameCalls())
+		{
+			if (call.type == RecordingRenderDevice::CallType::DrawIndexedInstancedIndirect)
+			{
+				CHECK(call.id == args.id);
+				offsets.push_back(call.slot);
+			}
+		}
+		CHECK(offsets.size() == 4u);
+		for (size_t i = 0u; i < offsets.size(); i++)
+		{
+			CHECK(offsets[i] == i * sizeof(DrawIndexedIndirectArgs));
+		}
+	}
+}
+
+int main()
+{
+	TestArgsLayout();
+	for (unsigned int threads : { 1u, 2u, 4u })
+	{
+		TestCompaction(threads, 1u, 5000u);
+		TestCompaction(threads, 17u, 100000u);
+	}
+	TestEmptyDraws();
+	TestQueueIssuesIndirectPackets();
+	return TestResult();
+}
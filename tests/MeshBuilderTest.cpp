@@ -0,0 +1,315 @@
+#include "MeshBuilder.h"
+#include "VectorMath.h"
+#include "Test.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	struct Vertex
+	{
+		float		position[3];
+		uint32_t	original;	// index in the source mesh
+	};
+
+	struct Mesh
+	{
+		std::vector<Vertex>		vertices;
+		std::vector<uint32_t>	indices;
+	};
+
+	// size x size quads in the xz plane, row by row; clockwise seen from +y
+	Mesh MakeGrid(uint32_t size)
+	{
+		Mesh mesh;
+		for (uint32_t z = 0u; z <= size; z++)
+		{
+			for (uint32_t x = 0u; x <= size; x++)
+			{
+				mesh.vertices.push_back({ { float(x), 0.0f, float(z) }, uint32_t(mesh.vertices.size()) });
+			}
+		}
+		for (uint32_t z = 0u; z < size; z++)
+		{
+			for (uint32_t x = 0u; x < size; x++)
+			{
+				const uint32_t a = z * (size + 1u) + x;
+				const uint32_t b = a + size + 1u;
+				mesh.indices.insert(mesh.indices.end(), { a, b, a + 1u, a + 1u, b, b + 1u });
+			}
+		}
+		return mesh;
+	}
+
+	// a unit UV sphere, every triangle clockwise seen from outside
+	Mesh MakeSphere(uint32_t segments, uint32_t rings)
+	{
+		Mesh mesh;
+		for (uint32_t r = 0u; r <= rings; r++)
+		{
+			const float theta = 3.14159265f * float(r) / float(rings);
+			for (uint32_t s = 0u; s <= segments; s++)
+			{
+				const float phi = 6.28318531f * float(s) / float(segments);
+				mesh.vertices.push_back({ { std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) },
+										  uint32_t(mesh.vertices.size()) });
+			}
+		}
+		for (uint32_t r = 0u; r < rings; r++)
+		{
+			for (uint32_t s = 0u; s < segments; s++)
+			{
+				const uint32_t a = r * (segments + 1u) + s;
+				const uint32_t b = a + segments + 1u;
+				if (r != 0u)
+				{
+					mesh.indices.insert(mesh.indices.end(), { a, a + 1u, b });
+				}
+				if (r != rings - 1u)
+				{
+					mesh.indices.insert(mesh.indices.end(), { a + 1u, b + 1u, b });
+				}
+			}
+		}
+		return mesh;
+	}
+
+	// dot(camera - p0, front normal) > 0 when the triangle faces the camera
+	float Facing(const Mesh& mesh, const uint32_t* pTriangle, const float camera[3])
+	{
+		const float* p0 = mesh.vertices[pTriangle[0]].position;
+		const float* p1 = mesh.vertices[pTriangle[1]].position;
+		const float* p2 = mesh.vertices[pTriangle[2]].position;
+		const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+		const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+		const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+		return (camera[0] - p0[0]) * n[0] + (camera[1] - p0[1]) * n[1] + (camera[2] - p0[2]) * n[2];
+	}
+
+	// the source triangles the chunks draw, as original vertex indices
+	std::vector<uint32_t> DrawnIndices(const MeshBuilder::IndexedMesh& built)
+	{
+		std::vector<uint32_t> drawn;
+		for (const auto& chunk : built.chunks)
+		{
+			for (unsigned int i = chunk.startIndex; i < chunk.startIndex + chunk.indexCount; i++)
+			{
+				uint32_t index;
+				if (built.indexFormat == IndexFormat::R16_UInt)
+				{
+					uint16_t local;
+					std::memcpy(&local, &built.indices[i * sizeof(uint16_t)], sizeof(local));
+					CHECK(local < chunk.vertexCount);
+					index = uint32_t(chunk.baseVertex) + local;
+				}
+				else
+				{
+					std::memcpy(&index, &built.indices[i * sizeof(uint32_t)], sizeof(index));
+				}
+				Vertex vertex;
+				std::memcpy(&vertex, &built.vertices[index * sizeof(Vertex)], sizeof(vertex));
+				drawn.push_back(vertex.original);
+			}
+		}
+		return drawn;
+	}
+
+	void TestSmallMesh()
+	{
+		const Mesh grid = MakeGrid(16u);
+		const MeshBuilder::IndexedMesh built = MeshBuilder::BuildIndexedMesh(grid.vertices.data(), grid.vertices.size(), sizeof(Vertex),
+																			 grid.indices.data(), grid.indices.size());
+		CHECK(built.indexFormat == IndexFormat::R16_UInt);
+		CHECK(built.vertexSize == sizeof(Vertex));
+		CHECK(built.chunks.size() == 1u);
+		CHECK(built.vertices.size() == grid.vertices.size() * sizeof(Vertex));
+		CHECK(built.indices.size() == grid.indices.size() * sizeof(uint16_t));
+		CHECK(DrawnIndices(built) == grid.indices);
+	}
+
+	void TestChunkedMesh()
+	{
+		// 160801 vertices, three chunks' worth
+		const Mesh grid = MakeGrid(400u);
+		const MeshBuilder::IndexedMesh built = MeshBuilder::BuildIndexedMesh(grid.vertices.data(), grid.vertices.size(), sizeof(Vertex),
+																			 grid.indices.data(), grid.indices.size());
+		CHECK(built.indexFormat == IndexFormat::R16_UInt);
+		CHECK(built.chunks.size() == 3u);
+		unsigned int nextIndex = 0u;
+		size_t vertices = 0u;
+		for (const auto& chunk : built.chunks)
+		{
+			CHECK(chunk.startIndex == nextIndex);
+			CHECK(size_t(chunk.baseVertex) == vertices);
+			CHECK(chunk.vertexCount <= MeshBuilder::MaxChunkVertices);
+			nextIndex += chunk.indexCount;
+			vertices += chunk.vertexCount;
+		}
+		CHECK(nextIndex == grid.indices.size());
+		CHECK(built.vertices.size() == vertices * sizeof(Vertex));
+		CHECK(DrawnIndices(built) == grid.indices);
+	}
+
+	void TestScatteredMeshStaysWide()
+	{
+		// triangles over random vertices share nothing within a chunk, the
+		// copies would cost more than 32 bit indices
+		Mesh mesh;
+		for (uint32_t v = 0u; v < 100000u; v++)
+		{
+			mesh.vertices.push_back({ { float(v), 0.0f, 0.0f }, v });
+		}
+		std::mt19937 rng(20u);
+		std::uniform_int_distribution<uint32_t> vertex(0u, 99999u);
+		for (int i = 0; i < 3 * 100000; i++)
+		{
+			mesh.indices.push_back(vertex(rng));
+		}
+		const MeshBuilder::IndexedMesh built = MeshBuilder::BuildIndexedMesh(mesh.vertices.data(), mesh.vertices.size(), sizeof(Vertex),
+																			 mesh.indices.data(), mesh.indices.size());
+		CHECK(built.indexFormat == IndexFormat::R32_UInt);
+		CHECK(built.chunks.size() == 1u);
+		CHECK(built.chunks[0].baseVertex == 0);
+		CHECK(DrawnIndices(built) == mesh.indices);
+	}
+
+	void TestMeshletBounds()
+	{
+		const Mesh sphere = MakeSphere(64u, 32u);
+		const MeshBuilder::Meshlets meshlets = MeshBuilder::BuildMeshlets(sphere.indices.data(), sphere.indices.size(),
+																		  sphere.vertices[0].position, sizeof(Vertex), sphere.vertices.size());
+		CHECK(!meshlets.meshlets.empty());
+		std::vector<uint32_t> drawn;
+		uint32_t nextVertex = 0u;
+		uint32_t nextTriangle = 0u;
+		for (const MeshBuilder::Meshlet& meshlet : meshlets.meshlets)
+		{
+			CHECK(meshlet.vertexCount > 0u && meshlet.vertexCount <= MeshBuilder::MaxMeshletVertices);
+			CHECK(meshlet.triangleCount > 0u && meshlet.triangleCount <= MeshBuilder::MaxMeshletTriangles);
+			CHECK(meshlet.firstVertex == nextVertex);
+			CHECK(meshlet.firstTriangle == nextTriangle);
+			nextVertex += meshlet.vertexCount;
+			nextTriangle += meshlet.triangleCount;
+
+			// every vertex inside the sphere
+			for (unsigned int i = 0u; i < meshlet.vertexCount; i++)
+			{
+				const float* p = sphere.vertices[meshlets.vertices[meshlet.firstVertex + i]].position;
+				const float dx = p[0] - meshlet.center[0];
+				const float dy = p[1] - meshlet.center[1];
+				const float dz = p[2] - meshlet.center[2];
+				CHECK(std::sqrt(dx * dx + dy * dy + dz * dz) <= meshlet.radius * 1.0001f + 1e-6f);
+			}
+			// a patch of a unit sphere has a narrow cone around its outward normal
+			CHECK(meshlet.coneCutoff < 1.0f);
+			const float outward = meshlet.coneAxis[0] * meshlet.center[0] + meshlet.coneAxis[1] * meshlet.center[1] +
+								  meshlet.coneAxis[2] * meshlet.center[2];
+			CHECK(outward > 0.0f);
+			for (unsigned int i = 0u; i < 3u * meshlet.triangleCount; i++)
+			{
+				const uint8_t local = meshlets.triangles[3u * meshlet.firstTriangle + i];
+				CHECK(local < meshlet.vertexCount);
+				drawn.push_back(meshlets.vertices[meshlet.firstVertex + local]);
+			}
+		}
+		CHECK(nextVertex == meshlets.vertices.size());
+		CHECK(3u * nextTriangle == meshlets.triangles.size());
+		// the triangles in the order given, winding kept
+		CHECK(drawn == sphere.indices);
+	}
+
+	// a meshlet the cone calls back facing has no triangle facing the camera
+	void TestConeCulling()
+	{
+		const Mesh sphere = MakeSphere(64u, 32u);
+		const MeshBuilder::Meshlets meshlets = MeshBuilder::BuildMeshlets(sphere.indices.data(), sphere.indices.size(),
+																		  sphere.vertices[0].position, sizeof(Vertex), sphere.vertices.size());
+		std::mt19937 rng(21u);
+		std::uniform_real_distribution<float> position(-4.0f, 4.0f);
+		size_t culled = 0u;
+		size_t tested = 0u;
+		for (int c = 0; c < 200; c++)
+		{
+			const float camera[3] = { position(rng), position(rng), position(rng) };
+			for (const MeshBuilder::Meshlet& meshlet : meshlets.meshlets)
+			{
+				tested++;
+				if (!MeshBuilder::IsBackfacing(meshlet, camera))
+				{
+					continue;
+				}
+				culled++;
+				bool allBack = true;
+				for (unsigned int t = 0u; t < meshlet.triangleCount; t++)
+				{
+					const uint32_t triangle[3] =
+					{
+						meshlets.vertices[meshlet.firstVertex + meshlets.triangles[3u * (meshlet.firstTriangle + t)]],
+						meshlets.vertices[meshlet.firstVertex + meshlets.triangles[3u * (meshlet.firstTriangle + t) + 1u]],
+						meshlets.vertices[meshlet.firstVertex + meshlets.triangles[3u * (meshlet.firstTriangle + t) + 2u]],
+					};
+					allBack = allBack && Facing(sphere, triangle, camera) <= 1e-5f;
+				}
+				CHECK(allBack);
+			}
+		}
+		// the cones are conservative, but still catch a good part of the half
+		// facing away
+		CHECK(culled > tested / 10u);
+
+		// a flat grid faces +y: everything is culled from below, nothing from above
+		const Mesh grid = MakeGrid(32u);
+		const MeshBuilder::Meshlets flat = MeshBuilder::BuildMeshlets(grid.indices.data(), grid.indices.size(),
+																	  grid.vertices[0].position, sizeof(Vertex), grid.vertices.size());
+		const float below[3] = { 16.0f, -100.0f, 16.0f };
+		const float above[3] = { 16.0f, 10.0f, 16.0f };
+		size_t culledBelow = 0u;
+		size_t culledAbove = 0u;
+		for (const MeshBuilder::Meshlet& meshlet : flat.meshlets)
+		{
+			culledBelow += MeshBuilder::IsBackfacing(meshlet, below) ? 1u : 0u;
+			culledAbove += MeshBuilder::IsBackfacing(meshlet, above) ? 1u : 0u;
+		}
+		CHECK(culledBelow == flat.meshlets.size());
+		CHECK(culledAbove == 0u);
+	}
+
+	void TestCullMeshlets()
+	{
+		const Mesh sphere = MakeSphere(64u, 32u);
+		const MeshBuilder::Meshlets meshlets = MeshBuilder::BuildMeshlets(sphere.indices.data(), sphere.indices.size(),
+																		  sphere.vertices[0].position, sizeof(Vertex), sphere.vertices.size());
+		const Mat4 projection = Mat4::Perspective(1.0f, 1.0f, 0.1f, 100.0f);
+		const float camera[3] = { 0.0f, 0.0f, -5.0f };
+		std::vector<uint32_t> visible(meshlets.meshlets.size());
+
+		// looking at the sphere: the back half is culled by the cones
+		float toClip[16];
+		(projection * Mat4::LookAt(Vec3::Load(camera), Vec3(0.0f), Vec3(0.0f, 1.0f, 0.0f))).Store(toClip);
+		const size_t count = MeshBuilder::CullMeshlets(meshlets, FrustumCuller::ExtractFrustum(toClip), camera, visible.data());
+		CHECK(count > 0u && count < meshlets.meshlets.size());
+		for (size_t i = 0u; i < count; i++)
+		{
+			CHECK(!MeshBuilder::IsBackfacing(meshlets.meshlets[visible[i]], camera));
+			CHECK(i == 0u || visible[i] > visible[i - 1u]);
+		}
+
+		// looking away: all outside the frustum
+		(projection * Mat4::LookAt(Vec3::Load(camera), Vec3(0.0f, 0.0f, -10.0f), Vec3(0.0f, 1.0f, 0.0f))).Store(toClip);
+		CHECK(MeshBuilder::CullMeshlets(meshlets, FrustumCuller::ExtractFrustum(toClip), camera, visible.data()) == 0u);
+	}
+}
+
+int main()
+{
+	TestSmallMesh();
+	TestChunkedMesh();
+	TestScatteredMeshStaysWide();
+	TestMeshletBounds();
+	TestConeCulling();
+	TestCullMeshlets();
+	return TestResult();
+}
@@ -0,0 +1,235 @@
+#include "MeshOptimizer.h"
+#include "Test.h"
+#include <algorithm>
+#include <array>
+#include <random>
+#include <vector>
+
+namespace
+{
+	struct Vertex
+	{
+		float		position[3];
+		uint32_t	original;	// index in the unoptimized mesh
+	};
+
+	struct Grid
+	{
+		std::vector<Vertex>		vertices;
+		std::vector<uint32_t>	indices;
+	};
+
+	// size x size quads in the xz plane, triangles shuffled so the cache
+	// order is poor; `unused` extra vertices no triangle refers to
+	Grid MakeShuffledGrid(uint32_t size, uint32_t unused, uint32_t seed)
+	{
+		Grid grid;
+		for (uint32_t z = 0u; z <= size; z++)
+		{
+			for (uint32_t x = 0u; x <= size; x++)
+			{
+				grid.vertices.push_back({ { float(x), 0.0f, float(z) }, uint32_t(grid.vertices.size()) });
+			}
+		}
+		for (uint32_t i = 0u; i < unused; i++)
+		{
+			grid.vertices.push_back({ { -1.0f, -1.0f, -1.0f }, uint32_t(grid.vertices.size()) });
+		}
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (uint32_t z = 0u; z < size; z++)
+		{
+			for (uint32_t x = 0u; x < size; x++)
+			{
+				const uint32_t a = z * (size + 1u) + x;
+				const uint32_t b = a + size + 1u;
+				triangles.push_back({ a, b, a + 1u });
+				triangles.push_back({ a + 1u, b, b + 1u });
+			}
+		}
+		std::mt19937 rng(seed);
+		std::shuffle(triangles.begin(), triangles.end(), rng);
+		for (const auto& triangle : triangles)
+		{
+			grid.indices.insert(grid.indices.end(), triangle.begin(), triangle.end());
+		}
+		return grid;
+	}
+
+	// the triangles as original vertex indices, each rotated to start at its
+	// smallest index (which keeps the winding), sorted
+	std::vector<std::array<uint32_t, 3>> Triangles(const std::vector<Vertex>& vertices, const uint32_t* pIndices, size_t indexCount)
+	{
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (size_t i = 0u; i < indexCount; i += 3u)
+		{
+			std::array<uint32_t, 3> t = { vertices[pIndices[i]].original, vertices[pIndices[i + 1u]].original,
+										  vertices[pIndices[i + 2u]].original };
+			std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+			triangles.push_back(t);
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	MeshOptimizer::Mesh MakeMesh(Grid& grid, IndexFormat format, std::vector<uint16_t>& indices16)
+	{
+		MeshOptimizer::Mesh mesh;
+		mesh.pVertices = grid.vertices.data();
+		mesh.vertexCount = grid.vertices.size();
+		mesh.vertexSize = sizeof(Vertex);
+		mesh.positionOffset = 0u;
+		mesh.indexFormat = format;
+		mesh.indexCount = grid.indices.size();
+		if (format == IndexFormat::R16_UInt)
+		{
+			indices16.assign(grid.indices.begin(), grid.indices.end());
+			mesh.pIndices = indices16.data();
+		}
+		else
+		{
+			mesh.pIndices = grid.indices.data();
+		}
+		return mesh;
+	}
+
+	void TestAnalyzeVertexCache()
+	{
+		const uint32_t one[] = { 0u, 1u, 2u };
+		MeshOptimizer::CacheStats stats = MeshOptimizer::AnalyzeVertexCache(one, 3u, 3u);
+		CHECK_NEAR(stats.acmr, 3.0f, 1e-6f);
+		CHECK_NEAR(stats.atvr, 1.0f, 1e-6f);
+		// the second triangle shares an edge, one new vertex
+		const uint32_t two[] = { 0u, 1u, 2u, 2u, 1u, 3u };
+		stats = MeshOptimizer::AnalyzeVertexCache(two, 6u, 4u);
+		CHECK_NEAR(stats.acmr, 2.0f, 1e-6f);
+		CHECK_NEAR(stats.atvr, 1.0f, 1e-6f);
+		// a cache of 3 has lost vertex 0 by the time it comes back
+		const uint32_t evicted[] = { 0u, 1u, 2u, 3u, 4u, 5u, 0u, 1u, 2u };
+		stats = MeshOptimizer::AnalyzeVertexCache(evicted, 9u, 6u, 3u);
+		CHECK_NEAR(stats.acmr, 3.0f, 1e-6f);
+		CHECK_NEAR(stats.atvr, 1.5f, 1e-6f);
+	}
+
+	void TestVertexCacheKeepsTriangles()
+	{
+		Grid grid = MakeShuffledGrid(64u, 0u, 1u);
+		const auto before = Triangles(grid.vertices, grid.indices.data(), grid.indices.size());
+		const float acmrBefore = MeshOptimizer::AnalyzeVertexCache(grid.indices.data(), grid.indices.size(), grid.vertices.size()).acmr;
+		MeshOptimizer::OptimizeVertexCache(grid.indices.data(), grid.indices.size(), grid.vertices.size());
+		CHECK(Triangles(grid.vertices, grid.indices.data(), grid.indices.size()) == before);
+		const float acmrAfter = MeshOptimizer::AnalyzeVertexCache(grid.indices.data(), grid.indices.size(), grid.vertices.size()).acmr;
+		CHECK(acmrBefore > 2.5f);
+		// a regular grid reaches about 0.5 with a perfect order
+		CHECK(acmrAfter < 0.8f);
+	}
+
+	void TestOverdrawKeepsTriangles()
+	{
+		Grid grid = MakeShuffledGrid(64u, 0u, 2u);
+		MeshOptimizer::OptimizeVertexCache(grid.indices.data(), grid.indices.size(), grid.vertices.size());
+		const auto before = Triangles(grid.vertices, grid.indices.data(), grid.indices.size());
+		const float acmrBefore = MeshOptimizer::AnalyzeVertexCache(grid.indices.data(), grid.indices.size(), grid.vertices.size()).acmr;
+		MeshOptimizer::OptimizeOverdraw(grid.indices.data(), grid.indices.size(), grid.vertices[0].position, sizeof(Vertex),
+										grid.vertices.size());
+		CHECK(Triangles(grid.vertices, grid.indices.data(), grid.indices.size()) == before);
+		// clusters keep most of the cache order
+		const float acmrAfter = MeshOptimizer::AnalyzeVertexCache(grid.indices.data(), grid.indices.size(), grid.vertices.size()).acmr;
+		CHECK(acmrAfter <= acmrBefore * MeshOptimizer::DefaultOverdrawThreshold + 0.05f);
+	}
+
+	void TestVertexFetchOrder()
+	{
+		Grid grid = MakeShuffledGrid(16u, 10u, 3u);
+		const auto before = Triangles(grid.vertices, grid.indices.data(), grid.indices.size());
+		const size_t used = MeshOptimizer::OptimizeVertexFetch(grid.vertices.data(), grid.vertices.size(), sizeof(Vertex),
+																grid.indices.data(), grid.indices.size());
+		CHECK(used == 17u * 17u);
+		CHECK(Triangles(grid.vertices, grid.indices.data(), grid.indices.size()) == before);
+		// vertices are numbered in order of first use
+		uint32_t next = 0u;
+		bool ordered = true;
+		for (const uint32_t index : grid.indices)
+		{
+			ordered = ordered && index <= next;
+			next = std::max(next, index + 1u);
+		}
+		CHECK(ordered);
+		CHECK(next == used);
+		for (size_t v = 0u; v < used; v++)
+		{
+			const Vertex& vertex = grid.vertices[v];
+			CHECK(vertex.position[0] == float(vertex.original % 17u) && vertex.position[2] == float(vertex.original / 17u));
+		}
+	}
+
+	void TestOptimize(IndexFormat format)
+	{
+		Grid grid = MakeShuffledGrid(100u, 5u, 4u);
+		const std::vector<Vertex> original = grid.vertices;
+		const auto before = Triangles(grid.vertices, grid.indices.data(), grid.indices.size());
+		std::vector<uint16_t> indices16;
+		MeshOptimizer::Mesh mesh = MakeMesh(grid, format, indices16);
+		const MeshOptimizer::Report report = MeshOptimizer::Optimize(mesh);
+
+		std::vector<uint32_t> indices(grid.indices.size());
+		if (format == IndexFormat::R16_UInt)
+		{
+			std::copy(indices16.begin(), indices16.end(), indices.begin());
+		}
+		else
+		{
+			indices = grid.indices;
+		}
+		CHECK(Triangles(grid.vertices, indices.data(), indices.size()) == before);
+		CHECK(report.verticesBefore == original.size());
+		CHECK(report.verticesAfter == 101u * 101u);
+		CHECK(mesh.vertexCount == report.verticesAfter);
+		CHECK(mesh.report.after.acmr == report.after.acmr);
+		CHECK(report.after.acmr < report.before.acmr * 0.5f);
+		CHECK(report.after.atvr < report.before.atvr);
+		const MeshOptimizer::CacheStats measured = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), mesh.vertexCount);
+		CHECK_NEAR(measured.acmr, report.after.acmr, 1e-6f);
+	}
+
+	// the batch gives every mesh what Optimize() on it alone does
+	void TestBatch(unsigned int threads)
+	{
+		constexpr uint32_t MeshCount = 6u;
+		std::vector<Grid> grids;
+		std::vector<Grid> expected;
+		std::vector<MeshOptimizer::Mesh> meshes;
+		std::vector<uint16_t> unused;
+		for (uint32_t m = 0u; m < MeshCount; m++)
+		{
+			grids.push_back(MakeShuffledGrid(20u + 4u * m, m, 10u + m));
+		}
+		expected = grids;
+		for (uint32_t m = 0u; m < MeshCount; m++)
+		{
+			meshes.push_back(MakeMesh(grids[m], IndexFormat::R32_UInt, unused));
+			MeshOptimizer::Mesh alone = MakeMesh(expected[m], IndexFormat::R32_UInt, unused);
+			MeshOptimizer::Optimize(alone);
+		}
+		JobSystem jobs(threads);
+		MeshOptimizer::Optimize(jobs, meshes.data(), meshes.size());
+		for (uint32_t m = 0u; m < MeshCount; m++)
+		{
+			CHECK(grids[m].indices == expected[m].indices);
+			CHECK(meshes[m].vertexCount == size_t(21u + 4u * m) * size_t(21u + 4u * m));
+			CHECK(meshes[m].report.after.acmr < meshes[m].report.before.acmr);
+		}
+	}
+}
+
+int main()
+{
+	TestAnalyzeVertexCache();
+	TestVertexCacheKeepsTriangles();
+	TestOverdrawKeepsTriangles();
+	TestVertexFetchOrder();
+	TestOptimize(IndexFormat::R32_UInt);
+	TestOptimize(IndexFormat::R16_UInt);
+	TestBatch(1u);
+	TestBatch(4u);
+	return TestResult();
+}
@@ -0,0 +1,195 @@
+#include "PipelineStateCache.h"
+#include "RecordingRenderDevice.h"
+#include "Test.h"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	using CallType = RecordingRenderDevice::CallType;
+
+	const InputElementDesc Elements[] =
+	{
+		{ "Position", 0u, ElementFormat::R32G32B32_Float, 0u, 0u },
+		{ "Color", 0u, ElementFormat::R8G8B8A8_UNorm, 0u, 12u },
+	};
+
+	std::vector<unsigned char> Code(const std::string& text)
+	{
+		return std::vector<unsigned char>(text.begin(), text.end());
+	}
+
+	PipelineStateDesc MakeDesc(const std::vector<unsigned char>& vs, const std::vector<unsigned char>& ps)
+	{
+		PipelineStateDesc desc;
+		desc.vertexShader = { vs.data(), vs.size(), "VertexShader.cso", 0u };
+		desc.pixelShader = { ps.data(), ps.size(), "PixelShader.cso", 0u };
+		desc.pInputElements = Elements;
+		desc.inputElementCount = 2u;
+		return desc;
+	}
+
+	void TestDeduplicateByContent()
+	{
+		RecordingRenderDevice device;
+		PipelineStateCache cache(device);
+
+		// equal bytes at different addresses under different names
+		const std::vector<unsigned char> vs = Code("vertex shader code");
+		const std::vector<unsigned char> vsCopy = vs;
+		const std::vector<unsigned char> ps = Code("pixel shader code");
+		const std::vector<unsigned char> psCopy = ps;
+		PipelineStateDesc desc = MakeDesc(vs, ps);
+		PipelineStateDesc copy = MakeDesc(vsCopy, psCopy);
+		copy.vertexShader.name = "shaders/Other.cso";
+		const PipelineState& state = cache.GetPipelineState(desc);
+		CHECK(&cache.GetPipelineState(copy) == &state);
+		CHECK(state.vertexShader.IsValid() && state.pixelShader.IsValid() && state.inputLayout.IsValid());
+
+		// hand built elements with the same content, names at other addresses
+		const std::string position = "Position";
+		const std::string color = "Color";
+		const InputElementDesc elements[] =
+		{
+			{ position.c_str(), 0u, ElementFormat::R32G32B32_Float, 0u, 0u },
+			{ color.c_str(), 0u, ElementFormat::R8G8B8A8_UNorm, 0u, 12u },
+		};
+		copy.pInputElements = elements;
+		CHECK(&cache.GetPipelineState(copy) == &state);
+
+		PipelineStateCache::Stats stats = cache.GetStats();
+		CHECK(stats.lookups == 3u);
+		CHECK(stats.creations == 1u);
+		CHECK_NEAR(stats.GetHitRate(), 2.0 / 3.0, 1e-9);
+		CHECK(cache.GetStateCount() == 1u);
+		CHECK(device.GetTotalCounters().creates == 3u);
+
+		// another offset is another layout, the shaders are shared
+		const InputElementDesc moved[] =
+		{
+			{ "Position", 0u, ElementFormat::R32G32B32_Float, 0u, 0u },
+			{ "Color", 0u, ElementFormat::R8G8B8A8_UNorm, 0u, 16u },
+		};
+		PipelineStateDesc other = desc;
+		other.pInputElements = moved;
+		const PipelineState& otherState = cache.GetPipelineState(other);
+		CHECK(otherState.inputLayout != state.inputLayout);
+		CHECK(otherState.vertexShader == state.vertexShader);
+		CHECK(device.GetCallCount(CallType::CreateInputLayout) == 2u);
+		CHECK(device.GetCallCount(CallType::CreateVertexShader) == 1u);
+
+		// other pixel shader code
+		const std::vector<unsigned char> ps2 = Code("pixel shader code 2");
+		const PipelineState& ps2State = cache.GetPipelineState(MakeDesc(vs, ps2));
+		CHECK(ps2State.pixelShader != state.pixelShader);
+		CHECK(ps2State.inputLayout == state.inputLayout);
+		CHECK(device.GetCallCount(CallType::CreatePixelShader) == 2u);
+
+		// depth only: no pixel shader
+		PipelineStateDesc depthOnly = desc;
+		depthOnly.pixelShader = {};
+		const PipelineState& depthState = cache.GetPipelineState(depthOnly);
+		CHECK(!depthState.pixelShader.IsValid());
+		CHECK(depthState.vertexShader == state.vertexShader && depthState.inputLayout == state.inputLayout);
+		CHECK(device.GetCallCount(CallType::CreatePixelShader) == 2u);
+
+		stats = cache.GetStats();
+		CHECK(stats.lookups == 6u);
+		CHECK(stats.creations == 4u);
+		CHECK(cache.GetStateCount() == 4u);
+	}
+
+	// threads look up overlapping sets of states in their own orders while
+	// misses grow the table from 16 slots; every thread sees the one state
+	// per desc and every desc is created once
+	void TestConcurrentLookups()
+	{
+		constexpr size_t StateCount = 600u;
+		constexpr unsigned int ThreadCount = 4u;
+		constexpr int Passes = 3;
+
+		const std::vector<unsigned char> vs = Code("shared vertex shader");
+		std::vector<std::vector<unsigned char>> pixelShaders;
+		for (size_t i = 0u; i < StateCount; i++)
+		{
+			pixelShaders.push_back(Code("pixel shader " + std::to_string(i)));
+		}
+		std::vector<PipelineStateDesc> descs;
+		for (const auto& ps : pixelShaders)
+		{
+			descs.push_back(MakeDesc(vs, ps));
+		}
+
+		RecordingRenderDevice device;
+		PipelineStateCache cache(device, 16u);
+		std::vector<std::vector<const PipelineState*>> seen(ThreadCount, std::vector<const PipelineState*>(StateCount, nullptr));
+		std::vector<int> mismatches(ThreadCount, 0);
+		std::vector<std::thread> threads;
+		for (unsigned int t = 0u; t < ThreadCount; t++)
+		{
+			threads.emplace_back([&, t]
+			{
+				std::vector<size_t> order(StateCount);
+				for (size_t i = 0u; i < StateCount; i++)
+				{
+					order[i] = i;
+				}
+				std::mt19937 rng(t);
+				for (int pass = 0; pass < Passes; pass++)
+				{
+					std::shuffle(order.begin(), order.end(), rng);
+					for (const size_t i : order)
+					{
+						const PipelineState* pState = &cache.GetPipelineState(descs[i]);
+						if (seen[t][i] && seen[t][i] != pState)
+						{
+							mismatches[t]++;
+						}
+						seen[t][i] = pState;
+					}
+				}
+			});
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+
+		for (unsigned int t = 0u; t < ThreadCount; t++)
+		{
+			CHECK(mismatches[t] == 0);
+			CHECK(seen[t] == seen[0]);
+		}
+		bool distinct = true;
+		for (size_t i = 0u; i < StateCount; i++)
+		{
+			distinct = distinct && seen[0][i] && seen[0][i]->pixelShader.IsValid();
+			distinct = distinct && (i == 0u || seen[0][i]->pixelShader != seen[0][i - 1u]->pixelShader);
+		}
+		CHECK(distinct);
+
+		const PipelineStateCache::Stats stats = cache.GetStats();
+		CHECK(cache.GetStateCount() == StateCount);
+		CHECK(stats.creations == StateCount);
+		CHECK(stats.lookups == uint64_t(ThreadCount) * Passes * StateCount);
+		CHECK(device.GetCallCount(CallType::CreateVertexShader) == 1u);
+		CHECK(device.GetCallCount(CallType::CreatePixelShader) == StateCount);
+		CHECK(device.GetCallCount(CallType::CreateInputLayout) == 1u);
+
+		// states found through the grown table are still the first ones
+		for (size_t i = 0u; i < StateCount; i += 37u)
+		{
+			CHECK(&cache.GetPipelineState(descs[i]) == seen[0][i]);
+		}
+	}
+}
+
+int main()
+{
+	TestDeduplicateByContent();
+	TestConcurrentLookups();
+	return TestResult();
+}
@@ -0,0 +1,129 @@
+#include "RingAllocator.h"
+#include "Test.h"
+#include <random>
+#include <vector>
+
+namespace
+{
+	void TestAlignmentPadding()
+	{
+		RingAllocator ring(256u);
+		CHECK(ring.Allocate(3u, 1u) == 0u);
+		// the padding up to the alignment is taken as well
+		CHECK(ring.Allocate(8u, 16u) == 16u);
+		CHECK(ring.GetUsed() == 24u);
+		CHECK(ring.Allocate(1u, 0u) == 24u);
+		CHECK(ring.Allocate(4u, 64u) == 64u);
+		CHECK(ring.GetUsed() == 68u);
+	}
+
+	void TestFullRing()
+	{
+		RingAllocator ring(64u);
+		CHECK(ring.Allocate(64u, 16u) == 0u);
+		CHECK(ring.Allocate(1u, 1u) == RingAllocator::InvalidOffset);
+		// larger than the whole ring never fits
+		RingAllocator empty(64u);
+		CHECK(empty.Allocate(65u, 1u) == RingAllocator::InvalidOffset);
+		CHECK(ring.GetStats().failures == 1u);
+		CHECK(empty.GetStats().failures == 1u);
+	}
+
+	void TestFenceBlocksReuse()
+	{
+		RingAllocator ring(64u);
+		CHECK(ring.Allocate(48u, 16u) == 0u);
+		ring.EndFrame(1u);
+		// 16 bytes left at the end, the start is still held by frame 1
+		CHECK(ring.Allocate(32u, 16u) == RingAllocator::InvalidOffset);
+		ring.Retire(0u);
+		CHECK(ring.GetPendingFrames() == 1u);
+		CHECK(ring.Allocate(32u, 16u) == RingAllocator::InvalidOffset);
+		ring.Retire(1u);
+		CHECK(ring.GetPendingFrames() == 0u);
+		CHECK(ring.GetUsed() == 0u);
+		CHECK(ring.Allocate(32u, 16u) == 0u);
+	}
+
+	void TestWrapAround()
+	{
+		RingAllocator ring(64u);
+		CHECK(ring.Allocate(40u, 8u) == 0u);
+		ring.EndFrame(1u);
+		CHECK(ring.Allocate(16u, 8u) == 40u);
+		ring.EndFrame(2u);
+		ring.Retire(1u);
+
+		// 8 bytes left before the end: skipped, the allocation starts at 0
+		// and the skipped bytes belong to frame 3
+		CHECK(ring.Allocate(16u, 8u) == 0u);
+		CHECK(ring.GetStats().wraps == 1u);
+		CHECK(ring.GetUsed() == 16u + 8u + 16u);
+		// [16, 40) is free, [40, 56) is frame 2's
+		CHECK(ring.Allocate(24u, 8u) == 16u);
+		CHECK(ring.Allocate(8u, 8u) == RingAllocator::InvalidOffset);
+		ring.EndFrame(3u);
+		ring.Retire(3u);
+		CHECK(ring.GetUsed() == 0u);
+		CHECK(ring.GetPendingFrames() == 0u);
+	}
+
+	// random frames with the GPU lagging a few frames behind: no allocation
+	// may overlap one of a frame that has not been retired
+	void TestRandomFrames()
+	{
+		constexpr size_t Capacity = 4096u;
+		constexpr uint64_t Lag = 3u;
+		RingAllocator ring(Capacity);
+		std::vector<uint64_t> owner(Capacity, 0u);	// frame + 1 per byte, 0 = free
+		std::mt19937 rng(11u);
+		bool overlap = false;
+		bool misaligned = false;
+		uint64_t allocated = 0u;
+
+		for (uint64_t frame = 1u; frame <= 2000u; frame++)
+		{
+			const int count = int(rng() % 24u);
+			for (int i = 0; i < count; i++)
+			{
+				const size_t size = 1u + rng() % 300u;
+				const size_t align = size_t(1u) << (rng() % 7u);
+				const size_t offset = ring.Allocate(size, align);
+				if (offset == RingAllocator::InvalidOffset)
+				{
+					continue;
+				}
+				allocated++;
+				misaligned |= offset % align != 0u || offset + size > Capacity;
+				for (size_t b = offset; b < offset + size && b < Capacity; b++)
+				{
+					overlap |= owner[b] != 0u;
+					owner[b] = frame;
+				}
+			}
+			ring.EndFrame(frame);
+			if (frame > Lag)
+			{
+				ring.Retire(frame - Lag);
+				for (uint64_t& byte : owner)
+				{
+					byte = byte != 0u && byte <= frame - Lag ? 0u : byte;
+				}
+			}
+		}
+		CHECK(!overlap);
+		CHECK(!misaligned);
+		CHECK(allocated > 10000u);
+		CHECK(ring.GetStats().wraps > 0u);
+	}
+}
+
+int main()
+{
+	TestAlignmentPadding();
+	TestFullRing();
+	TestFenceBlocksReuse();
+	TestWrapAround();
+	TestRandomFrames();
+	return TestResult();
+}
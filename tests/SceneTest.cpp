@@ -0,0 +1,64 @@
+#include "Scene.h"
+#include "SoftwareRenderDevice.h"
+#include "Test.h"
+#include <filesystem>
+#include <set>
+
+namespace
+{
+	// the software device finds its shaders by name, so the frame renders
+	// where no compiled shader is on disk
+	void TestHeadlessFrameWithoutShaderFiles()
+	{
+		namespace fs = std::filesystem;
+		const fs::path previous = fs::current_path();
+		const fs::path empty = fs::temp_directory_path() / "GenixSceneTest";
+		fs::remove_all(empty);
+		fs::create_directories(empty);
+		fs::current_path(empty);
+
+		auto pDevice = std::make_unique<SoftwareRenderDevice>(Graphics::ScreenWidth, Graphics::ScreenHeight);
+		const SoftwareRenderDevice& device = *pDevice;
+		bool rendered = false;
+		try
+		{
+			Graphics gfx(std::move(pDevice));
+			Scene scene;
+			for (int frame = 0; frame < 3; frame++)
+			{
+				scene.Update(1.0f / 60.0f);
+				scene.Draw(gfx);
+				gfx.EndFrame();
+			}
+			rendered = true;
+
+			// the test triangle in the middle and the instances around it
+			// in colors of their own on the clear color
+			const uint32_t* pPixels = device.GetFrontBuffer();
+			const uint32_t background = pPixels[0];
+			std::set<uint32_t> colors;
+			const size_t width = size_t(Graphics::ScreenWidth);
+			const size_t height = size_t(Graphics::ScreenHeight);
+			for (size_t i = 0u; i < width * height; i++)
+			{
+				colors.insert(pPixels[i]);
+			}
+			CHECK(pPixels[height / 2u * width + width / 2u] != background);
+			CHECK(colors.size() > 3u);
+		}
+		catch (const GenixException& e)
+		{
+			std::fprintf(stderr, "%s\n", e.what());
+		}
+		CHECK(rendered);
+
+		fs::current_path(previous);
+		fs::remove_all(empty);
+	}
+}
+
+int main()
+{
+	TestHeadlessFrameWithoutShaderFiles();
+	return TestResult();
+}
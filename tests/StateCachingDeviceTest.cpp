@@ -0,0 +1,134 @@
+#include "StateCachingDevice.h"
+#include "RecordingRenderDevice.h"
+#include "Test.h"
+
+namespace
+{
+	using CallType = RecordingRenderDevice::CallType;
+
+	// one bind of every slot the cache shadows
+	void BindAll(IRenderDevice& device)
+	{
+		Viewport viewport;
+		viewport.width = 1280.0f;
+		viewport.height = 720.0f;
+		viewport.maxDepth = 1.0f;
+		device.SetVertexBuffer(0u, BufferHandle { 1u }, 12u, 0u);
+		device.SetIndexBuffer(BufferHandle { 2u }, IndexFormat::R16_UInt, 0u);
+		device.SetVertexShader(VertexShaderHandle { 3u });
+		device.SetPixelShader(PixelShaderHandle { 4u });
+		device.SetInputLayout(InputLayoutHandle { 5u });
+		device.SetBackBufferTarget();
+		device.SetDepthMode(DepthMode::TestWrite);
+		device.SetPrimitiveTopology(PrimitiveTopology::TriangleList);
+		device.SetViewport(viewport);
+	}
+	constexpr unsigned int BindAllCount = 9u;
+
+	unsigned int Binds(const RecordingRenderDevice& device)
+	{
+		return device.GetFrameCounters().binds;
+	}
+
+	void TestFirstBindPassesThrough()
+	{
+		RecordingRenderDevice recording;
+		StateCachingDevice cache(recording);
+		BindAll(cache);
+		CHECK(Binds(recording) == BindAllCount);
+		CHECK(cache.GetCurrentCounters().issued == BindAllCount);
+		CHECK(cache.GetCurrentCounters().filtered == 0u);
+		CHECK(recording.GetCallCount(CallType::SetVertexShader) == 1u);
+		CHECK(recording.GetCallCount(CallType::SetViewport) == 1u);
+	}
+
+	void TestRedundantBindIsFiltered()
+	{
+		RecordingRenderDevice recording;
+		StateCachingDevice cache(recording);
+		BindAll(cache);
+		BindAll(cache);
+		CHECK(Binds(recording) == BindAllCount);
+		CHECK(cache.GetCurrentCounters().issued == BindAllCount);
+		CHECK(cache.GetCurrentCounters().filtered == BindAllCount);
+
+		// a change in any part of a slot goes through, the same again does not
+		cache.SetVertexBuffer(0u, BufferHandle { 1u }, 12u, 16u);
+		cache.SetVertexBuffer(0u, BufferHandle { 1u }, 12u, 16u);
+		cache.SetVertexBuffer(1u, BufferHandle { 1u }, 12u, 16u);
+		cache.SetIndexBuffer(BufferHandle { 2u }, IndexFormat::R32_UInt, 0u);
+		cache.SetVertexShader(VertexShaderHandle { 6u });
+		cache.SetVertexShader(VertexShaderHandle { 6u });
+		CHECK(Binds(recording) == BindAllCount + 4u);
+		CHECK(cache.GetCurrentCounters().issued == BindAllCount + 4u);
+		CHECK(cache.GetCurrentCounters().filtered == BindAllCount + 2u);
+		CHECK(recording.GetCallCount(CallType::SetVertexBuffer) == 3u);
+
+		// Present() closes the frame's counters, the totals go on
+		cache.Present();
+		CHECK(cache.GetFrameCounters().issued == BindAllCount + 4u);
+		CHECK(cache.GetFrameCounters().filtered == BindAllCount + 2u);
+		CHECK(cache.GetCurrentCounters().issued == 0u && cache.GetCurrentCounters().filtered == 0u);
+		cache.SetPixelShader(PixelShaderHandle { 4u });
+		CHECK(cache.GetCurrentCounters().filtered == 1u);
+		CHECK(cache.GetTotalCounters().issued == BindAllCount + 4u);
+		CHECK(cache.GetTotalCounters().filtered == BindAllCount + 3u);
+	}
+
+	// the back buffer is unbound by presenting, resizing and changing the
+	// sample count; everything else stays known
+	void TestTargetForgotten()
+	{
+		RecordingRenderDevice recording;
+		StateCachingDevice cache(recording);
+		BindAll(cache);
+
+		cache.Present();
+		cache.SetBackBufferTarget();
+		cache.SetPixelShader(PixelShaderHandle { 4u });
+		CHECK(recording.GetCallCount(CallType::SetBackBufferTarget) == 2u);
+		CHECK(recording.GetCallCount(CallType::SetPixelShader) == 1u);
+
+		cache.GetSwapChain().Resize(800u, 600u);
+		CHECK(recording.GetCallCount(CallType::ResizeSwapChain) == 1u);
+		CHECK(recording.GetDesc().width == 800u);
+		cache.SetBackBufferTarget();
+		CHECK(recording.GetCallCount(CallType::SetBackBufferTarget) == 3u);
+
+		CHECK(cache.GetSwapChain().SetSampleCount(4u) == 4u);
+		CHECK(recording.GetCallCount(CallType::SetSampleCount) == 1u);
+		cache.SetBackBufferTarget();
+		CHECK(recording.GetCallCount(CallType::SetBackBufferTarget) == 4u);
+
+		// once bound, it is filtered again until the next of those
+		cache.SetBackBufferTarget();
+		CHECK(recording.GetCallCount(CallType::SetBackBufferTarget) == 4u);
+		cache.SetDepthOnlyTarget();
+		cache.SetBackBufferTarget();
+		CHECK(recording.GetCallCount(CallType::SetBackBufferTarget) == 5u);
+	}
+
+	void TestInvalidateRebinds()
+	{
+		RecordingRenderDevice recording;
+		StateCachingDevice cache(recording);
+		BindAll(cache);
+		// the device used behind the cache's back
+		recording.SetVertexShader(VertexShaderHandle { 9u });
+		cache.Invalidate();
+		BindAll(cache);
+		CHECK(Binds(recording) == 2u * BindAllCount + 1u);
+		CHECK(cache.GetCurrentCounters().issued == 2u * BindAllCount);
+		CHECK(cache.GetCurrentCounters().filtered == 0u);
+		CHECK(recording.GetFrameCalls().back().type == CallType::SetViewport);
+	}
+}
+
+int main()
+{
+	TestFirstBindPassesThrough();
+	TestRedundantBindIsFiltered();
+	TestTargetForgotten();
+	TestInvalidateRebinds();
+	return TestResult();
+}
@@ -0,0 +1,136 @@
+#include "Graphics.h"
+#include "RecordingRenderDevice.h"
+#include "Test.h"
+#include <memory>
+
+namespace
+{
+	using CallType = RecordingRenderDevice::CallType;
+
+	// remembers the last viewport, which the recording device does not
+	class ViewportRecordingDevice : public RecordingRenderDevice
+	{
+	public:
+		using RecordingRenderDevice::RecordingRenderDevice;
+
+		void SetViewport(const Viewport& viewport) override
+		{
+			lastViewport = viewport;
+			RecordingRenderDevice::SetViewport(viewport);
+		}
+
+		Viewport lastViewport;
+	};
+
+	void TestBurstResizesOnce()
+	{
+		RecordingRenderDevice device(1280u, 720u);
+		SwapChainResizer resizer;
+		resizer.Request(800u, 600u);
+		resizer.Request(1024u, 768u);
+		resizer.Request(1600u, 900u);
+		CHECK(resizer.IsPending());
+		CHECK(device.GetCallCount(CallType::ResizeSwapChain) == 0u);
+
+		CHECK(resizer.Apply(device));
+		CHECK(!resizer.IsPending());
+		CHECK(device.GetCallCount(CallType::ResizeSwapChain) == 1u);
+		CHECK(device.GetDesc().width == 1600u && device.GetDesc().height == 900u);
+		CHECK(resizer.GetStats().requests == 3u);
+		CHECK(resizer.GetStats().resizes == 1u);
+
+		// nothing new requested
+		CHECK(!resizer.Apply(device));
+		CHECK(device.GetCallCount(CallType::ResizeSwapChain) == 1u);
+	}
+
+	void TestSameSizeIsNoOp()
+	{
+		RecordingRenderDevice device(1280u, 720u);
+		SwapChainResizer resizer;
+		resizer.Request(1280u, 720u);
+		CHECK(!resizer.Apply(device));
+		CHECK(!resizer.IsPending());
+		CHECK(device.GetCallCount(CallType::ResizeSwapChain) == 0u);
+
+		// a burst that ends where it started
+		resizer.Request(640u, 480u);
+		resizer.Request(1280u, 720u);
+		CHECK(!resizer.Apply(device));
+		CHECK(device.GetCallCount(CallType::ResizeSwapChain) == 0u);
+		CHECK(resizer.GetStats().resizes == 0u);
+	}
+
+	void TestMinimizedIsIgnored()
+	{
+		RecordingRenderDevice device(1280u, 720u);
+		SwapChainResizer resizer;
+		resizer.Request(0u, 0u);
+		CHECK(resizer.IsMinimized());
+		CHECK(!resizer.Apply(device));
+		CHECK(device.GetCallCount(CallType::ResizeSwapChain) == 0u);
+		CHECK(device.GetDesc().width == 1280u && device.GetDesc().height == 720u);
+
+		// a zero width alone counts too
+		resizer.Request(0u, 500u);
+		CHECK(!resizer.Apply(device));
+		CHECK(device.GetCallCount(CallType::ResizeSwapChain) == 0u);
+
+		// restored to a new size
+		resizer.Request(1024u, 576u);
+		CHECK(!resizer.IsMinimized());
+		CHECK(resizer.Apply(device));
+		CHECK(device.GetDesc().width == 1024u && device.GetDesc().height == 576u);
+	}
+
+	// Graphics applies the resize after presenting; the next frame binds the
+	// back buffer again and sets a viewport of the new size
+	void TestRebindAfterApply()
+	{
+		auto pDevice = std::make_unique<ViewportRecordingDevice>(1280u, 720u);
+		ViewportRecordingDevice& device = *pDevice;
+		Graphics gfx(std::move(pDevice));
+		gfx.ClearBuffer(0.0f, 0.0f, 0.0f);
+		gfx.DrawTestTriangle();
+		gfx.EndFrame();
+		CHECK(device.lastViewport.width == 1280.0f && device.lastViewport.height == 720.0f);
+
+		device.ResetFrame();
+		gfx.Resize(800u, 600u);
+		gfx.Resize(1000u, 700u);
+		gfx.ClearBuffer(0.0f, 0.0f, 0.0f);
+		gfx.DrawTestTriangle();
+		gfx.EndFrame();
+		CHECK(device.GetCallCount(CallType::ResizeSwapChain) == 1u);
+		CHECK(!device.GetFrameCalls().empty() && device.GetFrameCalls().back().type == CallType::ResizeSwapChain);
+		CHECK(gfx.GetResizeStats().resizes == 1u);
+
+		device.ResetFrame();
+		gfx.ClearBuffer(0.0f, 0.0f, 0.0f);
+		gfx.DrawTestTriangle();
+		gfx.EndFrame();
+		bool targetBound = false;
+		bool viewportSet = false;
+		bool drawnAfterBoth = false;
+		for (const RecordingRenderDevice::Call& call : device.GetFrameCalls())
+		{
+			targetBound = targetBound || call.type == CallType::SetBackBufferTarget;
+			viewportSet = viewportSet || call.type == CallType::SetViewport;
+			drawnAfterBoth = drawnAfterBoth || (call.type == CallType::DrawIndexed && targetBound && viewportSet);
+		}
+		CHECK(targetBound);
+		CHECK(viewportSet);
+		CHECK(drawnAfterBoth);
+		CHECK(device.lastViewport.width == 1000.0f && device.lastViewport.height == 700.0f);
+		CHECK(device.GetCallCount(CallType::ResizeSwapChain) == 1u);
+	}
+}
+
+int main()
+{
+	TestBurstResizesOnce();
+	TestSameSizeIsNoOp();
+	TestMinimizedIsIgnored();
+	TestRebindAfterApply();
+	return TestResult();
+}
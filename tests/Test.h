@@ -0,0 +1,44 @@
+#pragma once
+#include <cmath>
+#include <cstdio>
+
+// Checks for the test executables. A failed check prints where and what
+// failed and the test goes on; main() returns TestResult(), so ctest sees
+// every failure of a run at once.
+//
+//	int main()
+//	{
+//		CHECK(ring.Allocate(16u, 16u) == 0u);
+//		CHECK_NEAR(decoded, original, 1e-3f);
+//		return TestResult();
+//	}
+
+inline int& TestFailures() noexcept
+{
+	static int failures = 0;
+	return failures;
+}
+
+inline bool TestCheck(bool passed, const char* expression, const char* file, int line) noexcept
+{
+	if (!passed)
+	{
+		std::fprintf(stderr, "%s(%d): CHECK failed: %s\n", file, line, expression);
+		TestFailures()++;
+	}
+	return passed;
+}
+
+inline int TestResult() noexcept
+{
+	if (TestFailures() != 0)
+	{
+		std::fprintf(stderr, "%d check(s) failed\n", TestFailures());
+		return 1;
+	}
+	return 0;
+}
+
+#define CHECK(expression) TestCheck(bool(expression), #expression, __FILE__, __LINE__)
+#define CHECK_NEAR(a, b, tolerance) TestCheck(std::fabs(double(a) - double(b)) <= double(tolerance), \
+											  #a " ~ " #b " within " #tolerance, __FILE__, __LINE__)
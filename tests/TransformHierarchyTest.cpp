@@ -0,0 +1,213 @@
+#include "TransformHierarchy.h"
+#include "Test.h"
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	using Node = TransformHierarchy::Node;
+
+	// the hierarchy as plain per node records, recomputed completely and in
+	// handle order every time; a parent is always added before its children
+	struct Reference
+	{
+		struct Record
+		{
+			Node	parent;
+			Vec3	translation;
+			Quat	rotation;
+			Vec3	scale;
+		};
+		std::vector<Record>	nodes;
+		std::vector<Mat4>	worlds;
+
+		void Recompute()
+		{
+			worlds.resize(nodes.size());
+			for (size_t i = 0u; i < nodes.size(); i++)
+			{
+				const Record& r = nodes[i];
+				const Mat4 local = Mat4::Transform(r.translation, r.rotation, r.scale);
+				worlds[i] = r.parent == TransformHierarchy::InvalidNode ? local : worlds[r.parent] * local;
+			}
+		}
+	};
+
+	// same float operations in the same order, so the results are exact
+	bool SameMatrix(const Mat4& a, const Mat4& b)
+	{
+		float fa[16], fb[16];
+		a.Store(fa);
+		b.Store(fb);
+		return std::memcmp(fa, fb, sizeof(fa)) == 0;
+	}
+
+	class Scene
+	{
+	public:
+		Scene(unsigned int threads)
+			: jobs(threads), hierarchy(jobs)
+		{
+		}
+
+		void Add(Node parent, Vec3 translation, Quat rotation, Vec3 scale)
+		{
+			const Node node = hierarchy.AddNode(parent, translation, rotation, scale);
+			CHECK(node == Node(reference.nodes.size()));
+			reference.nodes.push_back({ parent, translation, rotation, scale });
+		}
+
+		bool Matches()
+		{
+			hierarchy.Update();
+			reference.Recompute();
+			bool same = hierarchy.GetNodeCount() == reference.nodes.size();
+			for (Node node = 0u; same && node < Node(reference.nodes.size()); node++)
+			{
+				same = SameMatrix(hierarchy.GetWorld(node), reference.worlds[node]) &&
+					   hierarchy.GetParent(node) == reference.nodes[node].parent;
+			}
+			return same;
+		}
+
+		JobSystem			jobs;
+		TransformHierarchy	hierarchy;
+		Reference			reference;
+	};
+
+	Vec3 RandomTranslation(std::mt19937& rng)
+	{
+		std::uniform_real_distribution<float> value(-2.0f, 2.0f);
+		return Vec3(value(rng), value(rng), value(rng));
+	}
+
+	Quat RandomRotation(std::mt19937& rng)
+	{
+		std::normal_distribution<float> normal;
+		return Normalize(Quat(normal(rng), normal(rng), normal(rng), normal(rng)));
+	}
+
+	Vec3 RandomScale(std::mt19937& rng)
+	{
+		std::uniform_real_distribution<float> value(0.9f, 1.1f);
+		return Vec3(value(rng), value(rng), value(rng));
+	}
+
+	// Random edits against the full recompute. There is no reparenting,
+	// nodes added below arbitrary earlier ones stand in for it: they break
+	// the depth first order and the next Update() reorders every node.
+	void TestAgainstRecompute(unsigned int threads)
+	{
+		std::mt19937 rng(7u);
+		Scene scene(threads);
+		TransformHierarchy& hierarchy = scene.hierarchy;
+
+		// a few roots, subtrees large enough to be split into jobs; half the
+		// nodes extend the last chain, the rest go below any earlier node
+		constexpr Node NodeCount = 20000u;
+		for (Node node = 0u; node < NodeCount; node++)
+		{
+			Node parent = TransformHierarchy::InvalidNode;
+			if (node >= 3u)
+			{
+				parent = rng() % 2u == 0u ? node - 1u : Node(rng() % node);
+			}
+			scene.Add(parent, RandomTranslation(rng), RandomRotation(rng), RandomScale(rng));
+		}
+		CHECK(scene.Matches());
+		CHECK(hierarchy.GetStats().reorders == 1u);
+
+		for (int round = 0; round < 20; round++)
+		{
+			// few edits take the sorted path, many the scan of all flags
+			const size_t edits = round % 4 == 3 ? NodeCount / 2u : 1u + rng() % 100u;
+			for (size_t e = 0u; e < edits; e++)
+			{
+				const Node node = Node(rng() % scene.reference.nodes.size());
+				Reference::Record& record = scene.reference.nodes[node];
+				switch (rng() % 3u)
+				{
+				case 0u:
+					record.translation = RandomTranslation(rng);
+					hierarchy.SetTranslation(node, record.translation);
+					break;
+				case 1u:
+					record.rotation = RandomRotation(rng);
+					hierarchy.SetRotation(node, record.rotation);
+					break;
+				default:
+					record.translation = RandomTranslation(rng);
+					record.rotation = RandomRotation(rng);
+					record.scale = RandomScale(rng);
+					hierarchy.SetLocal(node, record.translation, record.rotation, record.scale);
+					break;
+				}
+			}
+			// new nodes every other round, in or out of order
+			if (round % 2 == 1)
+			{
+				for (int a = 0; a < 50; a++)
+				{
+					const Node count = Node(scene.reference.nodes.size());
+					const Node parent = a % 5 == 0 ? TransformHierarchy::InvalidNode : Node(rng() % count);
+					scene.Add(parent, RandomTranslation(rng), RandomRotation(rng), RandomScale(rng));
+				}
+			}
+			CHECK(scene.Matches());
+		}
+		CHECK(hierarchy.GetStats().reorders > 1u);
+
+		// nothing flagged, nothing computed
+		const uint64_t updated = hierarchy.GetStats().nodesUpdated;
+		CHECK(scene.Matches());
+		CHECK(hierarchy.GetStats().nodesUpdated == updated);
+
+		// a leaf moves alone, a root with its whole subtree
+		const Node leaf = Node(scene.reference.nodes.size() - 1u);
+		scene.Add(leaf, RandomTranslation(rng), RandomRotation(rng), RandomScale(rng));
+		CHECK(scene.Matches());
+		const uint64_t before = hierarchy.GetStats().nodesUpdated;
+		const Node child = Node(scene.reference.nodes.size() - 1u);
+		scene.reference.nodes[child].translation = RandomTranslation(rng);
+		hierarchy.SetTranslation(child, scene.reference.nodes[child].translation);
+		CHECK(scene.Matches());
+		CHECK(hierarchy.GetStats().nodesUpdated == before + 1u);
+
+		scene.reference.nodes[0].rotation = RandomRotation(rng);
+		hierarchy.SetRotation(0u, scene.reference.nodes[0].rotation);
+		CHECK(scene.Matches());
+	}
+
+	// the split into jobs does not change a single bit
+	void TestThreadCountIndependent()
+	{
+		std::mt19937 rng(11u);
+		Scene serial(1u), parallel(4u);
+		for (Node node = 0u; node < 30000u; node++)
+		{
+			const Node parent = node == 0u ? TransformHierarchy::InvalidNode : Node(rng() % node);
+			const Vec3 translation = RandomTranslation(rng);
+			const Quat rotation = RandomRotation(rng);
+			const Vec3 scale = RandomScale(rng);
+			serial.Add(parent, translation, rotation, scale);
+			parallel.Add(parent, translation, rotation, scale);
+		}
+		CHECK(serial.Matches());
+		CHECK(parallel.Matches());
+		bool same = true;
+		for (Node node = 0u; node < 30000u; node++)
+		{
+			same = same && SameMatrix(serial.hierarchy.GetWorld(node), parallel.hierarchy.GetWorld(node));
+		}
+		CHECK(same);
+	}
+}
+
+int main()
+{
+	TestAgainstRecompute(1u);
+	TestAgainstRecompute(4u);
+	TestThreadCountIndependent();
+	return TestResult();
+}
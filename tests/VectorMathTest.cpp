@@ -0,0 +1,442 @@
+#include "VectorMath.h"
+#include "Test.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+// The math is checked against plain double precision code, so every
+// backend (run the test in an AVX2, SSE2 and a GENIX_SIMD=Scalar build)
+// is held to the same reference.
+
+namespace
+{
+	struct RefMat
+	{
+		double m[16];
+	};
+
+	RefMat ToRef(const Mat4& matrix)
+	{
+		float f[16];
+		matrix.Store(f);
+		RefMat r;
+		for (int i = 0; i < 16; i++)
+		{
+			r.m[i] = f[i];
+		}
+		return r;
+	}
+
+	RefMat Multiply(const RefMat& a, const RefMat& b)
+	{
+		RefMat r;
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				double sum = 0.0;
+				for (int k = 0; k < 4; k++)
+				{
+					sum += a.m[4 * i + k] * b.m[4 * k + j];
+				}
+				r.m[4 * i + j] = sum;
+			}
+		}
+		return r;
+	}
+
+	// Gauss-Jordan with partial pivoting
+	RefMat Invert(RefMat a)
+	{
+		RefMat r = {};
+		for (int i = 0; i < 4; i++)
+		{
+			r.m[5 * i] = 1.0;
+		}
+		for (int column = 0; column < 4; column++)
+		{
+			int pivot = column;
+			for (int row = column + 1; row < 4; row++)
+			{
+				if (std::fabs(a.m[4 * row + column]) > std::fabs(a.m[4 * pivot + column]))
+					pivot = row;
+			}
+			for (int k = 0; k < 4; k++)
+			{
+				std::swap(a.m[4 * column + k], a.m[4 * pivot + k]);
+				std::swap(r.m[4 * column + k], r.m[4 * pivot + k]);
+			}
+			const double scale = 1.0 / a.m[4 * column + column];
+			for (int k = 0; k < 4; k++)
+			{
+				a.m[4 * column + k] *= scale;
+				r.m[4 * column + k] *= scale;
+			}
+			for (int row = 0; row < 4; row++)
+			{
+				const double f = a.m[4 * row + column];
+				if (row == column || f == 0.0)
+					continue;
+				for (int k = 0; k < 4; k++)
+				{
+					a.m[4 * row + k] -= f * a.m[4 * column + k];
+					r.m[4 * row + k] -= f * r.m[4 * column + k];
+				}
+			}
+		}
+		return r;
+	}
+
+	bool Near(const Mat4& matrix, const RefMat& ref, double tolerance)
+	{
+		const RefMat m = ToRef(matrix);
+		for (int i = 0; i < 16; i++)
+		{
+			if (!(std::fabs(m.m[i] - ref.m[i]) <= tolerance * std::max(1.0, std::fabs(ref.m[i]))))
+				return false;
+		}
+		return true;
+	}
+
+	Mat4 RandomMatrix(std::mt19937& rng)
+	{
+		std::uniform_real_distribution<float> value(-2.0f, 2.0f);
+		float f[16];
+		for (float& e : f)
+		{
+			e = value(rng);
+		}
+		return Mat4::Load(f);
+	}
+
+	Quat RandomRotation(std::mt19937& rng)
+	{
+		std::normal_distribution<float> normal;
+		return Normalize(Quat(normal(rng), normal(rng), normal(rng), normal(rng)));
+	}
+
+	Vec3 RandomPoint(std::mt19937& rng, float range)
+	{
+		std::uniform_real_distribution<float> value(-range, range);
+		return Vec3(value(rng), value(rng), value(rng));
+	}
+
+	// Hamilton product, (x, y, z, w) with w real
+	void RefQuatMultiply(const double a[4], const double b[4], double r[4])
+	{
+		r[0] = a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1];
+		r[1] = a[3] * b[1] - a[0] * b[2] + a[1] * b[3] + a[2] * b[0];
+		r[2] = a[3] * b[2] + a[0] * b[1] - a[1] * b[0] + a[2] * b[3];
+		r[3] = a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2];
+	}
+
+	void ToRef(Quat q, double r[4])
+	{
+		r[0] = q.X();
+		r[1] = q.Y();
+		r[2] = q.Z();
+		r[3] = q.W();
+	}
+
+	void TestLoadStore()
+	{
+		const Float4 source = { 1.0f, -2.0f, 3.5f, 4.25f };
+		Float4 vector = {}, rotation = {};
+		Vec4::Load(source).Store(vector);
+		Quat::Load(source).Store(rotation);
+		CHECK(vector.x == 1.0f && vector.y == -2.0f && vector.z == 3.5f && vector.w == 4.25f);
+		CHECK(rotation.x == 1.0f && rotation.y == -2.0f && rotation.z == 3.5f && rotation.w == 4.25f);
+
+		// Vec3 leaves the float after z alone
+		float f[4] = { 0.0f, 0.0f, 0.0f, 7.0f };
+		Vec3(1.0f, 2.0f, 3.0f).Store(f);
+		CHECK(f[0] == 1.0f && f[1] == 2.0f && f[2] == 3.0f && f[3] == 7.0f);
+	}
+
+	void TestMatrixProducts()
+	{
+		std::mt19937 rng(1u);
+		for (int n = 0; n < 200; n++)
+		{
+			const Mat4 a = RandomMatrix(rng);
+			const Mat4 b = RandomMatrix(rng);
+			CHECK(Near(a * b, Multiply(ToRef(a), ToRef(b)), 1e-5));
+
+			const Mat4 t = Transpose(a);
+			const RefMat ra = ToRef(a), rt = ToRef(t);
+			bool transposed = true;
+			for (int i = 0; i < 4; i++)
+			{
+				for (int j = 0; j < 4; j++)
+					transposed = transposed && rt.m[4 * i + j] == ra.m[4 * j + i];
+			}
+			CHECK(transposed);
+
+			const Vec3 p = RandomPoint(rng, 10.0f);
+			const Vec4 q = a * Vec4(p.X(), p.Y(), p.Z(), 1.0f);
+			const Vec3 point = TransformPoint(a, p);
+			const Vec3 vector = TransformVector(a, p);
+			const double in[3] = { p.X(), p.Y(), p.Z() };
+			double refPoint[4], refVector[3];
+			for (int i = 0; i < 4; i++)
+			{
+				const double d = ra.m[4 * i] * in[0] + ra.m[4 * i + 1] * in[1] + ra.m[4 * i + 2] * in[2];
+				refPoint[i] = d + ra.m[4 * i + 3];
+				if (i < 3)
+					refVector[i] = d;
+			}
+			CHECK_NEAR(q.X(), refPoint[0], 1e-4);
+			CHECK_NEAR(q.Y(), refPoint[1], 1e-4);
+			CHECK_NEAR(q.Z(), refPoint[2], 1e-4);
+			CHECK_NEAR(q.W(), refPoint[3], 1e-4);
+			CHECK_NEAR(point.X(), refPoint[0], 1e-4);
+			CHECK_NEAR(point.Y(), refPoint[1], 1e-4);
+			CHECK_NEAR(point.Z(), refPoint[2], 1e-4);
+			CHECK_NEAR(vector.X(), refVector[0], 1e-4);
+			CHECK_NEAR(vector.Y(), refVector[1], 1e-4);
+			CHECK_NEAR(vector.Z(), refVector[2], 1e-4);
+		}
+	}
+
+	void TestInverse()
+	{
+		std::mt19937 rng(2u);
+		std::uniform_real_distribution<float> scale(0.25f, 4.0f);
+		for (int n = 0; n < 200; n++)
+		{
+			// affine transforms as the scene has them, and projections
+			const Mat4 affine = Mat4::Transform(RandomPoint(rng, 100.0f), RandomRotation(rng),
+												Vec3(scale(rng), scale(rng), scale(rng)));
+			const Mat4 projection = Mat4::Perspective(0.5f + scale(rng) * 0.5f, scale(rng), 0.1f, 1000.0f) * affine;
+			for (const Mat4& m : { affine, projection })
+			{
+				float determinant = 0.0f;
+				const Mat4 inverse = Inverse(m, &determinant);
+				const RefMat ref = ToRef(m);
+				CHECK(Near(inverse, Invert(ref), 1e-4));
+
+				// the determinant is the product of the pivots
+				RefMat a = ref;
+				double refDeterminant = 1.0;
+				for (int column = 0; column < 4; column++)
+				{
+					int pivot = column;
+					for (int row = column + 1; row < 4; row++)
+					{
+						if (std::fabs(a.m[4 * row + column]) > std::fabs(a.m[4 * pivot + column]))
+							pivot = row;
+					}
+					if (pivot != column)
+					{
+						for (int k = 0; k < 4; k++)
+							std::swap(a.m[4 * column + k], a.m[4 * pivot + k]);
+						refDeterminant = -refDeterminant;
+					}
+					refDeterminant *= a.m[4 * column + column];
+					for (int row = column + 1; row < 4; row++)
+					{
+						const double f = a.m[4 * row + column] / a.m[4 * column + column];
+						for (int k = column; k < 4; k++)
+							a.m[4 * row + k] -= f * a.m[4 * column + k];
+					}
+				}
+				CHECK_NEAR(determinant, refDeterminant, 1e-4 * std::max(1.0, std::fabs(refDeterminant)));
+			}
+		}
+	}
+
+	void TestQuaternions()
+	{
+		std::mt19937 rng(3u);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		for (int n = 0; n < 200; n++)
+		{
+			const Quat a = RandomRotation(rng);
+			const Quat b = RandomRotation(rng);
+			double ra[4], rb[4], product[4], r[4];
+			ToRef(a, ra);
+			ToRef(b, rb);
+			RefQuatMultiply(ra, rb, product);
+			ToRef(a * b, r);
+			for (int i = 0; i < 4; i++)
+			{
+				CHECK_NEAR(r[i], product[i], 1e-5);
+			}
+
+			// Rotate agrees with the rotation matrix
+			const Vec3 p = RandomPoint(rng, 10.0f);
+			const Vec3 rotated = Rotate(a, p);
+			const Vec3 byMatrix = TransformPoint(Mat4::Rotation(a), p);
+			CHECK_NEAR(rotated.X(), byMatrix.X(), 1e-4);
+			CHECK_NEAR(rotated.Y(), byMatrix.Y(), 1e-4);
+			CHECK_NEAR(rotated.Z(), byMatrix.Z(), 1e-4);
+			CHECK_NEAR(Length(rotated), Length(p), 1e-4);
+
+			// Slerp against the textbook formula in double, on the shorter arc
+			const float t = unit(rng);
+			double cosAngle = ra[0] * rb[0] + ra[1] * rb[1] + ra[2] * rb[2] + ra[3] * rb[3];
+			double to[4] = { rb[0], rb[1], rb[2], rb[3] };
+			if (cosAngle < 0.0)
+			{
+				cosAngle = -cosAngle;
+				for (double& e : to)
+					e = -e;
+			}
+			const double angle = std::acos(std::min(cosAngle, 1.0));
+			const double wa = std::sin((1.0 - t) * angle) / std::sin(angle);
+			const double wb = std::sin(t * angle) / std::sin(angle);
+			ToRef(Slerp(a, b, t), r);
+			for (int i = 0; i < 4; i++)
+			{
+				CHECK_NEAR(r[i], wa * ra[i] + wb * to[i], 1e-4);
+			}
+			CHECK_NEAR(Dot(Slerp(a, b, t), Slerp(a, b, t)), 1.0, 1e-5);
+		}
+
+		// the ends, and nearly equal rotations that take the linear fallback
+		const Quat a = Quat::RotationAxis(Vec3(0.0f, 1.0f, 0.0f), 0.5f);
+		const Quat b = Quat::RotationAxis(Vec3(0.0f, 1.0f, 0.0f), 0.52f);
+		double r[4], ra[4];
+		ToRef(Slerp(a, b, 0.0f), r);
+		ToRef(a, ra);
+		for (int i = 0; i < 4; i++)
+		{
+			CHECK_NEAR(r[i], ra[i], 1e-6);
+		}
+		const Quat half = Slerp(a, b, 0.5f);
+		ToRef(half, r);
+		CHECK_NEAR(r[1], std::sin(0.5 * 0.51), 1e-5);
+		CHECK_NEAR(r[3], std::cos(0.5 * 0.51), 1e-5);
+		// -b is the same rotation, the shorter arc is taken
+		const Quat negated(-b.X(), -b.Y(), -b.Z(), -b.W());
+		double rn[4];
+		ToRef(Slerp(a, negated, 0.5f), rn);
+		for (int i = 0; i < 4; i++)
+		{
+			CHECK_NEAR(rn[i], r[i], 1e-6);
+		}
+	}
+
+	void TestPerspective()
+	{
+		const float fovY = 1.0f, aspect = 16.0f / 9.0f, nearZ = 0.5f, farZ = 200.0f;
+		const double yScale = 1.0 / std::tan(0.5 * fovY);
+		for (const float far : { farZ, INFINITY })
+		{
+			const Mat4 projection = Mat4::Perspective(fovY, aspect, nearZ, far);
+			for (const float z : { nearZ, 1.0f, 10.0f, 150.0f, farZ })
+			{
+				const Vec4 clip = projection * Vec4(1.0f, -2.0f, z, 1.0f);
+				CHECK_NEAR(clip.W(), z, 1e-6);
+				CHECK_NEAR(clip.X(), yScale / aspect, 1e-5);
+				CHECK_NEAR(clip.Y(), -2.0 * yScale, 1e-5);
+				// reversed Z: 1 at the near plane, 0 at the far one (or at
+				// infinity)
+				const double depth = std::isinf(far) ? nearZ / double(z) : nearZ * (far - double(z)) / (double(z) * (far - nearZ));
+				CHECK_NEAR(clip.Z() / clip.W(), depth, 1e-5);
+			}
+		}
+	}
+
+	void TestLookAt()
+	{
+		std::mt19937 rng(4u);
+		for (int n = 0; n < 100; n++)
+		{
+			const Vec3 eye = RandomPoint(rng, 50.0f);
+			const Vec3 target = eye + RandomPoint(rng, 20.0f) + Vec3(0.0f, 0.0f, 0.5f);
+			const Mat4 view = Mat4::LookAt(eye, target, Vec3(0.0f, 1.0f, 0.0f));
+
+			// the eye goes to the origin, the target onto +z
+			const Vec3 origin = TransformPoint(view, eye);
+			const Vec3 forward = TransformPoint(view, target);
+			CHECK_NEAR(Length(origin), 0.0, 1e-4);
+			CHECK_NEAR(forward.X(), 0.0, 1e-4);
+			CHECK_NEAR(forward.Y(), 0.0, 1e-4);
+			CHECK_NEAR(forward.Z(), Length(target - eye), 1e-4);
+
+			// rows are orthonormal, up stays in the upper half
+			const RefMat m = ToRef(view);
+			for (int i = 0; i < 3; i++)
+			{
+				for (int j = 0; j < 3; j++)
+				{
+					const double dot = m.m[4 * i] * m.m[4 * j] + m.m[4 * i + 1] * m.m[4 * j + 1] + m.m[4 * i + 2] * m.m[4 * j + 2];
+					CHECK_NEAR(dot, i == j ? 1.0 : 0.0, 1e-5);
+				}
+			}
+			CHECK(TransformVector(view, Vec3(0.0f, 1.0f, 0.0f)).Y() >= 0.0f);
+		}
+	}
+
+	void TestBatches()
+	{
+		std::mt19937 rng(5u);
+		const Mat4 m = Mat4::Perspective(1.0f, 1.5f, 0.1f, 100.0f) * RandomMatrix(rng);
+
+		// 13 is a full block and a partial one for every SIMD width
+		constexpr size_t Count = 13u;
+		float x[Count], y[Count], z[Count], outX[Count], outY[Count], outZ[Count], outW[Count];
+		for (size_t i = 0u; i < Count; i++)
+		{
+			const Vec3 p = RandomPoint(rng, 10.0f);
+			x[i] = p.X();
+			y[i] = p.Y();
+			z[i] = p.Z();
+		}
+		TransformPoints(m, x, y, z, Count, outX, outY, outZ, outW);
+		for (size_t i = 0u; i < Count; i++)
+		{
+			const Vec4 r = m * Vec4(x[i], y[i], z[i], 1.0f);
+			CHECK_NEAR(outX[i], r.X(), 1e-4);
+			CHECK_NEAR(outY[i], r.Y(), 1e-4);
+			CHECK_NEAR(outZ[i], r.Z(), 1e-4);
+			CHECK_NEAR(outW[i], r.W(), 1e-4);
+		}
+
+		// Mat4x8 round trip and products, one batch and a remainder
+		Mat4 a[Count], b[Count], products[Count], single[Count];
+		for (size_t i = 0u; i < Count; i++)
+		{
+			a[i] = RandomMatrix(rng);
+			b[i] = RandomMatrix(rng);
+		}
+		const Mat4x8 batch = Mat4x8::Load(a);
+		Mat4 stored[SimdWidth];
+		batch.Store(stored);
+		bool same = true;
+		for (int i = 0; i < SimdWidth; i++)
+		{
+			const RefMat s = ToRef(stored[i]), r = ToRef(a[i]);
+			for (int e = 0; e < 16; e++)
+				same = same && s.m[e] == r.m[e];
+		}
+		CHECK(same);
+
+		MultiplyMatrices(a, b, products, Count);
+		MultiplyMatrices(a[0], b, single, Count);
+		for (size_t i = 0u; i < Count; i++)
+		{
+			CHECK(Near(products[i], Multiply(ToRef(a[i]), ToRef(b[i])), 1e-5));
+			CHECK(Near(single[i], Multiply(ToRef(a[0]), ToRef(b[i])), 1e-5));
+		}
+		const Mat4x8 product = Mat4x8::Load(a) * Mat4x8::Load(b);
+		product.Store(stored);
+		for (int i = 0; i < SimdWidth; i++)
+		{
+			CHECK(Near(stored[i], Multiply(ToRef(a[i]), ToRef(b[i])), 1e-5));
+		}
+	}
+}
+
+int main()
+{
+	TestLoadStore();
+	TestMatrixProducts();
+	TestInverse();
+	TestQuaternions();
+	TestPerspective();
+	TestLookAt();
+	TestBatches();
+	return TestResult();
+}
@@ -0,0 +1,249 @@
+#include "VertexCompression.h"
+#include "Test.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// in radians; atan2 stays accurate for the tiny angles acos loses
+	float AngleBetween(const float a[3], const float b[3])
+	{
+		const double cross[3] = { double(a[1]) * b[2] - double(a[2]) * b[1], double(a[2]) * b[0] - double(a[0]) * b[2],
+								  double(a[0]) * b[1] - double(a[1]) * b[0] };
+		const double dot = double(a[0]) * b[0] + double(a[1]) * b[1] + double(a[2]) * b[2];
+		return float(std::atan2(std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]), dot));
+	}
+
+	void RandomUnit(std::mt19937& rng, float out[3])
+	{
+		std::normal_distribution<float> normal;
+		float length = 0.0f;
+		while (length < 1e-3f)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				out[c] = normal(rng);
+			}
+			length = std::sqrt(out[0] * out[0] + out[1] * out[1] + out[2] * out[2]);
+		}
+		for (int c = 0; c < 3; c++)
+		{
+			out[c] /= length;
+		}
+	}
+
+	// every half that is not NaN comes back bit for bit through float
+	void TestHalfRoundTrip()
+	{
+		bool exact = true;
+		for (uint32_t bits = 0u; bits < 0x10000u; bits++)
+		{
+			const Half half = { uint16_t(bits) };
+			if ((bits & 0x7C00u) == 0x7C00u && (bits & 0x03FFu) != 0u)
+			{
+				CHECK(std::isnan(HalfToFloat(half)));
+				continue;
+			}
+			exact = exact && FloatToHalf(HalfToFloat(half)).bits == half.bits;
+		}
+		CHECK(exact);
+		CHECK(HalfToFloat(FloatToHalf(1.0f)) == 1.0f);
+		CHECK(HalfToFloat(FloatToHalf(65504.0f)) == 65504.0f);
+		CHECK(std::isinf(HalfToFloat(FloatToHalf(70000.0f))));
+		CHECK(std::isnan(HalfToFloat(FloatToHalf(std::nanf("")))));
+		// halfway between 1 and the next half rounds to even, down to 1
+		CHECK(HalfToFloat(FloatToHalf(1.0f + 1.0f / 2048.0f)) == 1.0f);
+		CHECK(HalfToFloat(FloatToHalf(1.0f + 3.0f / 2048.0f)) == 1.0f + 2.0f / 1024.0f);
+		// the smallest denormal
+		CHECK(HalfToFloat(FloatToHalf(std::ldexp(1.0f, -24))) == std::ldexp(1.0f, -24));
+	}
+
+	void TestOctahedral()
+	{
+		// the axes land on corners and edge midpoints, and come back exactly
+		const float axes[6][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+		for (const auto& axis : axes)
+		{
+			float encoded[2];
+			float decoded[3];
+			VertexCompressor::EncodeOctahedral(axis, encoded);
+			CHECK(std::fabs(encoded[0]) <= 1.0f && std::fabs(encoded[1]) <= 1.0f);
+			VertexCompressor::DecodeOctahedral(encoded[0], encoded[1], decoded);
+			for (int c = 0; c < 3; c++)
+			{
+				CHECK_NEAR(decoded[c], axis[c], 1e-6f);
+			}
+		}
+		// unquantized, only float rounding is lost, on both halves of the sphere
+		std::mt19937 rng(21u);
+		float worst = 0.0f;
+		for (int i = 0; i < 10000; i++)
+		{
+			float vector[3];
+			float encoded[2];
+			float decoded[3];
+			RandomUnit(rng, vector);
+			VertexCompressor::EncodeOctahedral(vector, encoded);
+			CHECK(std::fabs(encoded[0]) <= 1.0f && std::fabs(encoded[1]) <= 1.0f);
+			VertexCompressor::DecodeOctahedral(encoded[0], encoded[1], decoded);
+			worst = std::max(worst, AngleBetween(vector, decoded));
+		}
+		CHECK(worst < 1e-6f);
+	}
+
+	struct Original
+	{
+		std::vector<float>	positions;
+		std::vector<float>	normals;
+		std::vector<float>	tangents;
+		std::vector<float>	uvs;
+	};
+
+	Original MakeVertices(size_t count, float scale, uint32_t seed)
+	{
+		Original original;
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> position(-scale, 3.0f * scale);
+		std::uniform_real_distribution<float> uv(-2.0f, 6.0f);
+		std::bernoulli_distribution flip;
+		for (size_t i = 0u; i < count; i++)
+		{
+			float normal[3];
+			float tangent[3];
+			RandomUnit(rng, normal);
+			RandomUnit(rng, tangent);
+			for (int c = 0; c < 3; c++)
+			{
+				original.positions.push_back(position(rng));
+				original.normals.push_back(normal[c]);
+				original.tangents.push_back(tangent[c]);
+			}
+			original.tangents.push_back(flip(rng) ? -1.0f : 1.0f);
+			original.uvs.push_back(uv(rng));
+			original.uvs.push_back(uv(rng));
+		}
+		return original;
+	}
+
+	// decoded vertices against the originals, within what the formats can hold
+	void TestRoundTrip()
+	{
+		constexpr size_t Count = 20000u;
+		const Original original = MakeVertices(Count, 50.0f, 7u);
+		VertexCompressor::Source source;
+		source.pPositions = original.positions.data();
+		source.pNormals = original.normals.data();
+		source.pTangents = original.tangents.data();
+		source.pUvs = original.uvs.data();
+		source.vertexCount = Count;
+		const VertexCompressor::Mesh mesh = VertexCompressor::Compress(source);
+		CHECK(mesh.positions.size() == Count);
+		CHECK(mesh.attributes.size() == Count);
+		// 8 bytes for depth-only passes, 20 in all
+		CHECK(sizeof(PackedPosition) == 8u);
+		CHECK(sizeof(PackedAttributes) == 12u);
+
+		std::vector<VertexCompressor::DecodedVertex> decoded(Count);
+		VertexCompressor::Decode(mesh, 0u, Count, decoded.data());
+
+		float positionError[3] = {};
+		float normalError = 0.0f;
+		float tangentError = 0.0f;
+		float uvError = 0.0f;
+		float lengthError = 0.0f;
+		bool handedness = true;
+		for (size_t i = 0u; i < Count; i++)
+		{
+			const VertexCompressor::DecodedVertex& vertex = decoded[i];
+			for (int c = 0; c < 3; c++)
+			{
+				positionError[c] = std::max(positionError[c], std::fabs(vertex.position[c] - original.positions[i * 3u + c]));
+			}
+			normalError = std::max(normalError, AngleBetween(vertex.normal, &original.normals[i * 3u]));
+			tangentError = std::max(tangentError, AngleBetween(vertex.tangent, &original.tangents[i * 4u]));
+			lengthError = std::max(lengthError, std::fabs(std::sqrt(vertex.normal[0] * vertex.normal[0] + vertex.normal[1] * vertex.normal[1] +
+																	vertex.normal[2] * vertex.normal[2]) - 1.0f));
+			handedness = handedness && vertex.tangent[3] == original.tangents[i * 4u + 3u];
+			for (int c = 0; c < 2; c++)
+			{
+				// relative to the uv's magnitude, at least the spacing around 1
+				const float value = original.uvs[i * 2u + c];
+				uvError = std::max(uvError, std::fabs(vertex.uv[c] - value) / std::max(std::fabs(value), 1.0f));
+			}
+		}
+		for (int c = 0; c < 3; c++)
+		{
+			// half a step of 65535 over the bounds, and float rounding
+			const float rounding = 4.0f * std::numeric_limits<float>::epsilon() * (std::fabs(mesh.boundsMin[c]) + mesh.boundsExtent[c]);
+			CHECK(positionError[c] <= 0.5f * mesh.boundsExtent[c] / 65535.0f + rounding);
+		}
+		// the closest of the grid points around the exact encoding is within
+		// one and a half steps: 0.003 degrees at 16 bits, 0.7 at 8
+		CHECK(normalError < 1.5f / 32767.0f);
+		CHECK(tangentError < 1.5f / 127.0f);
+		CHECK(lengthError < 1e-6f);
+		// half floats keep 11 significant bits
+		CHECK(uvError <= 1.0f / 2048.0f);
+		CHECK(handedness);
+
+		// the shader's route: unorm stream 0 through GetDequantizeMatrix()
+		float dequantize[16];
+		VertexCompressor::GetDequantizeMatrix(mesh, dequantize);
+		bool matches = true;
+		for (size_t i = 0u; i < Count; i += 97u)
+		{
+			float unorm[4];
+			for (int c = 0; c < 4; c++)
+			{
+				unorm[c] = float(mesh.positions[i].position[c]) / 65535.0f;
+			}
+			for (int r = 0; r < 3; r++)
+			{
+				const float p = dequantize[r * 4] * unorm[0] + dequantize[r * 4 + 1] * unorm[1] + dequantize[r * 4 + 2] * unorm[2] +
+								dequantize[r * 4 + 3] * unorm[3];
+				matches = matches && std::fabs(p - decoded[i].position[r]) <= 1e-4f;
+			}
+			const float w = dequantize[12] * unorm[0] + dequantize[13] * unorm[1] + dequantize[14] * unorm[2] + dequantize[15] * unorm[3];
+			matches = matches && w == 1.0f;
+		}
+		CHECK(matches);
+
+		// a range in the middle decodes like the same vertices of the whole
+		std::vector<VertexCompressor::DecodedVertex> range(10u);
+		VertexCompressor::Decode(mesh, 1000u, range.size(), range.data());
+		CHECK(std::memcmp(range.data(), &decoded[1000], range.size() * sizeof(range[0])) == 0);
+	}
+
+	void TestMissingStreams()
+	{
+		// one position repeated: no extent, decoded exactly; no attributes
+		const float positions[] = { 2.5f, -1.0f, 7.0f, 2.5f, -1.0f, 7.0f };
+		VertexCompressor::Source source;
+		source.pPositions = positions;
+		source.vertexCount = 2u;
+		const VertexCompressor::Mesh mesh = VertexCompressor::Compress(source);
+		VertexCompressor::DecodedVertex decoded[2];
+		VertexCompressor::Decode(mesh, 0u, 2u, decoded);
+		for (const VertexCompressor::DecodedVertex& vertex : decoded)
+		{
+			CHECK(vertex.position[0] == 2.5f && vertex.position[1] == -1.0f && vertex.position[2] == 7.0f);
+			CHECK(vertex.uv[0] == 0.0f && vertex.uv[1] == 0.0f);
+			// a zero octahedral code is +z
+			CHECK_NEAR(vertex.normal[2], 1.0f, 1e-6f);
+		}
+		CHECK(VertexCompressor::Compress(VertexCompressor::Source {}).positions.empty());
+	}
+}
+
+int main()
+{
+	TestHalfRoundTrip();
+	TestOctahedral();
+	TestRoundTrip();
+	TestMissingStreams();
+	return TestResult();
+}
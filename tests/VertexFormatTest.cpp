@@ -0,0 +1,187 @@
+#include "VertexFormat.h"
+#include "DrawQueue.h"
+#include "VertexCompression.h"
+#include "Test.h"
+#include <cstring>
+#include <iterator>
+
+namespace
+{
+	// the test triangle's vertex, as Graphics has it
+	struct ColorVertex
+	{
+		Float2			pos;
+		unsigned char	color[4];
+	};
+
+	// 16 byte aligned, so the stride is larger than the members
+	struct alignas(16) PaddedVertex
+	{
+		Float3			position;
+		unsigned char	color[4];
+		int16_t			normal[2];
+	};
+
+	bool SameElement(const InputElementDesc& a, const InputElementDesc& b)
+	{
+		return std::strcmp(a.semanticName, b.semanticName) == 0 && a.semanticIndex == b.semanticIndex &&
+			   a.format == b.format && a.inputSlot == b.inputSlot && a.alignedByteOffset == b.alignedByteOffset &&
+			   a.classification == b.classification && a.instanceDataStepRate == b.instanceDataStepRate;
+	}
+}
+
+template<> struct VertexLayout<ColorVertex>
+{
+	static constexpr InputElementDesc elements[] =
+	{
+		VERTEX_ELEMENT(ColorVertex, pos, "Position", 0),
+		VERTEX_ELEMENT(ColorVertex, color, "Color", 0),
+	};
+};
+
+template<> struct VertexLayout<PaddedVertex>
+{
+	static constexpr InputElementDesc elements[] =
+	{
+		VERTEX_ELEMENT(PaddedVertex, position, "Position", 0),
+		VERTEX_ELEMENT(PaddedVertex, color, "Color", 0),
+		VERTEX_ELEMENT(PaddedVertex, normal, "Normal", 0),
+	};
+};
+
+namespace
+{
+	// the same layout as hand written descs, down to the hash
+	void TestSingleStream()
+	{
+		constexpr InputElementDesc handWritten[] =
+		{
+			{ "Position", 0, ElementFormat::R32G32_Float, 0, 0 },
+			{ "Color", 0, ElementFormat::R8G8B8A8_UNorm, 0, 8u },
+		};
+		using Format = VertexFormat<ColorVertex>;
+		CHECK(Format::stride == 12u);
+		CHECK(Format::count == std::size(handWritten));
+		for (unsigned int i = 0; i < Format::count; i++)
+		{
+			CHECK(SameElement(Format::pElements[i], handWritten[i]));
+		}
+		// constant, and equal to the hash of the run time descs
+		constexpr uint64_t hash = Format::hash;
+		CHECK(hash == HashInputElements(handWritten, 2u));
+		InputElementDesc copy[2];
+		std::memcpy(copy, handWritten, sizeof(copy));
+		CHECK(HashInputElements(copy, 2u) == hash);
+	}
+
+	void TestOffsetsAndStrides()
+	{
+		using Format = VertexFormat<PaddedVertex>;
+		CHECK(Format::stride == sizeof(PaddedVertex));
+		CHECK(Format::stride == 32u);
+		CHECK(Format::count == 3u);
+		CHECK(Format::pElements[0].alignedByteOffset == offsetof(PaddedVertex, position));
+		CHECK(Format::pElements[1].alignedByteOffset == offsetof(PaddedVertex, color));
+		CHECK(Format::pElements[2].alignedByteOffset == offsetof(PaddedVertex, normal));
+		CHECK(Format::pElements[0].format == ElementFormat::R32G32B32_Float);
+		CHECK(Format::pElements[1].format == ElementFormat::R8G8B8A8_UNorm);
+		CHECK(Format::pElements[2].format == ElementFormat::R16G16_SNorm);
+
+		// an element reaching past the stride does not fit
+		CHECK(VertexElementsFit(Format::pElements, Format::count, 20u));
+		CHECK(!VertexElementsFit(Format::pElements, Format::count, 19u));
+		const InputElementDesc outside = { "Position", 0, ElementFormat::R32G32B32A32_Float, 0, 8u };
+		CHECK(!VertexElementsFit(&outside, 1u, 16u));
+		CHECK(VertexElementsFit(&outside, 1u, 24u));
+	}
+
+	// VertexCompressor reads positions from slot 0 and the rest from slot 1,
+	// each stream at the offsets of its own struct
+	void TestMultiStream()
+	{
+		const InputElementDesc* pElements = VertexCompressor::Elements;
+		CHECK(VertexCompressor::ElementCount == 4u);
+		CHECK(pElements[0].inputSlot == 0u);
+		CHECK(pElements[0].alignedByteOffset == offsetof(PackedPosition, position));
+		CHECK(pElements[0].format == ElementFormat::R16G16B16A16_UNorm);
+		CHECK(pElements[1].inputSlot == 1u && pElements[1].alignedByteOffset == offsetof(PackedAttributes, normal));
+		CHECK(pElements[2].inputSlot == 1u && pElements[2].alignedByteOffset == offsetof(PackedAttributes, tangent));
+		CHECK(pElements[3].inputSlot == 1u && pElements[3].alignedByteOffset == offsetof(PackedAttributes, uv));
+		CHECK(pElements[3].format == ElementFormat::R16G16_Float);
+		CHECK(VertexElementsFit(pElements, 1u, sizeof(PackedPosition)));
+		CHECK(VertexElementsFit(pElements + 1, 3u, sizeof(PackedAttributes)));
+		CHECK(VertexCompressor::ElementsHash == HashInputElements(pElements, 4u));
+
+		// the depth layout is the position stream alone, with a hash of its
+		// own; the slot is part of the hash
+		using Depth = VertexFormat<PackedPosition>;
+		CHECK(Depth::stride == sizeof(PackedPosition));
+		CHECK(Depth::count == 1u);
+		CHECK(SameElement(Depth::pElements[0], pElements[0]));
+		CHECK(Depth::hash != VertexCompressor::ElementsHash);
+		InputElementDesc moved = pElements[0];
+		moved.inputSlot = 1u;
+		CHECK(HashInputElements(&moved, 1u) != Depth::hash);
+	}
+
+	// InstanceData goes to its own slot, one step per instance; Graphics
+	// lists all four elements after the test triangle's
+	void TestPerInstance()
+	{
+		const InputElementDesc* pElements = DrawQueue::InstanceElements;
+		CHECK(std::size(DrawQueue::InstanceElements) == 4u);
+		const unsigned int offsets[] = { offsetof(InstanceData, transform0), offsetof(InstanceData, transform1),
+										 offsetof(InstanceData, transform2), offsetof(InstanceData, color) };
+		for (unsigned int i = 0; i < 4u; i++)
+		{
+			CHECK(pElements[i].inputSlot == DrawQueue::InstanceSlot);
+			CHECK(pElements[i].classification == InputClassification::PerInstance);
+			CHECK(pElements[i].instanceDataStepRate == 1u);
+			CHECK(pElements[i].alignedByteOffset == offsets[i]);
+		}
+		CHECK(pElements[0].format == ElementFormat::R32G32B32A32_Float);
+		CHECK(pElements[3].format == ElementFormat::R8G8B8A8_UNorm);
+		CHECK(pElements[2].semanticIndex == 2u);
+		CHECK(VertexElementsFit(pElements, 4u, sizeof(InstanceData)));
+
+		// the same members read per vertex are a different layout
+		InputElementDesc perVertex[4];
+		std::memcpy(perVertex, pElements, sizeof(perVertex));
+		const uint64_t instanced = HashInputElements(perVertex, 4u);
+		for (InputElementDesc& e : perVertex)
+		{
+			e.classification = InputClassification::PerVertex;
+			e.instanceDataStepRate = 0u;
+		}
+		CHECK(HashInputElements(perVertex, 4u) != instanced);
+	}
+
+	void TestHashSensitivity()
+	{
+		using Format = VertexFormat<ColorVertex>;
+		InputElementDesc elements[2];
+		std::memcpy(elements, Format::pElements, sizeof(elements));
+		auto changed = [&](auto change)
+		{
+			InputElementDesc copy[2];
+			std::memcpy(copy, elements, sizeof(copy));
+			change(copy[1]);
+			return HashInputElements(copy, 2u) != Format::hash;
+		};
+		CHECK(changed([](InputElementDesc& e) { e.semanticName = "Colour"; }));
+		CHECK(changed([](InputElementDesc& e) { e.semanticIndex = 1u; }));
+		CHECK(changed([](InputElementDesc& e) { e.format = ElementFormat::R8G8B8A8_SNorm; }));
+		CHECK(changed([](InputElementDesc& e) { e.alignedByteOffset = 4u; }));
+		CHECK(HashInputElements(elements, 1u) != Format::hash);
+	}
+}
+
+int main()
+{
+	TestSingleStream();
+	TestOffsetsAndStrides();
+	TestMultiStream();
+	TestPerInstance();
+	TestHashSensitivity();
+	return TestResult();
+}